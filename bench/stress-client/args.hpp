@@ -237,6 +237,7 @@ void list_protocols() {
 #endif
 #ifdef USE_LIBMEMCACHED
     printf("libmemcached,");
+    printf("libmemcached-binary,");
 #endif
     printf("sqlite");
 }
@@ -21,6 +21,8 @@ protocol_t *server_t::connect() {
 #ifdef USE_LIBMEMCACHED
     case protocol_libmemcached:
         return new memcached_protocol_t(host);
+    case protocol_libmemcached_binary:
+        return new memcached_protocol_t(host, true);
 #endif
     case protocol_sqlite:
         return new sqlite_protocol_t(host);
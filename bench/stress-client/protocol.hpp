@@ -64,6 +64,7 @@ enum protocol_enum_t {
 #endif
 #ifdef USE_LIBMEMCACHED
     protocol_libmemcached,
+    protocol_libmemcached_binary,
 #endif
     protocol_sqlite,
 };
@@ -83,6 +84,8 @@ struct server_t {
 #ifdef USE_LIBMEMCACHED
         } else if (strcmp(name, "libmemcached") == 0) {
             return protocol_libmemcached;
+        } else if (strcmp(name, "libmemcached-binary") == 0) {
+            return protocol_libmemcached_binary;
 #endif
         } else if(strcmp(name, "sqlite") == 0) {
             return protocol_sqlite;
@@ -117,6 +120,8 @@ struct server_t {
 #ifdef USE_LIBMEMCACHED
         } else if (protocol == protocol_libmemcached) {
             printf("libmemcached");
+        } else if (protocol == protocol_libmemcached_binary) {
+            printf("libmemcached-binary");
 #endif
         } else if (protocol == protocol_sqlite) {
             printf("sqlite");
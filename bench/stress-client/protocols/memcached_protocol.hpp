@@ -7,10 +7,17 @@
 #include "protocol.hpp"
 
 struct memcached_protocol_t : public protocol_t {
-    memcached_protocol_t(const char *conn_str) {
+    /* If `binary` is true, libmemcached talks to the server using the binary
+    protocol instead of the text protocol. Multi-gets then go out as a pipeline
+    of quiet gets followed by a noop. */
+    memcached_protocol_t(const char *conn_str, bool binary = false) {
 
         memcached_create(&memcached);
 
+        if (binary) {
+            memcached_behavior_set(&memcached, MEMCACHED_BEHAVIOR_BINARY_PROTOCOL, 1);
+        }
+
         // NOTE: we don't turn on noreply behavior because the stress
         // client is designed to emulate real-world behavior, which
         // commonly requires a reply. In order to do this properly we
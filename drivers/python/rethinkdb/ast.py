@@ -244,6 +244,9 @@ class RqlQuery(object):
     def between(self, left_bound=None, right_bound=None, index=()):
         return Between(self, left_bound, right_bound, index=index)
 
+    def get_all(self, key, index=()):
+        return GetAll(self, key, index=index)
+
     def distinct(self):
         return Distinct(self)
 
@@ -552,14 +555,11 @@ class Table(RqlQuery):
     def get(self, key):
         return Get(self, key)
 
-    def get_all(self, key, index=()):
-        return GetAll(self, key, index=index)
-
-    def index_create(self, name, fundef=None):
+    def index_create(self, name, fundef=None, multi=(), projection=()):
         if fundef:
-            return IndexCreate(self, name, func_wrap(fundef))
+            return IndexCreate(self, name, func_wrap(fundef), multi=multi, projection=projection)
         else:
-            return IndexCreate(self, name)
+            return IndexCreate(self, name, multi=multi, projection=projection)
 
     def index_drop(self, name):
         return IndexDrop(self, name)
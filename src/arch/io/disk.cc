@@ -44,7 +44,7 @@ public:
     linux_disk_manager_t(linux_event_queue_t *queue, const int batch_factor, perfmon_collection_t *stats) :
         stack_stats(stats, "stack"),
         conflict_resolver(stats),
-        accounter(batch_factor),
+        accounter(batch_factor, stats),
         backend_stats(stats, "backend", accounter.producer),
         backend(queue, backend_stats.producer),
         outstanding_txn(0)
@@ -77,7 +77,8 @@ public:
     }
 
     void destroy_account(void *account) {
-        coro_t::spawn_sometime(boost::bind(&linux_disk_manager_t::delayed_destroy, this, account));
+        coro_t::spawn_sometime(boost::bind(&linux_disk_manager_t::delayed_destroy, this, account),
+                               CORO_STACK_SMALL);
     }
 
     void submit_action_to_stack_stats(action_t *a) {
@@ -86,24 +87,26 @@ public:
         stack_stats.submit(a);
     }
 
-    void submit_write(fd_t fd, const void *buf, size_t count, size_t offset, void *account, linux_iocallback_t *cb) {
+    void submit_write(fd_t fd, const void *buf, size_t count, size_t offset, void *account, ticks_t latency_target, linux_iocallback_t *cb) {
         int calling_thread = get_thread_id();
 
         action_t *a = new action_t;
         a->make_write(fd, buf, count, offset);
         a->account = static_cast<accounting_diskmgr_t::account_t*>(account);
+        a->latency_target = latency_target;
         a->cb = cb;
         a->cb_thread = calling_thread;
 
         do_on_thread(home_thread(), boost::bind(&linux_disk_manager_t::submit_action_to_stack_stats, this, a));
     }
 
-    void submit_read(fd_t fd, void *buf, size_t count, size_t offset, void *account, linux_iocallback_t *cb) {
+    void submit_read(fd_t fd, void *buf, size_t count, size_t offset, void *account, ticks_t latency_target, linux_iocallback_t *cb) {
         int calling_thread = get_thread_id();
 
         action_t *a = new action_t;
         a->make_read(fd, buf, count, offset);
         a->account = static_cast<accounting_diskmgr_t::account_t*>(account);
+        a->latency_target = latency_target;
         a->cb = cb;
         a->cb_thread = calling_thread;
 
@@ -218,18 +221,18 @@ void linux_file_t::set_size_at_least(size_t size) {
 void linux_file_t::read_async(size_t offset, size_t length, void *buf, file_account_t *account, linux_iocallback_t *callback) {
     rassert(diskmgr, "No diskmgr has been constructed (are we running without an event queue?)");
     verify_aligned_file_access(file_size, offset, length, buf);
+    file_account_t *acct = account == DEFAULT_DISK_ACCOUNT ? default_account.get() : account;
     diskmgr->submit_read(fd.get(), buf, length, offset,
-        account == DEFAULT_DISK_ACCOUNT ? default_account->get_account() : account->get_account(),
-        callback);
+        acct->get_account(), acct->get_latency_target(), callback);
 }
 
 void linux_file_t::write_async(size_t offset, size_t length, const void *buf, file_account_t *account, linux_iocallback_t *callback) {
     rassert(diskmgr, "No diskmgr has been constructed (are we running without an event queue?)");
 
     verify_aligned_file_access(file_size, offset, length, buf);
+    file_account_t *acct = account == DEFAULT_DISK_ACCOUNT ? default_account.get() : account;
     diskmgr->submit_write(fd.get(), buf, length, offset,
-        account == DEFAULT_DISK_ACCOUNT ? default_account->get_account() : account->get_account(),
-        callback);
+        acct->get_account(), acct->get_latency_target(), callback);
 }
 
 void linux_file_t::read_blocking(size_t offset, size_t length, void *buf) {
@@ -268,6 +271,10 @@ void linux_file_t::destroy_account(void *account) {
     diskmgr->destroy_account(account);
 }
 
+ticks_t linux_file_t::get_average_latency(void *account) {
+    return static_cast<accounting_diskmgr_t::account_t *>(account)->get_average_latency();
+}
+
 
 
 linux_file_t::~linux_file_t() {
@@ -74,6 +74,7 @@ public:
 
     void *create_account(int priority, int outstanding_requests_limit);
     void destroy_account(void *account);
+    ticks_t get_average_latency(void *account);
 
     ~linux_file_t();
 
@@ -1,17 +1,21 @@
 #include "arch/io/disk/accounting.hpp"
 
+#include <map>
+#include <vector>
+
 /* Each account on the `accounting_diskmgr_t` has its own
    `unlimited_fifo_queue_t` associated with it. Operations for that account
    queue up on that queue while they wait for the `accounting_queue_t` on the
    `accounting_diskmgr_t` to draw from that account. */
-struct accounting_diskmgr_eager_account_t : public semaphore_available_callback_t {
+struct accounting_diskmgr_eager_account_t : public semaphore_available_callback_t,
+                                            public accounting_queue_deadline_source_t {
     typedef accounting_diskmgr_action_t action_t;
 
     accounting_diskmgr_eager_account_t(accounting_diskmgr_t *par,
                                        int pri,
                                        int outstanding_requests_limit) :
         outstanding_requests_limiter(outstanding_requests_limit == UNLIMITED_OUTSTANDING_REQUESTS ? SEMAPHORE_NO_LIMIT : outstanding_requests_limit),
-        account(&par->queue, &queue, pri),
+        account(&par->queue, &queue, pri, this),
         accounter_lock(par->get_auto_drainer()) {
         rassert(outstanding_requests_limit == UNLIMITED_OUTSTANDING_REQUESTS || outstanding_requests_limit > 0);
     }
@@ -29,6 +33,16 @@ struct accounting_diskmgr_eager_account_t : public semaphore_available_callback_
         return &outstanding_requests_limiter;
     }
 
+    ticks_t next_pop_deadline() {
+        // Actions are queued in submission order, so only the head can be overdue
+        // before the ones behind it are. (This assumes that all actions on an account
+        // have the same latency target, which is the case.)
+        action_t *action = queue.peek();
+        return action->latency_target == 0
+            ? 0
+            : action->submit_time + action->latency_target / 2;
+    }
+
 private:
     // It would be nice if we could just use a limited_fifo_queue to
     // implement the limitation of outstanding requests.
@@ -49,10 +63,18 @@ accounting_diskmgr_account_t::accounting_diskmgr_account_t(accounting_diskmgr_t
                                                            int _pri,
                                                            int _outstanding_requests_limit)
         : par(_par), pri(_pri),
-          outstanding_requests_limit(_outstanding_requests_limit) { }
+          outstanding_requests_limit(_outstanding_requests_limit),
+          average_latency(0) {
+    for (int i = 0; i < ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS; ++i) {
+        queue_wait_histogram[i] = 0;
+    }
+}
 
 accounting_diskmgr_account_t::~accounting_diskmgr_account_t() {
     par->assert_thread();
+    if (eager_account.has()) {
+        par->accounts.remove(this);
+    }
 }
 
 void accounting_diskmgr_account_t::push(action_t *action) {
@@ -70,10 +92,33 @@ semaphore_t *accounting_diskmgr_account_t::get_outstanding_requests_limiter() {
     return eager_account->get_outstanding_requests_limiter();
 }
 
+void accounting_diskmgr_account_t::record_latency(ticks_t latency) {
+    par->assert_thread();
+    // Exponential moving average, weighting each new sample by 1/8. Only this thread
+    // writes `average_latency`, so we don't need anything fancier than a single store.
+    const ticks_t average = average_latency;
+    average_latency = average == 0
+        ? latency
+        : average + (static_cast<int64_t>(latency) - static_cast<int64_t>(average)) / 8;
+}
+
+void accounting_diskmgr_account_t::record_queue_wait(ticks_t wait) {
+    par->assert_thread();
+    const ticks_t usecs = wait / THOUSAND;
+    int bucket = 0;
+    for (ticks_t limit = ACCOUNTING_DISKMGR_QUEUE_WAIT_MIN_USECS;
+         usecs >= limit && bucket < ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS - 1;
+         limit *= 2) {
+        ++bucket;
+    }
+    ++queue_wait_histogram[bucket];
+}
+
 void accounting_diskmgr_account_t::maybe_init(){
     if (!eager_account.has()) {
         par->assert_thread();
         eager_account.init(new eager_account_t(par, pri, outstanding_requests_limit));
+        par->accounts.push_back(this);
     }
 }
 
@@ -89,17 +134,72 @@ void debug_print(append_only_printf_buffer_t *buf,
 }
 
 
+accounting_payload_t *accounting_diskmgr_dispatcher_t::produce_next_value() {
+    accounting_diskmgr_action_t *a = source->pop();
+    a->account->record_queue_wait(get_ticks() - a->submit_time);
+    return a;
+}
+
+/* Maps account priorities to the merged queue-wait histograms of all the accounts
+with that priority. */
+typedef std::map<int, std::vector<uint64_t> > queue_wait_stats_t;
+
+void *accounting_diskmgr_queue_wait_perfmon_t::begin_stats() {
+    return new queue_wait_stats_t;
+}
+
+void accounting_diskmgr_queue_wait_perfmon_t::visit_stats(void *ctx) {
+    // The histograms are only ever touched on the home thread, so that is the only
+    // place where we can read them.
+    if (get_thread_id() != parent->home_thread()) {
+        return;
+    }
+    queue_wait_stats_t *stats = static_cast<queue_wait_stats_t *>(ctx);
+    for (accounting_diskmgr_account_t *acct = parent->accounts.head();
+         acct != NULL;
+         acct = parent->accounts.next(acct)) {
+        std::vector<uint64_t> *merged = &(*stats)[acct->get_priority()];
+        merged->resize(ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS, 0);
+        const uint64_t *histogram = acct->get_queue_wait_histogram();
+        for (int i = 0; i < ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS; ++i) {
+            (*merged)[i] += histogram[i];
+        }
+    }
+}
+
+perfmon_result_t *accounting_diskmgr_queue_wait_perfmon_t::end_stats(void *ctx) {
+    queue_wait_stats_t *stats = static_cast<queue_wait_stats_t *>(ctx);
+    perfmon_result_t *result;
+    perfmon_result_t::alloc_map_result(&result);
+    for (queue_wait_stats_t::iterator it = stats->begin(); it != stats->end(); ++it) {
+        perfmon_result_t *histogram;
+        perfmon_result_t::alloc_map_result(&histogram);
+        int64_t limit = ACCOUNTING_DISKMGR_QUEUE_WAIT_MIN_USECS;
+        for (int i = 0; i < ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS - 1; ++i, limit *= 2) {
+            histogram->insert(strprintf("lt_%" PRIi64 "us", limit),
+                              new perfmon_result_t(strprintf("%" PRIu64, it->second[i])));
+        }
+        histogram->insert(strprintf("ge_%" PRIi64 "us", limit / 2),
+                          new perfmon_result_t(strprintf("%" PRIu64, it->second.back())));
+        result->insert(strprintf("priority_%d", it->first), histogram);
+    }
+    delete stats;
+    return result;
+}
+
 accounting_diskmgr_t::~accounting_diskmgr_t() {
     auto_drainer.reset();  // Make absolutely sure this happens first.
 }
 
 void accounting_diskmgr_t::submit(action_t *a) {
+    a->submit_time = get_ticks();
     a->account->push(a);
 }
 
 void accounting_diskmgr_t::done(accounting_payload_t *p) {
     // p really is an action_t...
     action_t *a = static_cast<action_t *>(p);
+    a->account->record_latency(get_ticks() - a->submit_time);
     a->account->get_outstanding_requests_limiter()->unlock(1);
     done_fun(static_cast<action_t *>(p));
 }
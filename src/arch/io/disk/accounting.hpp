@@ -13,27 +13,15 @@
 #include "concurrency/semaphore.hpp"
 #include "arch/io/disk.hpp"
 #include "arch/io/disk/stats.hpp"
-
-/* `casting_passive_producer_t` is useful when you have a
-`passive_producer_t<X>` but you need a `passive_producer_t<Y>`, where `X` can
-be cast to `Y`. */
-
-template <class input_t, class output_t>
-struct casting_passive_producer_t : public passive_producer_t<output_t> {
-    explicit casting_passive_producer_t(passive_producer_t<input_t> *_source) :
-        passive_producer_t<output_t>(_source->available), source(_source) { }
-
-    output_t produce_next_value() {
-        /* Implicit cast from `input_t` to `output_t` in return */
-        return source->pop();
-    }
-
-private:
-    passive_producer_t<input_t> *source;
-};
+#include "perfmon/perfmon.hpp"
 
 /* `accounting_diskmgr_t` shares disk throughput proportionally between a
-number of different "accounts". */
+number of different "accounts".
+
+Actions can also carry a latency target (see `file_account_t::set_latency_target()`).
+Once an action with a latency target has spent half of it waiting in its account's
+queue, its account is dispatched ahead of the others, regardless of the shares. That
+leaves the other half of the target for the device itself. */
 
 typedef stats_diskmgr_2_t::action_t accounting_payload_t;
 
@@ -43,7 +31,11 @@ struct accounting_diskmgr_action_t;
 
 struct accounting_diskmgr_eager_account_t;
 
-struct accounting_diskmgr_account_t {
+// Queue waits are bucketed by powers of two, starting at this many microseconds.
+#define ACCOUNTING_DISKMGR_QUEUE_WAIT_MIN_USECS 16
+#define ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS 17
+
+struct accounting_diskmgr_account_t : public intrusive_list_node_t<accounting_diskmgr_account_t> {
     typedef accounting_diskmgr_action_t action_t;
 
     accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
@@ -56,6 +48,24 @@ struct accounting_diskmgr_account_t {
     void on_semaphore_available();
     semaphore_t *get_outstanding_requests_limiter();
 
+    // Records how long an action took from `accounting_diskmgr_t::submit()` to
+    // `accounting_diskmgr_t::done()`.
+    void record_latency(ticks_t latency);
+
+    // A moving average of the latencies recorded above, or 0 if nothing has completed
+    // on this account yet. May be read from any thread, as a hint.
+    ticks_t get_average_latency() const { return average_latency; }
+
+    // Records how long an action waited between `accounting_diskmgr_t::submit()` and
+    // being handed to the backend.
+    void record_queue_wait(ticks_t wait);
+
+    int get_priority() const { return pri; }
+
+    // The number of actions whose queue wait fell into each bucket so far. Only valid
+    // on the `accounting_diskmgr_t`'s home thread.
+    const uint64_t *get_queue_wait_histogram() const { return queue_wait_histogram; }
+
 private:
     typedef accounting_diskmgr_eager_account_t eager_account_t;
 
@@ -66,6 +76,10 @@ private:
     int outstanding_requests_limit;
     scoped_ptr_t<eager_account_t> eager_account;
 
+    volatile ticks_t average_latency;
+
+    uint64_t queue_wait_histogram[ACCOUNTING_DISKMGR_QUEUE_WAIT_BUCKETS];
+
     DISABLE_COPYING(accounting_diskmgr_account_t);
 };
 
@@ -73,17 +87,54 @@ struct accounting_diskmgr_action_t
     : public intrusive_list_node_t<accounting_diskmgr_action_t>,
       public accounting_payload_t {
     accounting_diskmgr_account_t *account;
+    ticks_t submit_time;
+    // 0 if the action has no latency target.
+    ticks_t latency_target;
 };
 
 void debug_print(append_only_printf_buffer_t *buf,
                  const accounting_diskmgr_action_t &action);
 
+/* Pops actions off the `accounting_queue_t` for the backend, recording how long each
+one has been waiting. */
+class accounting_diskmgr_dispatcher_t : public passive_producer_t<accounting_payload_t *> {
+public:
+    explicit accounting_diskmgr_dispatcher_t(passive_producer_t<accounting_diskmgr_action_t *> *_source)
+        : passive_producer_t<accounting_payload_t *>(_source->available), source(_source) { }
+
+private:
+    accounting_payload_t *produce_next_value();
+
+    passive_producer_t<accounting_diskmgr_action_t *> *source;
+
+    DISABLE_COPYING(accounting_diskmgr_dispatcher_t);
+};
+
+/* Reports the queue-wait histograms of the accounts on an `accounting_diskmgr_t`,
+merging accounts that have the same priority. */
+class accounting_diskmgr_queue_wait_perfmon_t : public perfmon_t {
+public:
+    explicit accounting_diskmgr_queue_wait_perfmon_t(accounting_diskmgr_t *_parent)
+        : parent(_parent) { }
+
+    void *begin_stats();
+    void visit_stats(void *ctx);
+    perfmon_result_t *end_stats(void *ctx);
+
+private:
+    accounting_diskmgr_t *parent;
+
+    DISABLE_COPYING(accounting_diskmgr_queue_wait_perfmon_t);
+};
+
 class accounting_diskmgr_t : public home_thread_mixin_t {
 public:
-    explicit accounting_diskmgr_t(int batch_factor)
-        : producer(&caster),
+    accounting_diskmgr_t(int batch_factor, perfmon_collection_t *stats)
+        : producer(&dispatcher),
           queue(batch_factor),
-          caster(&queue),
+          dispatcher(&queue),
+          queue_wait_perfmon(this),
+          queue_wait_membership(stats, &queue_wait_perfmon, "queue_wait"),
           auto_drainer(new auto_drainer_t()) { }
 
     ~accounting_diskmgr_t();
@@ -105,9 +156,17 @@ public:
 
 private:
     friend struct accounting_diskmgr_eager_account_t;
+    friend struct accounting_diskmgr_account_t;
+    friend class accounting_diskmgr_queue_wait_perfmon_t;
 
     accounting_queue_t<action_t *> queue;
-    casting_passive_producer_t<action_t *, accounting_payload_t *> caster;
+    accounting_diskmgr_dispatcher_t dispatcher;
+
+    // The accounts that have seen any actions. Only touched on the home thread.
+    intrusive_list_t<account_t> accounts;
+    accounting_diskmgr_queue_wait_perfmon_t queue_wait_perfmon;
+    perfmon_membership_t queue_wait_membership;
+
     scoped_ptr_t<auto_drainer_t> auto_drainer;
 
     DISABLE_COPYING(accounting_diskmgr_t);
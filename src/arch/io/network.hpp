@@ -5,6 +5,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -104,6 +105,12 @@ public:
     pipe and throws `tcp_conn_write_closed_exc_t`. */
     void write(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* writev() is like write(), but gathers the data from the `iovcnt` pieces
+    of `iov`, which are sent with as few syscalls as possible and without being
+    copied. `iov` and the data it points to must stay valid until writev()
+    returns. */
+    void writev(const iovec *iov, size_t iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     /* write_buffered() is like write(), but it might not send the data until
     flush_buffer*() or write() is called. Internally, it bundles together the
     buffered writes; this may improve performance. */
@@ -243,6 +250,10 @@ private:
         write_buffer_t *dealloc;
         const void *buffer;
         size_t size;
+        /* If `iov` isn't NULL, the op writes its `iovcnt` pieces instead of
+        `buffer`. */
+        const iovec *iov;
+        size_t iovcnt;
         cond_t *cond;
         auto_drainer_t::lock_t keepalive;
     };
@@ -300,6 +311,7 @@ private:
     /* Used to actually perform a write. If the write end of the connection is open, then writes
     `size` bytes from `buffer` to the socket. */
     void perform_write(const void *buffer, size_t size);
+    void perform_writev(const iovec *iov, size_t iovcnt);
 
     scoped_ptr_t<auto_drainer_t> drainer;
 };
@@ -4,6 +4,8 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include <vector>
+
 #ifndef NDEBUG
 #include <cxxabi.h>   // For __cxa_current_exception_type (see below)
 #endif
@@ -32,13 +34,19 @@ bool context_ref_t::is_nil() {
 }
 
 artificial_stack_t::artificial_stack_t(void (*initial_fun)(void), size_t _stack_size)
-    : stack_size(_stack_size) {
-    /* Allocate the stack */
-    stack = malloc_aligned(stack_size, getpagesize());
+    : stack_size(ceil_aligned(_stack_size, getpagesize())) {
+    /* Allocate the stack. We map it directly rather than going through malloc so
+    that it doesn't split up the heap's mappings when we protect its end, and so
+    that untouched pages are never committed. With `MAP_NORESERVE`, thousands of
+    mostly-unused stacks don't count against the overcommit limit either. */
+    stack = mmap(NULL, stack_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    guarantee_err(stack != MAP_FAILED, "Could not allocate a coroutine stack");
 
     /* Protect the end of the stack so that we crash when we get a stack
     overflow instead of corrupting memory. */
-    mprotect(stack, getpagesize(), PROT_NONE);
+    int res = mprotect(stack, getpagesize(), PROT_NONE);
+    guarantee_err(res == 0, "Could not protect the end of a coroutine stack");
 
     /* Register our stack with Valgrind so that it understands what's going on
     and doesn't create spurious errors */
@@ -124,11 +132,22 @@ artificial_stack_t::~artificial_stack_t() {
 #endif
 #endif
 
-    /* Undo protections changes */
-    mprotect(stack, getpagesize(), PROT_READ | PROT_WRITE);
+    /* Release the stack we allocated, protection page and all */
+    int res = munmap(stack, stack_size);
+    guarantee_err(res == 0, "Could not release a coroutine stack");
+}
 
-    /* Release the stack we allocated */
-    free(stack);
+size_t artificial_stack_t::get_resident_size() {
+    const size_t page_size = getpagesize();
+    std::vector<unsigned char> pages(stack_size / page_size);
+    int res = mincore(stack, stack_size, &pages[0]);
+    guarantee_err(res == 0, "mincore failed on a coroutine stack");
+
+    size_t resident_pages = 0;
+    for (size_t i = 0; i < pages.size(); ++i) {
+        resident_pages += pages[i] & 1;
+    }
+    return resident_pages * page_size;
 }
 
 bool artificial_stack_t::address_in_stack(void *addr) {
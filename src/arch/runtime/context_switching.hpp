@@ -39,7 +39,8 @@ public:
     /* `artificial_stack_t()` sets up an artificial context. Once it is set up,
     you can use `context` to swap into and out of it. When you call
     `~artificial_stack_t()`, the original context must have been returned to
-    `context` again. */
+    `context` again. The stack gets its own mapping, so its pages are only
+    committed once the coroutine actually touches them. */
     artificial_stack_t(void (*initial_fun)(void), size_t stack_size);
     ~artificial_stack_t();
 
@@ -58,6 +59,13 @@ public:
     /* Returns the end of the stack */
     void* get_stack_bound() { return stack; }
 
+    /* Returns the size of the stack, including its protection page */
+    size_t get_stack_size() { return stack_size; }
+
+    /* Returns how many bytes of the stack are currently resident in memory. This
+    makes a system call, so don't call it on a hot path. */
+    size_t get_resident_size();
+
 private:
     void *stack;
     size_t stack_size;
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+
 #ifndef NDEBUG
 #include <stack>   /* the data structure, not the run-time concept */
 #endif
@@ -20,14 +22,27 @@
 #include "perfmon/perfmon.hpp"
 #include "utils.hpp"
 
-static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines;
+static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines, pm_coroutine_stack_bytes;
 static perfmon_multi_membership_t pm_coroutines_membership(&get_global_perfmon_collection(),
     &pm_active_coroutines, "active_coroutines",
     &pm_allocated_coroutines, "allocated_coroutines",
+    &pm_coroutine_stack_bytes, "coroutine_stack_bytes",
     NULLPTR);
 
 size_t coro_stack_size = COROUTINE_STACK_SIZE; //Default, setable by command-line parameter
 
+static size_t coroutine_stack_size(coro_stack_class_t stack_class) {
+    switch (stack_class) {
+    case CORO_STACK_SMALL:
+        return std::min<size_t>(COROUTINE_SMALL_STACK_SIZE, coro_stack_size);
+    case CORO_STACK_DEFAULT:
+        return coro_stack_size;
+    case NUM_CORO_STACK_CLASSES:
+    default:
+        unreachable();
+    }
+}
+
 /* `coro_globals_t` holds all of the thread-local variables that coroutines need
 to operate. There is one per thread; it is constructed by the constructor for
 `coro_runtime_t` and destroyed by the destructor. If one exists, you can find
@@ -44,8 +59,11 @@ struct coro_globals_t {
     /* The previous context. */
     coro_t *prev_coro;
 
-    /* A list of coro_t objects that are not in use. */
-    intrusive_list_t<coro_t> free_coros;
+    /* Lists of coro_t objects that are not in use, one for each stack class. We
+    never give their stacks back to the system (or `madvise()` them away) until the
+    thread shuts down; the pages a coroutine type needed once it will probably need
+    again. */
+    intrusive_list_t<coro_t> free_coros[NUM_CORO_STACK_CLASSES];
 
 #ifndef NDEBUG
 
@@ -64,6 +82,8 @@ struct coro_globals_t {
 
     std::map<std::string, size_t> running_coroutine_counts;
     std::map<std::string, size_t> total_coroutine_counts;
+    std::map<std::string, ticks_t> total_spawn_ticks;
+    size_t stacks_allocated[NUM_CORO_STACK_CLASSES];
 
     std::set<coro_t*> active_coroutines;
 
@@ -77,16 +97,24 @@ struct coro_globals_t {
         , assert_no_coro_waiting_counter(0)
         , assert_finite_coro_waiting_counter(0)
 #endif
-        { }
+    {
+#ifndef NDEBUG
+        for (int i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+            stacks_allocated[i] = 0;
+        }
+#endif
+    }
 
     ~coro_globals_t() {
         /* We shouldn't be shutting down from within a coroutine */
         rassert(!current_coro);
 
         /* Destroy remaining coroutines */
-        while (coro_t *s = free_coros.head()) {
-            free_coros.remove(s);
-            delete s;
+        for (int i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+            while (coro_t *s = free_coros[i].head()) {
+                free_coros[i].remove(s);
+                delete s;
+            }
         }
     }
 
@@ -106,9 +134,41 @@ coro_runtime_t::~coro_runtime_t() {
 }
 
 #ifndef NDEBUG
-void coro_runtime_t::get_coroutine_counts(std::map<std::string, size_t> *dest) {
-    dest->clear();
-    dest->insert(cglobals->total_coroutine_counts.begin(), cglobals->total_coroutine_counts.end());
+coroutine_summary_t::coroutine_summary_t()
+    : stack_bytes_reserved(0), stack_bytes_resident(0) {
+    for (int i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+        stacks[i] = 0;
+    }
+}
+
+void coroutine_summary_t::add(const coroutine_summary_t &other) {
+    for (std::map<std::string, size_t>::const_iterator it = other.counts.begin();
+         it != other.counts.end(); ++it) {
+        counts[it->first] += it->second;
+    }
+    for (std::map<std::string, ticks_t>::const_iterator it = other.spawn_ticks.begin();
+         it != other.spawn_ticks.end(); ++it) {
+        spawn_ticks[it->first] += it->second;
+    }
+    for (int i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+        stacks[i] += other.stacks[i];
+    }
+    stack_bytes_reserved += other.stack_bytes_reserved;
+    stack_bytes_resident += other.stack_bytes_resident;
+}
+
+void coro_runtime_t::get_coroutine_summary(coroutine_summary_t *dest) {
+    *dest = coroutine_summary_t();
+    dest->counts = cglobals->total_coroutine_counts;
+    dest->spawn_ticks = cglobals->total_spawn_ticks;
+    for (int i = 0; i < NUM_CORO_STACK_CLASSES; ++i) {
+        dest->stacks[i] = cglobals->stacks_allocated[i];
+        // By the time we shut down, every coroutine is back in its free list.
+        for (coro_t *c = cglobals->free_coros[i].head(); c != NULL; c = cglobals->free_coros[i].next(c)) {
+            dest->stack_bytes_reserved += c->get_stack()->get_stack_size();
+            dest->stack_bytes_resident += c->get_stack()->get_resident_size();
+        }
+    }
 }
 #endif
 
@@ -118,18 +178,22 @@ void coro_runtime_t::get_coroutine_counts(std::map<std::string, size_t> *dest) {
 static __thread int64_t coro_selfname_counter = 0;
 #endif
 
-coro_t::coro_t() :
-    stack(&coro_t::run, coro_stack_size),
+coro_t::coro_t(coro_stack_class_t stack_class) :
+    stack_class_(stack_class),
+    stack(&coro_t::run, coroutine_stack_size(stack_class)),
     current_thread_(linux_thread_pool_t::thread_id),
     notified_(false),
     waiting_(false)
 #ifndef NDEBUG
     , selfname_number(get_thread_id() + MAX_THREADS * ++coro_selfname_counter)
+    , spawn_ticks(0)
 #endif
 {
     ++pm_allocated_coroutines;
+    pm_coroutine_stack_bytes += stack.get_stack_size();
 
 #ifndef NDEBUG
+    cglobals->stacks_allocated[stack_class_]++;
     cglobals->coro_count++;
     rassert(cglobals->coro_count < MAX_COROS_PER_THREAD, "Too many "
             "coroutines allocated on this thread. This is problem due to a "
@@ -138,7 +202,7 @@ coro_t::coro_t() :
 }
 
 void coro_t::return_coro_to_free_list(coro_t *coro) {
-    cglobals->free_coros.push_back(coro);
+    cglobals->free_coros[coro->stack_class_].push_back(coro);
 }
 
 coro_t::~coro_t() {
@@ -149,6 +213,7 @@ coro_t::~coro_t() {
     cglobals->coro_count--;
 #endif
     --pm_allocated_coroutines;
+    pm_coroutine_stack_bytes -= stack.get_stack_size();
 }
 
 void coro_t::run() {
@@ -170,6 +235,7 @@ void coro_t::run() {
         // Keep track of how many coroutines of each type ran
         cglobals->running_coroutine_counts[coro->coroutine_type.c_str()]++;
         cglobals->total_coroutine_counts[coro->coroutine_type.c_str()]++;
+        cglobals->total_spawn_ticks[coro->coroutine_type.c_str()] += coro->spawn_ticks;
         cglobals->active_coroutines.insert(coro);
 #endif
         coro->action_wrapper.run();
@@ -348,15 +414,17 @@ bool coroutines_have_been_initialized() {
     return cglobals != NULL;
 }
 
-coro_t * coro_t::get_coro() {
+coro_t * coro_t::get_coro(coro_stack_class_t stack_class) {
     rassert(coroutines_have_been_initialized());
     coro_t *coro;
 
-    if (cglobals->free_coros.size() == 0) {
-        coro = new coro_t();
+    intrusive_list_t<coro_t> *free_coros = &cglobals->free_coros[stack_class];
+    if (free_coros->empty()) {
+        coro = new coro_t(stack_class);
     } else {
-        coro = cglobals->free_coros.tail();
-        cglobals->free_coros.remove(coro);
+        // Take the most recently used one; its stack is the most likely to still be in cache.
+        coro = free_coros->tail();
+        free_coros->remove(coro);
     }
 
     rassert(!coro->intrusive_list_node_t<coro_t>::in_a_list());
@@ -3,6 +3,7 @@
 #define ARCH_RUNTIME_COROUTINES_HPP_
 
 #ifndef NDEBUG
+#include <map>
 #include <string>
 #endif
 
@@ -15,6 +16,37 @@ const size_t MAX_COROUTINE_STACK_SIZE = 8*1024*1024;
 int get_thread_id();
 struct coro_globals_t;
 
+/* Coroutine stacks come in size classes. Each thread keeps a separate pool of idle
+coroutines for each class. Callers that know the coroutine they spawn stays shallow
+(no callbacks into other components, no parsing or serializing of anything large) can
+ask for a small stack by passing `CORO_STACK_SMALL` to `spawn_*()`; everything else
+gets the default (command-line settable) stack size. A coroutine that overflows its
+small stack crashes with "Callstack overflow in a coroutine". */
+enum coro_stack_class_t {
+    CORO_STACK_SMALL,
+    CORO_STACK_DEFAULT,
+    NUM_CORO_STACK_CLASSES
+};
+
+#ifndef NDEBUG
+/* What the coroutine summary reports at shutdown. Each thread fills one in, and the
+thread pool adds them up. */
+struct coroutine_summary_t {
+    coroutine_summary_t();
+    void add(const coroutine_summary_t &other);
+
+    // How many coroutines of each type ran, and how long spawning them took in total
+    std::map<std::string, size_t> counts;
+    std::map<std::string, ticks_t> spawn_ticks;
+
+    // How many stacks of each class were allocated, how much address space they
+    // took up, and how much of that was actually resident
+    size_t stacks[NUM_CORO_STACK_CLASSES];
+    size_t stack_bytes_reserved;
+    size_t stack_bytes_resident;
+};
+#endif
+
 /* A coro_t represents a fiber of execution within a thread. Create one with spawn_*(). Within a
 coroutine, call wait() to return control to the scheduler; the coroutine will be resumed when
 another fiber calls notify_*() on it.
@@ -27,21 +59,24 @@ public:
     friend bool is_coroutine_stack_overflow(void *);
 
     template<class Callable>
-    static void spawn_now_dangerously(const Callable &action) {
-        get_and_init_coro(action)->notify_now_deprecated();
+    static void spawn_now_dangerously(const Callable &action,
+                      coro_stack_class_t stack_class = CORO_STACK_DEFAULT) {
+        get_and_init_coro(action, stack_class)->notify_now_deprecated();
     }
 
     template<class Callable>
-    static void spawn_sometime(const Callable &action) {
-        get_and_init_coro(action)->notify_sometime();
+    static void spawn_sometime(const Callable &action,
+                      coro_stack_class_t stack_class = CORO_STACK_DEFAULT) {
+        get_and_init_coro(action, stack_class)->notify_sometime();
     }
 
     // TODO: spawn_later_ordered is usually what naive people want,
     // but it's such a long and onerous name.  It should have the
     // shortest name.
     template<class Callable>
-    static void spawn_later_ordered(const Callable &action) {
-        get_and_init_coro(action)->notify_later_ordered();
+    static void spawn_later_ordered(const Callable &action,
+                      coro_stack_class_t stack_class = CORO_STACK_DEFAULT) {
+        get_and_init_coro(action, stack_class)->notify_later_ordered();
     }
 
     // Use coro_t::spawn_*(boost::bind(...)) for spawning with parameters.
@@ -50,8 +85,9 @@ public:
     `notify_later_ordered()`. They are deprecated and new code should not use
     them. */
     template<class Callable>
-    static void spawn(const Callable &action) {
-        spawn_later_ordered(action);
+    static void spawn(const Callable &action,
+                      coro_stack_class_t stack_class = CORO_STACK_DEFAULT) {
+        spawn_later_ordered(action, stack_class);
     }
 
     /* Pauses the current coroutine until it is notified */
@@ -117,20 +153,27 @@ private:
 
     // Contructor sets up the stack, get_and_init_coro will load a function to be run
     //  at which point the coroutine can be notified
-    coro_t();
+    explicit coro_t(coro_stack_class_t stack_class);
 
-    // If this function footprint ever changes, you may need to update the parse_coroutine_info function
+    // If this function footprint ever changes, you may need to update the parse_coroutine_info
+    //  function
     template<class Callable>
-    static coro_t * get_and_init_coro(const Callable &action) {
-        coro_t *coro = get_coro();
+    static coro_t * get_and_init_coro(const Callable &action, coro_stack_class_t stack_class) {
+#ifndef NDEBUG
+        ticks_t start = get_ticks();
+#endif
+        coro_t *coro = get_coro(stack_class);
 #ifndef NDEBUG
         coro->parse_coroutine_type(__PRETTY_FUNCTION__);
 #endif
         coro->action_wrapper.reset(action);
+#ifndef NDEBUG
+        coro->spawn_ticks = get_ticks() - start;
+#endif
         return coro;
     }
 
-    static coro_t * get_coro();
+    static coro_t * get_coro(coro_stack_class_t stack_class);
 
     static void return_coro_to_free_list(coro_t *coro);
 
@@ -141,6 +184,7 @@ private:
 
     virtual void on_thread_switch();
 
+    const coro_stack_class_t stack_class_;
     artificial_stack_t stack;
 
     int current_thread_;
@@ -154,6 +198,7 @@ private:
 #ifndef NDEBUG
     int64_t selfname_number;
     std::string coroutine_type;
+    ticks_t spawn_ticks;
     void parse_coroutine_type(const char *coroutine_function);
 #endif
 
@@ -75,6 +75,8 @@ void epoll_event_queue_t::run() {
         // new descriptor (which we probably can't at this point).
         guarantee_err(res != -1, "Waiting for epoll events failed");
 
+        parent->on_wake();
+
         // nevents might be used by forget_resource during the loop
         nevents = res;
 
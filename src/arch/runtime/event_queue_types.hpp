@@ -14,6 +14,8 @@ struct linux_event_callback_t {
 
 struct linux_queue_parent_t {
     virtual void pump() = 0;
+    // Called whenever the queue stops waiting for events.
+    virtual void on_wake() = 0;
     virtual bool should_shut_down() = 0;
     virtual ~linux_queue_parent_t() {}
 };
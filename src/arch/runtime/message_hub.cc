@@ -14,22 +14,84 @@
 #define RDB_RELOOP_MESSAGES 0
 #endif
 
+linux_message_hub_t::message_ring_t::message_ring_t() {
+    head_.value = 0;
+    tail_.value = 0;
+    producer_blocked_.value = 0;
+}
+
+linux_message_hub_t::message_ring_t::~message_ring_t() {
+    guarantee(head_.value == tail_.value);
+}
+
+size_t linux_message_hub_t::message_ring_t::push_from(msg_list_t *list) {
+    const uint64_t tail = tail_.value;
+    // The consumer only advances `head_` after it is done reading the slots, and x86
+    // doesn't reorder this load with the stores below, so the slots we fill are free.
+    const uint64_t space = MESSAGE_HUB_RING_SIZE - (tail - head_.value);
+
+    uint64_t count = 0;
+    while (count < space && !list->empty()) {
+        linux_thread_message_t *msg = list->head();
+        list->remove(msg);
+        slots_[(tail + count) % MESSAGE_HUB_RING_SIZE] = msg;
+        ++count;
+    }
+
+    if (count > 0) {
+        // Make the slot contents visible before the new tail.
+        __sync_synchronize();
+        tail_.value = tail + count;
+    }
+    return count;
+}
+
+bool linux_message_hub_t::message_ring_t::pop_into(msg_list_t *list) {
+    const uint64_t head = head_.value;
+    const uint64_t tail = tail_.value;
+    if (head == tail) {
+        return false;
+    }
+
+    // Don't read the slots before we've seen the tail that covers them.
+    __sync_synchronize();
+    for (uint64_t i = head; i != tail; ++i) {
+        list->push_back(slots_[i % MESSAGE_HUB_RING_SIZE]);
+    }
+
+    // Finish reading the slots before handing them back to the producer.
+    __sync_synchronize();
+    head_.value = tail;
+    return true;
+}
+
+bool linux_message_hub_t::message_ring_t::empty() const {
+    return head_.value == tail_.value;
+}
+
+void linux_message_hub_t::message_ring_t::set_producer_blocked() {
+    producer_blocked_.value = 1;
+    // Pairs with the barrier in `take_producer_blocked`: either the consumer sees the
+    // flag, or the producer's retry sees the room the consumer made.
+    __sync_synchronize();
+}
+
+bool linux_message_hub_t::message_ring_t::take_producer_blocked() {
+    __sync_synchronize();
+    return producer_blocked_.value != 0
+        && __sync_bool_compare_and_swap(&producer_blocked_.value, 1, 0);
+}
+
 linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue, linux_thread_pool_t *thread_pool, int current_thread)
     : queue_(queue), thread_pool_(thread_pool), current_thread_(current_thread) {
 
-    // We have to do this through dynamically, otherwise we might
-    // allocate far too many file descriptors since this is what the
-    // constructor of the system_event_t object (which is a member of
-    // notify_t) does.
-    notify_ = new notify_t[thread_pool_->n_threads];
+    // Only allocate rings for threads that actually exist; each one is about
+    // 8 * MESSAGE_HUB_RING_SIZE bytes.
+    incoming_rings_ = new message_ring_t[thread_pool_->n_threads];
 
-    for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Create notify fd for other cores that send work to us
-        notify_[i].notifier_thread = i;
-        notify_[i].parent = this;
+    wakeup_pending_.value = 0;
 
-        queue_->watch_resource(notify_[i].event.get_notify_fd(), poll_event_in, &notify_[i]);
-    }
+    queue_->watch_resource(event_.get_notify_fd(), poll_event_in, this);
 }
 
 linux_message_hub_t::~linux_message_hub_t() {
@@ -37,9 +99,9 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(queues_[i].msg_local_list.empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(external_messages_.empty());
 
-    delete[] notify_;
+    delete[] incoming_rings_;
 }
 
 void linux_message_hub_t::do_store_message(unsigned int nthread, linux_thread_message_t *msg) {
@@ -83,15 +145,48 @@ void linux_message_hub_t::store_message_sometime(unsigned int nthread, linux_thr
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
     {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        incoming_messages_.push_back(msg);
+        spinlock_acq_t acq(&external_messages_lock_);
+        external_messages_.push_back(msg);
     }
 
     // Wakey wakey eggs and bakey
-    notify_[current_thread_].event.wakey_wakey();
+    wake();
+}
+
+void linux_message_hub_t::wake() {
+    // Order the producer's publication of the ring tail (or the external list) before
+    // our read of `wakeup_pending_`; the consumer does the opposite in `on_event`.
+    __sync_synchronize();
+    if (wakeup_pending_.value == 0
+        && __sync_bool_compare_and_swap(&wakeup_pending_.value, 0, 1)) {
+        event_.wakey_wakey();
+    }
 }
 
-void linux_message_hub_t::notify_t::on_event(int events) {
+void linux_message_hub_t::pull_messages(msg_list_t *out) {
+    for (int i = 0; i < thread_pool_->n_threads; i++) {
+        if (incoming_rings_[i].pop_into(out) && incoming_rings_[i].take_producer_blocked()) {
+            // Thread #i ran out of room in this ring; now there is some again.
+            thread_pool_->threads[i]->message_hub.wake();
+        }
+    }
+
+    spinlock_acq_t acq(&external_messages_lock_);
+    out->append_and_clear(&external_messages_);
+}
+
+bool linux_message_hub_t::has_incoming_messages() {
+    for (int i = 0; i < thread_pool_->n_threads; i++) {
+        if (!incoming_rings_[i].empty()) {
+            return true;
+        }
+    }
+
+    spinlock_acq_t acq(&external_messages_lock_);
+    return !external_messages_.empty();
+}
+
+void linux_message_hub_t::on_event(int events) {
 
     if (events != poll_event_in) {
         logERR("Unexpected event mask: %d", events);
@@ -99,15 +194,13 @@ void linux_message_hub_t::notify_t::on_event(int events) {
 
     // Read from the event so level-triggered mechanism such as poll
     // don't pester us and use 100% cpu
-    event.consume_wakey_wakeys();
+    event_.consume_wakey_wakeys();
 
     msg_list_t msg_list;
 
-    // Pull the messages
-    {
-        spinlock_acq_t acq(&parent->incoming_messages_lock_);
-        msg_list.append_and_clear(&parent->incoming_messages_);
-    }
+    // Pull the messages. `wakeup_pending_` is still set, so producers won't touch our
+    // eventfd while we do this or while we run the messages.
+    pull_messages(&msg_list);
 
 #ifndef NDEBUG
     start_watchdog(); // Initialize watchdog before handling messages
@@ -118,7 +211,7 @@ void linux_message_hub_t::notify_t::on_event(int events) {
 #ifndef NDEBUG
         if (m->reloop_count_ > 0) {
             --m->reloop_count_;
-            parent->do_store_message(parent->current_thread_, m);
+            do_store_message(current_thread_, m);
             continue;
         }
 #endif
@@ -129,31 +222,39 @@ void linux_message_hub_t::notify_t::on_event(int events) {
         pet_watchdog(); // Verify that each message completes in the acceptable time range
 #endif
     }
+
+    // Re-arm. From here on a producer that publishes something will signal us...
+    wakeup_pending_.value = 0;
+    __sync_synchronize();
+
+    // ...but anything that was published while we were busy is our job. We don't deliver
+    // it right here, because the event loop has to get around to `pump()` and the other
+    // events in between, or messages that hop back out of this thread would starve.
+    if (has_incoming_messages()) {
+        wake();
+    }
 }
 
-// Pushes messages collected locally global lists available to all
-// threads.
+// Pushes messages collected locally into the destination threads' rings.
 void linux_message_hub_t::push_messages() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Append the local list for ith thread to that thread's global
-        // message list.
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
             // Transfer messages to the other core
+            linux_message_hub_t *dest = &thread_pool_->threads[i]->message_hub;
+            message_ring_t *ring = &dest->incoming_rings_[current_thread_];
 
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                //We only need to do a wake up if the global
-                do_wake_up = thread_pool_->threads[i]->message_hub.incoming_messages_.empty();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
+            bool pushed = ring->push_from(&queue->msg_local_list) > 0;
+            if (!queue->msg_local_list.empty()) {
+                // The destination is behind. Have it wake us once it makes room, rather
+                // than spinning on a full ring; the rest waits in our local list until then.
+                ring->set_producer_blocked();
+                pushed = (ring->push_from(&queue->msg_local_list) > 0) || pushed;
             }
 
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.notify_[current_thread_].event.wakey_wakey();
+            if (pushed) {
+                // Wakey wakey, perhaps eggs and bakey
+                dest->wake();
             }
         }
     }
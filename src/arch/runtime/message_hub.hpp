@@ -3,6 +3,7 @@
 #define ARCH_RUNTIME_MESSAGE_HUB_HPP_
 
 #include <pthread.h>
+#include <stdint.h>
 #include <strings.h>
 
 #include "arch/runtime/event_queue.hpp"
@@ -21,16 +22,23 @@ class linux_thread_pool_t;
 /* There is one message hub per thread, NOT one message hub for the entire program.
 
 Each message hub stores messages that are going from that message hub's home thread to
-other threads. It keeps a separate queue for messages destined for each other thread. */
+other threads. It keeps a separate queue for messages destined for each other thread.
 
-class linux_message_hub_t {
+Messages travel between two threads through a lock-free single-producer/single-consumer
+ring owned by the destination hub; there is one ring for every source thread. The
+destination drains all of its rings when it is woken up. Wakeups are coalesced: a
+producer only writes to the destination's eventfd if no wakeup is already pending,
+and the destination keeps the wakeup "pending" for as long as it is busy delivering
+messages, so a thread that is already awake never gets an eventfd write. */
+
+class linux_message_hub_t : public linux_event_callback_t {
 public:
     typedef intrusive_list_t<linux_thread_message_t> msg_list_t;
 
     linux_message_hub_t(linux_event_queue_t *queue, linux_thread_pool_t *thread_pool, int current_thread);
 
-    /* For each thread, transfer messages from our msg_local_list for that thread to our
-    msg_global_list for that thread */
+    /* For each thread, transfer messages from our msg_local_list for that thread to the
+    ring that thread keeps for us */
     void push_messages();
 
     /* Schedules the given message to be sent to the given thread by pushing it onto our
@@ -47,17 +55,24 @@ public:
 
     ~linux_message_hub_t();
 
+    // Called when our eventfd fires; delivers everything that other threads have sent us.
+    void on_event(int events);
+
 private:
     // Does store_message or store_message_sometime, only without setting the reloop_count_ in
     // debug mode.
     void do_store_message(unsigned int nthread, linux_thread_message_t *msg);
 
+    /* Signals our eventfd unless a wakeup is already pending. This is the only method on
+    linux_message_hub_t (besides insert_external_message) that is called from threads other
+    than the one the message hub belongs to. */
+    void wake();
 
-    /* pull_messages should be called on thread N with N as its argument. (The argument is
-    partially redundant.) It will cause the actual delivery of messages that originated
-    on this->current_thread and are destined for thread N. It is (almost) the only method on
-    linux_message_hub_t that is not called on the thread that the message hub belongs to. */
-    void pull_messages(int thread);
+    // Moves every message that has been published to us onto `out`.
+    void pull_messages(msg_list_t *out);
+
+    // True if some ring or the external list has messages we haven't pulled yet.
+    bool has_incoming_messages();
 
     linux_event_queue_t *const queue_;
     linux_thread_pool_t *const thread_pool_;
@@ -66,34 +81,63 @@ private:
     struct thread_queue_t {
         //TODO this doesn't need to be a class anymore
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
+        /* Messages are cached here before being pushed to the destination's ring so that we
+        only have to publish (and maybe wake the destination) once per event loop pass. */
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
-
-    /* We keep one notify_t for each other message hub that we interact with. When it has
-    messages for us, it signals the appropriate notify_t from our set of notify_ts. We get
-    the notification and call push_messages on the sender in reply. */
-    struct notify_t : public linux_event_callback_t
-    {
+    /* A bounded single-producer/single-consumer queue of messages. `incoming_rings_[j]` of
+    hub #i is written only by thread #j (in `push_messages()`) and read only by thread #i.
+    The producer and consumer positions live on separate cache lines so the two threads
+    don't bounce a line back and forth on every message. */
+    class message_ring_t {
     public:
-        /* message_hubs[i]->notify[j].on_event() is called when thread #j has messages for
-        thread #i. */
-        void on_event(int events);
+        message_ring_t();
+        ~message_ring_t();
 
-    public:
-        /* hub->notify[j].notifier_thread == j */
-        int notifier_thread;
+        // Producer side. Moves as many messages from the front of `list` as fit, and
+        // returns the number moved.
+        size_t push_from(msg_list_t *list);
+
+        // Consumer side. Appends every published message to `list`, and returns true if
+        // there were any.
+        bool pop_into(msg_list_t *list);
+
+        // Consumer side.
+        bool empty() const;
 
-        system_event_t event;                    // the eventfd to notify
+        // The producer calls this when the ring is full and it still has messages left
+        // over; it must then try `push_from` once more before relying on the consumer.
+        void set_producer_blocked();
 
-        /* hub->notify[i].parent = hub */
-        linux_message_hub_t *parent;
+        // The consumer calls this after popping. Returns true (and clears the flag) if the
+        // producer is waiting for room and must be woken up.
+        bool take_producer_blocked();
+
+    private:
+        // Total number of messages ever popped; written only by the consumer.
+        cache_line_padded_t<volatile uint64_t> head_;
+        // Total number of messages ever pushed; written only by the producer.
+        cache_line_padded_t<volatile uint64_t> tail_;
+
+        cache_line_padded_t<volatile int> producer_blocked_;
+
+        linux_thread_message_t *slots_[MESSAGE_HUB_RING_SIZE];
+
+        DISABLE_COPYING(message_ring_t);
     };
-    notify_t *notify_;
+    message_ring_t *incoming_rings_;
+
+    /* Messages from threads outside the pool (see `insert_external_message`). These are
+    rare, so a spinlock is fine here. */
+    msg_list_t external_messages_;
+    spinlock_t external_messages_lock_;
+
+    /* Non-zero from the moment somebody signals `event_` until we are done delivering
+    messages, so at most one eventfd write is outstanding per hub at a time. */
+    cache_line_padded_t<volatile int> wakeup_pending_;
+
+    system_event_t event_;
 
     /* The thread that we queue messages originating from. (Recall that there is one
     message_hub_t per thread.) */
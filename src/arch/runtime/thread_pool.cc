@@ -244,14 +244,14 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
 
 #ifndef NDEBUG
     // Save each thread's coroutine counters before shutting down
-    std::vector<std::map<std::string, size_t> > coroutine_counts(n_threads);
+    std::vector<coroutine_summary_t> coroutine_summaries(n_threads);
 #endif
 
     // Shut down child threads
     for (int i = 0; i < n_threads; i++) {
         // Cause child thread to break out of its loop
 #ifndef NDEBUG
-        threads[i]->initiate_shut_down(&coroutine_counts[i]);
+        threads[i]->initiate_shut_down(&coroutine_summaries[i]);
 #else
         threads[i]->initiate_shut_down();
 #endif
@@ -271,19 +271,22 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
 #ifndef NDEBUG
     if (coroutine_summary)
     {
-        // Combine coroutine counts from each thread, and log the totals
-        std::map<std::string, size_t> total_coroutine_counts;
+        // Combine coroutine summaries from each thread, and log the totals
+        coroutine_summary_t total;
         for (int i = 0; i < n_threads; ++i) {
-            for (std::map<std::string, size_t>::iterator j = coroutine_counts[i].begin();
-                 j != coroutine_counts[i].end(); ++j) {
-                total_coroutine_counts[j->first] += j->second;
-            }
+            total.add(coroutine_summaries[i]);
         }
 
-        for (std::map<std::string, size_t>::iterator i = total_coroutine_counts.begin();
-             i != total_coroutine_counts.end(); ++i) {
-            logDBG("%zu coroutines ran with type %s", i->second, i->first.c_str());
+        for (std::map<std::string, size_t>::iterator i = total.counts.begin();
+             i != total.counts.end(); ++i) {
+            logDBG("%zu coroutines ran with type %s, average spawn cost %.2f usec",
+                   i->second, i->first.c_str(),
+                   ticks_to_secs(total.spawn_ticks[i->first]) * MILLION / i->second);
         }
+        logDBG("%zu small and %zu default coroutine stacks, %zu KB reserved, %zu KB resident",
+               total.stacks[CORO_STACK_SMALL], total.stacks[CORO_STACK_DEFAULT],
+               static_cast<size_t>(total.stack_bytes_reserved / KILOBYTE),
+               static_cast<size_t>(total.stack_bytes_resident / KILOBYTE));
     }
 #endif  // NDEBUG
 }
@@ -354,10 +357,11 @@ linux_thread_pool_t::~linux_thread_pool_t() {
 linux_thread_t::linux_thread_t(linux_thread_pool_t *parent_pool, int thread_id)
     : queue(this),
       message_hub(&queue, parent_pool, thread_id),
+      work_stealer(parent_pool, thread_id),
       timer_handler(&queue),
       do_shutdown(false)
 #ifndef NDEBUG
-      , coroutine_counts_at_shutdown(NULL)
+      , coroutine_summary_at_shutdown(NULL)
 #endif
 {
     // Initialize the mutex which synchronizes access to the do_shutdown variable
@@ -371,10 +375,9 @@ linux_thread_t::linux_thread_t(linux_thread_pool_t *parent_pool, int thread_id)
 linux_thread_t::~linux_thread_t() {
 
 #ifndef NDEBUG
-    // Save the coroutine counts before they're deleted, should be ready at shutdown
-    rassert(coroutine_counts_at_shutdown != NULL);
-    coroutine_counts_at_shutdown->clear();
-    coro_runtime.get_coroutine_counts(coroutine_counts_at_shutdown);
+    // Save the coroutine summary before the coroutines are deleted, should be ready at shutdown
+    rassert(coroutine_summary_at_shutdown != NULL);
+    coro_runtime.get_coroutine_summary(coroutine_summary_at_shutdown);
 #endif
 
     int res = pthread_mutex_destroy(&do_shutdown_mutex);
@@ -382,9 +385,15 @@ linux_thread_t::~linux_thread_t() {
 }
 
 void linux_thread_t::pump() {
+    // The work stealer goes first, so that the messages it sends go out right away.
+    work_stealer.pump();
     message_hub.push_messages();
 }
 
+void linux_thread_t::on_wake() {
+    work_stealer.on_wake();
+}
+
 void linux_thread_t::on_event(int events) {
     // No-op. This is just to make sure that the event queue wakes up
     // so it can shut down.
@@ -404,14 +413,14 @@ bool linux_thread_t::should_shut_down() {
 }
 
 #ifndef NDEBUG
-void linux_thread_t::initiate_shut_down(std::map<std::string, size_t> *coroutine_counts) {
+void linux_thread_t::initiate_shut_down(coroutine_summary_t *coroutine_summary) {
 #else
 void linux_thread_t::initiate_shut_down() {
 #endif
     int res = pthread_mutex_lock(&do_shutdown_mutex);
     guarantee_xerr(res == 0, res, "could not lock do_shutdown_mutex");
 #ifndef NDEBUG
-    coroutine_counts_at_shutdown = coroutine_counts;
+    coroutine_summary_at_shutdown = coroutine_summary;
 #endif
     do_shutdown = true;
     shutdown_notify_event.wakey_wakey();
@@ -11,6 +11,7 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/system_event.hpp"
 #include "arch/runtime/message_hub.hpp"
+#include "arch/runtime/work_stealer.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "arch/io/blocker_pool.hpp"
 #include "arch/io/timer_provider.hpp"
@@ -27,7 +28,7 @@ struct coro_runtime_t {
     ~coro_runtime_t();
 
 #ifndef NDEBUG
-    void get_coroutine_counts(std::map<std::string, size_t> *dest);
+    void get_coroutine_summary(coroutine_summary_t *dest);
 #endif
 };
 
@@ -88,6 +89,12 @@ public:
     template <class Callable>
     static void run_in_blocker_pool(const Callable &);
 
+    // Run a CPU-heavy function on whichever thread of the pool has time for it, and block
+    // the calling coroutine until it's done. See linux_work_stealer_t for the rules the
+    // function has to follow.
+    template <class Callable>
+    static void run_thread_agnostic(const Callable &);
+
     int n_threads;
     bool do_set_affinity;
     // The thread_pool that started the thread we are currently in
@@ -141,6 +148,39 @@ void linux_thread_pool_t::run_in_blocker_pool(const Callable &fn)
     }
 }
 
+template <class Callable>
+struct thread_agnostic_job_t :
+    public linux_work_stealer_t::job_t
+{
+    void run() {
+        (*fn)();
+    }
+
+    void done() {
+        suspended->notify_sometime();
+    }
+
+    const Callable *fn;
+    coro_t* suspended;
+};
+
+template <class Callable>
+void linux_thread_pool_t::run_thread_agnostic(const Callable &fn)
+{
+    if (thread_pool != NULL) {
+        thread_agnostic_job_t<Callable> job;
+        job.fn = &fn;
+        job.suspended = coro_t::self();
+
+        thread->work_stealer.submit(&job);
+
+        // Give up execution, to be resumed when the done callback is made
+        coro_t::wait();
+    } else {
+        fn();
+    }
+}
+
 class linux_thread_t :
     public linux_event_callback_t,
     public linux_queue_parent_t {
@@ -150,6 +190,7 @@ public:
 
     linux_event_queue_t queue;
     linux_message_hub_t message_hub;
+    linux_work_stealer_t work_stealer;
     timer_handler_t timer_handler;
 
     /* Never accessed; its constructor and destructor set up and tear down thread-local variables
@@ -157,9 +198,10 @@ public:
     coro_runtime_t coro_runtime;
 
     void pump();   // Called by the event queue
+    void on_wake();   // Called by the event queue
     bool should_shut_down();   // Called by the event queue
 #ifndef NDEBUG
-    void initiate_shut_down(std::map<std::string, size_t> *coroutine_counts); // Can be called from any thread
+    void initiate_shut_down(coroutine_summary_t *coroutine_summary); // Can be called from any thread
 #else
     void initiate_shut_down(); // Can be called from any thread
 #endif
@@ -171,7 +213,7 @@ private:
     system_event_t shutdown_notify_event;
 
 #ifndef NDEBUG
-    std::map<std::string, size_t> *coroutine_counts_at_shutdown;
+    coroutine_summary_t *coroutine_summary_at_shutdown;
 #endif
 };
 
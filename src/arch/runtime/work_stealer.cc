@@ -0,0 +1,216 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "arch/runtime/work_stealer.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "perfmon/perfmon.hpp"
+
+// How long a utilization measurement window is.
+#define UTILIZATION_WINDOW_TICKS secs_to_ticks(1)
+
+/* Reports `linux_work_stealer_t::utilization()` for each thread, so that an imbalance
+between threads is visible in the stats. */
+class perfmon_thread_utilization_t : public perfmon_perthread_t<double, std::vector<double> > {
+private:
+    void get_thread_stat(double *stat) {
+        *stat = linux_thread_pool_t::thread->work_stealer.utilization();
+    }
+    std::vector<double> combine_stats(double *stats) {
+        return std::vector<double>(stats, stats + get_num_threads());
+    }
+    perfmon_result_t *output_stat(const std::vector<double> &stats) {
+        perfmon_result_t *result;
+        perfmon_result_t::alloc_map_result(&result);
+        for (size_t i = 0; i < stats.size(); ++i) {
+            result->insert(strprintf("thread_%zu", i),
+                           new perfmon_result_t(strprintf("%.4f", stats[i])));
+        }
+        return result;
+    }
+};
+
+static perfmon_thread_utilization_t pm_thread_utilization;
+static perfmon_counter_t pm_thread_agnostic_jobs, pm_thread_agnostic_jobs_stolen;
+static perfmon_multi_membership_t pm_work_stealer_membership(&get_global_perfmon_collection(),
+    &pm_thread_utilization, "thread_utilization",
+    &pm_thread_agnostic_jobs, "thread_agnostic_jobs",
+    &pm_thread_agnostic_jobs_stolen, "thread_agnostic_jobs_stolen",
+    NULL);
+
+linux_work_stealer_t::linux_work_stealer_t(linux_thread_pool_t *thread_pool, int current_thread)
+    : thread_pool_(thread_pool), current_thread_(current_thread),
+      poke_in_flight_(0),
+      window_start_(get_ticks()), idle_ticks_in_window_(0), went_idle_at_(0),
+      last_utilization_(0) {
+    num_jobs_.value = 0;
+    // The event loop only calls `pump()` after its first wakeup, so start out idle.
+    idle_.value = 1;
+    poke_message_.parent = this;
+}
+
+linux_work_stealer_t::~linux_work_stealer_t() {
+    guarantee(jobs_.empty());
+}
+
+void linux_work_stealer_t::submit(job_t *job) {
+    rassert(linux_thread_pool_t::thread_id == current_thread_);
+    job->home_thread_ = current_thread_;
+
+    {
+        spinlock_acq_t acq(&jobs_lock_);
+        jobs_.push_back(job);
+        ++num_jobs_.value;
+    }
+
+    // Hand the job to an idle thread if there is one. If nobody takes it, we'll run it
+    // ourselves when our event loop gets to `pump()`.
+    linux_work_stealer_t *peer = find_idle_peer();
+    if (peer != NULL) {
+        peer->poke();
+    }
+}
+
+void linux_work_stealer_t::pump() {
+    job_t *job = NULL;
+    // Our own jobs go to idle peers first, because we have other things to do (or we
+    // wouldn't have handed the work off in the first place).
+    linux_work_stealer_t *idle_peer = find_idle_peer();
+    if (idle_peer == NULL) {
+        job = pop_own_job();
+    } else if (num_jobs_.value != 0) {
+        // It may have gone to sleep before our jobs showed up.
+        idle_peer->poke();
+    }
+    if (job == NULL) {
+        job = steal_job();
+    }
+
+    if (job == NULL) {
+        idle_.value = 1;
+    } else {
+        idle_.value = 0;
+        run_job(job);
+        // There may be more where that came from; handle whatever events have arrived in
+        // the meantime and then check again.
+        if (work_is_queued()) {
+            poke();
+        }
+    }
+
+    went_idle_at_ = get_ticks();
+}
+
+void linux_work_stealer_t::on_wake() {
+    const ticks_t now = get_ticks();
+    if (went_idle_at_ != 0) {
+        idle_ticks_in_window_ += now - std::max(went_idle_at_, window_start_);
+        went_idle_at_ = 0;
+    }
+    if (now - window_start_ >= UTILIZATION_WINDOW_TICKS) {
+        roll_utilization_window(now);
+    }
+}
+
+double linux_work_stealer_t::utilization() {
+    // We're running (we're answering this), so we aren't idle right now.
+    const ticks_t now = get_ticks();
+    if (now - window_start_ >= UTILIZATION_WINDOW_TICKS) {
+        roll_utilization_window(now);
+    }
+    return last_utilization_;
+}
+
+void linux_work_stealer_t::roll_utilization_window(ticks_t now) {
+    const ticks_t elapsed = now - window_start_;
+    last_utilization_ = elapsed == 0
+        ? 0
+        : 1.0 - static_cast<double>(std::min(idle_ticks_in_window_, elapsed)) / elapsed;
+    window_start_ = now;
+    idle_ticks_in_window_ = 0;
+}
+
+linux_work_stealer_t::job_t *linux_work_stealer_t::pop_own_job() {
+    if (num_jobs_.value == 0) {
+        return NULL;
+    }
+    spinlock_acq_t acq(&jobs_lock_);
+    job_t *job = jobs_.head();
+    if (job != NULL) {
+        jobs_.remove(job);
+        --num_jobs_.value;
+    }
+    return job;
+}
+
+linux_work_stealer_t::job_t *linux_work_stealer_t::steal_job() {
+    // Steal from whoever has the most work queued up. The counts are only hints; we
+    // recheck under the victim's lock.
+    linux_work_stealer_t *victim = NULL;
+    int64_t most_jobs = 0;
+    for (int i = 0; i < thread_pool_->n_threads; ++i) {
+        linux_work_stealer_t *peer = &thread_pool_->threads[i]->work_stealer;
+        if (peer != this && peer->num_jobs_.value > most_jobs) {
+            victim = peer;
+            most_jobs = peer->num_jobs_.value;
+        }
+    }
+    if (victim == NULL) {
+        return NULL;
+    }
+
+    spinlock_acq_t acq(&victim->jobs_lock_);
+    job_t *job = victim->jobs_.tail();
+    if (job != NULL) {
+        victim->jobs_.remove(job);
+        --victim->num_jobs_.value;
+        ++pm_thread_agnostic_jobs_stolen;
+    }
+    return job;
+}
+
+linux_work_stealer_t *linux_work_stealer_t::find_idle_peer() {
+    // Start looking at a random thread so that concurrent submitters don't all pick the
+    // same one.
+    const int n = thread_pool_->n_threads;
+    const int start = randint(n);
+    for (int i = 0; i < n; ++i) {
+        linux_work_stealer_t *peer = &thread_pool_->threads[(start + i) % n]->work_stealer;
+        if (peer != this && peer->idle_.value != 0) {
+            return peer;
+        }
+    }
+    return NULL;
+}
+
+bool linux_work_stealer_t::work_is_queued() {
+    for (int i = 0; i < thread_pool_->n_threads; ++i) {
+        if (thread_pool_->threads[i]->work_stealer.num_jobs_.value != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool linux_work_stealer_t::poke() {
+    if (!__sync_bool_compare_and_swap(&poke_in_flight_, 0, 1)) {
+        return false;
+    }
+    linux_thread_pool_t::thread->message_hub.store_message(current_thread_, &poke_message_);
+    return true;
+}
+
+void linux_work_stealer_t::poke_message_t::on_thread_switch() {
+    // There's nothing to do here; `pump()` runs once the event loop is done with
+    // this batch of events.
+    __sync_lock_release(&parent->poke_in_flight_);
+}
+
+void linux_work_stealer_t::run_job(job_t *job) {
+    ++pm_thread_agnostic_jobs;
+    job->run();
+    // Deliver `done()` through the message hub even if the job ran at home, so that it
+    // always happens at a point where it is safe to resume coroutines.
+    linux_thread_pool_t::thread->message_hub.store_message(job->home_thread_, job);
+}
@@ -0,0 +1,113 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_WORK_STEALER_HPP_
+#define ARCH_RUNTIME_WORK_STEALER_HPP_
+
+#include <stdint.h>
+
+#include "arch/runtime/runtime_utils.hpp"
+#include "arch/spinlock.hpp"
+#include "containers/intrusive_list.hpp"
+#include "utils.hpp"
+
+class linux_thread_pool_t;
+
+/* There is one work stealer per thread. It holds the "thread-agnostic" jobs that
+coroutines on that thread have submitted: pure CPU work (datum transforms, sorting,
+parsing JSON, ...) that may just as well run on any other thread of the pool.
+
+Each thread runs its own jobs from its event loop, one per pass, but only while no other
+thread is idle. Idle threads steal jobs from the back of the busiest peer's queue instead,
+and the job's `done()` is then delivered back to the submitting thread as a thread
+message. This way one heavy query doesn't pin its home core while the other cores have
+nothing to do.
+
+Use `linux_thread_pool_t::run_thread_agnostic()` rather than this class directly. */
+
+class linux_work_stealer_t {
+public:
+    class job_t : public intrusive_list_node_t<job_t>, public linux_thread_message_t {
+    public:
+        job_t() : home_thread_(-1) { }
+
+        /* run() may be called on any thread in the pool, from the event loop rather than
+        from within a coroutine. It must not block, must not touch thread-local state, and
+        must not touch anything that other coroutines on the home thread might be using at
+        the same time. (For example, `counted_t` reference counts are not atomic.) */
+        virtual void run() = 0;
+
+        /* done() will be called on the thread that submitted the job once run() is done. */
+        virtual void done() = 0;
+
+    protected:
+        virtual ~job_t() { }
+
+    private:
+        friend class linux_work_stealer_t;
+        void on_thread_switch() { done(); }
+        int home_thread_;
+
+        DISABLE_COPYING(job_t);
+    };
+
+    linux_work_stealer_t(linux_thread_pool_t *thread_pool, int current_thread);
+    ~linux_work_stealer_t();
+
+    // Queues `job` on this thread. Must be called on this stealer's thread.
+    void submit(job_t *job);
+
+    // Called by the event loop before it goes to sleep (and before the message hub pushes
+    // its messages). Runs at most one job, either one of our own or one stolen from a peer.
+    void pump();
+
+    // Called by the event loop when it stops waiting for events.
+    void on_wake();
+
+    // The fraction of time this thread has spent outside of the event queue's wait
+    // during the last complete measurement window.
+    double utilization();
+
+private:
+    job_t *pop_own_job();
+    job_t *steal_job();
+    linux_work_stealer_t *find_idle_peer();
+    bool work_is_queued();
+
+    // Makes sure this thread's event loop comes around at least once more. Returns false if
+    // a poke was already on its way. Can be called from any thread in the pool.
+    bool poke();
+
+    void run_job(job_t *job);
+
+    void roll_utilization_window(ticks_t now);
+
+    linux_thread_pool_t *const thread_pool_;
+    const int current_thread_;
+
+    // Jobs submitted on this thread that nobody has taken yet. Our own thread pops from
+    // the front, stealers from the back.
+    spinlock_t jobs_lock_;
+    intrusive_list_t<job_t> jobs_;
+    // Same as `jobs_.size()`, but can be peeked at without taking the lock.
+    cache_line_padded_t<volatile int64_t> num_jobs_;
+
+    // Set while our last pass found nothing to run. Read by peers to decide whether to
+    // leave their jobs to us.
+    cache_line_padded_t<volatile int> idle_;
+
+    // An empty message that other threads send us to wake our event loop up.
+    struct poke_message_t : public linux_thread_message_t {
+        void on_thread_switch();
+        linux_work_stealer_t *parent;
+    } poke_message_;
+    volatile int poke_in_flight_;
+
+    // Utilization accounting; only touched on our own thread.
+    ticks_t window_start_;
+    ticks_t idle_ticks_in_window_;
+    ticks_t went_idle_at_;
+    double last_utilization_;
+
+    DISABLE_COPYING(linux_work_stealer_t);
+};
+
+#endif  // ARCH_RUNTIME_WORK_STEALER_HPP_
@@ -100,6 +100,11 @@ public:
     virtual void *create_account(int priority, int outstanding_requests_limit) = 0;
     virtual void destroy_account(void *account) = 0;
 
+    /* Returns a moving average of how long recent operations on `account` took from
+    being submitted to being completed, or 0 if that isn't known. Can be called from
+    any thread; the result is only a hint. */
+    virtual ticks_t get_average_latency(void *account) = 0;
+
     virtual bool coop_lock_and_check() = 0;
 };
 
@@ -108,6 +113,13 @@ public:
     file_account_t(file_t *f, int p, int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
     ~file_account_t();
     void *get_account() { return account; }
+    ticks_t get_average_latency() { return parent->get_average_latency(account); }
+
+    /* Asks the disk scheduler to dispatch this account's requests ahead of other
+    accounts' once they have been waiting long enough to put `latency_target` at risk.
+    0 (the default) means no latency target. Must be set before the account is used. */
+    void set_latency_target(ticks_t target) { latency_target = target; }
+    ticks_t get_latency_target() const { return latency_target; }
 
 private:
     file_t *parent;
@@ -118,6 +130,8 @@ private:
 
     void *account;
 
+    ticks_t latency_target;
+
     DISABLE_COPYING(file_account_t);
 };
 
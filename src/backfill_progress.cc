@@ -5,6 +5,7 @@
 #include <boost/bind.hpp>
 
 #include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 
 traversal_progress_combiner_t::~traversal_progress_combiner_t() {
@@ -55,3 +56,39 @@ progress_completion_fraction_t traversal_progress_combiner_t::guess_completion()
 
     return progress_completion_fraction_t(released, total);
 }
+
+backfill_rate_meter_t::backfill_rate_meter_t()
+    : start_ticks(get_ticks()), chunks(0), measured_chunks(0), measured_bytes(0) { }
+
+bool backfill_rate_meter_t::on_chunk() {
+    return chunks++ % BACKFILL_CHUNK_SIZE_SAMPLE_INTERVAL == 0;
+}
+
+void backfill_rate_meter_t::on_chunk_measured(int64_t bytes) {
+    ++measured_chunks;
+    measured_bytes += bytes;
+}
+
+backfill_progress_report_t backfill_rate_meter_t::make_report(const progress_completion_fraction_t &fraction) const {
+    backfill_progress_report_t report;
+    report.released_nodes = fraction.estimate_of_released_nodes;
+    report.total_nodes = fraction.estimate_of_total_nodes;
+
+    if (measured_chunks != 0) {
+        report.bytes_sent = chunks * measured_bytes / measured_chunks;
+    }
+
+    const double elapsed_secs = ticks_to_secs(get_ticks() - start_ticks);
+    if (elapsed_secs > 0) {
+        report.bytes_per_sec = report.bytes_sent / elapsed_secs;
+
+        // Assume that the rest of the tree takes as long per node as what we've seen
+        // so far.
+        if (!fraction.invalid() && fraction.estimate_of_released_nodes > 0) {
+            const int remaining_nodes = fraction.estimate_of_total_nodes - fraction.estimate_of_released_nodes;
+            report.eta_secs = elapsed_secs * remaining_nodes / fraction.estimate_of_released_nodes;
+        }
+    }
+
+    return report;
+}
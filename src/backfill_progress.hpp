@@ -4,6 +4,7 @@
 
 #include <vector>
 
+#include "rpc/serialize_macros.hpp"
 #include "utils.hpp"
 
 template <class> class scoped_ptr_t;
@@ -68,6 +69,48 @@ private:
     DISABLE_COPYING(traversal_progress_combiner_t);
 };
 
+/* What a backfiller reports when it is asked how one of its backfills is going. */
+struct backfill_progress_report_t {
+    backfill_progress_report_t()
+        : released_nodes(-1), total_nodes(-1), bytes_sent(0), bytes_per_sec(-1), eta_secs(-1) { }
 
+    // As in `progress_completion_fraction_t`; both are -1 if unknown.
+    int released_nodes;
+    int total_nodes;
+
+    // An estimate of how many bytes of backfill chunks have been sent so far, and of the
+    // average rate at which they have been sent (-1 if unknown).
+    int64_t bytes_sent;
+    double bytes_per_sec;
+
+    // How many more seconds the backfill is expected to take, or -1 if we can't tell.
+    double eta_secs;
+
+    RDB_MAKE_ME_SERIALIZABLE_5(released_nodes, total_nodes, bytes_sent, bytes_per_sec, eta_secs);
+};
+
+/* Keeps track of how much data a backfill has sent and for how long, so that it can
+report a rate and an ETA. Measuring every chunk would mean serializing it twice, so only
+every `BACKFILL_CHUNK_SIZE_SAMPLE_INTERVAL`th chunk is measured, and the others are assumed
+to be of the average measured size. */
+class backfill_rate_meter_t {
+public:
+    backfill_rate_meter_t();
+
+    // Call once for each chunk that is sent. Returns true if the chunk's serialized size
+    // should be measured and passed to `on_chunk_measured()`.
+    bool on_chunk();
+    void on_chunk_measured(int64_t bytes);
+
+    backfill_progress_report_t make_report(const progress_completion_fraction_t &fraction) const;
+
+private:
+    ticks_t start_ticks;
+    int64_t chunks;
+    int64_t measured_chunks;
+    int64_t measured_bytes;
+
+    DISABLE_COPYING(backfill_rate_meter_t);
+};
 
 #endif  // BACKFILL_PROGRESS_HPP_
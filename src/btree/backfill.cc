@@ -15,6 +15,10 @@
 #include "buffer_cache/buffer_cache.hpp"
 #include "protocol_api.hpp"
 
+static bool backfill_pair_key_less(const backfill_pair_t &a, const backfill_pair_t &b) {
+    return sized_strcmp(a.key->contents, a.key->size, b.key->contents, b.key->size) < 0;
+}
+
 struct backfill_traversal_helper_t : public btree_traversal_helper_t, public home_thread_mixin_debug_only_t {
     void process_a_leaf(transaction_t *txn, buf_lock_t *leaf_node_buf, const btree_key_t *left_exclusive_or_null, const btree_key_t *right_inclusive_or_null, signal_t *interruptor, int * /*population_change_out*/) THROWS_ONLY(interrupted_exc_t) {
         assert_thread();
@@ -38,9 +42,15 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
                 }
             }
 
+            // The entries come out in timestamp order; we collect the pairs and hand
+            // them over in key order once we've seen them all.
             void key_value(const btree_key_t *k, const void *value, repli_timestamp_t tstamp) {
                 if (range.contains_key(k->contents, k->size)) {
-                    cb->on_pair(txn, tstamp, k, value, interruptor);
+                    backfill_pair_t pair;
+                    pair.key = k;
+                    pair.value = value;
+                    pair.recency = tstamp;
+                    pairs.push_back(pair);
                 }
             }
 
@@ -48,6 +58,7 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
             transaction_t *txn;
             key_range_t range;
             signal_t *interruptor;
+            std::vector<backfill_pair_t> pairs;
         } x;
         x.cb = callback_;
         x.txn = txn;
@@ -55,6 +66,11 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         x.interruptor = interruptor;
 
         leaf::dump_entries_since_time(sizer_, data, since_when_, leaf_node_buf->get_recency(), &x);
+
+        if (!x.pairs.empty()) {
+            std::sort(x.pairs.begin(), x.pairs.end(), &backfill_pair_key_less);
+            callback_->on_pairs(txn, x.pairs, interruptor);
+        }
     }
 
     void postprocess_internal_node(UNUSED buf_lock_t *internal_node_buf) {
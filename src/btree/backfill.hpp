@@ -3,11 +3,13 @@
 #define BTREE_BACKFILL_HPP_
 
 #include <map>
+#include <vector>
 
 #include "btree/btree_store.hpp"
 #include "btree/secondary_operations.hpp"
 #include "buffer_cache/types.hpp"
 #include "containers/uuid.hpp"
+#include "repli_timestamp.hpp"
 #include "utils.hpp"
 
 class btree_slice_t;
@@ -16,15 +18,29 @@ struct key_range_t;
 class parallel_traversal_progress_t;
 class superblock_t;
 template <class> class value_sizer_t;
-class repli_timestamp_t;
 class signal_t;
 
+/* A live key/value pair that the backfill found in a leaf. `key` and `value` point
+into the leaf, which stays locked until `on_pairs()` returns. */
+struct backfill_pair_t {
+    const btree_key_t *key;
+    const void *value;
+    repli_timestamp_t recency;
+};
+
 
 class agnostic_backfill_callback_t {
 public:
     virtual void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_deletion(const btree_key_t *key, repli_timestamp_t recency, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_pair(transaction_t *txn, repli_timestamp_t recency, const btree_key_t *key, const void *value, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    // Called once per leaf with all of its pairs, sorted by key, so that they can be
+    // sent (and applied) as a contiguous run. By default, calls `on_pair()` for each.
+    virtual void on_pairs(transaction_t *txn, const std::vector<backfill_pair_t> &pairs, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        for (std::vector<backfill_pair_t>::const_iterator it = pairs.begin(); it != pairs.end(); ++it) {
+            on_pair(txn, it->recency, it->key, it->value, interruptor);
+        }
+    }
     virtual void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual ~agnostic_backfill_callback_t() { }
 };
@@ -1,6 +1,8 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "btree/btree_store.hpp"
 
+#include <algorithm>
+
 #include "btree/operations.hpp"
 #include "btree/secondary_operations.hpp"
 #include "concurrency/wait_any.hpp"
@@ -179,7 +181,9 @@ void btree_store_t<protocol_t>::receive_backfill(
 
     scoped_ptr_t<transaction_t> txn;
     scoped_ptr_t<real_superblock_t> superblock;
-    const int expected_change_count = 1; // FIXME: this is probably not correct
+    // A chunk can carry a whole leaf's worth of keys, and they're all written
+    // in this one transaction.
+    const int expected_change_count = static_cast<int>(std::max<size_t>(1, chunk.get_key_count()));
 
     object_buffer_t<fifo_enforcer_sink_t::exit_write_t>::destruction_sentinel_t
         token_destroyer(&token_pair->sindex_write_token);
@@ -522,6 +526,25 @@ THROWS_NOTHING {
     return found;
 }
 
+template <class protocol_t>
+bool btree_store_t<protocol_t>::mark_index_post_construction_progress(
+    uuid_u id,
+    const store_key_t &progress,
+    transaction_t *txn,
+    buf_lock_t *sindex_block)
+THROWS_NOTHING {
+    secondary_index_t sindex;
+    bool found = ::get_secondary_index(txn, sindex_block, id, &sindex);
+
+    if (found) {
+        sindex.post_construction_progress = progress;
+
+        ::set_secondary_index(txn, sindex_block, id, sindex);
+    }
+
+    return found;
+}
+
 template <class protocol_t>
 MUST_USE bool btree_store_t<protocol_t>::drop_sindex(
         write_token_pair_t *token_pair,
@@ -762,7 +785,10 @@ void btree_store_t<protocol_t>::aquire_post_constructed_sindex_superblocks_for_w
     ::get_secondary_indexes(txn, sindex_block, &sindexes);
 
     for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
-        if (it->second.post_construction_complete) {
+        /* Sindexes which are partway through post construction are included
+         * too, it's up to the caller to only touch the keys they've reached. */
+        if (it->second.post_construction_complete ||
+            it->second.post_construction_progress != store_key_t::min()) {
             sindexes_to_acquire.insert(it->first);
         }
     }
@@ -195,6 +195,15 @@ public:
         buf_lock_t *sindex_block)
     THROWS_NOTHING;
 
+    /* Records that post construction has indexed every key less than
+     * `progress`. */
+    bool mark_index_post_construction_progress(
+        uuid_u id,
+        const store_key_t &progress,
+        transaction_t *txn,
+        buf_lock_t *sindex_block)
+    THROWS_NOTHING;
+
     bool drop_sindex(
         write_token_pair_t *token_pair,
         const std::string &id,
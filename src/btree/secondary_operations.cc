@@ -25,6 +25,21 @@ void get_secondary_indexes_internal(transaction_t *txn, buf_lock_t *sindex_block
     vector_read_stream_t read_stream(&sindex);
     int res = deserialize(&read_stream, sindexes_out);
     guarantee_err(res == 0, "corrupted secondary index.");
+
+    /* Sindex blocks written before post construction kept track of its
+     * progress end here; their sindexes keep the default progress. */
+    std::map<std::string, store_key_t> progress;
+    res = deserialize(&read_stream, &progress);
+    if (res == ARCHIVE_SOCK_EOF) {
+        return;
+    }
+    guarantee_err(res == 0, "corrupted secondary index.");
+
+    for (auto it = progress.begin(); it != progress.end(); ++it) {
+        auto jt = sindexes_out->find(it->first);
+        guarantee(jt != sindexes_out->end(), "corrupted secondary index.");
+        jt->second.post_construction_progress = it->second;
+    }
 }
 
 void set_secondary_indexes_internal(transaction_t *txn, buf_lock_t *sindex_block, const std::map<std::string, secondary_index_t> &sindexes) {
@@ -33,8 +48,14 @@ void set_secondary_indexes_internal(transaction_t *txn, buf_lock_t *sindex_block
     blob_t sindex_blob(data->sindex_blob, btree_sindex_block_t::SINDEX_BLOB_MAXREFLEN);
     sindex_blob.clear(txn);
 
+    std::map<std::string, store_key_t> progress;
+    for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+        progress[it->first] = it->second.post_construction_progress;
+    }
+
     write_message_t wm;
     wm << sindexes;
+    wm << progress;
 
     vector_stream_t stream;
     int res = send_write_message(&stream, &wm);
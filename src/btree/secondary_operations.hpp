@@ -4,6 +4,7 @@
 
 #include <vector>
 
+#include "btree/keys.hpp"
 #include "buffer_cache/mirrored/writeback.hpp"
 #include "containers/archive/archive.hpp"
 #include "rpc/serialize_macros.hpp"
@@ -12,6 +13,7 @@
 struct secondary_index_t {
     secondary_index_t()
         : superblock(NULL_BLOCK_ID), post_construction_complete(false),
+          post_construction_progress(store_key_t::min()),
           id(generate_uuid())
     { }
 
@@ -30,6 +32,16 @@ struct secondary_index_t {
     /* Whether or not the sindex has complete postconstruction. */
     bool post_construction_complete;
 
+    /* Post construction proceeds in order of primary key and checkpoints as it
+     * goes; every primary key less than this one has already been indexed.
+     * Writes to those keys update the sindex directly, writes to the rest are
+     * left to post construction. */
+    store_key_t post_construction_progress;
+
+    bool is_ready_for_key(const store_key_t &primary_key) const {
+        return post_construction_complete || primary_key < post_construction_progress;
+    }
+
     /* An opaque blob that describes the index */
     opaque_definition_t opaque_definition;
 
@@ -45,6 +57,10 @@ struct secondary_index_t {
                opaque_definition == other.opaque_definition;
     }
 
+    /* `post_construction_progress` is left out so that sindexes written
+     * before it existed still deserialize; the sindex block stores it after
+     * the map of sindexes (see `secondary_operations.cc`). It is local to the
+     * store, so backfills don't need it. */
     RDB_MAKE_ME_SERIALIZABLE_4(superblock, opaque_definition, post_construction_complete, id);
 };
 
@@ -57,5 +57,50 @@ private:
     DISABLE_COPYING(refcount_superblock_t);
 };
 
+/* Lets a superblock that someone else owns be used for a btree operation that
+ * would release it. */
+class shared_superblock_t : public superblock_t {
+public:
+    explicit shared_superblock_t(superblock_t *sb) : sub_superblock(sb) { }
+
+    void release() { }
+
+    block_id_t get_root_block_id() const {
+        return sub_superblock->get_root_block_id();
+    }
+
+    void set_root_block_id(const block_id_t new_root_block) {
+        sub_superblock->set_root_block_id(new_root_block);
+    }
+
+    block_id_t get_stat_block_id() const {
+        return sub_superblock->get_stat_block_id();
+    }
+
+    void set_stat_block_id(block_id_t new_stat_block) {
+        sub_superblock->set_stat_block_id(new_stat_block);
+    }
+
+    block_id_t get_sindex_block_id() const {
+        return sub_superblock->get_sindex_block_id();
+    }
+
+    void set_sindex_block_id(block_id_t new_sindex_block) {
+        sub_superblock->set_sindex_block_id(new_sindex_block);
+    }
+
+    void set_eviction_priority(eviction_priority_t eviction_priority) {
+        sub_superblock->set_eviction_priority(eviction_priority);
+    }
+
+    eviction_priority_t get_eviction_priority() {
+        return sub_superblock->get_eviction_priority();
+    }
+
+private:
+    superblock_t *sub_superblock;
+
+    DISABLE_COPYING(shared_superblock_t);
+};
 
 #endif  // BTREE_SUPERBLOCK_HPP_
@@ -195,8 +195,10 @@ mc_inner_buf_t::mc_inner_buf_t(mc_cache_t *_cache, block_id_t _block_id, file_ac
 
     // Some things expect us to return immediately (as of 5/12/2011), so we do the loading in a
     // separate coro. We have to make sure that load_inner_buf() acquires the lock first
-    // however, so we use spawn_now_dangerously().
-    coro_t::spawn_now_dangerously(boost::bind(&mc_inner_buf_t::load_inner_buf, this, true, _io_account));
+    // however, so we use spawn_now_dangerously(). Every cache miss spawns one of these, and
+    // all they do is wait on the serializer, so they get small stacks.
+    coro_t::spawn_now_dangerously(boost::bind(&mc_inner_buf_t::load_inner_buf, this, true, _io_account),
+                                  CORO_STACK_SMALL);
 
     // TODO: only increment pm_n_blocks_in_memory when we actually load the block into memory.
     ++_cache->stats->pm_n_blocks_in_memory;
@@ -1142,6 +1144,7 @@ mc_cache_t::mc_cache_t(serializer_t *_serializer,
     {
         on_thread_t thread_switcher(serializer->home_thread());
         reads_io_account.init(serializer->make_io_account(dynamic_config.io_priority_reads));
+        reads_io_account->set_latency_target(CACHE_READS_IO_LATENCY_TARGET_MS * MILLION);
         writes_io_account.init(serializer->make_io_account(dynamic_config.io_priority_writes));
     }
 
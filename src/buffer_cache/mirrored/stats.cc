@@ -33,10 +33,12 @@ mc_cache_stats_t::mc_cache_stats_t(perfmon_collection_t *parent)
       pm_transactions_starting(secs_to_ticks(1)),
       pm_transactions_active(secs_to_ticks(1)),
       pm_transactions_committing(secs_to_ticks(1)),
+      pm_transactions_throttling(secs_to_ticks(1)),
       pm_flushes_locking(secs_to_ticks(1)),
       pm_flushes_writing(secs_to_ticks(1)),
       pm_flushes_blocks(secs_to_ticks(1), true),
       pm_flushes_blocks_dirty(secs_to_ticks(1), true),
+      pm_flushes_target_blocks(secs_to_ticks(1), true),
       pm_n_blocks_in_memory(),
       pm_n_blocks_dirty(),
       pm_n_blocks_total(),
@@ -53,10 +55,12 @@ mc_cache_stats_t::mc_cache_stats_t(perfmon_collection_t *parent)
           &pm_transactions_starting, "transactions_starting",
           &pm_transactions_active, "transactions_active",
           &pm_transactions_committing, "transactions_committing",
+          &pm_transactions_throttling, "transactions_throttling",
           &pm_flushes_locking, "flushes_locking",
           &pm_flushes_writing, "flushes_writing",
           &pm_flushes_blocks, "flushes_blocks",
           &pm_flushes_blocks_dirty, "flushes_blocks_need_flush",
+          &pm_flushes_target_blocks, "flushes_target_blocks",
           &pm_n_blocks_in_memory, "blocks_in_memory",
           &pm_n_blocks_dirty, "blocks_dirty",
           &pm_n_blocks_total, "blocks_total",
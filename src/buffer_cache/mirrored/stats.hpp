@@ -28,7 +28,8 @@ struct mc_cache_stats_t {
     perfmon_duration_sampler_t
         pm_transactions_starting,
         pm_transactions_active,
-        pm_transactions_committing;
+        pm_transactions_committing,
+        pm_transactions_throttling;
 
 
     /* Used in writeback.hpp */
@@ -38,7 +39,8 @@ struct mc_cache_stats_t {
 
     perfmon_sampler_t
         pm_flushes_blocks,
-        pm_flushes_blocks_dirty;
+        pm_flushes_blocks_dirty,
+        pm_flushes_target_blocks;
 
     perfmon_counter_t
         pm_n_blocks_in_memory,
@@ -3,10 +3,13 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
 #include "arch/runtime/runtime.hpp"
+#include "arch/timing.hpp"
 #include "buffer_cache/mirrored/mirrored.hpp"
 #include "containers/scoped.hpp"
 #include "perfmon/perfmon.hpp"
@@ -30,6 +33,11 @@ writeback_t::writeback_t(
     flush_timer(NULL),
     writeback_in_progress(false),
     active_flushes(0),
+    dirty_rate_window_start(get_ticks()),
+    blocks_dirtied_in_window(0),
+    dirty_blocks_per_sec(0),
+    flushed_blocks_per_sec(0),
+    next_admission_time(0),
     dirty_block_semaphore(_max_dirty_blocks),
     cache(_cache),
     start_next_sync_immediately(false),
@@ -99,7 +107,8 @@ void writeback_t::begin_transaction(mc_transaction_t *txn) {
     if (txn->get_access() == rwi_write) {
 
         /* Throttling */
-        dirty_block_semaphore.co_lock(txn->expected_change_count);
+        throttle_smoothly(txn->expected_change_count);
+        dirty_block_semaphore.co_lock(dirty_block_reservation(txn));
 
         /* Acquire flush lock in non-exclusive mode */
         flush_lock.co_lock(rwi_read);
@@ -124,13 +133,16 @@ void writeback_t::begin_transaction(mc_transaction_t *txn) {
 
 void writeback_t::on_transaction_commit(mc_transaction_t *txn) {
     if (txn->get_access() == rwi_write) {
-        dirty_block_semaphore.unlock(txn->expected_change_count);
+        dirty_block_semaphore.unlock(dirty_block_reservation(txn));
 
         flush_lock.unlock();
 
         /* At the end of every write transaction, check if the number of dirty blocks exceeds the
         threshold to force writeback to start. */
-        if (num_dirty_blocks() > flush_threshold) {
+        update_dirty_rate();
+        const unsigned int threshold = adaptive_flush_threshold();
+        if (num_dirty_blocks() > threshold) {
+            cache->stats->pm_flushes_target_blocks.record(threshold);
             sync(NULL);
         } else if (num_dirty_blocks() > 0 && flush_time_randomizer.is_zero()) {
             sync(NULL);
@@ -155,6 +167,7 @@ void writeback_t::local_buf_t::set_dirty(bool _dirty) {
         dirty = true;
         if (!recency_dirty) {
             gbuf->cache->writeback.dirty_bufs.push_back(this);
+            ++gbuf->cache->writeback.blocks_dirtied_in_window;
             /* Use `force_lock()` to prevent deadlocks; `co_lock()` could block. */
             gbuf->cache->writeback.dirty_block_semaphore.force_lock();
         }
@@ -178,6 +191,7 @@ void writeback_t::local_buf_t::set_recency_dirty(bool _recency_dirty) {
         recency_dirty = true;
         if (!dirty) {
             gbuf->cache->writeback.dirty_bufs.push_back(this);
+            ++gbuf->cache->writeback.blocks_dirtied_in_window;
             gbuf->cache->writeback.dirty_block_semaphore.force_lock();
         }
         // TODO perfmon
@@ -206,6 +220,86 @@ bool writeback_t::can_read_ahead_block_be_accepted(block_id_t block_id) {
     return reject_read_ahead_blocks.find(block_id) == reject_read_ahead_blocks.end();
 }
 
+void writeback_t::update_dirty_rate() {
+    const ticks_t now = get_ticks();
+    const ticks_t elapsed = now - dirty_rate_window_start;
+    if (elapsed < WRITEBACK_RATE_WINDOW_MS * MILLION) {
+        return;
+    }
+    const double sample = blocks_dirtied_in_window / ticks_to_secs(elapsed);
+    dirty_blocks_per_sec = dirty_blocks_per_sec == 0
+        ? sample
+        : dirty_blocks_per_sec + (sample - dirty_blocks_per_sec) / 4;
+    dirty_rate_window_start = now;
+    blocks_dirtied_in_window = 0;
+}
+
+unsigned int writeback_t::adaptive_flush_threshold() {
+    if (dirty_blocks_per_sec == 0 || flush_time_randomizer.is_never_flush()) {
+        // We don't know anything yet, or we've been told to hold on to dirty blocks.
+        return flush_threshold;
+    }
+
+    double target = dirty_blocks_per_sec * WRITEBACK_TARGET_FLUSH_INTERVAL_MS / THOUSAND;
+
+    const ticks_t write_latency = cache->writes_io_account->get_average_latency();
+    const ticks_t target_latency = WRITEBACK_TARGET_WRITE_LATENCY_MS * MILLION;
+    if (write_latency > target_latency) {
+        target *= static_cast<double>(write_latency) / target_latency;
+    }
+
+    const unsigned int min_threshold = std::min<unsigned int>(WRITEBACK_MIN_FLUSH_BLOCKS, flush_threshold);
+    if (target < min_threshold) {
+        return min_threshold;
+    }
+    if (target > flush_threshold) {
+        return flush_threshold;
+    }
+    return static_cast<unsigned int>(target);
+}
+
+void writeback_t::record_flush_throughput(size_t blocks, ticks_t duration) {
+    if (duration == 0) {
+        return;
+    }
+    const double sample = blocks / ticks_to_secs(duration);
+    flushed_blocks_per_sec = flushed_blocks_per_sec == 0
+        ? sample
+        : flushed_blocks_per_sec + (sample - flushed_blocks_per_sec) / 4;
+}
+
+int writeback_t::dirty_block_reservation(const mc_transaction_t *txn) const {
+    return std::min<int>(txn->expected_change_count, max_dirty_blocks);
+}
+
+void writeback_t::throttle_smoothly(int expected_change_count) {
+    const double soft_limit = max_dirty_blocks * WRITEBACK_SOFT_THROTTLE_FRACTION;
+    const double dirty = num_dirty_blocks();
+    if (dirty <= soft_limit || flushed_blocks_per_sec == 0) {
+        return;
+    }
+
+    /* `pressure` goes from 0 at the soft limit to 1 at `max_dirty_blocks`. We admit
+    blocks at `flushed_blocks_per_sec / pressure`, so at the hard limit writers are
+    paced to exactly what the flushes manage to write out. */
+    const double pressure = std::min(1.0, (dirty - soft_limit) / (max_dirty_blocks - soft_limit));
+    const double interval_secs = std::max(expected_change_count, 1) * pressure / flushed_blocks_per_sec;
+
+    const ticks_t now = get_ticks();
+    const ticks_t admission_time = std::max(now, next_admission_time);
+    next_admission_time = admission_time + static_cast<ticks_t>(interval_secs * BILLION);
+
+    // Delays below the timer resolution add up in `next_admission_time` until they
+    // are worth sleeping for.
+    const int64_t delay_ms = (admission_time - now) / MILLION;
+    if (delay_ms > 0) {
+        ticks_t start_time;
+        cache->stats->pm_transactions_throttling.begin(&start_time);
+        nap(delay_ms);
+        cache->stats->pm_transactions_throttling.end(&start_time);
+    }
+}
+
 void writeback_t::on_timer() {
     // The flush timer callback.
 
@@ -356,8 +450,12 @@ void writeback_t::do_concurrent_flush() {
 
     // Now that preparations are complete, send the writes to the serializer
     if (!state.serializer_writes.empty()) {
-        on_thread_t switcher(cache->serializer->home_thread());
-        do_writes(cache->serializer, state.serializer_writes, cache->writes_io_account.get());
+        const ticks_t write_start_time = get_ticks();
+        {
+            on_thread_t switcher(cache->serializer->home_thread());
+            do_writes(cache->serializer, state.serializer_writes, cache->writes_io_account.get());
+        }
+        record_flush_throughput(state.serializer_writes.size(), get_ticks() - write_start_time);
     }
 
     // Once transaction has completed, perform cleanup.
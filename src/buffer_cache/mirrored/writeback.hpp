@@ -110,6 +110,39 @@ private:
     bool writeback_in_progress;
     unsigned int active_flushes;
 
+    /* Adaptive flushing. Rather than letting dirty blocks pile up until the flush
+    timer goes off or `flush_threshold` is reached and then writing them out in one big
+    burst, we keep track of how fast blocks are being dirtied and start a flush whenever
+    about `WRITEBACK_TARGET_FLUSH_INTERVAL_MS` worth of them has accumulated. If the
+    disk is slow to answer (according to the write account's average latency), flushes
+    are allowed to grow so that more overwrites get coalesced.
+
+    We can't flush only part of the dirty blocks, because a flush has to capture a
+    consistent state of the cache; so "right-sized batches" means starting flushes at
+    the right time. If another flush is still writing, the next one starts as soon as
+    `max_concurrent_flushes` allows. */
+    void update_dirty_rate();
+    unsigned int adaptive_flush_threshold();
+    void record_flush_throughput(size_t blocks, ticks_t duration);
+
+    ticks_t dirty_rate_window_start;
+    unsigned int blocks_dirtied_in_window;
+    double dirty_blocks_per_sec;
+    double flushed_blocks_per_sec;
+
+    /* Smooth throttling. Past `WRITEBACK_SOFT_THROTTLE_FRACTION` of `max_dirty_blocks`,
+    write transactions are admitted at a rate that drops towards the rate at which
+    flushes are writing blocks out as the number of dirty blocks approaches
+    `max_dirty_blocks`. `dirty_block_semaphore` remains the hard limit. */
+    void throttle_smoothly(int expected_change_count);
+
+    /* How much of `dirty_block_semaphore` a write transaction holds. Large
+    transactions, such as a backfill chunk of a whole leaf, are capped at
+    `max_dirty_blocks`, or they would never get in. */
+    int dirty_block_reservation(const mc_transaction_t *txn) const;
+
+    ticks_t next_admission_time;
+
     /* Use `adjustable_semaphore_t` instead of `semaphore_t` so we can get `force_lock()`. */
     adjustable_semaphore_t dirty_block_semaphore;
 
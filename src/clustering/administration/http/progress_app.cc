@@ -22,11 +22,11 @@ static const uint64_t MAX_PROGRESS_REQ_TIMEOUT_MS = 60*1000;
 /* A record of a request made to another peer for progress on a backfill. */
 class request_record_t {
 public:
-    scoped_ptr_t<promise_t<std::pair<int, int> > > promise;
-    scoped_ptr_t<mailbox_t<void(std::pair<int, int>)> > resp_mbox;
+    scoped_ptr_t<promise_t<backfill_progress_report_t> > promise;
+    scoped_ptr_t<mailbox_t<void(backfill_progress_report_t)> > resp_mbox;
 
     // TODO: We take ownership of these pointers?  Look at users.
-    request_record_t(promise_t<std::pair<int, int> > *_promise, mailbox_t<void(std::pair<int, int>)> *_resp_mbox)
+    request_record_t(promise_t<backfill_progress_report_t> *_promise, mailbox_t<void(backfill_progress_report_t)> *_resp_mbox)
         : promise(_promise), resp_mbox(_resp_mbox)
     { }
 };
@@ -146,10 +146,10 @@ void send_backfill_requests_t::handle_request_internal(const reactor_business_ca
 
     boost::optional<backfiller_business_card_t<rdb_protocol_t> > backfiller = boost::apply_visitor(get_backfiller_business_card_t<rdb_protocol_t>(), region_activity_entry.activity);
     if (backfiller) {
-        promise_t<std::pair<int, int> > *value = new promise_t<std::pair<int, int> >;
-        mailbox_t<void(std::pair<int, int>)> *resp_mbox = new mailbox_t<void(std::pair<int, int>)>(
+        promise_t<backfill_progress_report_t> *value = new promise_t<backfill_progress_report_t>;
+        mailbox_t<void(backfill_progress_report_t)> *resp_mbox = new mailbox_t<void(backfill_progress_report_t)>(
             mbox_manager,
-            boost::bind(&promise_t<std::pair<int, int> >::pulse, value, _1),
+            boost::bind(&promise_t<backfill_progress_report_t>::pulse, value, _1),
             mailbox_callback_mode_inline);
 
         send(mbox_manager, backfiller->request_progress_mailbox, loc.backfill_session_id, resp_mbox->get_address());
@@ -360,12 +360,17 @@ http_res_t progress_app_t::handle(const http_req_t &req) {
                     waiter.wait();
 
                     if (r_it->second->promise->get_ready_signal()->is_pulsed()) {
-                        /* The promise is pulsed, we got an answer. */
-                        std::pair<int, int> response = r_it->second->promise->wait();
-                        cJSON *pair = cJSON_CreateArray();
-                        cJSON_AddItemToArray(pair, cJSON_CreateNumber(response.first));
-                        cJSON_AddItemToArray(pair, cJSON_CreateNumber(response.second));
-                        cJSON_AddItemToArray(region_info, pair);
+                        /* The promise is pulsed, we got an answer. The first two
+                         * entries are the released and total node counts; the
+                         * throughput and ETA come after them so that readers
+                         * that only know about the first two keep working. */
+                        backfill_progress_report_t response = r_it->second->promise->wait();
+                        cJSON *progress = cJSON_CreateArray();
+                        cJSON_AddItemToArray(progress, cJSON_CreateNumber(response.released_nodes));
+                        cJSON_AddItemToArray(progress, cJSON_CreateNumber(response.total_nodes));
+                        cJSON_AddItemToArray(progress, cJSON_CreateNumber(response.bytes_per_sec));
+                        cJSON_AddItemToArray(progress, cJSON_CreateNumber(response.eta_secs));
+                        cJSON_AddItemToArray(region_info, progress);
                     } else {
                         /* The promise is not pulsed.. we timed out. */
                         cJSON_AddItemToArray(region_info, cJSON_CreateString("Timeout"));
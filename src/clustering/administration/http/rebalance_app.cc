@@ -0,0 +1,261 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "clustering/administration/http/rebalance_app.hpp"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/variant.hpp>
+
+#include "arch/timing.hpp"
+#include "clustering/administration/stat_manager.hpp"
+#include "clustering/administration/suggester.hpp"
+#include "config/args.hpp"
+#include "containers/uuid.hpp"
+#include "http/json.hpp"
+#include "memcached/protocol.hpp"
+#include "memcached/protocol_json_adapter.hpp"
+#include "perfmon/archive.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "stl_utils.hpp"
+
+static const uint64_t REBALANCE_STATS_TIMEOUT_MS = 1000;
+static const int REBALANCE_DISTRIBUTION_DEPTH = 2;
+static const size_t REBALANCE_DISTRIBUTION_LIMIT = 1024;
+
+class shard_load_request_t {
+public:
+    explicit shard_load_request_t(mailbox_manager_t *mbox_manager)
+        : response_mailbox(mbox_manager, boost::bind(&promise_t<perfmon_result_t>::pulse, &stats, _1), mailbox_callback_mode_inline)
+    { }
+    promise_t<perfmon_result_t> stats;
+    mailbox_t<void(perfmon_result_t)> response_mailbox;
+};
+
+static const perfmon_result_t *get_stat(const perfmon_result_t *stats, const std::string &name) {
+    if (stats == NULL || !stats->is_map()) {
+        return NULL;
+    }
+    perfmon_result_t::const_iterator it = stats->get_map()->find(name);
+    return it == stats->get_map()->end() ? NULL : it->second;
+}
+
+static double get_rate(const perfmon_result_t *stats, const std::string &name) {
+    const perfmon_result_t *rate = get_stat(stats, name);
+    if (rate == NULL || !rate->is_string()) {
+        return 0;
+    }
+    return strtod(rate->get_string()->c_str(), NULL);
+}
+
+static std::map<store_key_t, int64_t> get_key_distribution(namespace_interface_t<memcached_protocol_t> *namespace_if, signal_t *interruptor) {
+    memcached_protocol_t::read_t read(distribution_get_query_t(REBALANCE_DISTRIBUTION_DEPTH, REBALANCE_DISTRIBUTION_LIMIT), time(NULL));
+    memcached_protocol_t::read_response_t response;
+    namespace_if->read_outdated(read, &response, interruptor);
+    return boost::get<distribution_result_t>(response.result).key_counts;
+}
+
+static std::map<store_key_t, int64_t> get_key_distribution(namespace_interface_t<rdb_protocol_t> *namespace_if, signal_t *interruptor) {
+    rdb_protocol_t::read_t read(rdb_protocol_t::distribution_read_t(REBALANCE_DISTRIBUTION_DEPTH, REBALANCE_DISTRIBUTION_LIMIT));
+    rdb_protocol_t::read_response_t response;
+    namespace_if->read_outdated(read, &response, interruptor);
+    return boost::get<rdb_protocol_t::distribution_read_response_t>(response.response).key_counts;
+}
+
+rebalance_http_app_t::rebalance_http_app_t(mailbox_manager_t *_mbox_manager,
+                                           metadata_change_handler_t<cluster_semilattice_metadata_t> *_metadata_change_handler,
+                                           const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > &_directory_metadata,
+                                           namespace_repo_t<memcached_protocol_t> *_ns_repo,
+                                           namespace_repo_t<rdb_protocol_t> *_rdb_ns_repo,
+                                           uuid_u _us)
+    : mbox_manager(_mbox_manager),
+      metadata_change_handler(_metadata_change_handler),
+      directory_metadata(_directory_metadata),
+      ns_repo(_ns_repo),
+      rdb_ns_repo(_rdb_ns_repo),
+      us(_us)
+{ }
+
+http_res_t rebalance_http_app_t::handle(const http_req_t &req) {
+    if (req.method != GET && req.method != POST) {
+        return http_res_t(HTTP_METHOD_NOT_ALLOWED);
+    }
+
+    boost::optional<std::string> maybe_n_id = req.find_query_param("namespace");
+    if (!maybe_n_id || !is_uuid(*maybe_n_id)) {
+        return http_error_res("Valid uuid required for query parameter \"namespace\"\n");
+    }
+    namespace_id_t n_id = str_to_uuid(*maybe_n_id);
+
+    cluster_semilattice_metadata_t cluster_metadata = metadata_change_handler->get();
+    if (std_contains(cluster_metadata.memcached_namespaces->namespaces, n_id)) {
+        return handle_namespace<memcached_protocol_t>(req, &cluster_metadata, &cluster_metadata.memcached_namespaces, ns_repo, n_id);
+    } else if (std_contains(cluster_metadata.rdb_namespaces->namespaces, n_id)) {
+        return handle_namespace<rdb_protocol_t>(req, &cluster_metadata, &cluster_metadata.rdb_namespaces, rdb_ns_repo, n_id);
+    } else {
+        return http_res_t(HTTP_NOT_FOUND);
+    }
+}
+
+template <class protocol_t>
+http_res_t rebalance_http_app_t::handle_namespace(const http_req_t &req,
+                                                  cluster_semilattice_metadata_t *cluster_metadata,
+                                                  cow_ptr_t<namespaces_semilattice_metadata_t<protocol_t> > *namespaces,
+                                                  namespace_repo_t<protocol_t> *repo,
+                                                  const namespace_id_t &namespace_id) {
+    const deletable_t<namespace_semilattice_metadata_t<protocol_t> > &ns =
+        (*namespaces)->namespaces.find(namespace_id)->second;
+    if (ns.is_deleted()) {
+        return http_res_t(HTTP_NOT_FOUND);
+    }
+    if (ns.get().shards.in_conflict()) {
+        return http_error_res("Table shards are in conflict.\n");
+    }
+    const nonoverlapping_regions_t<protocol_t> shards = ns.get().shards.get();
+
+    uint64_t num_shards = shards.size();
+    boost::optional<std::string> maybe_shards = req.find_query_param("shards");
+    if (maybe_shards) {
+        if (!strtou64_strict(maybe_shards.get(), 10, &num_shards) || num_shards == 0 || num_shards > REBALANCE_DISTRIBUTION_LIMIT) {
+            return http_error_res("Invalid shards value.");
+        }
+    }
+
+    std::map<std::string, double> loads = get_shard_loads(namespace_id);
+
+    std::vector<std::pair<key_range_t, double> > shard_loads;
+    bool all_loads_known = true;
+    scoped_cJSON_t shards_json(cJSON_CreateArray());
+    for (typename nonoverlapping_regions_t<protocol_t>::iterator it = shards.begin(); it != shards.end(); ++it) {
+        typename protocol_t::region_t region = *it;
+        std::string region_name = render_region_as_string(&region);
+        std::map<std::string, double>::const_iterator load = loads.find(region_name);
+        all_loads_known = all_loads_known && load != loads.end();
+        shard_loads.push_back(std::make_pair(region.inner, load == loads.end() ? 0.0 : load->second));
+
+        scoped_cJSON_t shard_json(cJSON_CreateObject());
+        shard_json.AddItemToObject("region", cJSON_CreateString(region_name.c_str()));
+        shard_json.AddItemToObject("load", cJSON_CreateNumber(shard_loads.back().second));
+        shards_json.AddItemToArray(shard_json.release());
+    }
+
+    std::map<store_key_t, int64_t> key_counts;
+    try {
+        cond_t interrupt;
+        typename namespace_repo_t<protocol_t>::access_t ns_access(repo, namespace_id, &interrupt);
+        key_counts = get_key_distribution(ns_access.get_namespace_if(), &interrupt);
+    } catch (const cannot_perform_query_exc_t &) {
+        return http_res_t(HTTP_INTERNAL_SERVER_ERROR);
+    }
+
+    std::vector<store_key_t> split_points;
+    bool have_suggestion = suggest_split_points_by_load(shard_loads, key_counts, num_shards, &split_points);
+
+    scoped_cJSON_t split_points_json(cJSON_CreateArray());
+    for (size_t i = 0; i < split_points.size(); ++i) {
+        split_points_json.AddItemToArray(render_as_json(&split_points[i]));
+    }
+
+    if (req.method == POST) {
+        /* Applying a partial suggestion would merge shards we know nothing about
+        and throw away every pinning, so we'd rather not do anything. */
+        if (!all_loads_known) {
+            return http_error_res("Couldn't get the load on every shard of the table; try again later.\n");
+        }
+        if (!have_suggestion) {
+            return http_error_res(strprintf("The table doesn't have enough load or keys to be split into %" PRIu64 " shards by load.\n", num_shards));
+        }
+
+        std::vector<typename protocol_t::region_t> new_regions;
+        for (size_t i = 0; i <= split_points.size(); ++i) {
+            key_range_t range;
+            range.left = i == 0 ? store_key_t::min() : split_points[i - 1];
+            range.right = i < split_points.size()
+                ? key_range_t::right_bound_t(split_points[i])
+                : key_range_t::right_bound_t();
+            new_regions.push_back(typename protocol_t::region_t(range));
+        }
+        nonoverlapping_regions_t<protocol_t> new_shards;
+        bool success = new_shards.set_regions(new_regions);
+        guarantee(success);
+
+        {
+            typename cow_ptr_t<namespaces_semilattice_metadata_t<protocol_t> >::change_t change(namespaces);
+            namespace_semilattice_metadata_t<protocol_t> *ns_change = change.get()->namespaces[namespace_id].get_mutable();
+            ns_change->shards = ns_change->shards.make_new_version(new_shards, us);
+
+            // Any time shards are changed, we destroy existing pinnings
+            region_map_t<protocol_t, machine_id_t> new_primaries(protocol_t::region_t::universe(), nil_uuid());
+            region_map_t<protocol_t, std::set<machine_id_t> > new_secondaries(protocol_t::region_t::universe(), std::set<machine_id_t>());
+            ns_change->primary_pinnings = ns_change->primary_pinnings.make_resolving_version(new_primaries, us);
+            ns_change->secondary_pinnings = ns_change->secondary_pinnings.make_resolving_version(new_secondaries, us);
+        }
+
+        try {
+            fill_in_blueprints(cluster_metadata, directory_metadata->get(), us, false);
+        } catch (const missing_machine_exc_t &e) { }
+
+        logINF("Rebalancing table %s into %zu shards by load", uuid_to_str(namespace_id).c_str(), new_regions.size());
+        metadata_change_handler->update(*cluster_metadata);
+    }
+
+    scoped_cJSON_t body(cJSON_CreateObject());
+    body.AddItemToObject("shards", shards_json.release());
+    body.AddItemToObject("split_points", split_points_json.release());
+    body.AddItemToObject("applied", cJSON_CreateBool(req.method == POST));
+    return http_json_res(body.get());
+}
+
+std::map<std::string, double> rebalance_http_app_t::get_shard_loads(const namespace_id_t &namespace_id) {
+    std::set<stat_manager_t::stat_id_t> filter;
+    filter.insert(uuid_to_str(namespace_id) + "/regions");
+
+    std::map<peer_id_t, cluster_directory_metadata_t> directory = directory_metadata->get();
+    boost::ptr_vector<shard_load_request_t> requests;
+    for (std::map<peer_id_t, cluster_directory_metadata_t>::iterator it = directory.begin(); it != directory.end(); ++it) {
+        if (it->second.peer_type == SERVER_PEER) {
+            requests.push_back(new shard_load_request_t(mbox_manager));
+            send(mbox_manager, it->second.get_stats_mailbox_address, requests.back().response_mailbox.get_address(), filter);
+        }
+    }
+
+    /* A machine that doesn't answer in time just doesn't count towards the load;
+    the suggestion will be a little off, but it's only a suggestion. */
+    signal_timer_t timer(REBALANCE_STATS_TIMEOUT_MS);
+    std::map<std::string, double> loads;
+    for (boost::ptr_vector<shard_load_request_t>::iterator it = requests.begin(); it != requests.end(); ++it) {
+        const signal_t *stats_ready = it->stats.get_ready_signal();
+        wait_any_t waiter(&timer, stats_ready);
+        waiter.wait();
+        if (!stats_ready->is_pulsed()) {
+            continue;
+        }
+
+        perfmon_result_t stats = it->stats.wait();
+        const perfmon_result_t *regions = get_stat(get_stat(&stats, uuid_to_str(namespace_id)), "regions");
+        if (regions == NULL || !regions->is_map()) {
+            continue;
+        }
+        /* The primaries are named "be_primary_<id>_<region>"; the hash shards of
+        a key range all add to that range's load. */
+        const std::string prefix = "be_primary_";
+        for (perfmon_result_t::const_iterator jt = regions->begin(); jt != regions->end(); ++jt) {
+            if (jt->first.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            size_t id_end = jt->first.find('_', prefix.size());
+            if (id_end == std::string::npos) {
+                continue;
+            }
+            const perfmon_result_t *broadcaster = get_stat(jt->second, "broadcaster");
+            loads[jt->first.substr(id_end + 1)] +=
+                get_rate(broadcaster, "reads_per_sec") + SHARD_LOAD_WRITE_WEIGHT * get_rate(broadcaster, "writes_per_sec");
+        }
+    }
+    return loads;
+}
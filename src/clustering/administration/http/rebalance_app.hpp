@@ -0,0 +1,62 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_REBALANCE_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_REBALANCE_APP_HPP_
+
+#include <map>
+#include <string>
+
+#include "clustering/administration/metadata.hpp"
+#include "clustering/administration/metadata_change_handler.hpp"
+#include "clustering/administration/namespace_interface_repository.hpp"
+#include "containers/clone_ptr.hpp"
+#include "http/http.hpp"
+
+class memcached_protocol_t;
+struct rdb_protocol_t;
+
+/* `rebalance_http_app_t` suggests new split points for a table based on how busy
+each of its shards is, rather than on how many keys each shard has. Each shard's
+load comes from the `reads_per_sec` and `writes_per_sec` stats of its primary's
+broadcaster; the table's key distribution tells us where to put split points
+within a shard.
+
+`GET /ajax/rebalance?namespace=<UUID>[&shards=<N>]` previews the suggestion, and
+`POST` with the same parameters applies it. `POST` fails instead if some shard's
+load is unknown, or if the load doesn't give a split point for every new shard
+(for example because the table is idle). Applying a suggestion replaces the
+table's shards and clears its pinnings, just like splitting or merging shards
+does, so the blueprint suggester then spreads the new, evenly loaded shards over
+the machines. */
+class rebalance_http_app_t : public http_app_t {
+public:
+    rebalance_http_app_t(mailbox_manager_t *_mbox_manager,
+                         metadata_change_handler_t<cluster_semilattice_metadata_t> *_metadata_change_handler,
+                         const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > &_directory_metadata,
+                         namespace_repo_t<memcached_protocol_t> *_ns_repo,
+                         namespace_repo_t<rdb_protocol_t> *_rdb_ns_repo,
+                         uuid_u _us);
+    http_res_t handle(const http_req_t &req);
+
+private:
+    template <class protocol_t>
+    http_res_t handle_namespace(const http_req_t &req,
+                                cluster_semilattice_metadata_t *cluster_metadata,
+                                cow_ptr_t<namespaces_semilattice_metadata_t<protocol_t> > *namespaces,
+                                namespace_repo_t<protocol_t> *repo,
+                                const namespace_id_t &namespace_id);
+
+    /* Returns the load on each shard of the table, summed over all the machines
+    that answered in time. */
+    std::map<std::string, double> get_shard_loads(const namespace_id_t &namespace_id);
+
+    mailbox_manager_t *mbox_manager;
+    metadata_change_handler_t<cluster_semilattice_metadata_t> *metadata_change_handler;
+    clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > directory_metadata;
+    namespace_repo_t<memcached_protocol_t> *ns_repo;
+    namespace_repo_t<rdb_protocol_t> *rdb_ns_repo;
+    uuid_u us;
+
+    DISABLE_COPYING(rebalance_http_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_REBALANCE_APP_HPP_ */
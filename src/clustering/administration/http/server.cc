@@ -8,6 +8,7 @@
 #include "clustering/administration/http/last_seen_app.hpp"
 #include "clustering/administration/http/log_app.hpp"
 #include "clustering/administration/http/progress_app.hpp"
+#include "clustering/administration/http/rebalance_app.hpp"
 #include "clustering/administration/http/semilattice_app.hpp"
 #include "clustering/administration/http/stat_app.hpp"
 #include "clustering/administration/http/combining_app.hpp"
@@ -230,6 +231,8 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
     progress_app.init(new progress_app_t(_directory_metadata, mbox_manager));
     distribution_app.init(new distribution_app_t(metadata_field(&cluster_semilattice_metadata_t::memcached_namespaces, _semilattice_metadata), _namespace_repo,
                                                  metadata_field(&cluster_semilattice_metadata_t::rdb_namespaces, _semilattice_metadata), _rdb_namespace_repo));
+    rebalance_app.init(new rebalance_http_app_t(mbox_manager, _metadata_change_handler, _directory_metadata,
+                                                _namespace_repo, _rdb_namespace_repo, _us));
 
 #ifndef NDEBUG
     cyanide_app.init(new cyanide_http_app_t);
@@ -243,6 +246,7 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
     ajax_routes["log"] = log_app.get();
     ajax_routes["progress"] = progress_app.get();
     ajax_routes["distribution"] = distribution_app.get();
+    ajax_routes["rebalance"] = rebalance_app.get();
     ajax_routes["semilattice"] = semilattice_app.get();
     ajax_routes["reql"] = reql_app;
     DEBUG_ONLY_CODE(ajax_routes["cyanide"] = cyanide_app.get());
@@ -26,6 +26,7 @@ class log_http_app_t;
 class progress_app_t;
 class stat_manager_t;
 class distribution_app_t;
+class rebalance_http_app_t;
 class cyanide_http_app_t;
 class combining_http_app_t;
 
@@ -59,6 +60,7 @@ private:
     scoped_ptr_t<log_http_app_t> log_app;
     scoped_ptr_t<progress_app_t> progress_app;
     scoped_ptr_t<distribution_app_t> distribution_app;
+    scoped_ptr_t<rebalance_http_app_t> rebalance_app;
     scoped_ptr_t<combining_http_app_t> combining_app;
 #ifndef NDEBUG
     scoped_ptr_t<cyanide_http_app_t> cyanide_app;
@@ -363,6 +363,7 @@ service_address_ports_t get_service_address_ports(const std::map<std::string, op
 #else
                                    port_defaults::client_port,
 #endif
+                                   exists_option(opts, "--no-cluster-compression"),
                                    exists_option(opts, "--no-http-admin"),
                                    offseted_port(get_single_int(opts, "--http-port"), port_offset),
                                    offseted_port(get_single_int(opts, "--driver-port"), port_offset),
@@ -681,6 +682,10 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              strprintf("%d", port_defaults::peer_port)));
     help.add("--cluster-port port", "port for receiving connections from other nodes");
 
+    options_out->push_back(options::option_t(options::names_t("--no-cluster-compression"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--no-cluster-compression", "don't compress large messages sent to other nodes");
+
 #ifndef NDEBUG
     options_out->push_back(options::option_t(options::names_t("--client-port"),
                                              options::OPTIONAL,
@@ -137,7 +137,8 @@ bool do_serve(
                                                                address_ports.port,
                                                                &message_multiplexer_run,
                                                                address_ports.client_port,
-                                                               &heartbeat_manager);
+                                                               &heartbeat_manager,
+                                                               !address_ports.cluster_compression_is_disabled);
 
         // If (0 == port), then we asked the OS to give us a port number.
         if (address_ports.port != 0) {
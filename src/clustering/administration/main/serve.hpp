@@ -27,6 +27,7 @@ struct service_address_ports_t {
     service_address_ports_t() :
         port(0),
         client_port(0),
+        cluster_compression_is_disabled(false),
         http_port(0),
         reql_port(0),
         port_offset(0) { }
@@ -34,6 +35,7 @@ struct service_address_ports_t {
     service_address_ports_t(const std::set<ip_address_t> &_local_addresses,
                             int _port,
                             int _client_port,
+                            bool _cluster_compression_is_disabled,
                             bool _http_admin_is_disabled,
                             int _http_port,
                             int _reql_port,
@@ -41,6 +43,7 @@ struct service_address_ports_t {
         local_addresses(_local_addresses),
         port(_port),
         client_port(_client_port),
+        cluster_compression_is_disabled(_cluster_compression_is_disabled),
         http_admin_is_disabled(_http_admin_is_disabled),
         http_port(_http_port),
         reql_port(_reql_port),
@@ -59,6 +62,7 @@ struct service_address_ports_t {
     std::set<ip_address_t> local_addresses;
     int port;
     int client_port;
+    bool cluster_compression_is_disabled;
     bool http_admin_is_disabled;
     int http_port;
     int reql_port;
@@ -43,7 +43,7 @@ static void write_blob(transaction_t *txn, char *ref, int maxreflen, const T &va
     std::string str;
     str.reserve(slen);
     for (write_buffer_t *p = buffers->head(); p != NULL; p = buffers->next(p)) {
-        str.append(p->data, p->size);
+        str.append(p->get_data(), p->size);
     }
     guarantee(str.size() == slen);
     blob_t blob(ref, maxreflen);
@@ -7,10 +7,9 @@
 #include "concurrency/fifo_enforcer_queue.hpp"
 #include "concurrency/promise.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
+#include "config/args.hpp"
 #include "containers/death_runner.hpp"
 
-#define ALLOCATION_CHUNK 50
-
 template <class protocol_t>
 struct backfill_queue_entry_t {
     // TODO: The fact that fifo_enforcer_queue_t requires a default
@@ -50,7 +49,7 @@ public:
                      fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *_chunk_queue, mailbox_manager_t *_mbox_manager,
                      mailbox_addr_t<void(int)> _allocation_mailbox) :
         svs(_svs), chunk_queue(_chunk_queue), mbox_manager(_mbox_manager),
-        allocation_mailbox(_allocation_mailbox), unacked_chunks(0),
+        allocation_mailbox(_allocation_mailbox), unacked_keys(0),
         done_message_arrived(false), num_outstanding_chunks(0)
     { }
 
@@ -80,22 +79,22 @@ public:
                 // We acquire the write token in apply_backfill_chunk.
                 apply_backfill_chunk(chunk.write_token, chunk.chunk, interruptor);
 
-                /* Allow the backfiller to send us more data */
-                int chunks_to_send_out = 0;
+                /* Allow the backfiller to send us more data. We hand back
+                   exactly the credit the backfiller charged for the chunk. */
+                int keys_to_send_out = 0;
                 {
                     /* Notice it's important that we don't wait while we're
-                     * modifying unacked chunks, otherwise another callback may
+                     * modifying unacked keys, otherwise another callback may
                      * decided to send out an allocation as well. */
                     ASSERT_NO_CORO_WAITING;
-                    ++unacked_chunks;
-                    guarantee(unacked_chunks <= ALLOCATION_CHUNK);
-                    if (unacked_chunks == ALLOCATION_CHUNK) {
-                        unacked_chunks = 0;
-                        chunks_to_send_out = ALLOCATION_CHUNK;
+                    unacked_keys += backfill_chunk_credit<protocol_t>(chunk.chunk);
+                    if (unacked_keys >= BACKFILL_CREDIT_GRANT_KEYS) {
+                        keys_to_send_out = unacked_keys;
+                        unacked_keys = 0;
                     }
                 }
-                if (chunks_to_send_out != 0) {
-                    send(mbox_manager, allocation_mailbox, chunks_to_send_out);
+                if (keys_to_send_out != 0) {
+                    send(mbox_manager, allocation_mailbox, keys_to_send_out);
                 }
 
                 num_outstanding_chunks--;
@@ -128,7 +127,7 @@ private:
     fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *chunk_queue;
     mailbox_manager_t *mbox_manager;
     mailbox_addr_t<void(int)> allocation_mailbox;
-    int unacked_chunks;
+    int unacked_keys;
     bool done_message_arrived;
     int num_outstanding_chunks;
 
@@ -252,6 +251,12 @@ void backfillee(
             guarantee(got_value);
         }
 
+        /* The backfiller doesn't send any chunks until we give it credit. We give it
+        the whole window right away; the chunks will wait in `chunk_queue` while we
+        set up the metainfo below, and after that they are applied while the
+        backfiller goes on traversing. */
+        send(mailbox_manager, allocation_mailbox, static_cast<int>(BACKFILL_MAX_KEYS_IN_FLIGHT));
+
         /* Wait until we get a message in `end_point_mailbox`. */
         {
             wait_any_t waiter(end_point_cond.get_ready_signal(), backfiller.get_failed_signal());
@@ -321,7 +326,7 @@ void backfillee(
 
         chunk_callback_t<protocol_t> chunk_callback(svs, &chunk_queue, mailbox_manager, allocation_mailbox);
 
-        coro_pool_t<backfill_queue_entry_t<protocol_t> > backfill_workers(10, &chunk_queue, &chunk_callback);
+        coro_pool_t<backfill_queue_entry_t<protocol_t> > backfill_workers(BACKFILL_RECEIVER_WORKERS, &chunk_queue, &chunk_callback);
 
         /* Now wait for the backfill to be over */
         {
@@ -5,11 +5,10 @@
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/semaphore.hpp"
+#include "config/args.hpp"
 #include "rpc/semilattice/view.hpp"
 #include "stl_utils.hpp"
 
-#define MAX_CHUNKS_OUT 5000
-
 inline state_timestamp_t get_earliest_timestamp_of_version_range(const version_range_t &vr) {
     return vr.earliest.timestamp;
 }
@@ -85,17 +84,10 @@ bool backfiller_t<protocol_t>::confirm_and_send_metainfo(typename store_view_t<p
     return true;
 }
 
-template <class protocol_t>
-void do_send_chunk(mailbox_manager_t *mbox_manager,
-                   mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_addr,
-                   const typename protocol_t::backfill_chunk_t &chunk,
-                   fifo_enforcer_source_t *fifo_src,
-                   semaphore_t *chunk_semaphore,
-                   signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-    chunk_semaphore->co_lock_interruptible(interruptor);
-    send(mbox_manager, chunk_addr, chunk, fifo_src->enter_write());
-}
-
+/* The traversal hands us chunks one at a time. Each chunk waits for credit from the
+backfillee for the keys it carries, but then it is serialized and sent in its own coroutine, so that the
+traversal can go on producing chunks while earlier ones are on their way. The fifo
+tokens let the backfillee put the chunks back in order. */
 template <class protocol_t>
 class backfiller_send_backfill_callback_t : public send_backfill_callback_t<protocol_t> {
 public:
@@ -104,14 +96,17 @@ public:
                                         mailbox_manager_t *mailbox_manager,
                                         mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_cont,
                                         fifo_enforcer_source_t *fifo_src,
-                                        semaphore_t *chunk_semaphore,
+                                        semaphore_t *chunk_credit,
+                                        backfill_rate_meter_t *rate_meter,
                                         backfiller_t<protocol_t> *backfiller)
         : start_point_(start_point),
           end_point_cont_(end_point_cont),
           mailbox_manager_(mailbox_manager),
           chunk_cont_(chunk_cont),
           fifo_src_(fifo_src),
-          chunk_semaphore_(chunk_semaphore),
+          chunk_credit_(chunk_credit),
+          send_slots_(BACKFILL_MAX_CONCURRENT_SENDS),
+          rate_meter_(rate_meter),
           backfiller_(backfiller) { }
 
     bool should_backfill_impl(const typename store_view_t<protocol_t>::metainfo_t &metainfo) {
@@ -119,17 +114,40 @@ public:
     }
 
     void send_chunk(const typename protocol_t::backfill_chunk_t &chunk, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-        do_send_chunk<protocol_t>(mailbox_manager_, chunk_cont_, chunk, fifo_src_, chunk_semaphore_, interruptor);
+        chunk_credit_->co_lock_interruptible(interruptor, backfill_chunk_credit<protocol_t>(chunk));
+        send_slots_.co_lock_interruptible(interruptor);
+        fifo_enforcer_write_token_t token = fifo_src_->enter_write();
+        coro_t::spawn_sometime(boost::bind(&backfiller_send_backfill_callback_t<protocol_t>::do_send_chunk, this,
+                                           chunk, token, rate_meter_->on_chunk(), auto_drainer_t::lock_t(&drainer_)));
     }
+
 private:
+    void do_send_chunk(const typename protocol_t::backfill_chunk_t &chunk,
+                       fifo_enforcer_write_token_t token,
+                       bool measure,
+                       UNUSED auto_drainer_t::lock_t keepalive) {
+        if (measure) {
+            write_message_t msg;
+            msg << chunk;
+            rate_meter_->on_chunk_measured(msg.size());
+        }
+        send(mailbox_manager_, chunk_cont_, chunk, token);
+        send_slots_.unlock();
+    }
+
     const region_map_t<protocol_t, version_range_t> *start_point_;
     mailbox_addr_t<void(region_map_t<protocol_t, version_range_t>, branch_history_t<protocol_t>)> end_point_cont_;
     mailbox_manager_t *mailbox_manager_;
     mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_cont_;
     fifo_enforcer_source_t *fifo_src_;
-    semaphore_t *chunk_semaphore_;
+    semaphore_t *chunk_credit_;
+    semaphore_t send_slots_;
+    backfill_rate_meter_t *rate_meter_;
     backfiller_t<protocol_t> *backfiller_;
 
+    // Waits for the sends that are still in progress when we are destroyed.
+    auto_drainer_t drainer_;
+
     DISABLE_COPYING(backfiller_send_backfill_callback_t);
 };
 
@@ -154,14 +172,19 @@ void backfiller_t<protocol_t>::on_backfill(backfill_session_id_t session_id,
     /* Set up a local progress monitor so people can query us for progress. */
     traversal_progress_combiner_t local_progress;
     map_insertion_sentry_t<backfill_session_id_t, traversal_progress_combiner_t *> display_progress(&local_backfill_progress, session_id, &local_progress);
+    backfill_rate_meter_t local_rate;
+    map_insertion_sentry_t<backfill_session_id_t, backfill_rate_meter_t *> display_rate(&local_backfill_rates, session_id, &local_rate);
 
     /* Set up a cond that gets pulsed if we're interrupted by either the
        backfillee stopping or the backfiller destructor being called, but don't
        wait on that cond yet. */
     wait_any_t interrupted(&local_interruptor, keepalive.get_drain_signal());
 
-    semaphore_t chunk_semaphore(MAX_CHUNKS_OUT);
-    mailbox_t<void(int)> receive_allocations_mbox(mailbox_manager, boost::bind(&semaphore_t::unlock, &chunk_semaphore, _1), mailbox_callback_mode_inline);
+    /* We may only send as many keys as the backfillee has granted us credit for, and
+    it hasn't granted us any yet. */
+    semaphore_t chunk_credit(BACKFILL_MAX_KEYS_IN_FLIGHT);
+    chunk_credit.lock_now(BACKFILL_MAX_KEYS_IN_FLIGHT);
+    mailbox_t<void(int)> receive_allocations_mbox(mailbox_manager, boost::bind(&semaphore_t::unlock, &chunk_credit, _1), mailbox_callback_mode_inline);
     send(mailbox_manager, allocation_registration_box, receive_allocations_mbox.get_address());
 
     try {
@@ -177,7 +200,7 @@ void backfiller_t<protocol_t>::on_backfill(backfill_session_id_t session_id,
         svs->new_read_token_pair(&send_backfill_token_pair);
 
         backfiller_send_backfill_callback_t<protocol_t>
-            send_backfill_cb(&start_point, end_point_cont, mailbox_manager, chunk_cont, &fifo_src, &chunk_semaphore, this);
+            send_backfill_cb(&start_point, end_point_cont, mailbox_manager, chunk_cont, &fifo_src, &chunk_credit, &local_rate, this);
 
         /* Actually perform the backfill */
         svs->send_backfill(
@@ -223,14 +246,16 @@ void backfiller_t<protocol_t>::on_cancel_backfill(backfill_session_id_t session_
 
 template <class protocol_t>
 void backfiller_t<protocol_t>::request_backfill_progress(backfill_session_id_t session_id,
-                                                         mailbox_addr_t<void(std::pair<int, int>)> response_mbox,
+                                                         mailbox_addr_t<void(backfill_progress_report_t)> response_mbox,
                                                          auto_drainer_t::lock_t) {
     if (std_contains(local_backfill_progress, session_id) && local_backfill_progress[session_id]) {
         progress_completion_fraction_t fraction = local_backfill_progress[session_id]->guess_completion();
-        std::pair<int, int> pair_fraction = std::make_pair(fraction.estimate_of_released_nodes, fraction.estimate_of_total_nodes);
-        send(mailbox_manager, response_mbox, pair_fraction);
+        /* `guess_completion()` may have blocked, so look the meter up only now. */
+        typename std::map<backfill_session_id_t, backfill_rate_meter_t *>::iterator it = local_backfill_rates.find(session_id);
+        send(mailbox_manager, response_mbox,
+             it != local_backfill_rates.end() ? it->second->make_report(fraction) : backfill_progress_report_t());
     } else {
-        send(mailbox_manager, response_mbox, std::make_pair(-1, -1));
+        send(mailbox_manager, response_mbox, backfill_progress_report_t());
     }
 
     //TODO indicate an error has occurred
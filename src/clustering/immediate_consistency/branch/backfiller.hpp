@@ -10,6 +10,7 @@
 
 template <class> class backfiller_send_backfill_callback_t;
 template <class> class semilattice_read_view_t;
+class backfill_rate_meter_t;
 class traversal_progress_combiner_t;
 
 /* If you construct a `backfiller_t` for a given store, then it will advertise
@@ -46,7 +47,7 @@ private:
     void on_cancel_backfill(backfill_session_id_t session_id, UNUSED auto_drainer_t::lock_t);
 
     void request_backfill_progress(backfill_session_id_t session_id,
-                                   mailbox_addr_t<void(std::pair<int, int>)> response_mbox,
+                                   mailbox_addr_t<void(backfill_progress_report_t)> response_mbox,
                                    auto_drainer_t::lock_t);
 
     mailbox_manager_t *const mailbox_manager;
@@ -56,6 +57,7 @@ private:
 
     std::map<backfill_session_id_t, cond_t *> local_interruptors;
     std::map<backfill_session_id_t, traversal_progress_combiner_t *> local_backfill_progress;
+    std::map<backfill_session_id_t, backfill_rate_meter_t *> local_backfill_rates;
     auto_drainer_t drainer;
 
     typename backfiller_business_card_t<protocol_t>::backfill_mailbox_t backfill_mailbox;
@@ -1,9 +1,12 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/branch/broadcaster.hpp"
 
+#include <vector>
+
 #include "utils.hpp"
 #include <boost/make_shared.hpp>
 
+#include "arch/timing.hpp"
 #include "concurrency/coro_fifo.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/cross_thread_signal.hpp"
@@ -41,6 +44,12 @@ broadcaster_t<protocol_t>::broadcaster_t(mailbox_manager_t *mm,
         signal_t *interruptor) THROWS_ONLY(interrupted_exc_t)
     : broadcaster_collection(),
       broadcaster_membership(parent_perfmon_collection, &broadcaster_collection, "broadcaster"),
+      reads_per_sec(secs_to_ticks(1)),
+      writes_per_sec(secs_to_ticks(1)),
+      load_membership(&broadcaster_collection,
+                      &reads_per_sec, "reads_per_sec",
+                      &writes_per_sec, "writes_per_sec",
+                      NULLPTR),
       mailbox_manager(mm),
       branch_id(generate_uuid()),
       branch_history_manager(bhm),
@@ -200,6 +209,28 @@ private:
     boost::shared_ptr<incomplete_write_t> write;
 };
 
+/* A `write_batch_t` is a group of writes that a `dispatchee_t` sends to its
+   mirror in a single message. Either all of them are write-reads with the same
+   durability, or none of them is. */
+
+template <class protocol_t>
+class broadcaster_t<protocol_t>::write_batch_t {
+public:
+    write_batch_t(bool wr, write_durability_t d) : is_writeread(wr), durability(d) { }
+
+    const bool is_writeread;
+    const write_durability_t durability;
+
+    std::vector<listener_write_t<protocol_t> > writes;
+
+    /* These keep the writes from being considered complete until the mirror
+    has acknowledged the batch. */
+    std::vector<incomplete_write_ref_t> write_refs;
+
+private:
+    DISABLE_COPYING(write_batch_t);
+};
+
 /* The `registrar_t` constructs a `dispatchee_t` for every mirror that
    connects to us. */
 
@@ -239,9 +270,8 @@ public:
 
         for (typename std::list<boost::shared_ptr<incomplete_write_t> >::iterator it = controller->incomplete_writes.begin();
                 it != controller->incomplete_writes.end(); it++) {
-
-            coro_t::spawn_sometime(boost::bind(&broadcaster_t::background_write, controller,
-                                               this, auto_drainer_t::lock_t(&drainer), incomplete_write_ref_t(*it), order_source.check_in("dispatchee_t"), fifo_source.enter_write()));
+            queue_write(incomplete_write_ref_t(*it), order_source.check_in("dispatchee_t"),
+                        fifo_source.enter_write(), WRITE_DURABILITY_INVALID);
         }
     }
 
@@ -257,7 +287,62 @@ public:
         return write_mailbox.get_peer();
     }
 
+    /* Adds a write to the batch that will be sent to the mirror next. The
+    caller must hold `controller->mutex` and must queue writes in the order in
+    which it got their tokens from `fifo_source`. `durability` only matters if
+    the dispatchee is readable. */
+    void queue_write(incomplete_write_ref_t write_ref, order_token_t order_token,
+                     fifo_enforcer_write_token_t token, write_durability_t durability) {
+        ASSERT_FINITE_CORO_WAITING;
+        if (pending_batch && is_readable && pending_batch->durability != durability) {
+            send_pending_batch();
+        }
+        if (!pending_batch) {
+            pending_batch = boost::make_shared<write_batch_t>(is_readable, durability);
+            coro_t::spawn_sometime(boost::bind(&dispatchee_t::close_batch_after_window, this,
+                pending_batch, auto_drainer_t::lock_t(&drainer)));
+        }
+        pending_batch->writes.push_back(listener_write_t<protocol_t>(
+            write_ref.get()->write, write_ref.get()->timestamp, order_token, token));
+        pending_batch->write_refs.push_back(write_ref);
+        if (pending_batch->writes.size() >= BROADCASTER_WRITE_BATCH_MAX_WRITES) {
+            send_pending_batch();
+        }
+    }
+
 private:
+    void send_pending_batch() {
+        if (pending_batch->is_writeread) {
+            background_write_queue.push(boost::bind(&broadcaster_t::background_writeread_batch, controller,
+                this, auto_drainer_t::lock_t(&drainer), pending_batch));
+        } else {
+            background_write_queue.push(boost::bind(&broadcaster_t::background_write_batch, controller,
+                this, auto_drainer_t::lock_t(&drainer), pending_batch));
+        }
+        pending_batch.reset();
+    }
+
+    /* `queue_write()` spawns this whenever it opens a new batch. */
+    void close_batch_after_window(boost::shared_ptr<write_batch_t> batch,
+                                  auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
+        try {
+            if (BROADCASTER_WRITE_BATCH_WINDOW_MS > 0) {
+                nap(BROADCASTER_WRITE_BATCH_WINDOW_MS, keepalive.get_drain_signal());
+            }
+        } catch (const interrupted_exc_t &) {
+            return;
+        }
+        if (keepalive.get_drain_signal()->is_pulsed()) {
+            return;
+        }
+        DEBUG_VAR mutex_assertion_t::acq_t acq(&controller->mutex);
+        ASSERT_FINITE_CORO_WAITING;
+        /* The batch may have been sent already because it filled up. */
+        if (pending_batch == batch) {
+            send_pending_batch();
+        }
+    }
+
     /* The constructor spawns `send_intro()` in the background. */
     void send_intro(listener_business_card_t<protocol_t> to_send_intro_to,
                     state_timestamp_t intro_timestamp,
@@ -271,7 +356,8 @@ private:
                                           downgrade_mailbox.get_address()));
     }
 
-    /* `upgrade()` and `downgrade()` are mailbox callbacks. */
+    /* `upgrade()` and `downgrade()` are mailbox callbacks. Both cut the
+    pending batch, which was put together for the old mailbox. */
     void upgrade(typename listener_business_card_t<protocol_t>::writeread_mailbox_t::address_t wrm,
                  typename listener_business_card_t<protocol_t>::read_mailbox_t::address_t rm,
                  auto_drainer_t::lock_t)
@@ -279,6 +365,9 @@ private:
         DEBUG_VAR mutex_assertion_t::acq_t acq(&controller->mutex);
         ASSERT_FINITE_CORO_WAITING;
         guarantee(!is_readable);
+        if (pending_batch) {
+            send_pending_batch();
+        }
         is_readable = true;
         writeread_mailbox = wrm;
         read_mailbox = rm;
@@ -290,6 +379,9 @@ private:
             DEBUG_VAR mutex_assertion_t::acq_t acq(&controller->mutex);
             ASSERT_FINITE_CORO_WAITING;
             guarantee(is_readable);
+            if (pending_batch) {
+                send_pending_batch();
+            }
             is_readable = false;
             controller->readable_dispatchees.remove(this);
         }
@@ -324,6 +416,11 @@ public:
 private:
     coro_pool_t<boost::function<void()> > background_write_workers;
     broadcaster_t *controller;
+
+    /* The batch that `queue_write()` is adding writes to, or `NULL` if there
+    is none. Protected by `controller->mutex`. */
+    boost::shared_ptr<write_batch_t> pending_batch;
+
     auto_drainer_t drainer;
 
     typename listener_business_card_t<protocol_t>::upgrade_mailbox_t upgrade_mailbox;
@@ -340,8 +437,7 @@ template<class protocol_t>
 void listener_write(
         mailbox_manager_t *mailbox_manager,
         const typename listener_business_card_t<protocol_t>::write_mailbox_t::address_t &write_mailbox,
-        const typename protocol_t::write_t &w, transition_timestamp_t ts,
-        order_token_t order_token, fifo_enforcer_write_token_t token,
+        const std::vector<listener_write_t<protocol_t> > &writes,
         signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t)
 {
@@ -352,7 +448,7 @@ void listener_write(
         mailbox_callback_mode_inline);
 
     send(mailbox_manager, write_mailbox,
-         w, ts, order_token, token, ack_mailbox.get_address());
+         writes, ack_mailbox.get_address());
 
     wait_interruptible(&ack_cond, interruptor);
 }
@@ -388,6 +484,7 @@ template<class protocol_t>
 void broadcaster_t<protocol_t>::read(const typename protocol_t::read_t &read, typename protocol_t::read_response_t *response, fifo_enforcer_sink_t::exit_read_t *lock, order_token_t order_token, signal_t *interruptor) THROWS_ONLY(cannot_perform_query_exc_t, interrupted_exc_t) {
 
     order_token.assert_read_mode();
+    reads_per_sec.record();
 
     dispatchee_t *reader;
     auto_drainer_t::lock_t reader_lock;
@@ -431,6 +528,7 @@ void broadcaster_t<protocol_t>::spawn_write(const typename protocol_t::write_t &
                                             const ack_checker_t *ack_checker) THROWS_ONLY(interrupted_exc_t) {
 
     order_token.assert_write_mode();
+    writes_per_sec.record();
 
     wait_interruptible(lock, interruptor);
     ASSERT_FINITE_CORO_WAITING;
@@ -473,13 +571,10 @@ void broadcaster_t<protocol_t>::spawn_write(const typename protocol_t::write_t &
         that we don't check `interruptor` until the write is on its way
         to every dispatchee. */
         fifo_enforcer_write_token_t fifo_enforcer_token = it->first->fifo_source.enter_write();
-        if (it->first->is_readable) {
-            it->first->background_write_queue.push(boost::bind(&broadcaster_t::background_writeread, this,
-                it->first, it->second, write_ref, order_token, fifo_enforcer_token, ack_checker->get_write_durability(it->first->get_peer())));
-        } else {
-            it->first->background_write_queue.push(boost::bind(&broadcaster_t::background_write, this,
-                it->first, it->second, write_ref, order_token, fifo_enforcer_token));
-        }
+        write_durability_t durability = it->first->is_readable
+            ? ack_checker->get_write_durability(it->first->get_peer())
+            : WRITE_DURABILITY_INVALID;
+        it->first->queue_write(write_ref, order_token, fifo_enforcer_token, durability);
     }
 }
 
@@ -503,10 +598,10 @@ void broadcaster_t<protocol_t>::pick_a_readable_dispatchee(dispatchee_t **dispat
 }
 
 template<class protocol_t>
-void broadcaster_t<protocol_t>::background_write(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, incomplete_write_ref_t write_ref, order_token_t order_token, fifo_enforcer_write_token_t token) THROWS_NOTHING {
+void broadcaster_t<protocol_t>::background_write_batch(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, boost::shared_ptr<write_batch_t> batch) THROWS_NOTHING {
     try {
         listener_write<protocol_t>(mailbox_manager, mirror->write_mailbox,
-                                   write_ref.get()->write, write_ref.get()->timestamp, order_token, token,
+                                   batch->writes,
                                    mirror_lock.get_drain_signal());
     } catch (const interrupted_exc_t &) {
         return;
@@ -514,22 +609,25 @@ void broadcaster_t<protocol_t>::background_write(dispatchee_t *mirror, auto_drai
 }
 
 template<class protocol_t>
-void broadcaster_t<protocol_t>::background_writeread(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, incomplete_write_ref_t write_ref, order_token_t order_token, fifo_enforcer_write_token_t token, const write_durability_t durability) THROWS_NOTHING {
+void broadcaster_t<protocol_t>::background_writeread_batch(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, boost::shared_ptr<write_batch_t> batch) THROWS_NOTHING {
     try {
         cond_t response_cond;
-        typename protocol_t::write_response_t response;
-        mailbox_t<void(typename protocol_t::write_response_t)> response_mailbox(
+        std::vector<typename protocol_t::write_response_t> responses;
+        mailbox_t<void(std::vector<typename protocol_t::write_response_t>)> response_mailbox(
             mailbox_manager,
-            boost::bind(&store_listener_response<typename protocol_t::write_response_t>, &response, _1, &response_cond),
+            boost::bind(&store_listener_response<std::vector<typename protocol_t::write_response_t> >, &responses, _1, &response_cond),
             mailbox_callback_mode_inline);
 
-        send(mailbox_manager, mirror->writeread_mailbox, write_ref.get()->write, write_ref.get()->timestamp, order_token, token, response_mailbox.get_address(), durability);
+        send(mailbox_manager, mirror->writeread_mailbox, batch->writes, batch->durability, response_mailbox.get_address());
 
         wait_interruptible(&response_cond, mirror_lock.get_drain_signal());
 
-        // TODO: Require that everybody provide a callback.
-        if (write_ref.get()->callback) {
-            write_ref.get()->callback->on_response(mirror->get_peer(), response);
+        guarantee(responses.size() == batch->write_refs.size());
+        for (size_t i = 0; i < responses.size(); ++i) {
+            // TODO: Require that everybody provide a callback.
+            if (batch->write_refs[i].get()->callback) {
+                batch->write_refs[i].get()->callback->on_response(mirror->get_peer(), responses[i]);
+            }
         }
 
     } catch (const interrupted_exc_t &) {
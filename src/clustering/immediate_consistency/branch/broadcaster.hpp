@@ -12,6 +12,7 @@
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "clustering/immediate_consistency/branch/metadata.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
+#include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
 #include "timestamps.hpp"
 
@@ -101,8 +102,14 @@ private:
     machine.) */
     void pick_a_readable_dispatchee(dispatchee_t **dispatchee_out, mutex_assertion_t::acq_t *proof, auto_drainer_t::lock_t *lock_out) THROWS_ONLY(cannot_perform_query_exc_t);
 
-    void background_write(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, incomplete_write_ref_t write_ref, order_token_t order_token, fifo_enforcer_write_token_t token) THROWS_NOTHING;
-    void background_writeread(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, incomplete_write_ref_t write_ref, order_token_t order_token, fifo_enforcer_write_token_t token, write_durability_t durability) THROWS_NOTHING;
+    /* Writes aren't sent to each mirror one by one. Instead, each `dispatchee_t`
+    collects them into a `write_batch_t`, which it sends as a single message once
+    it is full or `BROADCASTER_WRITE_BATCH_WINDOW_MS` have passed. The mirror
+    acknowledges the whole batch at once. */
+    class write_batch_t;
+
+    void background_write_batch(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, boost::shared_ptr<write_batch_t> batch) THROWS_NOTHING;
+    void background_writeread_batch(dispatchee_t *mirror, auto_drainer_t::lock_t mirror_lock, boost::shared_ptr<write_batch_t> batch) THROWS_NOTHING;
     void end_write(boost::shared_ptr<incomplete_write_t> write) THROWS_NOTHING;
 
     /* This function sanity-checks `incomplete_writes`, `current_timestamp`,
@@ -113,6 +120,11 @@ private:
     perfmon_collection_t broadcaster_collection;
     perfmon_membership_t broadcaster_membership;
 
+    /* How busy this shard is. The rebalancing suggester uses these to find hot
+    shards. */
+    perfmon_rate_monitor_t reads_per_sec, writes_per_sec;
+    perfmon_multi_membership_t load_membership;
+
     mailbox_manager_t *mailbox_manager;
 
     branch_id_t branch_id;
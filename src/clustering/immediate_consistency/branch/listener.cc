@@ -77,10 +77,10 @@ listener_t<protocol_t>::listener_t(const base_path_t &base_path,
         WRITE_QUEUE_SEMAPHORE_TRICKLE_FRACTION),
     enforce_max_outstanding_writes_from_broadcaster_(MAX_OUTSTANDING_WRITES_FROM_BROADCASTER),
     write_mailbox_(mailbox_manager_,
-        boost::bind(&listener_t::on_write, this, _1, _2, _3, _4, _5),
+        boost::bind(&listener_t::on_write, this, _1, _2),
         mailbox_callback_mode_inline),
     writeread_mailbox_(mailbox_manager_,
-        boost::bind(&listener_t::on_writeread, this, _1, _2, _3, _4, _5, _6),
+        boost::bind(&listener_t::on_writeread, this, _1, _2, _3),
         mailbox_callback_mode_inline),
     read_mailbox_(mailbox_manager_,
         boost::bind(&listener_t::on_read, this, _1, _2, _3, _4, _5),
@@ -251,10 +251,10 @@ listener_t<protocol_t>::listener_t(const base_path_t &base_path,
         WRITE_QUEUE_SEMAPHORE_TRICKLE_FRACTION),
     enforce_max_outstanding_writes_from_broadcaster_(MAX_OUTSTANDING_WRITES_FROM_BROADCASTER),
     write_mailbox_(mailbox_manager_,
-        boost::bind(&listener_t::on_write, this, _1, _2, _3, _4, _5),
+        boost::bind(&listener_t::on_write, this, _1, _2),
         mailbox_callback_mode_inline),
     writeread_mailbox_(mailbox_manager_,
-        boost::bind(&listener_t::on_writeread, this, _1, _2, _3, _4, _5, _6),
+        boost::bind(&listener_t::on_writeread, this, _1, _2, _3),
         mailbox_callback_mode_inline),
     read_mailbox_(mailbox_manager_,
         boost::bind(&listener_t::on_read, this, _1, _2, _3, _4, _5),
@@ -396,41 +396,47 @@ void listener_t<protocol_t>::try_start_receiving_writes(
 }
 
 template <class protocol_t>
-void listener_t<protocol_t>::on_write(const typename protocol_t::write_t &write,
-        transition_timestamp_t transition_timestamp,
-        order_token_t order_token,
-        fifo_enforcer_write_token_t fifo_token,
+void listener_t<protocol_t>::on_write(const std::vector<listener_write_t<protocol_t> > &writes,
         mailbox_addr_t<void()> ack_addr) THROWS_NOTHING {
-    rassert(region_is_superset(our_branch_region_, write.get_region()));
-    rassert(!region_is_empty(write.get_region()));
-    order_token.assert_write_mode();
+    guarantee(!writes.empty());
+#ifndef NDEBUG
+    for (size_t i = 0; i < writes.size(); ++i) {
+        rassert(region_is_superset(our_branch_region_, writes[i].write.get_region()));
+        rassert(!region_is_empty(writes[i].write.get_region()));
+        writes[i].order_token.assert_write_mode();
+    }
+#endif
 
     coro_t::spawn_sometime(boost::bind(
-        &listener_t<protocol_t>::enqueue_write, this,
-        write, transition_timestamp, order_token, fifo_token, ack_addr,
+        &listener_t<protocol_t>::enqueue_writes, this,
+        writes, ack_addr,
         auto_drainer_t::lock_t(&drainer_)));
 }
 
 template <class protocol_t>
-void listener_t<protocol_t>::enqueue_write(const typename protocol_t::write_t &write,
-        transition_timestamp_t transition_timestamp,
-        order_token_t order_token,
-        fifo_enforcer_write_token_t fifo_token,
+void listener_t<protocol_t>::enqueue_writes(const std::vector<listener_write_t<protocol_t> > &writes,
         mailbox_addr_t<void()> ack_addr,
         auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
     try {
-        /* Make sure that the broadcaster isn't sending us too many concurrent
-        writes */
-        semaphore_assertion_t::acq_t sem_acq(&enforce_max_outstanding_writes_from_broadcaster_);
-
-        fifo_enforcer_sink_t::exit_write_t fifo_exit(&write_queue_entrance_sink_, fifo_token);
-        wait_interruptible(&fifo_exit, keepalive.get_drain_signal());
-        write_queue_semaphore_.co_lock_interruptible(keepalive.get_drain_signal());
-        write_queue_.push(write_queue_entry_t(write, transition_timestamp, order_token, fifo_token));
+        /* The writes in a batch have consecutive FIFO tokens, so once the first
+        one gets through `write_queue_entrance_sink_`, the others follow right
+        away. */
+        for (size_t i = 0; i < writes.size(); ++i) {
+            const listener_write_t<protocol_t> &w = writes[i];
+
+            /* Make sure that the broadcaster isn't sending us too many
+            concurrent writes */
+            semaphore_assertion_t::acq_t sem_acq(&enforce_max_outstanding_writes_from_broadcaster_);
+
+            fifo_enforcer_sink_t::exit_write_t fifo_exit(&write_queue_entrance_sink_, w.fifo_token);
+            wait_interruptible(&fifo_exit, keepalive.get_drain_signal());
+            write_queue_semaphore_.co_lock_interruptible(keepalive.get_drain_signal());
+            write_queue_.push(write_queue_entry_t(w.write, w.timestamp, w.order_token, w.fifo_token));
+        }
 
-        /* Release the semaphore before sending the response, because the
-        broadcaster can send us a new write as soon as we send the ack */
-        sem_acq.reset();
+        /* The semaphore has been released by now, which matters because the
+        broadcaster can send us new writes as soon as we send the ack. One ack
+        covers the whole batch. */
         send(mailbox_manager_, ack_addr);
 
     } catch (const interrupted_exc_t &) {
@@ -482,31 +488,56 @@ void listener_t<protocol_t>::perform_enqueued_write(const write_queue_entry_t &q
 }
 
 template <class protocol_t>
-void listener_t<protocol_t>::on_writeread(const typename protocol_t::write_t &write,
-        transition_timestamp_t transition_timestamp,
-        order_token_t order_token,
-        fifo_enforcer_write_token_t fifo_token,
-        mailbox_addr_t<void(typename protocol_t::write_response_t)> ack_addr,
-        write_durability_t durability) THROWS_NOTHING {
-    rassert(region_is_superset(our_branch_region_, write.get_region()));
-    rassert(!region_is_empty(write.get_region()));
-    rassert(region_is_superset(svs_->get_region(), write.get_region()));
-    order_token.assert_write_mode();
+class listener_t<protocol_t>::writeread_batch_t {
+public:
+    writeread_batch_t(const std::vector<listener_write_t<protocol_t> > &_writes,
+                      write_durability_t _durability,
+                      const mailbox_addr_t<void(std::vector<typename protocol_t::write_response_t>)> &_ack_addr)
+        : writes(_writes), durability(_durability), ack_addr(_ack_addr),
+          responses(_writes.size()), num_remaining(_writes.size()) { }
 
-    coro_t::spawn_sometime(boost::bind(
-        &listener_t<protocol_t>::perform_writeread, this,
-        write, transition_timestamp, order_token, fifo_token, ack_addr, durability,
-        auto_drainer_t::lock_t(&drainer_)));
+    const std::vector<listener_write_t<protocol_t> > writes;
+    const write_durability_t durability;
+    const mailbox_addr_t<void(std::vector<typename protocol_t::write_response_t>)> ack_addr;
+
+    std::vector<typename protocol_t::write_response_t> responses;
+    size_t num_remaining;
+
+private:
+    DISABLE_COPYING(writeread_batch_t);
+};
+
+template <class protocol_t>
+void listener_t<protocol_t>::on_writeread(const std::vector<listener_write_t<protocol_t> > &writes,
+        write_durability_t durability,
+        mailbox_addr_t<void(std::vector<typename protocol_t::write_response_t>)> ack_addr) THROWS_NOTHING {
+    guarantee(!writes.empty());
+#ifndef NDEBUG
+    for (size_t i = 0; i < writes.size(); ++i) {
+        rassert(region_is_superset(our_branch_region_, writes[i].write.get_region()));
+        rassert(!region_is_empty(writes[i].write.get_region()));
+        rassert(region_is_superset(svs_->get_region(), writes[i].write.get_region()));
+        writes[i].order_token.assert_write_mode();
+    }
+#endif
+
+    boost::shared_ptr<writeread_batch_t> batch(new writeread_batch_t(writes, durability, ack_addr));
+    for (size_t i = 0; i < writes.size(); ++i) {
+        coro_t::spawn_sometime(boost::bind(
+            &listener_t<protocol_t>::perform_writeread, this,
+            batch, i,
+            auto_drainer_t::lock_t(&drainer_)));
+    }
 }
 
 template <class protocol_t>
-void listener_t<protocol_t>::perform_writeread(const typename protocol_t::write_t &write,
-        transition_timestamp_t transition_timestamp,
-        order_token_t order_token,
-        fifo_enforcer_write_token_t fifo_token,
-        mailbox_addr_t<void(typename protocol_t::write_response_t)> ack_addr,
-        const write_durability_t durability,
+void listener_t<protocol_t>::perform_writeread(boost::shared_ptr<writeread_batch_t> batch,
+        size_t index,
         auto_drainer_t::lock_t keepalive) THROWS_NOTHING {
+    const typename protocol_t::write_t &write = batch->writes[index].write;
+    const transition_timestamp_t transition_timestamp = batch->writes[index].timestamp;
+    const order_token_t order_token = batch->writes[index].order_token;
+    const fifo_enforcer_write_token_t fifo_token = batch->writes[index].fifo_token;
     try {
         /* Make sure the broadcaster isn't sending us too many writes */
         semaphore_assertion_t::acq_t sem_acq(&enforce_max_outstanding_writes_from_broadcaster_);
@@ -538,14 +569,12 @@ void listener_t<protocol_t>::perform_writeread(const typename protocol_t::write_
 #endif
 
         // Perform the operation
-        typename protocol_t::write_response_t response;
-
         svs_->write(DEBUG_ONLY(metainfo_checker, )
                     region_map_t<protocol_t, binary_blob_t>(svs_->get_region(),
                                                             binary_blob_t(version_range_t(version_t(branch_id_, transition_timestamp.timestamp_after())))),
                     write,
-                    &response,
-                    durability,
+                    &batch->responses[index],
+                    batch->durability,
                     transition_timestamp,
                     order_token,
                     &write_token_pair,
@@ -554,7 +583,13 @@ void listener_t<protocol_t>::perform_writeread(const typename protocol_t::write_
         /* Release the semaphore before sending the response, because the
         broadcaster can send us a new write as soon as we send the ack */
         sem_acq.reset();
-        send(mailbox_manager_, ack_addr, response);
+
+        /* The last write of the batch to finish answers for all of them. */
+        guarantee(batch->num_remaining > 0);
+        --batch->num_remaining;
+        if (batch->num_remaining == 0) {
+            send(mailbox_manager_, batch->ack_addr, batch->responses);
+        }
 
     } catch (const interrupted_exc_t &) {
         /* pass */
@@ -3,6 +3,10 @@
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_LISTENER_HPP_
 
 #include <map>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/shared_ptr.hpp>
 
 #include "clustering/immediate_consistency/branch/metadata.hpp"
 #include "concurrency/promise.hpp"
@@ -155,17 +159,13 @@ private:
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, broadcaster_lost_exc_t);
 
-    void on_write(const typename protocol_t::write_t &write,
-            transition_timestamp_t transition_timestamp,
-            order_token_t order_token,
-            fifo_enforcer_write_token_t fifo_token,
+    void on_write(const std::vector<listener_write_t<protocol_t> > &writes,
             mailbox_addr_t<void()> ack_addr)
         THROWS_NOTHING;
 
-    void enqueue_write(const typename protocol_t::write_t &write,
-            transition_timestamp_t transition_timestamp,
-            order_token_t order_token,
-            fifo_enforcer_write_token_t fifo_token,
+    /* `enqueue_writes()` puts a whole batch of writes into the write queue, one
+    after another, and then acknowledges the batch. */
+    void enqueue_writes(const std::vector<listener_write_t<protocol_t> > &writes,
             mailbox_addr_t<void()> ack_addr,
             auto_drainer_t::lock_t keepalive)
         THROWS_NOTHING;
@@ -176,20 +176,18 @@ private:
     /* See the note at the place where `writeread_mailbox` is declared for an
     explanation of why `on_writeread()` and `on_read()` are here. */
 
-    void on_writeread(const typename protocol_t::write_t &write,
-            transition_timestamp_t transition_timestamp,
-            order_token_t order_token,
-            fifo_enforcer_write_token_t fifo_token,
-            mailbox_addr_t<void(typename protocol_t::write_response_t)> ack_addr,
-            write_durability_t durability)
-        THROWS_NOTHING;
+    /* The writes of a batch of write-reads are performed concurrently, like
+    separate write-reads would be; `writeread_batch_t` collects their responses
+    so that they can be sent back together once the last one is done. */
+    class writeread_batch_t;
 
-    void perform_writeread(const typename protocol_t::write_t &write,
-            transition_timestamp_t transition_timestamp,
-            order_token_t order_token,
-            fifo_enforcer_write_token_t fifo_token,
-            mailbox_addr_t<void(typename protocol_t::write_response_t)> ack_addr,
+    void on_writeread(const std::vector<listener_write_t<protocol_t> > &writes,
             write_durability_t durability,
+            mailbox_addr_t<void(std::vector<typename protocol_t::write_response_t>)> ack_addr)
+        THROWS_NOTHING;
+
+    void perform_writeread(boost::shared_ptr<writeread_batch_t> batch,
+            size_t index,
             auto_drainer_t::lock_t keepalive)
         THROWS_NOTHING;
 
@@ -2,14 +2,19 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_METADATA_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_METADATA_HPP_
 
+#include <algorithm>
 #include <map>
 #include <utility>
+#include <vector>
 
+#include "backfill_progress.hpp"
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "concurrency/fifo_checker.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/promise.hpp"
+#include "config/args.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "containers/printf_buffer.hpp"
 #include "containers/uuid.hpp"
 #include "protocol_api.hpp"
@@ -19,6 +24,25 @@
 
 template <class> class listener_intro_t;
 
+/* The broadcaster sends writes to a mirror in batches of `listener_write_t`s. The
+writes in a batch have consecutive `fifo_token`s. */
+
+template<class protocol_t>
+class listener_write_t {
+public:
+    listener_write_t() { }
+    listener_write_t(const typename protocol_t::write_t &w, transition_timestamp_t ts,
+                     order_token_t ot, fifo_enforcer_write_token_t ft)
+        : write(w), timestamp(ts), order_token(ot), fifo_token(ft) { }
+
+    typename protocol_t::write_t write;
+    transition_timestamp_t timestamp;
+    order_token_t order_token;
+    fifo_enforcer_write_token_t fifo_token;
+
+    RDB_MAKE_ME_SERIALIZABLE_4(write, timestamp, order_token, fifo_token);
+};
+
 /* Every `listener_t` constructs a `listener_business_card_t` and sends it to
 the `broadcaster_t`. */
 
@@ -29,18 +53,16 @@ public:
     /* These are the types of mailboxes that the master uses to communicate with
     the mirrors. */
 
-    typedef mailbox_t<void(typename protocol_t::write_t,
-                           transition_timestamp_t,
-                           order_token_t,
-                           fifo_enforcer_write_token_t,
+    /* A mirror acknowledges a batch of writes as a whole, once it has done all of
+    them; for `writeread_mailbox_t`, the response carries one write response per
+    write in the batch, in the same order. */
+
+    typedef mailbox_t<void(std::vector<listener_write_t<protocol_t> >,
                            mailbox_addr_t<void()> ack_addr)> write_mailbox_t;
 
-    typedef mailbox_t<void(typename protocol_t::write_t,
-                           transition_timestamp_t,
-                           order_token_t,
-                           fifo_enforcer_write_token_t,
-                           mailbox_addr_t<void(typename protocol_t::write_response_t)>,
-                           write_durability_t)> writeread_mailbox_t;
+    typedef mailbox_t<void(std::vector<listener_write_t<protocol_t> >,
+                           write_durability_t,
+                           mailbox_addr_t<void(std::vector<typename protocol_t::write_response_t>)>)> writeread_mailbox_t;
 
     typedef mailbox_t<void(typename protocol_t::read_t,
                            state_timestamp_t,
@@ -98,6 +120,16 @@ backfills over the network. It appears in the directory. */
 
 typedef uuid_u backfill_session_id_t;
 
+/* How much of the backfill's credit window a chunk uses: one unit per key it
+carries, so that the data in flight is bounded no matter how many keys the
+protocol packs into a chunk. A chunk always costs at least one unit, and never
+more than the whole window, or it could never be sent. */
+template<class protocol_t>
+int backfill_chunk_credit(const typename protocol_t::backfill_chunk_t &chunk) {
+    size_t keys = chunk.get_key_count();
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(keys, BACKFILL_MAX_KEYS_IN_FLIGHT)));
+}
+
 template<class protocol_t>
 struct backfiller_business_card_t {
 
@@ -118,7 +150,7 @@ struct backfiller_business_card_t {
 
 
     /* Mailboxes used for requesting the progress of a backfill */
-    typedef mailbox_t<void(backfill_session_id_t, mailbox_addr_t<void(std::pair<int, int>)>)> request_progress_mailbox_t;
+    typedef mailbox_t<void(backfill_session_id_t, mailbox_addr_t<void(backfill_progress_report_t)>)> request_progress_mailbox_t;
 
     backfiller_business_card_t() { }
     backfiller_business_card_t(
@@ -15,7 +15,12 @@ direct_reader_t<protocol_t>::direct_reader_t(
 
 template <class protocol_t>
 direct_reader_business_card_t<protocol_t> direct_reader_t<protocol_t>::get_business_card() {
-    return direct_reader_business_card_t<protocol_t>(read_mailbox.get_address());
+    return direct_reader_business_card_t<protocol_t>(read_mailbox.get_address(), true, 0);
+}
+
+template <class protocol_t>
+direct_reader_business_card_t<protocol_t> direct_reader_t<protocol_t>::get_outdated_business_card(microtime_t live_until) {
+    return direct_reader_business_card_t<protocol_t>(read_mailbox.get_address(), false, live_until);
 }
 
 template <class protocol_t>
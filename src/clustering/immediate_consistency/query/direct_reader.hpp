@@ -20,8 +20,13 @@ public:
             mailbox_manager_t *mm,
             store_view_t<protocol_t> *svs);
 
+    /* The business card of a live replica; see `direct_reader_metadata.hpp`. */
     direct_reader_business_card_t<protocol_t> get_business_card();
 
+    /* The business card of a replica that was last live at `live_until`, or
+    never if it's zero. */
+    direct_reader_business_card_t<protocol_t> get_outdated_business_card(microtime_t live_until);
+
 private:
     void on_read(
             const typename protocol_t::read_t &,
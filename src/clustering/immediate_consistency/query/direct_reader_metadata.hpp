@@ -3,9 +3,17 @@
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_QUERY_DIRECT_READER_METADATA_HPP_
 
 #include "rpc/mailbox/typed.hpp"
+#include "utils.hpp"
 
 /* Each replica exposes a `direct_reader_business_card_t` for each shard that it
-is a primary or secondary for. */
+is a primary or secondary for.
+
+The business card also says how out of date the replica's data may be. A replica
+is "live" if it is the primary or is getting the primary's writes as they happen.
+A replica that lost its primary advertises when that happened (by its own clock),
+so that readers who can put up with a bounded amount of staleness know whether
+they can use it. A replica that hasn't been live since it started doesn't know how
+old its data is, and advertises a `live_until` of zero. */
 
 template <class protocol_t>
 class direct_reader_business_card_t {
@@ -15,12 +23,28 @@ public:
             mailbox_addr_t< void(typename protocol_t::read_response_t)>
             )> read_mailbox_t;
 
-    direct_reader_business_card_t() { }
-    explicit direct_reader_business_card_t(const typename read_mailbox_t::address_t &rm) : read_mailbox(rm) { }
+    direct_reader_business_card_t() : is_live(false), live_until(0) { }
+    direct_reader_business_card_t(const typename read_mailbox_t::address_t &rm,
+                                  bool _is_live, microtime_t _live_until)
+        : read_mailbox(rm), is_live(_is_live), live_until(_live_until) { }
+
+    /* Returns how many microseconds out of date the replica's data may be at
+    `now`, or -1 if nobody knows. */
+    int64_t staleness(microtime_t now) const {
+        if (is_live) {
+            return 0;
+        } else if (live_until == 0) {
+            return -1;
+        } else {
+            return now > live_until ? now - live_until : 0;
+        }
+    }
 
     typename read_mailbox_t::address_t read_mailbox;
+    bool is_live;
+    microtime_t live_until;
 
-    RDB_MAKE_ME_SERIALIZABLE_1(read_mailbox);
+    RDB_MAKE_ME_SERIALIZABLE_3(read_mailbox, is_live, live_until);
 };
 
 #endif /* CLUSTERING_IMMEDIATE_CONSISTENCY_QUERY_DIRECT_READER_METADATA_HPP_ */
@@ -0,0 +1,28 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_REACTOR_EXPIRATION_REAPER_HPP_
+#define CLUSTERING_REACTOR_EXPIRATION_REAPER_HPP_
+
+#include "errors.hpp"
+
+template <class protocol_t> class broadcaster_t;
+class ack_checker_t;
+class perfmon_collection_t;
+
+/* The primary for each shard runs an `expiration_reaper_t` next to its
+`master_t`. Protocols whose values can expire specialize it to go looking for
+expired data in the background and remove it through the broadcaster, so that the
+removals reach every replica. Other protocols get this version, which does
+nothing. */
+template <class protocol_t>
+class expiration_reaper_t {
+public:
+    expiration_reaper_t(UNUSED broadcaster_t<protocol_t> *broadcaster,
+                        UNUSED ack_checker_t *ack_checker,
+                        UNUSED const typename protocol_t::region_t &region,
+                        UNUSED perfmon_collection_t *parent_perfmon_collection) { }
+
+private:
+    DISABLE_COPYING(expiration_reaper_t);
+};
+
+#endif  // CLUSTERING_REACTOR_EXPIRATION_REAPER_HPP_
@@ -1,6 +1,7 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "clustering/reactor/namespace_interface.hpp"
 #include "clustering/immediate_consistency/query/master_access.hpp"
+#include "config/args.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/watchable.hpp"
 
@@ -12,6 +13,7 @@ cluster_namespace_interface_t<protocol_t>::cluster_namespace_interface_t(
     : mailbox_manager(mm),
       directory_view(dv),
       ctx(_ctx),
+      relationships_index(&relationships),
       start_count(0),
       watcher_subscription(new watchable_subscription_t<std::map<peer_id_t, cow_ptr_t<reactor_business_card_t<protocol_t> > > >(boost::bind(&cluster_namespace_interface_t::update_registrants, this, false))) {
     {
@@ -43,7 +45,14 @@ void cluster_namespace_interface_t<protocol_t>::read_outdated(const typename pro
     /* This seems kind of silly. We do it this way because
        `dispatch_outdated_read` needs to be able to see `outdated_read_info_t`,
        which is defined in the `private` section. */
-    dispatch_outdated_read(r, response, interruptor);
+    dispatch_outdated_read(r, response, -1, interruptor);
+}
+
+template <class protocol_t>
+void cluster_namespace_interface_t<protocol_t>::read_bounded_staleness(const typename protocol_t::read_t &r, typename protocol_t::read_response_t *response, int64_t max_staleness_ms, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+    guarantee(max_staleness_ms >= 0);
+    dispatch_outdated_read(r, response, max_staleness_ms * 1000, interruptor);
 }
 
 template <class protocol_t>
@@ -63,7 +72,11 @@ cluster_namespace_interface_t<protocol_t>::get_sharding_scheme() THROWS_ONLY(can
     std::vector<typename protocol_t::region_t> s;
     for (typename region_map_t<protocol_t, std::set<relationship_t *> >::iterator it = relationships.begin(); it != relationships.end(); it++) {
         for (typename std::set<relationship_t *>::iterator jt = it->second.begin(); jt != it->second.end(); jt++) {
-            s.push_back((*jt)->region);
+            /* Secondaries cover the same regions as the masters, so they
+            would make the join fail. */
+            if ((*jt)->master_access) {
+                s.push_back((*jt)->region);
+            }
         }
     }
     typename protocol_t::region_t whole;
@@ -90,10 +103,13 @@ void cluster_namespace_interface_t<protocol_t>::dispatch_immediate_op(
 
     boost::ptr_vector<immediate_op_info_t<op_type, fifo_enforcer_token_type> > masters_to_contact;
     scoped_ptr_t<immediate_op_info_t<op_type, fifo_enforcer_token_type> > new_op_info(new immediate_op_info_t<op_type, fifo_enforcer_token_type>());
-    for (auto it = relationships.begin(); it != relationships.end(); ++it) {
-        if (op.shard(it->first, &new_op_info->sharded_op)) {
+    std::vector<size_t> shards;
+    relationships_index.find_overlapping(op.get_region(), &shards);
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const std::pair<typename protocol_t::region_t, std::set<relationship_t *> > &shard = relationships.get_nth(shards[i]);
+        if (op.shard(shard.first, &new_op_info->sharded_op)) {
             relationship_t *chosen_relationship = NULL;
-            const std::set<relationship_t *> *relationship_map = &it->second;
+            const std::set<relationship_t *> *relationship_map = &shard.second;
             for (auto jt = relationship_map->begin(); jt != relationship_map->end(); ++jt) {
                 if ((*jt)->master_access) {
                     if (chosen_relationship) {
@@ -174,6 +190,7 @@ template <class protocol_t>
 void
 cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename protocol_t::read_t &op,
                                                                   typename protocol_t::read_response_t *response,
+                                                                  int64_t max_staleness,
                                                                   signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
 
@@ -181,31 +198,22 @@ cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename
 
     boost::ptr_vector<outdated_read_info_t> direct_readers_to_contact;
 
+    const microtime_t now = current_microtime();
     scoped_ptr_t<outdated_read_info_t> new_op_info(new outdated_read_info_t());
-    for (auto it = relationships.begin(); it != relationships.end(); ++it) {
-        if (op.shard(it->first, &new_op_info->sharded_op)) {
-            std::vector<relationship_t *> potential_relationships;
-            relationship_t *chosen_relationship = NULL;
-
-            const std::set<relationship_t *> *relationship_map = &it->second;
-            for (auto jt = relationship_map->begin(); jt != relationship_map->end(); ++jt) {
-                if ((*jt)->direct_reader_access) {
-                    if ((*jt)->is_local) {
-                        chosen_relationship = *jt;
-                        break;
-                    } else {
-                        potential_relationships.push_back(*jt);
-                    }
-                }
-            }
-            if (!chosen_relationship && !potential_relationships.empty()) {
-                chosen_relationship = potential_relationships[distributor_rng.randint(potential_relationships.size())];
-            }
+    std::vector<size_t> shards;
+    relationships_index.find_overlapping(op.get_region(), &shards);
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const std::pair<typename protocol_t::region_t, std::set<relationship_t *> > &shard = relationships.get_nth(shards[i]);
+        if (op.shard(shard.first, &new_op_info->sharded_op)) {
+            relationship_t *chosen_relationship = choose_direct_reader(shard.second, max_staleness, now);
             if (!chosen_relationship) {
                 /* Don't bother looking for masters; if there are no direct
                    readers, there won't be any masters either. */
-                throw cannot_perform_query_exc_t("No direct reader available");
+                throw cannot_perform_query_exc_t(max_staleness == -1
+                    ? "No direct reader available"
+                    : "No direct reader is up to date enough");
             }
+            new_op_info->relationship = chosen_relationship;
             new_op_info->direct_reader_access = chosen_relationship->direct_reader_access;
             new_op_info->keepalive = auto_drainer_t::lock_t(&chosen_relationship->drainer);
             direct_readers_to_contact.push_back(new_op_info.release());
@@ -213,6 +221,11 @@ cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename
         }
     }
 
+    /* `perform_outdated_read()` takes these back off when the reads are done. */
+    for (size_t i = 0; i < direct_readers_to_contact.size(); ++i) {
+        ++direct_readers_to_contact[i].relationship->reads_in_flight;
+    }
+
     std::vector<typename protocol_t::read_response_t> results(direct_readers_to_contact.size());
     std::vector<std::string> failures(direct_readers_to_contact.size());
     pmap(direct_readers_to_contact.size(), boost::bind(&cluster_namespace_interface_t::perform_outdated_read, this,
@@ -229,6 +242,53 @@ cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename
     op.unshard(results.data(), results.size(), response, ctx, interruptor);
 }
 
+template <class protocol_t>
+typename cluster_namespace_interface_t<protocol_t>::relationship_t *
+cluster_namespace_interface_t<protocol_t>::choose_direct_reader(const std::set<relationship_t *> &candidates,
+                                                                int64_t max_staleness,
+                                                                microtime_t now) {
+    std::vector<relationship_t *> eligible;
+    for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+        if (!(*it)->direct_reader_access) {
+            continue;
+        }
+        if (max_staleness != -1) {
+            int64_t staleness;
+            try {
+                staleness = (*it)->direct_reader_access->access().staleness(now);
+            } catch (const resource_lost_exc_t &) {
+                continue;
+            }
+            if (staleness == -1 || staleness > max_staleness) {
+                continue;
+            }
+        }
+        eligible.push_back(*it);
+    }
+    if (eligible.empty()) {
+        return NULL;
+    }
+
+    /* Local replicas usually win because they answer fastest, but not once
+    they're busy enough that a remote replica would answer sooner. We start
+    looking at a random replica so that ties go to a random one. */
+    const size_t start = distributor_rng.randint(eligible.size());
+    relationship_t *best = NULL;
+    double best_wait = 0;
+    for (size_t i = 0; i < eligible.size(); ++i) {
+        relationship_t *candidate = eligible[(start + i) % eligible.size()];
+        const double latency = candidate->read_latency_secs != 0
+            ? candidate->read_latency_secs
+            : DIRECT_READ_INITIAL_LATENCY_SECS;
+        const double expected_wait = latency * (1 + candidate->reads_in_flight);
+        if (best == NULL || expected_wait < best_wait) {
+            best = candidate;
+            best_wait = expected_wait;
+        }
+    }
+    return best;
+}
+
 template <class protocol_t>
 void outdated_read_store_result(typename protocol_t::read_response_t *result_out, const typename protocol_t::read_response_t &result_in, cond_t *done) {
     *result_out = result_in;
@@ -245,7 +305,9 @@ void cluster_namespace_interface_t<protocol_t>::perform_outdated_read(
     THROWS_NOTHING
 {
     outdated_read_info_t *direct_reader_to_contact = &(*direct_readers_to_contact)[i];
+    relationship_t *relationship = direct_reader_to_contact->relationship;
 
+    const ticks_t start_time = get_ticks();
     try {
         cond_t done;
         mailbox_t<void(typename protocol_t::read_response_t)> cont(mailbox_manager,
@@ -256,6 +318,12 @@ void cluster_namespace_interface_t<protocol_t>::perform_outdated_read(
         wait_any_t waiter(direct_reader_to_contact->direct_reader_access->get_failed_signal(), &done);
         wait_interruptible(&waiter, interruptor);
         direct_reader_to_contact->direct_reader_access->access();   /* throws if `get_failed_signal()->is_pulsed()` */
+
+        const double latency = ticks_to_secs(get_ticks() - start_time);
+        relationship->read_latency_secs = relationship->read_latency_secs == 0
+            ? latency
+            : (1 - DIRECT_READ_LATENCY_SMOOTHING) * relationship->read_latency_secs
+                + DIRECT_READ_LATENCY_SMOOTHING * latency;
     } catch (const resource_lost_exc_t &) {
         failures->at(i).assign("lost contact with direct reader");
     } catch (const interrupted_exc_t &) {
@@ -264,6 +332,7 @@ void cluster_namespace_interface_t<protocol_t>::perform_outdated_read(
            `read_outdated()` will notice that the interruptor has been pulsed
            and won't try to access our result. */
     }
+    --relationship->reads_in_flight;
 }
 
 template <class protocol_t>
@@ -396,8 +465,11 @@ void cluster_namespace_interface_t<protocol_t>::relationship_coroutine(peer_id_t
         relationship_record.region = region;
         relationship_record.master_access = master_access.has() ? master_access.get() : NULL;
         relationship_record.direct_reader_access = direct_reader_access.has() ? direct_reader_access.get() : NULL;
+        relationship_record.reads_in_flight = 0;
+        relationship_record.read_latency_secs = 0;
 
         region_map_set_membership_t<protocol_t, relationship_t *> relationship_map_insertion(&relationships,
+                                                                                             &relationships_index,
                                                                                              region,
                                                                                              &relationship_record);
 
@@ -23,6 +23,7 @@
 #include "concurrency/promise.hpp"
 #include "concurrency/watchable.hpp"
 #include "protocol_api.hpp"
+#include "region_map_index.hpp"
 
 template <class> class cow_ptr_t;
 template <class protocol_t> class master_access_t;
@@ -34,13 +35,16 @@ template <class> class watchable_subscription_t;
 template <class protocol_t, class value_t>
 class region_map_set_membership_t {
 public:
-    region_map_set_membership_t(region_map_t<protocol_t, std::set<value_t> > *m, const typename protocol_t::region_t &r, const value_t &v) :
-        map(m), region(r), value(v) {
+    region_map_set_membership_t(region_map_t<protocol_t, std::set<value_t> > *m,
+                                region_map_index_t<protocol_t, std::set<value_t> > *i,
+                                const typename protocol_t::region_t &r, const value_t &v) :
+        map(m), index(i), region(r), value(v) {
         region_map_t<protocol_t, std::set<value_t> > submap = map->mask(region);
         for (typename region_map_t<protocol_t, std::set<value_t> >::iterator it = submap.begin(); it != submap.end(); it++) {
             it->second.insert(value);
         }
         map->update(submap);
+        index->rebuild();
     }
     ~region_map_set_membership_t() {
         region_map_t<protocol_t, std::set<value_t> > submap = map->mask(region);
@@ -48,9 +52,11 @@ public:
             it->second.erase(value);
         }
         map->update(submap);
+        index->rebuild();
     }
 private:
     region_map_t<protocol_t, std::set<value_t> > *map;
+    region_map_index_t<protocol_t, std::set<value_t> > *index;
     typename protocol_t::region_t region;
     value_t value;
 };
@@ -77,6 +83,8 @@ public:
 
     void read_outdated(const typename protocol_t::read_t &r, typename protocol_t::read_response_t *response, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
 
+    void read_bounded_staleness(const typename protocol_t::read_t &r, typename protocol_t::read_response_t *response, int64_t max_staleness_ms, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
+
     void write(const typename protocol_t::write_t &w, typename protocol_t::write_response_t *response, order_token_t order_token, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
 
     std::set<typename protocol_t::region_t> get_sharding_scheme() THROWS_ONLY(cannot_perform_query_exc_t);
@@ -88,6 +96,13 @@ private:
         typename protocol_t::region_t region;
         master_access_t<protocol_t> *master_access;
         resource_access_t<direct_reader_business_card_t<protocol_t> > *direct_reader_access;
+
+        /* What we've seen of the direct reader, for picking which replica to
+        send outdated reads to. `read_latency_secs` is zero until the first read
+        comes back. */
+        int reads_in_flight;
+        double read_latency_secs;
+
         auto_drainer_t drainer;
     };
 
@@ -107,6 +122,7 @@ private:
     class outdated_read_info_t {
     public:
         typename protocol_t::read_t sharded_op;
+        relationship_t *relationship;
         resource_access_t<direct_reader_business_card_t<protocol_t> > *direct_reader_access;
         auto_drainer_t::lock_t keepalive;
     };
@@ -133,12 +149,22 @@ private:
             signal_t *interruptor)
         THROWS_NOTHING;
 
+    /* `max_staleness` is in microseconds, or -1 if any replica will do. */
     void dispatch_outdated_read(
             const typename protocol_t::read_t &op,
             typename protocol_t::read_response_t *response,
+            int64_t max_staleness,
             signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
 
+    /* Returns the replica among `candidates` that we expect to answer soonest,
+    of those whose data is at most `max_staleness` microseconds out of date at
+    `now`; or NULL if there are none. */
+    relationship_t *choose_direct_reader(
+            const std::set<relationship_t *> &candidates,
+            int64_t max_staleness,
+            microtime_t now);
+
     void perform_outdated_read(
             boost::ptr_vector<outdated_read_info_t> *direct_readers_to_contact,
             std::vector<typename protocol_t::read_response_t> *results,
@@ -167,6 +193,9 @@ private:
 
     std::set<reactor_activity_id_t> handled_activity_ids;
     region_map_t<protocol_t, std::set<relationship_t *> > relationships;
+    /* Lets `dispatch_immediate_op()` and `dispatch_outdated_read()` find the
+    shards that an operation touches without looking at every shard. */
+    region_map_index_t<protocol_t, std::set<relationship_t *> > relationships_index;
 
     /* `start_cond` will be pulsed when we have either successfully connected to
     or tried and failed to connect to every peer present when the constructor
@@ -35,6 +35,7 @@ reactor_t<protocol_t>::reactor_t(
     parent_perfmon_collection(_parent_perfmon_collection),
     regions_perfmon_collection(),
     regions_perfmon_membership(parent_perfmon_collection, &regions_perfmon_collection, "regions"),
+    next_be_primary_perfmon_id(0),
     io_backender(_io_backender),
     mailbox_manager(mm),
     ack_checker(ack_checker_),
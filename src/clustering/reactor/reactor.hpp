@@ -160,6 +160,10 @@ private:
     perfmon_collection_t regions_perfmon_collection;
     perfmon_membership_t regions_perfmon_membership;
 
+    /* Numbers the `be_primary` perfmon collections, since several hash shards
+    of one key range render as the same region name. */
+    uint64_t next_be_primary_perfmon_id;
+
     io_backender_t *io_backender;
 
     mailbox_manager_t *mailbox_manager;
@@ -13,6 +13,7 @@
 #include "clustering/immediate_consistency/branch/listener.hpp"
 #include "clustering/immediate_consistency/branch/replier.hpp"
 #include "clustering/immediate_consistency/query/direct_reader.hpp"
+#include "clustering/reactor/expiration_reaper.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/cross_thread_watchable.hpp"
 
@@ -415,8 +416,10 @@ void reactor_t<protocol_t>::be_primary(typename protocol_t::region_t region, sto
          * interrupted or we have backfilled the most up to date data. */
         while (!attempt_backfill_from_peers(&directory_entry, &order_source, region, svs, blueprint, interruptor)) { }
 
-        // TODO: Don't use local stack variable.
-        std::string region_name = strprintf("be_primary_%p", &region);
+        /* The rebalancing suggester looks up each shard's load by the rendered
+        region that follows the id in this name. */
+        std::string region_name = strprintf("be_primary_%" PRIu64 "_", next_be_primary_perfmon_id++) +
+            render_region_as_string(&region);
 
         cross_thread_signal_t ct_interruptor(interruptor, svs->home_thread());
         on_thread_t th(svs->home_thread());
@@ -445,6 +448,7 @@ void reactor_t<protocol_t>::be_primary(typename protocol_t::region_t region, sto
         listener_t<protocol_t> listener(base_path, io_backender, mailbox_manager, ct_broadcaster_business_card.get_watchable(), branch_history_manager, &broadcaster, &region_perfmon_collection, &ct_interruptor, &order_source);
         replier_t<protocol_t> replier(&listener, mailbox_manager, branch_history_manager);
         master_t<protocol_t> master(mailbox_manager, ack_checker, region, &broadcaster);
+        expiration_reaper_t<protocol_t> expiration_reaper(&broadcaster, ack_checker, region, &region_perfmon_collection);
         direct_reader_t<protocol_t> direct_reader(mailbox_manager, svs);
 
         on_thread_t th4(this->home_thread());
@@ -466,6 +470,7 @@ void reactor_t<protocol_t>::be_primary(typename protocol_t::region_t region, sto
 
 #include "mock/dummy_protocol.hpp"
 #include "mock/dummy_protocol_json_adapter.hpp"
+#include "memcached/expiration_reaper.hpp"
 #include "memcached/protocol.hpp"
 #include "memcached/protocol_json_adapter.hpp"
 #include "rdb_protocol/protocol.hpp"
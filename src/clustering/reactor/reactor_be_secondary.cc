@@ -150,6 +150,12 @@ void reactor_t<protocol_t>::be_secondary(typename protocol_t::region_t region, s
         /* Tell everyone that we're backfilling so that we can get up to
          * date. */
         directory_entry_t directory_entry(this, region);
+
+        /* When we last stopped following a primary, by our clock, or zero if we
+        haven't followed one since we started. We advertise this while we don't
+        have a primary, so that readers know how stale our data is. */
+        microtime_t live_until = 0;
+
         while (true) {
             clone_ptr_t<watchable_t<boost::optional<boost::optional<broadcaster_business_card_t<protocol_t> > > > > broadcaster;
             clone_ptr_t<watchable_t<boost::optional<boost::optional<replier_business_card_t<protocol_t> > > > > location_to_backfill_from;
@@ -185,7 +191,8 @@ void reactor_t<protocol_t>::be_secondary(typename protocol_t::region_t region, s
                 branch_history_manager->export_branch_history(to_version_range_map(metainfo_blob), &branch_history);
 
                 typename reactor_business_card_t<protocol_t>::secondary_without_primary_t
-                    activity(to_version_range_map(metainfo_blob), backfiller.get_business_card(), direct_reader.get_business_card(), branch_history);
+                    activity(to_version_range_map(metainfo_blob), backfiller.get_business_card(),
+                             direct_reader.get_outdated_business_card(live_until), branch_history);
 
                 directory_entry.set(activity);
 
@@ -261,6 +268,7 @@ void reactor_t<protocol_t>::be_secondary(typename protocol_t::region_t region, s
 
                 /* Wait for something to change. */
                 wait_interruptible(&ct_broadcaster_lost_signal, interruptor);
+                live_until = current_microtime();
             } catch (const typename listener_t<protocol_t>::backfiller_lost_exc_t &) {
                 /* We lost the replier which means we should retry, just
                  * going back to the top of the while loop accomplishes this.
@@ -1,6 +1,10 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "clustering/suggester/suggester.hpp"
 
+#include <math.h>
+
+#include <algorithm>
+
 #include "stl_utils.hpp"
 #include "containers/priority_queue.hpp"
 #include "clustering/generic/nonoverlapping_regions.hpp"
@@ -99,6 +103,10 @@ bool operator<(const priority_t &x, const priority_t &y) {
 }
 
 
+bool shard_left_less(const std::pair<key_range_t, double> &x, const std::pair<key_range_t, double> &y) {
+    return x.first.left < y.first.left;
+}
+
 } //anonymous namespace
 
 /* Returns a "score" indicating how expensive it would be to turn the machine
@@ -346,6 +354,87 @@ persistable_blueprint_t<protocol_t> suggest_blueprint(
     return blueprint;
 }
 
+bool suggest_split_points_by_load(
+        const std::vector<std::pair<key_range_t, double> > &shard_loads,
+        const std::map<store_key_t, int64_t> &key_counts,
+        size_t num_shards,
+        std::vector<store_key_t> *split_points_out) {
+    split_points_out->clear();
+
+    /* Spread each shard's load over the distribution buckets that start inside
+    it, in proportion to how many keys each bucket has. This gives us a list of
+    places where we could split the table, along with how much load lies before
+    each of them. */
+    std::vector<std::pair<key_range_t, double> > sorted_shards(shard_loads);
+    std::sort(sorted_shards.begin(), sorted_shards.end(), shard_left_less);
+
+    std::vector<std::pair<store_key_t, double> > buckets;
+    for (size_t i = 0; i < sorted_shards.size(); ++i) {
+        const key_range_t &range = sorted_shards[i].first;
+        const double load = std::max(sorted_shards[i].second, 0.0);
+
+        size_t first_bucket = buckets.size();
+        std::map<store_key_t, int64_t>::const_iterator it = key_counts.lower_bound(range.left);
+        if (it == key_counts.end() || it->first != range.left) {
+            buckets.push_back(std::make_pair(range.left, 0.0));
+        }
+        int64_t total_keys = 0;
+        for (; it != key_counts.end() && range.contains_key(it->first); ++it) {
+            buckets.push_back(std::make_pair(it->first, static_cast<double>(std::max<int64_t>(it->second, 0))));
+            total_keys += std::max<int64_t>(it->second, 0);
+        }
+
+        if (total_keys == 0) {
+            /* We don't know where the keys are, so we can only put the load at
+            the start of the shard. */
+            for (size_t j = first_bucket; j < buckets.size(); ++j) {
+                buckets[j].second = 0;
+            }
+            buckets[first_bucket].second = load;
+        } else {
+            for (size_t j = first_bucket; j < buckets.size(); ++j) {
+                buckets[j].second = load * buckets[j].second / total_keys;
+            }
+        }
+    }
+
+    double total_load = 0;
+    for (size_t j = 0; j < buckets.size(); ++j) {
+        total_load += buckets[j].second;
+    }
+
+    if (num_shards <= 1) {
+        return true;
+    }
+    if (total_load <= 0) {
+        return false;
+    }
+
+    /* `load_before[j]` is the load on all buckets before bucket `j`. For each
+    split point we want, pick the bucket boundary whose `load_before` is closest
+    to the ideal; boundaries only move forward, so the split points come out
+    in order and distinct. */
+    std::vector<double> load_before(buckets.size(), 0);
+    for (size_t j = 1; j < buckets.size(); ++j) {
+        load_before[j] = load_before[j - 1] + buckets[j - 1].second;
+    }
+
+    size_t next_boundary = 1;
+    for (size_t k = 1; k < num_shards && next_boundary < buckets.size(); ++k) {
+        double ideal = total_load * k / num_shards;
+        size_t best = next_boundary;
+        while (best + 1 < buckets.size() &&
+               std::fabs(load_before[best + 1] - ideal) <= std::fabs(load_before[best] - ideal)) {
+            ++best;
+        }
+        split_points_out->push_back(buckets[best].first);
+        next_boundary = best + 1;
+    }
+
+    return split_points_out->size() == num_shards - 1;
+}
+
+
 #include "mock/dummy_protocol.hpp"
 
 
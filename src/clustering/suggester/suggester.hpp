@@ -5,7 +5,10 @@
 #include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "btree/keys.hpp"
 #include "clustering/administration/datacenter_metadata.hpp"
 #include "clustering/administration/persistable_blueprint.hpp"
 #include "clustering/reactor/metadata.hpp"
@@ -40,4 +43,19 @@ persistable_blueprint_t<protocol_t> suggest_blueprint(
         std::map<machine_id_t, int> *usage,
         bool prioritize_distribution);
 
+/* Suggests `num_shards - 1` split points that divide the table's load evenly
+between `num_shards` shards, and puts them in `split_points_out`. `shard_loads` lists the table's current shards
+and how busy each of them is (in operations per second, or any other unit, as long
+as it's the same for all of them). `key_counts` is the table's key distribution, as
+returned by a distribution read; it tells us where the keys are within each shard.
+Within a shard, load is assumed to be spread evenly over its keys.
+
+Returns false if there's no load to go by or there aren't enough places to split
+the table; `split_points_out` then holds however many split points were found. */
+bool suggest_split_points_by_load(
+        const std::vector<std::pair<key_range_t, double> > &shard_loads,
+        const std::map<store_key_t, int64_t> &key_counts,
+        size_t num_shards,
+        std::vector<store_key_t> *split_points_out);
+
 #endif /* CLUSTERING_SUGGESTER_SUGGESTER_HPP_ */
@@ -4,6 +4,7 @@
 
 #include "concurrency/queue/passive_producer.hpp"
 #include "containers/intrusive_list.hpp"
+#include "utils.hpp"
 
 /* `accounting_queue_t` is useful when you have some number of actors competing
 for a shared resource, and you want them to be granted access to the resource in
@@ -15,7 +16,26 @@ from a number of other `passive_producer_t`s. To associate the
 `account_t`s determines which `passive_producer_t`s the `accounting_queue_t`
 will `pop()` from when its own `pop()` method is called. When one of the sub-
 `passive_producer_t`s is not available, then it is ignored until it becomes
-available. */
+available.
+
+An `account_t` may also be given an `accounting_queue_deadline_source_t`, which
+tells the `accounting_queue_t` by when the account's next value should be
+popped. Whenever an active account's deadline has passed, the
+`accounting_queue_t` pops from the account with the earliest deadline instead of
+going by the shares. So that the other accounts don't starve, at most
+`batch_factor` values are popped that way in a row before the next value is
+popped according to the shares again. */
+
+class accounting_queue_deadline_source_t {
+public:
+    /* Returns the time (as in `get_ticks()`) by which the account's next value
+    should be popped, or 0 if there is no deadline for it. Only called while the
+    account's source is available. */
+    virtual ticks_t next_pop_deadline() = 0;
+
+protected:
+    virtual ~accounting_queue_deadline_source_t() { }
+};
 
 template<class value_t>
 class accounting_queue_t :
@@ -27,7 +47,9 @@ public:
         passive_producer_t<value_t>(&available_control),
         total_shares(0),
         selector(0),
-        batch_factor(_batch_factor) {
+        batch_factor(_batch_factor),
+        active_deadline_accounts(0),
+        deadline_pops_in_a_row(0) {
 
         rassert(batch_factor > 0);
     }
@@ -39,8 +61,10 @@ public:
 
     class account_t : private availability_callback_t, public intrusive_list_node_t<account_t> {
     public:
-        account_t(accounting_queue_t *p, passive_producer_t<value_t> *s, int _shares)
-            : parent(p), source(s), shares(_shares), active(false) {
+        account_t(accounting_queue_t *p, passive_producer_t<value_t> *s, int _shares,
+                  accounting_queue_deadline_source_t *_deadline_source = NULL)
+            : parent(p), source(s), shares(_shares), deadline_source(_deadline_source),
+              active(false) {
             parent->assert_thread();
             rassert(shares > 0);
             if (source->available->get()) {
@@ -81,16 +105,23 @@ public:
             active = true;
             parent->active_accounts.push_back(this);
             parent->total_shares += shares;
+            if (deadline_source != NULL) {
+                ++parent->active_deadline_accounts;
+            }
         }
         void deactivate() {
             active = false;
             parent->active_accounts.remove(this);
             parent->total_shares -= shares;
+            if (deadline_source != NULL) {
+                --parent->active_deadline_accounts;
+            }
         }
 
         accounting_queue_t *parent;
         passive_producer_t<value_t> *source;
         int shares;
+        accounting_queue_deadline_source_t *deadline_source;
         bool active;
     };
 
@@ -101,10 +132,44 @@ private:
 
     int total_shares, selector, batch_factor;
 
+    // How many of the accounts in `active_accounts` have a deadline source, so
+    // that we don't have to look for overdue accounts when there can't be any.
+    int active_deadline_accounts;
+    int deadline_pops_in_a_row;
+
     availability_control_t available_control;
+
+    // Returns the active account whose deadline has passed longest ago, or `NULL`.
+    account_t *most_overdue_account() {
+        const ticks_t now = get_ticks();
+        account_t *most_overdue = NULL;
+        ticks_t earliest_deadline = 0;
+        for (account_t *acct = active_accounts.head(); acct != NULL; acct = active_accounts.next(acct)) {
+            if (acct->deadline_source == NULL) {
+                continue;
+            }
+            const ticks_t deadline = acct->deadline_source->next_pop_deadline();
+            if (deadline != 0 && deadline <= now
+                && (most_overdue == NULL || deadline < earliest_deadline)) {
+                most_overdue = acct;
+                earliest_deadline = deadline;
+            }
+        }
+        return most_overdue;
+    }
+
     value_t produce_next_value() {
         assert_thread();
 
+        if (active_deadline_accounts > 0 && deadline_pops_in_a_row < batch_factor) {
+            account_t *overdue = most_overdue_account();
+            if (overdue != NULL) {
+                ++deadline_pops_in_a_row;
+                return overdue->source->pop();
+            }
+        }
+        deadline_pops_in_a_row = 0;
+
         selector %= total_shares * batch_factor;
         // TODO: Maybe that line should be like this instead?
         // It would be very fair, but there might be some issues with that (like
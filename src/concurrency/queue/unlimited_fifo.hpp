@@ -52,6 +52,12 @@ struct unlimited_fifo_queue_t : public passive_producer_t<value_t> {
         return queue.size();
     }
 
+    // Returns the value that will be popped next, without popping it.
+    value_t peek() {
+        rassert(!queue.empty());
+        return unlimited_fifo_queue::get_front_of_list(queue);
+    }
+
 private:
     availability_control_t available_control;
     value_t produce_next_value() {
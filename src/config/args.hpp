@@ -58,6 +58,11 @@
 #define CACHE_READS_IO_PRIORITY                   512
 #define CACHE_WRITES_IO_PRIORITY                  64
 
+// Reads on behalf of queries have a latency target; once a read has used up half
+// of it waiting in the disk queue, it is dispatched ahead of background IO (writes,
+// GC, backfilling) regardless of the priorities above.
+#define CACHE_READS_IO_LATENCY_TARGET_MS          10
+
 // Garbage Colletion uses its own two IO accounts.
 // There is one low-priority account that is meant to guarantee
 // (performance-wise) unintrusive garbage collection.
@@ -98,6 +103,11 @@
 // TODO: make this dynamic where possible
 #define MAX_THREADS                               128
 
+// Capacity of each per-(source, destination) message ring in the message hub. When a ring
+// is full the remaining messages wait in the source thread's local queue until the
+// destination makes room.
+#define MESSAGE_HUB_RING_SIZE                     1024
+
 // Ticks (in milliseconds) the internal timed tasks are performed at
 #define TIMER_TICKS_IN_MS                         5
 
@@ -109,6 +119,27 @@
 // on a specific slice at any given time.
 #define DEFAULT_MAX_CONCURRENT_FLUSHES            1
 
+// Adaptive writeback: start a flush once about this many milliseconds' worth of dirty
+// blocks (at the current dirtying rate) have accumulated, rather than waiting for the flush
+// timer or the flush threshold. The flush threshold is still the upper bound.
+#define WRITEBACK_TARGET_FLUSH_INTERVAL_MS        50
+
+// If writes on the cache's IO account take longer than this on average, the disk is
+// busy, and flushes are allowed to grow proportionally so that more overwrites get
+// coalesced.
+#define WRITEBACK_TARGET_WRITE_LATENCY_MS         10
+
+// Adaptive flushes are never triggered for fewer dirty blocks than this.
+#define WRITEBACK_MIN_FLUSH_BLOCKS                16
+
+// How often the writeback re-estimates how fast blocks are being dirtied.
+#define WRITEBACK_RATE_WINDOW_MS                  100
+
+// Once this fraction of the unsaved data limit is dirty, write transactions are paced to
+// the rate at which flushes are writing blocks out, more strictly the closer we get to
+// the limit.
+#define WRITEBACK_SOFT_THROTTLE_FRACTION          0.5
+
 // If more than this many bytes of dirty data accumulate in the cache, then write
 // transactions will be throttled.
 // A value of 0 means that it will automatically be set to MAX_UNSAVED_DATA_LIMIT_FRACTION
@@ -218,8 +249,103 @@
 
 #define COROUTINE_STACK_SIZE                      131072
 
+// Stack size for coroutines spawned with `CORO_STACK_SMALL` (see
+// `coro_stack_class_t` in coroutines.hpp).
+#define COROUTINE_SMALL_STACK_SIZE                32768
+
 #define MAX_COROS_PER_THREAD                      10000
 
+// The directory sends a full copy of a peer's metadata instead of a delta once every
+// this many updates, so that the peers' copies never depend on a long chain of deltas.
+#define DIRECTORY_FULL_UPDATE_INTERVAL            100
+
+// How many TCP connections we keep open to each peer. Mailbox messages are spread over
+// all of them by destination mailbox; everything else goes over the first one.
+#define CONNECTIVITY_CONNECTIONS_PER_PEER         4
+
+// How long we wait for the extra connections to a peer to be set up before we go on
+// without the ones that aren't there yet.
+#define CONNECTIVITY_LANE_SETUP_TIMEOUT_MS        5000
+
+// On connections where both ends support it, mailbox messages at least this big are
+// compressed before they go out. Smaller ones don't shrink enough to pay for it.
+#define CLUSTER_COMPRESSION_THRESHOLD_BYTES       512
+
+// The zlib compression level for cluster traffic. Level 1 is the fastest; higher levels
+// buy a little more ratio for a lot more CPU time.
+#define CLUSTER_COMPRESSION_LEVEL                 1
+
+// The broadcaster sends writes to each mirror in batches. A batch is sent once it has
+// this many writes in it...
+#define BROADCASTER_WRITE_BATCH_MAX_WRITES        64
+
+// ...or once it has been open for this long. With 0, a batch collects whatever writes
+// arrive before the event loop comes around again, which adds no latency.
+#define BROADCASTER_WRITE_BATCH_WINDOW_MS         0
+
+// Backfill chunks are flow-controlled by the receiver: the backfillee grants the
+// backfiller credit for this many keys up front, and each chunk uses up credit for
+// the keys it carries...
+#define BACKFILL_MAX_KEYS_IN_FLIGHT               5000
+
+// ...and grants more, at least this many keys at a time, as it applies them.
+#define BACKFILL_CREDIT_GRANT_KEYS                16
+
+// How many chunks the backfiller may be serializing and sending at once while the
+// traversal goes on producing more.
+#define BACKFILL_MAX_CONCURRENT_SENDS             16
+
+// How many chunks the backfillee applies to its store at once.
+#define BACKFILL_RECEIVER_WORKERS                 10
+
+// The backfiller measures the serialized size of one in this many chunks to estimate
+// how many bytes per second a backfill is sending.
+#define BACKFILL_CHUNK_SIZE_SAMPLE_INTERVAL       16
+
+// Outdated reads go to the replica with the shortest expected wait: its smoothed
+// read latency times one more than the number of reads we already have out to it.
+// Each new latency sample gets this much weight in the smoothed value...
+#define DIRECT_READ_LATENCY_SMOOTHING             0.2
+
+// ...and replicas that we haven't heard back from yet are assumed to take this long.
+#define DIRECT_READ_INITIAL_LATENCY_SECS          0.001
+
+// When suggesting split points by load, a shard's load is its reads per second plus
+// this many times its writes per second, since every replica has to apply each write.
+#define SHARD_LOAD_WRITE_WEIGHT                   2.0
+
+// The primary of each memcached shard looks for expired keys and removes them this
+// often...
+#define MEMCACHED_EXPIRATION_SWEEP_INTERVAL_MS    60000
+
+// ...a batch of at most this many keys at a time. It keeps going until a batch comes
+// up short.
+#define MEMCACHED_EXPIRATION_SWEEP_BATCH_SIZE     1000
+
+// How many queries a client connection that asked for unordered responses may have
+// running at once. When it has this many, we stop reading more from it until one
+// finishes.
+#define PROTOB_MAX_CONCURRENT_QUERIES_PER_CONN    256
+
+// All the datums a connection's cached streams have read ahead of the client
+// together take up at most about this much memory.
+#define RDB_STREAM_CACHE_PREFETCH_BUDGET_BYTES    (16 * MEGABYTE)
+
+// A ReQL range read asks the shards for chunks of this many bytes of rows to begin
+// with. The stream then doubles the chunk size whenever the client had to wait for a
+// chunk, and halves it whenever a chunk took longer than
+// RDB_RGET_TARGET_CHUNK_LATENCY_MS to read, staying between the two bounds below.
+#define RDB_RGET_INITIAL_CHUNK_BYTES              (256 * KILOBYTE)
+#define RDB_RGET_MIN_CHUNK_BYTES                  (16 * KILOBYTE)
+#define RDB_RGET_MAX_CHUNK_BYTES                  (16 * MEGABYTE)
+#define RDB_RGET_TARGET_CHUNK_LATENCY_MS          50
+
+// Secondary index post construction works through the primary btree in chunks of
+// about this many keys, checkpointing its progress after each one. The chunk
+// boundaries come from the btree's key distribution down to this depth.
+#define RDB_SINDEX_POST_CONSTRUCTION_CHUNK_KEYS   100000
+#define RDB_SINDEX_POST_CONSTRUCTION_DEPTH        2
+
 
 // Size of a cache line (used in cache_line_padded_t).
 #define CACHE_LINE_SIZE                           64
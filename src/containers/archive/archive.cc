@@ -1,9 +1,11 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "containers/archive/archive.hpp"
 
+#include <limits.h>
 #include <string.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "containers/uuid.hpp"
 
@@ -39,8 +41,11 @@ write_message_t::~write_message_t() {
 }
 
 void write_message_t::append(const void *p, int64_t n) {
+    size_ += n;
+    bytes_copied_ += n;
     while (n > 0) {
-        if (buffers_.empty() || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
+        if (buffers_.empty() || buffers_.tail()->external != NULL
+            || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
             buffers_.push_back(new write_buffer_t);
         }
 
@@ -54,15 +59,78 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
-int send_write_message(write_stream_t *s, const write_message_t *msg) {
-    intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(msg)->unsafe_expose_buffers();
-    for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
-        int64_t res = s->write(p->data, p->size);
+void write_message_t::append_reference(const void *p, int64_t n) {
+    append_external(static_cast<const char *>(p), n, counted_t<data_buffer_t>());
+}
+
+void write_message_t::append_data_buffer(const counted_t<data_buffer_t> &buf) {
+    if (buf->size() < MIN_REFERENCE_SIZE) {
+        append(buf->buf(), buf->size());
+    } else {
+        append_external(buf->buf(), buf->size(), buf);
+    }
+}
+
+void write_message_t::append_external(const char *p, int64_t n, const counted_t<data_buffer_t> &owner) {
+    size_ += n;
+    while (n > 0) {
+        // `write_buffer_t::size` is an `int`, so huge payloads take several buffers.
+        const int64_t k = std::min<int64_t>(n, INT_MAX);
+        write_buffer_t *b = new write_buffer_t;
+        b->external = p;
+        b->external_owner = owner;
+        b->size = k;
+        buffers_.push_back(b);
+        p += k;
+        n -= k;
+    }
+}
+
+int64_t write_stream_t::writev(const iovec *iov, int64_t iovcnt) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < iovcnt; ++i) {
+        int64_t res = write(iov[i].iov_base, iov[i].iov_len);
         if (res == -1) {
             return -1;
         }
-        rassert(res == p->size);
+        rassert(res == static_cast<int64_t>(iov[i].iov_len));
+        total += res;
+    }
+    return total;
+}
+
+int send_write_message(write_stream_t *s, const write_message_t *msg) {
+    intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(msg)->unsafe_expose_buffers();
+
+    // Most messages fit in a handful of buffers.
+    const int64_t max_stack_iovecs = 16;
+    iovec stack_iovecs[max_stack_iovecs];
+    std::vector<iovec> heap_iovecs;
+
+    int64_t iovcnt = 0;
+    for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
+        ++iovcnt;
+    }
+    iovec *iov = stack_iovecs;
+    if (iovcnt > max_stack_iovecs) {
+        heap_iovecs.resize(iovcnt);
+        iov = heap_iovecs.data();
+    }
+
+    int64_t i = 0;
+    for (write_buffer_t *p = list->head(); p; p = list->next(p), ++i) {
+        iov[i].iov_base = const_cast<char *>(p->get_data());
+        iov[i].iov_len = p->size;
+    }
+
+    if (iovcnt == 0) {
+        return 0;
+    }
+    int64_t res = s->writev(iov, iovcnt);
+    if (res == -1) {
+        return -1;
     }
+    rassert(res == msg->size());
     return 0;
 }
 
@@ -3,7 +3,9 @@
 #define CONTAINERS_ARCHIVE_ARCHIVE_HPP_
 
 #include <stdint.h>
+#include <sys/uio.h>
 
+#include "containers/data_buffer.hpp"
 #include "containers/intrusive_list.hpp"
 #include "utils.hpp"
 
@@ -66,18 +68,32 @@ public:
     write_stream_t() { }
     // Returns n, or -1 upon error. Blocks until all bytes are written.
     virtual int64_t write(const void *p, int64_t n) = 0;
+
+    // Writes the `iovcnt` pieces of `iov` in order. Returns the total number of
+    // bytes, or -1 upon error. The default implementation calls `write()` for
+    // each piece; streams that can hand all of them to the kernel (or copy them)
+    // at once should override it.
+    virtual int64_t writev(const iovec *iov, int64_t iovcnt);
 protected:
     virtual ~write_stream_t() { }
 private:
     DISABLE_COPYING(write_stream_t);
 };
 
+// A buffer either holds its `size` bytes in `data`, or it refers to `size`
+// bytes of memory that belongs to somebody else at `external`. Use `get_data()`
+// to get at the bytes either way.
 class write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
 public:
-    write_buffer_t() : size(0) { }
+    write_buffer_t() : size(0), external(NULL) { }
+
+    const char *get_data() const { return external != NULL ? external : data; }
 
     static const int DATA_SIZE = 4096;
     int size;
+    const char *external;
+    // Keeps `external` alive, if it points into a `data_buffer_t`.
+    counted_t<data_buffer_t> external_owner;
     char data[DATA_SIZE];
 
 private:
@@ -87,16 +103,34 @@ private:
 // A set of buffers in which an atomic message to be sent on a stream
 // gets built up.  (This way we don't flush after the first four bytes
 // sent to a stream, or buffer things and then forget to manually
-// flush.  This type can be extended to support holding references to
-// large buffers, to save copying.)  Generally speaking, you serialize
-// to a write_message_t, and then flush that to a write_stream_t.
+// flush.)  Large payloads can be appended by reference instead of being
+// copied; `send_write_message()` hands all the buffers to the stream in
+// one `writev()`. Generally speaking, you serialize to a
+// write_message_t, and then flush that to a write_stream_t.
 class write_message_t {
 public:
-    write_message_t() { }
+    write_message_t() : size_(0), bytes_copied_(0) { }
     ~write_message_t();
 
     void append(const void *p, int64_t n);
 
+    // Appends a reference to the `n` bytes at `p` instead of a copy of them.
+    // They must stay valid and unchanged until the message is destroyed.
+    void append_reference(const void *p, int64_t n);
+
+    // Appends the contents of `buf`, by reference if it's big enough to be
+    // worth it. The message holds a reference to `buf` for as long as it
+    // needs it.
+    void append_data_buffer(const counted_t<data_buffer_t> &buf);
+
+    // Payloads smaller than this get copied even if they could be referenced.
+    static const int64_t MIN_REFERENCE_SIZE = 4 * write_buffer_t::DATA_SIZE;
+
+    // The total number of bytes in the message, and how many of them were
+    // copied into the message's own buffers.
+    int64_t size() const { return size_; }
+    int64_t bytes_copied() const { return bytes_copied_; }
+
     intrusive_list_t<write_buffer_t> *unsafe_expose_buffers() { return &buffers_; }
 
     template <class T>
@@ -107,7 +141,11 @@ public:
 private:
     friend int send_write_message(write_stream_t *s, const write_message_t *msg);
 
+    void append_external(const char *p, int64_t n, const counted_t<data_buffer_t> &owner);
+
     intrusive_list_t<write_buffer_t> buffers_;
+    int64_t size_;
+    int64_t bytes_copied_;
 
     DISABLE_COPYING(write_message_t);
 };
@@ -18,6 +18,7 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    virtual MUST_USE int64_t writev(const iovec *iov, int64_t iovcnt);
 
     void rethread(int new_thread);
 
@@ -57,6 +58,7 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    virtual MUST_USE int64_t writev(const iovec *iov, int64_t iovcnt);
 
 private:
     keepalive_callback_t *keepalive_callback;
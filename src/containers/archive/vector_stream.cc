@@ -14,6 +14,17 @@ int64_t vector_stream_t::write(const void *p, int64_t n) {
     return n;
 }
 
+int64_t vector_stream_t::writev(const iovec *iov, int64_t iovcnt) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < iovcnt; ++i) {
+        const char *chp = static_cast<const char *>(iov[i].iov_base);
+        vec_.insert(vec_.end(), chp, chp + iov[i].iov_len);
+        total += iov[i].iov_len;
+    }
+
+    return total;
+}
+
 vector_read_stream_t::vector_read_stream_t(const std::vector<char> *vector) : pos_(0), vec_(vector) { }
 vector_read_stream_t::~vector_read_stream_t() { }
 
@@ -0,0 +1,88 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "memcached/expiration_reaper.hpp"
+
+#include "arch/timing.hpp"
+#include "clustering/immediate_consistency/branch/broadcaster.hpp"
+
+expiration_reaper_t<memcached_protocol_t>::expiration_reaper_t(
+        broadcaster_t<memcached_protocol_t> *_broadcaster,
+        ack_checker_t *_ack_checker,
+        const memcached_protocol_t::region_t &_region,
+        perfmon_collection_t *parent_perfmon_collection)
+    : broadcaster(_broadcaster),
+      ack_checker(_ack_checker),
+      region(_region),
+      reaper_membership(parent_perfmon_collection, &reaper_collection, "expiration_reaper"),
+      stats_membership(&reaper_collection,
+                       &keys_reclaimed, "keys_reclaimed",
+                       &bytes_reclaimed, "bytes_reclaimed",
+                       NULLPTR) {
+    coro_t::spawn_sometime(boost::bind(&expiration_reaper_t<memcached_protocol_t>::reap, this, auto_drainer_t::lock_t(&drainer)));
+}
+
+void expiration_reaper_t<memcached_protocol_t>::reap(auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+    try {
+        for (;;) {
+            nap(MEMCACHED_EXPIRATION_SWEEP_INTERVAL_MS, keepalive.get_drain_signal());
+            try {
+                while (sweep_batch(keepalive.get_drain_signal())) { }
+            } catch (const cannot_perform_query_exc_t &) {
+                /* No replica could do the read; try again next time. */
+            }
+        }
+    } catch (const interrupted_exc_t &) {
+        /* We're shutting down. */
+    }
+}
+
+bool expiration_reaper_t<memcached_protocol_t>::sweep_batch(signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+    memcached_protocol_t::read_t read(expired_keys_query_t(region, MEMCACHED_EXPIRATION_SWEEP_BATCH_SIZE), time(NULL));
+    memcached_protocol_t::read_response_t response;
+    {
+        fifo_enforcer_sink_t::exit_read_t exiter(&fifo_sink, fifo_source.enter_read());
+        broadcaster->read(read, &response, &exiter, order_source.check_in("expiration_reaper_t::sweep_batch").with_read_mode(), interruptor);
+    }
+
+    const expired_keys_result_t *result = boost::get<expired_keys_result_t>(&response.result);
+    guarantee(result, "Bad boost::get\n");
+
+    for (size_t i = 0; i < result->keys.size(); ++i) {
+        if (expire_key(result->keys[i], interruptor)) {
+            ++keys_reclaimed;
+            bytes_reclaimed += result->sizes[i];
+        }
+    }
+
+    return result->keys.size() >= MEMCACHED_EXPIRATION_SWEEP_BATCH_SIZE;
+}
+
+bool expiration_reaper_t<memcached_protocol_t>::expire_key(const store_key_t &key, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    class expire_callback_t : public broadcaster_t<memcached_protocol_t>::write_callback_t {
+    public:
+        expire_callback_t() : expired(false) { }
+        void on_response(UNUSED peer_id_t peer, const memcached_protocol_t::write_response_t &response) {
+            /* Every replica applies the write with the same effective time, so
+            they all agree on whether the key had expired. */
+            const delete_result_t *result = boost::get<delete_result_t>(&response.result);
+            guarantee(result, "Bad boost::get\n");
+            expired = (*result == dr_deleted);
+        }
+        void on_done() {
+            done_cond.pulse();
+        }
+        bool expired;
+        cond_t done_cond;
+    } write_callback;
+
+    memcached_protocol_t::write_t write(expire_mutation_t(key), INVALID_CAS, time(NULL));
+    {
+        fifo_enforcer_sink_t::exit_write_t exiter(&fifo_sink, fifo_source.enter_write());
+        broadcaster->spawn_write(write, &exiter, order_source.check_in("expiration_reaper_t::expire_key"), &write_callback, interruptor, ack_checker);
+    }
+
+    /* Waiting for every replica to finish before we send the next write is
+    what keeps the reaper from crowding out client writes. */
+    wait_interruptible(&write_callback.done_cond, interruptor);
+    return write_callback.expired;
+}
@@ -0,0 +1,55 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef MEMCACHED_EXPIRATION_REAPER_HPP_
+#define MEMCACHED_EXPIRATION_REAPER_HPP_
+
+#include "clustering/reactor/expiration_reaper.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/fifo_checker.hpp"
+#include "concurrency/fifo_enforcer.hpp"
+#include "memcached/protocol.hpp"
+#include "perfmon/perfmon.hpp"
+
+/* Memcached values with an expiration time are only checked against it when
+somebody touches them, so keys that are never read again would stay on disk and
+in the cache forever. Every `MEMCACHED_EXPIRATION_SWEEP_INTERVAL_MS`, this sweeps
+the shard for expired keys and removes them with `expire_mutation_t`s, one at a
+time. Each batch of keys is found with an `expired_keys_query_t`, which reads the
+btree on the backfill account. */
+template <>
+class expiration_reaper_t<memcached_protocol_t> : public home_thread_mixin_t {
+public:
+    expiration_reaper_t(broadcaster_t<memcached_protocol_t> *broadcaster,
+                        ack_checker_t *ack_checker,
+                        const memcached_protocol_t::region_t &region,
+                        perfmon_collection_t *parent_perfmon_collection);
+
+private:
+    void reap(auto_drainer_t::lock_t keepalive);
+
+    /* Removes up to `MEMCACHED_EXPIRATION_SWEEP_BATCH_SIZE` expired keys.
+    Returns `true` if it found that many, in which case there are probably
+    more. */
+    bool sweep_batch(signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
+
+    /* Returns `true` if `key` had actually expired and was removed. */
+    bool expire_key(const store_key_t &key, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t);
+
+    broadcaster_t<memcached_protocol_t> *broadcaster;
+    ack_checker_t *ack_checker;
+    memcached_protocol_t::region_t region;
+
+    order_source_t order_source;
+    fifo_enforcer_source_t fifo_source;
+    fifo_enforcer_sink_t fifo_sink;
+
+    perfmon_collection_t reaper_collection;
+    perfmon_membership_t reaper_membership;
+    perfmon_counter_t keys_reclaimed, bytes_reclaimed;
+    perfmon_multi_membership_t stats_membership;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(expiration_reaper_t);
+};
+
+#endif  // MEMCACHED_EXPIRATION_REAPER_HPP_
@@ -31,6 +31,14 @@ public:
             throw no_more_data_exc_t();
     }
 
+    char peek(signal_t *interruptor) {
+        if (interruptor->is_pulsed()) throw no_more_data_exc_t();
+        int c = getc(file);
+        if (c == EOF) throw no_more_data_exc_t();
+        ungetc(c, file);
+        return c;
+    }
+
     void read_line(std::vector<char> *dest, signal_t *interruptor) {
         if (interruptor->is_pulsed()) throw no_more_data_exc_t();
         int limit = MEGABYTE;
@@ -0,0 +1,103 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "memcached/memcached_btree/expire.hpp"
+
+#include "btree/leaf_node.hpp"
+#include "btree/operations.hpp"
+#include "btree/parallel_traversal.hpp"
+#include "btree/slice.hpp"
+#include "buffer_cache/buffer_cache.hpp"
+#include "memcached/memcached_btree/node.hpp"
+#include "memcached/memcached_btree/value.hpp"
+
+class expired_keys_traversal_helper_t : public btree_traversal_helper_t {
+public:
+    expired_keys_traversal_helper_t(const key_range_t &_range, int _maximum,
+                                    exptime_t _effective_time, expired_keys_result_t *_result)
+        : range(_range), maximum(_maximum), effective_time(_effective_time), result(_result) { }
+
+    void process_a_leaf(UNUSED transaction_t *txn, buf_lock_t *leaf_node_buf,
+                        const btree_key_t *, const btree_key_t *,
+                        signal_t *, int *) THROWS_ONLY(interrupted_exc_t) {
+        const leaf_node_t *node = reinterpret_cast<const leaf_node_t *>(leaf_node_buf->get_data_read());
+
+        leaf::live_iter_t it = leaf::iter_for_whole_leaf(node);
+        const btree_key_t *key;
+        while (!is_full() && (key = it.get_key(node))) {
+            const memcached_value_t *value = static_cast<const memcached_value_t *>(it.get_value(node));
+            if (range.contains_key(key->contents, key->size) && value->expired(effective_time)) {
+                result->keys.push_back(store_key_t(key->size, key->contents));
+                result->sizes.push_back(key->size + value->value_size());
+            }
+            it.step(node);
+        }
+    }
+
+    void postprocess_internal_node(UNUSED buf_lock_t *internal_node_buf) { }
+
+    void filter_interesting_children(UNUSED transaction_t *txn, ranged_block_ids_t *ids_source, interesting_children_callback_t *cb) {
+        /* Once we have as many keys as we were asked for, there's no point in
+        reading any more of the tree. */
+        if (!is_full()) {
+            for (int i = 0, e = ids_source->num_block_ids(); i < e; ++i) {
+                block_id_t block_id;
+                const btree_key_t *left_excl, *right_incl;
+                ids_source->get_block_id_and_bounding_interval(i, &block_id, &left_excl, &right_incl);
+                if (overlaps_range(left_excl, right_incl)) {
+                    cb->receive_interesting_child(i);
+                }
+            }
+        }
+        cb->no_more_interesting_children();
+    }
+
+    access_t btree_superblock_mode() { return rwi_read; }
+    access_t btree_node_mode() { return rwi_read; }
+
+private:
+    bool is_full() const {
+        return result->keys.size() >= static_cast<size_t>(maximum);
+    }
+
+    // Checks if (left_excl, right_incl] intersects `range`.
+    bool overlaps_range(const btree_key_t *left_excl, const btree_key_t *right_incl) const {
+        return (right_incl == NULL || sized_strcmp(right_incl->contents, right_incl->size, range.left.contents(), range.left.size()) >= 0)
+            && (left_excl == NULL || range.right.unbounded || sized_strcmp(left_excl->contents, left_excl->size, range.right.key.contents(), range.right.key.size()) < 0);
+    }
+
+    const key_range_t range;
+    const int maximum;
+    const exptime_t effective_time;
+    expired_keys_result_t *result;
+
+    DISABLE_COPYING(expired_keys_traversal_helper_t);
+};
+
+expired_keys_result_t memcached_expired_keys(btree_slice_t *slice, const key_range_t &range,
+        int maximum, exptime_t effective_time, transaction_t *txn, superblock_t *superblock) {
+    txn->set_account(slice->get_backfill_account());
+
+    expired_keys_result_t result;
+    expired_keys_traversal_helper_t helper(range, maximum, effective_time, &result);
+    cond_t non_interruptor;
+    btree_parallel_traversal(txn, superblock, slice, &helper, &non_interruptor);
+    return result;
+}
+
+delete_result_t memcached_expire(const store_key_t &key, btree_slice_t *slice, exptime_t effective_time, repli_timestamp_t timestamp, transaction_t *txn, superblock_t *superblock) {
+    keyvalue_location_t<memcached_value_t> kv_location;
+    find_keyvalue_location_for_write(txn, superblock, key.btree_key(), &kv_location, &slice->root_eviction_priority, &slice->stats);
+
+    if (!kv_location.value.has() || !kv_location.value->expired(effective_time)) {
+        return dr_not_found;
+    }
+
+    {
+        blob_t b(kv_location.value->value_ref(), blob::btree_maxreflen);
+        b.clear(txn);
+    }
+    kv_location.value.reset();
+
+    null_key_modification_callback_t<memcached_value_t> null_cb;
+    apply_keyvalue_change(txn, &kv_location, key.btree_key(), timestamp, true, &null_cb, &slice->root_eviction_priority);
+    return dr_deleted;
+}
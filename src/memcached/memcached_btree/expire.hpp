@@ -0,0 +1,19 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef MEMCACHED_MEMCACHED_BTREE_EXPIRE_HPP_
+#define MEMCACHED_MEMCACHED_BTREE_EXPIRE_HPP_
+
+#include "buffer_cache/types.hpp"
+#include "memcached/queries.hpp"
+
+class btree_slice_t;
+class superblock_t;
+
+/* Walks the leaves of `slice` that overlap `range` and collects up to `maximum`
+keys whose values have expired as of `effective_time`. The leaves are read on the
+slice's backfill account, so the walk yields to client traffic for I/O. */
+expired_keys_result_t memcached_expired_keys(btree_slice_t *slice, const key_range_t &range,
+        int maximum, exptime_t effective_time, transaction_t *txn, superblock_t *superblock);
+
+delete_result_t memcached_expire(const store_key_t &key, btree_slice_t *slice, exptime_t effective_time, repli_timestamp_t timestamp, transaction_t *txn, superblock_t *superblock);
+
+#endif // MEMCACHED_MEMCACHED_BTREE_EXPIRE_HPP_
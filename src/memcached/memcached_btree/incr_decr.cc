@@ -11,15 +11,31 @@
 
 struct memcached_incr_decr_oper_t : public memcached_modify_oper_t {
 
-    memcached_incr_decr_oper_t(bool _increment, uint64_t _delta)
-        : increment(_increment), delta(_delta)
+    memcached_incr_decr_oper_t(bool _increment, uint64_t _delta,
+                               bool _create_if_missing, uint64_t _initial, exptime_t _exptime)
+        : increment(_increment), delta(_delta),
+          create_if_missing(_create_if_missing), initial(_initial), exptime(_exptime)
     { }
 
     bool operate(transaction_t *txn, scoped_malloc_t<memcached_value_t> *value) {
-        // If the key didn't exist before, we fail.
+        // If the key didn't exist before, we either create it or fail.
         if (!value->has()) {
-            result.res = incr_decr_result_t::idr_not_found;
-            return false;
+            if (!create_if_missing) {
+                result.res = incr_decr_result_t::idr_not_found;
+                return false;
+            }
+
+            // An all-zero value reference is an empty blob, so the new value's
+            // blob starts out empty once the metadata is in place.
+            scoped_malloc_t<memcached_value_t> tmp(MAX_MEMCACHED_VALUE_SIZE);
+            memset(tmp.get(), 0, MAX_MEMCACHED_VALUE_SIZE);
+            metadata_write(&tmp->metadata_flags, tmp->contents, 0, exptime);
+            value->swap(tmp);
+
+            result.res = incr_decr_result_t::idr_success;
+            result.new_value = initial;
+            write_number(txn, value, initial);
+            return true;
         }
 
         // If we can't parse the value as a number, we fail.
@@ -70,6 +86,12 @@ struct memcached_incr_decr_oper_t : public memcached_modify_oper_t {
         result.res = incr_decr_result_t::idr_success;
         result.new_value = number;
 
+        write_number(txn, value, number);
+        return true;
+    }
+
+    void write_number(transaction_t *txn, scoped_malloc_t<memcached_value_t> *value, uint64_t number) {
+        blob_t b((*value)->value_ref(), blob::btree_maxreflen);
         printf_buffer_t<50> tmp("%" PRIu64, number);
         b.clear(txn);
         b.append_region(txn, tmp.size());
@@ -79,8 +101,6 @@ struct memcached_incr_decr_oper_t : public memcached_modify_oper_t {
         rassert(group.num_buffers() == 1);
         rassert(group.get_buffer(0).size == tmp.size(), "expecting %zd == %d", group.get_buffer(0).size, tmp.size());
         memcpy(group.get_buffer(0).data, tmp.data(), tmp.size());
-
-        return true;
     }
 
     int compute_expected_change_count(UNUSED block_size_t block_size) {
@@ -90,11 +110,15 @@ struct memcached_incr_decr_oper_t : public memcached_modify_oper_t {
     bool increment;   // If false, then decrement
     uint64_t delta;   // Amount to increment or decrement by
 
+    bool create_if_missing;
+    uint64_t initial;   // The value to create a missing key with
+    exptime_t exptime;   // The expiration time to create a missing key with
+
     incr_decr_result_t result;
 };
 
-incr_decr_result_t memcached_incr_decr(const store_key_t &key, btree_slice_t *slice, bool increment, uint64_t delta, cas_t proposed_cas, exptime_t effective_time, repli_timestamp_t timestamp, transaction_t *txn, superblock_t *superblock) {
-    memcached_incr_decr_oper_t oper(increment, delta);
+incr_decr_result_t memcached_incr_decr(const store_key_t &key, btree_slice_t *slice, bool increment, uint64_t delta, bool create_if_missing, uint64_t initial, exptime_t exptime, cas_t proposed_cas, exptime_t effective_time, repli_timestamp_t timestamp, transaction_t *txn, superblock_t *superblock) {
+    memcached_incr_decr_oper_t oper(increment, delta, create_if_missing, initial, exptime);
     run_memcached_modify_oper(&oper, slice, key, proposed_cas, effective_time, timestamp, txn, superblock);
     return oper.result;
 }
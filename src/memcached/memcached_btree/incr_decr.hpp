@@ -8,6 +8,8 @@
 
 class superblock_t;
 
-incr_decr_result_t memcached_incr_decr(const store_key_t &key, btree_slice_t *slice, bool increment, uint64_t delta, cas_t proposed_cas, exptime_t effective_time, repli_timestamp_t timestamp, transaction_t *txn, superblock_t *superblock);
+/* If `create_if_missing` is true, a missing key is stored with the value `initial`
+and expiration time `exptime` rather than reported as not found. */
+incr_decr_result_t memcached_incr_decr(const store_key_t &key, btree_slice_t *slice, bool increment, uint64_t delta, bool create_if_missing, uint64_t initial, exptime_t exptime, cas_t proposed_cas, exptime_t effective_time, repli_timestamp_t timestamp, transaction_t *txn, superblock_t *superblock);
 
 #endif // MEMCACHED_MEMCACHED_BTREE_INCR_DECR_HPP_
@@ -11,6 +11,8 @@
 
 #include <set>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "errors.hpp"
@@ -35,7 +37,7 @@
 static const char *crlf = "\r\n";
 
 /* txt_memcached_handler_t only exists as a convenient thing to pass around to do_get(),
-do_storage(), and the like. */
+do_storage(), and the like. Despite the name, the binary protocol uses it too. */
 
 struct txt_memcached_handler_t : public home_thread_mixin_debug_only_t {
     txt_memcached_handler_t(memcached_interface_t *_interface,
@@ -187,6 +189,14 @@ struct txt_memcached_handler_t : public home_thread_mixin_debug_only_t {
             throw memcached_interface_t::no_more_data_exc_t();
         }
     }
+
+    char peek() THROWS_ONLY(memcached_interface_t::no_more_data_exc_t) {
+        try {
+            return interface->peek(interruptor);
+        } catch (const interrupted_exc_t &) {
+            throw memcached_interface_t::no_more_data_exc_t();
+        }
+    }
 };
 
 class pipeliner_t {
@@ -301,6 +311,42 @@ void do_one_get(txt_memcached_handler_t *rh, bool with_cas, get_t *gets, int i,
     }
 }
 
+/* Looks up all the keys of a "get" with one `multi_get_query_t`, which reaches
+each shard once rather than once per key. */
+void do_multi_get(txt_memcached_handler_t *rh, std::vector<get_t> *gets, order_token_t token) {
+    std::vector<store_key_t> keys;
+    keys.reserve(gets->size());
+    for (size_t i = 0; i < gets->size(); ++i) {
+        keys.push_back((*gets)[i].key);
+    }
+
+    std::string error_message;
+    bool ok;
+    try {
+        multi_get_query_t multi_get_query(keys);
+        memcached_protocol_t::read_t read(multi_get_query, time(NULL));
+        memcached_protocol_t::read_response_t response;
+        rh->nsi->read(read, &response, token, rh->interruptor);
+        multi_get_result_t *result = boost::get<multi_get_result_t>(&response.result);
+        guarantee(result != NULL && result->results.size() == gets->size());
+        for (size_t i = 0; i < gets->size(); ++i) {
+            (*gets)[i].res = result->results[i];
+        }
+        ok = true;
+    } catch (const cannot_perform_query_exc_t &e) {
+        error_message = e.what();
+        ok = false;
+    } catch (const interrupted_exc_t &) {
+        /* do nothing */
+        return;
+    }
+
+    for (size_t i = 0; i < gets->size(); ++i) {
+        (*gets)[i].ok = ok;
+        (*gets)[i].error_message = error_message;
+    }
+}
+
 void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas, int argc, char **argv, order_token_t token) {
     // We should already be spawned within a coroutine.
     pipeliner_acq_t pipeliner_acq(pipeliner);
@@ -336,8 +382,13 @@ void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas,
 
     block_pm_duration get_timer(&rh->stats->pm_cmd_get);
 
-    /* Now that we're sure they're all valid, send off the requests */
-    pmap(gets.size(), boost::bind(&do_one_get, rh, with_cas, gets.data(), _1, token));
+    /* Now that we're sure they're all valid, send off the requests. "gets" has
+    to give each key a CAS, which takes a write per key. */
+    if (!with_cas && gets.size() > 1) {
+        do_multi_get(rh, &gets, token);
+    } else {
+        pmap(gets.size(), boost::bind(&do_one_get, rh, with_cas, gets.data(), _1, token));
+    }
 
     if (rh->interruptor->is_pulsed()) {
         pipeliner_acq.begin_write();
@@ -577,6 +628,27 @@ struct storage_metadata_t {
         : mcflags(_mcflags), exptime(_exptime), unique(_unique) { }
 };
 
+exptime_t absolute_exptime(exptime_t exptime) {
+    // This is protocol.txt, verbatim:
+    // Some commands involve a client sending some kind of expiration time
+    // (relative to an item or to an operation requested by the client) to
+    // the server. In all such cases, the actual value sent may either be
+    // Unix time (number of seconds since January 1, 1970, as a 32-bit
+    // value), or a number of seconds starting from current time. In the
+    // latter case, this number of seconds may not exceed 60*60*24*30 (number
+    // of seconds in 30 days); if the number sent by a client is larger than
+    // that, the server will consider it to be real Unix time value rather
+    // than an offset from current time.
+    if (exptime <= 60*60*24*30 && exptime > 0) {
+        // If 60*60*24*30 < exptime <= time(NULL), that's fine, the
+        // btree code needs to handle that case gracefully anyway
+        // (since the clock can tick in the middle of an insert
+        // anyway...).  We have tests in expiration.py.
+        exptime += time(NULL);
+    }
+    return exptime;
+}
+
 void run_storage_command(txt_memcached_handler_t *rh,
                          pipeliner_acq_t *pipeliner_acq_raw,
                          storage_command_t sc,
@@ -771,23 +843,7 @@ void do_storage(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, storage_com
         return;
     }
 
-    // This is protocol.txt, verbatim:
-    // Some commands involve a client sending some kind of expiration time
-    // (relative to an item or to an operation requested by the client) to
-    // the server. In all such cases, the actual value sent may either be
-    // Unix time (number of seconds since January 1, 1970, as a 32-bit
-    // value), or a number of seconds starting from current time. In the
-    // latter case, this number of seconds may not exceed 60*60*24*30 (number
-    // of seconds in 30 days); if the number sent by a client is larger than
-    // that, the server will consider it to be real Unix time value rather
-    // than an offset from current time.
-    if (exptime <= 60*60*24*30 && exptime > 0) {
-        // If 60*60*24*30 < exptime <= time(NULL), that's fine, the
-        // btree code needs to handle that case gracefully anyway
-        // (since the clock can tick in the middle of an insert
-        // anyway...).  We have tests in expiration.py.
-        exptime += time(NULL);
-    }
+    exptime = absolute_exptime(exptime);
 
     /* Now parse the value length */
     size_t value_size = strtou64_strict(argv[4], &invalid_char, 10);
@@ -1064,7 +1120,7 @@ void do_delete(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, int argc, ch
 
 /* "stats" command */
 
-void format_stats(const perfmon_result_t *stats, const std::string& name, const std::set<std::string>& names_to_match, std::vector<std::string> *result) {
+void format_stats(const perfmon_result_t *stats, const std::string& name, const std::set<std::string>& names_to_match, std::vector<std::pair<std::string, std::string> > *result) {
     // `switch` is used instead of `if` with `is_map` and `is_string` checks
     // because that way the compiler guarantees us an error message if someone
     // adds another type of `perfmon_results_t` and forgets to change this code
@@ -1073,7 +1129,7 @@ void format_stats(const perfmon_result_t *stats, const std::string& name, const
              // This is not super-efficient (better to only scan for the stats
              // that match the name), but we don't care right now
             if (names_to_match.empty() || names_to_match.count(name) != 0) {
-                result->push_back(strprintf("STAT %s %s\r\n", name.c_str(), stats->get_string()->c_str()));
+                result->push_back(std::make_pair(name, *stats->get_string()));
             }
             break;
         case perfmon_result_t::type_map:
@@ -1087,6 +1143,13 @@ void format_stats(const perfmon_result_t *stats, const std::string& name, const
     }
 }
 
+/* Fills `stats_out` with the name and value of every stat in `names_to_match`, or
+of every stat if `names_to_match` is empty. */
+void get_memcached_stats(const std::set<std::string> &names_to_match, std::vector<std::pair<std::string, std::string> > *stats_out) {
+    scoped_ptr_t<perfmon_result_t> stats(perfmon_get_stats());
+    format_stats(stats.get(), std::string(), names_to_match, stats_out);
+}
+
 void memcached_stats(int argc, char **argv, std::vector<std::string> *stat_response_lines) {
     static const std::string end_marker("END\r\n");
 
@@ -1096,44 +1159,726 @@ void memcached_stats(int argc, char **argv, std::vector<std::string> *stat_respo
         names_to_match.insert(argv[i]);
     }
 
-    scoped_ptr_t<perfmon_result_t> stats(perfmon_get_stats());
-    format_stats(stats.get(), std::string(), names_to_match, stat_response_lines);
+    std::vector<std::pair<std::string, std::string> > stats;
+    get_memcached_stats(names_to_match, &stats);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        stat_response_lines->push_back(strprintf("STAT %s %s\r\n", stats[i].first.c_str(), stats[i].second.c_str()));
+    }
     stat_response_lines->push_back(end_marker);
 }
 
-/* Handle memcached, takes a txt_memcached_handler_t and handles the memcached commands that come in on it */
-void handle_memcache(memcached_interface_t *interface,
-        namespace_interface_t<memcached_protocol_t> *nsi,
-        int max_concurrent_queries_per_connection,
-        memcached_stats_t *stats,
-        signal_t *interruptor) {
-    logDBG("Opened memcached stream: %p", coro_t::self());
+/* Binary protocol
+
+The binary protocol is described at
+https://code.google.com/p/memcached/wiki/BinaryProtocolRevamped. Requests carry
+their key, value, and numbers as raw bytes with explicit lengths, so we don't have
+to tokenize, unescape, or parse anything. Each request also carries an "opaque"
+that we copy into its response. We always answer requests in the order they came
+in, but clients use the opaque to match up responses to the quiet commands, which
+don't send a response at all if they succeed (or, for "getq", if the key isn't
+found). */
+
+static const uint8_t binary_request_magic = 0x80;
+static const uint8_t binary_response_magic = 0x81;
+
+static const size_t binary_header_size = 24;
+
+enum binary_opcode_t {
+    binary_op_get = 0x00,
+    binary_op_set = 0x01,
+    binary_op_add = 0x02,
+    binary_op_replace = 0x03,
+    binary_op_delete = 0x04,
+    binary_op_increment = 0x05,
+    binary_op_decrement = 0x06,
+    binary_op_quit = 0x07,
+    binary_op_flush = 0x08,
+    binary_op_getq = 0x09,
+    binary_op_noop = 0x0a,
+    binary_op_version = 0x0b,
+    binary_op_getk = 0x0c,
+    binary_op_getkq = 0x0d,
+    binary_op_append = 0x0e,
+    binary_op_prepend = 0x0f,
+    binary_op_stat = 0x10,
+    binary_op_setq = 0x11,
+    binary_op_addq = 0x12,
+    binary_op_replaceq = 0x13,
+    binary_op_deleteq = 0x14,
+    binary_op_incrementq = 0x15,
+    binary_op_decrementq = 0x16,
+    binary_op_quitq = 0x17,
+    binary_op_flushq = 0x18,
+    binary_op_appendq = 0x19,
+    binary_op_prependq = 0x1a
+};
 
-    /* This object just exists to group everything together so we don't have to pass a lot of
-    context around. */
-    txt_memcached_handler_t rh(interface, nsi, max_concurrent_queries_per_connection, stats, interruptor);
+enum binary_status_t {
+    binary_status_ok = 0x0000,
+    binary_status_key_not_found = 0x0001,
+    binary_status_key_exists = 0x0002,
+    binary_status_value_too_large = 0x0003,
+    binary_status_invalid_arguments = 0x0004,
+    binary_status_item_not_stored = 0x0005,
+    binary_status_non_numeric_value = 0x0006,
+    binary_status_unknown_command = 0x0081,
+    binary_status_internal_error = 0x0084
+};
 
-    /* The commands from each individual memcached handler must be performed in the order
-    that the handler parses them. This `order_source_t` is used to guarantee that. */
-    order_source_t order_source;
+/* Numbers in the binary protocol are big-endian. */
+
+static uint64_t decode_binary_number(const char *bytes, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value = (value << 8) | static_cast<uint8_t>(bytes[i]);
+    }
+    return value;
+}
+
+static void encode_binary_number(uint64_t value, size_t size, char *bytes_out) {
+    for (size_t i = size; i > 0; --i) {
+        bytes_out[i - 1] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+struct binary_request_t {
+    uint8_t opcode;
+    uint8_t extras_length;
+    uint16_t key_length;
+    uint32_t body_length;
+    uint32_t opaque;
+    cas_t cas;
+
+    /* The extras and the key, which are the start of the body */
+    std::vector<char> extras_and_key;
+    /* The rest of the body */
+    counted_t<data_buffer_t> value;
+
+    const char *extras() const { return extras_and_key.data(); }
+    const char *key_data() const { return extras_and_key.data() + extras_length; }
+    store_key_t key() const {
+        rassert(key_length <= MAX_KEY_SIZE);
+        return store_key_t(key_length, reinterpret_cast<const uint8_t *>(key_data()));
+    }
+};
+
+static bool binary_opcode_is_quiet(uint8_t opcode) {
+    switch (opcode) {
+    case binary_op_getq:
+    case binary_op_getkq:
+    case binary_op_setq:
+    case binary_op_addq:
+    case binary_op_replaceq:
+    case binary_op_deleteq:
+    case binary_op_incrementq:
+    case binary_op_decrementq:
+    case binary_op_quitq:
+    case binary_op_flushq:
+    case binary_op_appendq:
+    case binary_op_prependq:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Checks that the request has the extras, key, and value that its opcode calls
+for. */
+static bool binary_request_is_well_formed(const binary_request_t *request) {
+    size_t value_length = request->value->size();
+    switch (request->opcode) {
+    case binary_op_get:
+    case binary_op_getq:
+    case binary_op_getk:
+    case binary_op_getkq:
+    case binary_op_delete:
+    case binary_op_deleteq:
+        return request->extras_length == 0 && request->key_length > 0 && value_length == 0;
+    case binary_op_set:
+    case binary_op_setq:
+    case binary_op_add:
+    case binary_op_addq:
+    case binary_op_replace:
+    case binary_op_replaceq:
+        return request->extras_length == 8 && request->key_length > 0;
+    case binary_op_append:
+    case binary_op_appendq:
+    case binary_op_prepend:
+    case binary_op_prependq:
+        return request->extras_length == 0 && request->key_length > 0;
+    case binary_op_increment:
+    case binary_op_incrementq:
+    case binary_op_decrement:
+    case binary_op_decrementq:
+        return request->extras_length == 20 && request->key_length > 0 && value_length == 0;
+    case binary_op_stat:
+        return request->extras_length == 0 && value_length == 0;
+    default:
+        return request->extras_length == 0 && request->key_length == 0 && value_length == 0;
+    }
+}
+
+static void write_binary_response_header(txt_memcached_handler_t *rh, const binary_request_t *request, binary_status_t status,
+                                         size_t extras_length, size_t key_length, size_t value_length, cas_t cas) {
+    char header[binary_header_size];
+    header[0] = static_cast<char>(binary_response_magic);
+    header[1] = static_cast<char>(request->opcode);
+    encode_binary_number(key_length, 2, header + 2);
+    header[4] = extras_length;
+    header[5] = 0;   // Data type
+    encode_binary_number(status, 2, header + 6);
+    encode_binary_number(extras_length + key_length + value_length, 4, header + 8);
+    encode_binary_number(request->opaque, 4, header + 12);
+    encode_binary_number(cas, 8, header + 16);
+    rh->write(header, binary_header_size);
+}
+
+static void write_binary_response(txt_memcached_handler_t *rh, const binary_request_t *request, binary_status_t status,
+                                  const char *key, size_t key_length, const char *value, size_t value_length) {
+    write_binary_response_header(rh, request, status, 0, key_length, value_length, 0);
+    if (key_length > 0) {
+        rh->write(key, key_length);
+    }
+    if (value_length > 0) {
+        rh->write(value, value_length);
+    }
+}
+
+/* Error responses carry a message in their value. Unlike other responses, they
+are sent even for quiet commands. */
+static void write_binary_error(txt_memcached_handler_t *rh, const binary_request_t *request, binary_status_t status, const std::string &message) {
+    write_binary_response(rh, request, status, NULL, 0, message.data(), message.size());
+}
+
+static void write_binary_success(txt_memcached_handler_t *rh, const binary_request_t *request) {
+    if (!binary_opcode_is_quiet(request->opcode)) {
+        write_binary_response(rh, request, binary_status_ok, NULL, 0, NULL, 0);
+    }
+}
+
+/* Reads a request off the connection. Returns false if the connection should be
+closed, either because the client went away or because it sent something we can't
+make sense of. */
+static bool read_binary_request(txt_memcached_handler_t *rh, binary_request_t *request_out) {
+    char header[binary_header_size];
+    try {
+        rh->read(header, binary_header_size);
+    } catch (const memcached_interface_t::no_more_data_exc_t &) {
+        return false;
+    }
+
+    if (static_cast<uint8_t>(header[0]) != binary_request_magic) {
+        logDBG("Closing memcached stream %p because of a bad magic byte", coro_t::self());
+        return false;
+    }
+    request_out->opcode = header[1];
+    request_out->key_length = decode_binary_number(header + 2, 2);
+    request_out->extras_length = header[4];
+    request_out->body_length = decode_binary_number(header + 8, 4);
+    request_out->opaque = decode_binary_number(header + 12, 4);
+    request_out->cas = decode_binary_number(header + 16, 8);
+
+    size_t extras_and_key_length = request_out->extras_length + request_out->key_length;
+    if (extras_and_key_length > request_out->body_length) {
+        logDBG("Closing memcached stream %p because of a bad body length", coro_t::self());
+        return false;
+    }
+    size_t value_length = request_out->body_length - extras_and_key_length;
+    // Check for signed 32 bit max value for Memcached compatibility...
+    if (value_length >= (1u << 31) - 1) {
+        logDBG("Closing memcached stream %p because of a value that's too large", coro_t::self());
+        return false;
+    }
+
+    request_out->extras_and_key.resize(extras_and_key_length);
+    request_out->value = data_buffer_t::create(value_length);
+    try {
+        if (extras_and_key_length > 0) {
+            rh->read(request_out->extras_and_key.data(), extras_and_key_length);
+        }
+        if (value_length > 0) {
+            rh->read(request_out->value->buf(), value_length);
+        }
+    } catch (const memcached_interface_t::no_more_data_exc_t &) {
+        return false;
+    }
+    return true;
+}
+
+void run_binary_get(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq, const binary_request_t *request, order_token_t token) {
+    block_pm_duration get_timer(&rh->stats->pm_cmd_get);
+
+    get_result_t res;
+    std::string error_message;
+    bool ok;
+
+    try {
+        get_query_t get_query(request->key());
+        memcached_protocol_t::read_t read(get_query, time(NULL));
+        memcached_protocol_t::read_response_t response;
+        rh->nsi->read(read, &response, token, rh->interruptor);
+        res = boost::get<get_result_t>(response.result);
+        ok = true;
+    } catch (const cannot_perform_query_exc_t &e) {
+        error_message = e.what();
+        ok = false;
+    } catch (const interrupted_exc_t &) {
+        pipeliner_acq->begin_write();
+        pipeliner_acq->end_write();
+        return;
+    }
+
+    pipeliner_acq->begin_write();
+
+    bool with_key = request->opcode == binary_op_getk || request->opcode == binary_op_getkq;
+    if (!ok) {
+        write_binary_error(rh, request, binary_status_internal_error, error_message);
+    } else if (res.value.has()) {
+        /* We send whatever CAS the read reports. A plain read doesn't give the
+        value a CAS, so that's zero, which clients take to mean "no CAS". */
+        char flags[4];
+        encode_binary_number(res.flags, sizeof(flags), flags);
+        size_t key_length = with_key ? request->key_length : 0;
+        write_binary_response_header(rh, request, binary_status_ok, sizeof(flags), key_length, res.value->size(), res.cas);
+        rh->write(flags, sizeof(flags));
+        if (key_length > 0) {
+            rh->write(request->key_data(), key_length);
+        }
+        rh->write_from_data_provider(res.value.get());
+    } else if (!binary_opcode_is_quiet(request->opcode)) {
+        write_binary_error(rh, request, binary_status_key_not_found, "Not found");
+    }
+
+    pipeliner_acq->end_write();
+}
+
+/* Like `run_storage_command()`, but for "set", "add", and "replace" and their
+quiet variants. A nonzero CAS in the request makes "set" and "replace" behave
+like the text protocol's "cas". */
+void run_binary_storage(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq, const binary_request_t *request, order_token_t token) {
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    add_policy_t add_policy;
+    replace_policy_t replace_policy;
+    switch (request->opcode) {
+    case binary_op_set:
+    case binary_op_setq:
+        add_policy = request->cas == 0 ? add_policy_yes : add_policy_no;
+        replace_policy = request->cas == 0 ? replace_policy_yes : replace_policy_if_cas_matches;
+        break;
+    case binary_op_add:
+    case binary_op_addq:
+        add_policy = add_policy_yes;
+        replace_policy = replace_policy_no;
+        break;
+    case binary_op_replace:
+    case binary_op_replaceq:
+        add_policy = add_policy_no;
+        replace_policy = request->cas == 0 ? replace_policy_yes : replace_policy_if_cas_matches;
+        break;
+    default:
+        unreachable();
+    }
+
+    mcflags_t mcflags = decode_binary_number(request->extras(), 4);
+    exptime_t exptime = absolute_exptime(decode_binary_number(request->extras() + 4, 4));
+
+    set_result_t res = set_result_t(-1);
+    std::string error_message;
+    bool ok;
+
+    try {
+        sarc_mutation_t sarc_mutation(request->key(), request->value, mcflags, exptime,
+            add_policy, replace_policy, request->cas == 0 ? NO_CAS_SUPPLIED : request->cas);
+        memcached_protocol_t::write_t write(sarc_mutation, rh->generate_cas(), time(NULL));
+        memcached_protocol_t::write_response_t result;
+        rh->nsi->write(write, &result, token, rh->interruptor);
+        res = boost::get<set_result_t>(result.result);
+        ok = true;
+    } catch (const cannot_perform_query_exc_t &e) {
+        error_message = e.what();
+        ok = false;
+    } catch (const interrupted_exc_t &) {
+        pipeliner_acq->begin_write();
+        pipeliner_acq->end_write();
+        return;
+    }
+
+    pipeliner_acq->begin_write();
+
+    if (ok) {
+        switch (res) {
+        case sr_stored:
+            write_binary_success(rh, request);
+            break;
+        case sr_didnt_add:
+            write_binary_error(rh, request, binary_status_key_not_found, "Not found");
+            break;
+        case sr_didnt_replace:
+            write_binary_error(rh, request, binary_status_key_exists, "Data exists for key");
+            break;
+        case sr_too_large:
+            write_binary_error(rh, request, binary_status_value_too_large, "Too large");
+            break;
+        default: unreachable();
+        }
+    } else {
+        write_binary_error(rh, request, binary_status_internal_error, error_message);
+    }
+
+    pipeliner_acq->end_write();
+}
+
+void run_binary_append_prepend(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq, const binary_request_t *request, order_token_t token) {
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    bool append = request->opcode == binary_op_append || request->opcode == binary_op_appendq;
+
+    append_prepend_result_t res = append_prepend_result_t(-1);
+    std::string error_message;
+    bool ok;
+
+    try {
+        append_prepend_mutation_t append_prepend_mutation(
+            append ? append_prepend_APPEND : append_prepend_PREPEND,
+            request->key(), request->value);
+        memcached_protocol_t::write_t write(append_prepend_mutation, rh->generate_cas(), time(NULL));
+        memcached_protocol_t::write_response_t result;
+        rh->nsi->write(write, &result, token, rh->interruptor);
+        res = boost::get<append_prepend_result_t>(result.result);
+        ok = true;
+    } catch (const cannot_perform_query_exc_t &e) {
+        error_message = e.what();
+        ok = false;
+    } catch (const interrupted_exc_t &) {
+        pipeliner_acq->begin_write();
+        pipeliner_acq->end_write();
+        return;
+    }
 
+    pipeliner_acq->begin_write();
+
+    if (ok) {
+        switch (res) {
+        case apr_success:
+            write_binary_success(rh, request);
+            break;
+        case apr_not_found:
+            write_binary_error(rh, request, binary_status_item_not_stored, "Not stored");
+            break;
+        case apr_too_large:
+            write_binary_error(rh, request, binary_status_value_too_large, "Too large");
+            break;
+        default: unreachable();
+        }
+    } else {
+        write_binary_error(rh, request, binary_status_internal_error, error_message);
+    }
+
+    pipeliner_acq->end_write();
+}
+
+void run_binary_delete(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq, const binary_request_t *request, order_token_t token) {
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    delete_result_t res = delete_result_t(-1);
+    std::string error_message;
+    bool ok;
+
+    try {
+        delete_mutation_t delete_mutation(request->key(), false);
+        memcached_protocol_t::write_t write(delete_mutation, INVALID_CAS, time(NULL));
+        memcached_protocol_t::write_response_t result;
+        rh->nsi->write(write, &result, token, rh->interruptor);
+        res = boost::get<delete_result_t>(result.result);
+        ok = true;
+    } catch (const cannot_perform_query_exc_t &e) {
+        error_message = e.what();
+        ok = false;
+    } catch (const interrupted_exc_t &) {
+        pipeliner_acq->begin_write();
+        pipeliner_acq->end_write();
+        return;
+    }
+
+    pipeliner_acq->begin_write();
+
+    if (ok) {
+        switch (res) {
+        case dr_deleted:
+            write_binary_success(rh, request);
+            break;
+        case dr_not_found:
+            write_binary_error(rh, request, binary_status_key_not_found, "Not found");
+            break;
+        default: unreachable();
+        }
+    } else {
+        write_binary_error(rh, request, binary_status_internal_error, error_message);
+    }
+
+    pipeliner_acq->end_write();
+}
+
+/* The binary protocol's "increment" and "decrement" can create the key if it
+doesn't exist: the request carries an initial value, which is stored unless the
+request's expiration time is all ones. */
+void run_binary_incr_decr(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq, const binary_request_t *request, order_token_t token) {
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    bool incr = request->opcode == binary_op_increment || request->opcode == binary_op_incrementq;
+    uint64_t delta = decode_binary_number(request->extras(), 8);
+    uint64_t initial = decode_binary_number(request->extras() + 8, 8);
+    uint32_t raw_exptime = decode_binary_number(request->extras() + 16, 4);
+    bool may_create = raw_exptime != 0xffffffff;
+
+    incr_decr_result_t res;
+    std::string error_message;
+    bool ok;
+
+    try {
+        /* Creating a missing key happens in the same write as the increment, so
+        that the request only uses its own place in the pipeline's order. */
+        incr_decr_kind_t kind = incr ? incr_decr_INCR : incr_decr_DECR;
+        incr_decr_mutation_t incr_decr_mutation = may_create
+            ? incr_decr_mutation_t(kind, request->key(), delta, initial, absolute_exptime(raw_exptime))
+            : incr_decr_mutation_t(kind, request->key(), delta);
+        memcached_protocol_t::write_t write(incr_decr_mutation, rh->generate_cas(), time(NULL));
+        memcached_protocol_t::write_response_t result;
+        rh->nsi->write(write, &result, token, rh->interruptor);
+        res = boost::get<incr_decr_result_t>(result.result);
+        ok = true;
+    } catch (const cannot_perform_query_exc_t &e) {
+        error_message = e.what();
+        res = incr_decr_result_t();   /* shut up compiler warnings */
+        ok = false;
+    } catch (const interrupted_exc_t &) {
+        pipeliner_acq->begin_write();
+        pipeliner_acq->end_write();
+        return;
+    }
+
+    pipeliner_acq->begin_write();
+
+    if (ok) {
+        switch (res.res) {
+        case incr_decr_result_t::idr_success:
+            if (!binary_opcode_is_quiet(request->opcode)) {
+                char new_value[8];
+                encode_binary_number(res.new_value, sizeof(new_value), new_value);
+                write_binary_response(rh, request, binary_status_ok, NULL, 0, new_value, sizeof(new_value));
+            }
+            break;
+        case incr_decr_result_t::idr_not_found:
+            write_binary_error(rh, request, binary_status_key_not_found, "Not found");
+            break;
+        case incr_decr_result_t::idr_not_numeric:
+            write_binary_error(rh, request, binary_status_non_numeric_value, "Non-numeric server-side value for incr or decr");
+            break;
+        default: unreachable();
+        }
+    } else {
+        write_binary_error(rh, request, binary_status_internal_error, error_message);
+    }
+
+    pipeliner_acq->end_write();
+}
+
+/* Runs one request that touches the database. Like `run_storage_command()`, this
+is spawned after the request has been read off the socket, and takes ownership of
+`pipeliner_acq` and `request`. */
+void run_binary_request(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq_raw, binary_request_t *request_raw, order_token_t token) {
+    scoped_ptr_t<pipeliner_acq_t> pipeliner_acq(pipeliner_acq_raw);
+    scoped_ptr_t<binary_request_t> request(request_raw);
+
+    switch (request->opcode) {
+    case binary_op_get:
+    case binary_op_getq:
+    case binary_op_getk:
+    case binary_op_getkq:
+        run_binary_get(rh, pipeliner_acq.get(), request.get(), token.with_read_mode());
+        break;
+    case binary_op_set:
+    case binary_op_setq:
+    case binary_op_add:
+    case binary_op_addq:
+    case binary_op_replace:
+    case binary_op_replaceq:
+        run_binary_storage(rh, pipeliner_acq.get(), request.get(), token);
+        break;
+    case binary_op_append:
+    case binary_op_appendq:
+    case binary_op_prepend:
+    case binary_op_prependq:
+        run_binary_append_prepend(rh, pipeliner_acq.get(), request.get(), token);
+        break;
+    case binary_op_delete:
+    case binary_op_deleteq:
+        run_binary_delete(rh, pipeliner_acq.get(), request.get(), token);
+        break;
+    case binary_op_increment:
+    case binary_op_incrementq:
+    case binary_op_decrement:
+    case binary_op_decrementq:
+        run_binary_incr_decr(rh, pipeliner_acq.get(), request.get(), token);
+        break;
+    default:
+        unreachable();
+    }
+}
+
+/* Handles binary protocol requests until the client quits or goes away */
+void handle_binary_memcache(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, order_source_t *order_source) {
+    while (pipeliner->lock_argparsing(), !rh->interruptor->is_pulsed()) {
+        scoped_ptr_t<binary_request_t> request(new binary_request_t);
+
+        block_pm_duration read_timer(&rh->stats->pm_conns_reading);
+        if (!read_binary_request(rh, request.get())) {
+            break;
+        }
+        read_timer.end();
+
+        block_pm_duration action_timer(&rh->stats->pm_conns_acting);
+
+        scoped_ptr_t<pipeliner_acq_t> pipeliner_acq(new pipeliner_acq_t(pipeliner));
+
+        if (!binary_request_is_well_formed(request.get()) || request->key_length > MAX_KEY_SIZE) {
+            pipeliner_acq->done_argparsing();
+            pipeliner_acq->begin_write();
+            write_binary_error(rh, request.get(), binary_status_invalid_arguments, "Invalid arguments");
+            pipeliner_acq->end_write();
+            continue;
+        }
+
+        uint8_t opcode = request->opcode;
+        if (opcode == binary_op_quit || opcode == binary_op_quitq) {
+            pipeliner_acq->done_argparsing();
+            pipeliner_acq->begin_write();
+            write_binary_success(rh, request.get());
+            pipeliner_acq->end_write();
+            /* Leave the argparsing mutex locked, like `handle_text_memcache()`
+            does when it sees "quit". */
+            pipeliner->lock_argparsing();
+            break;
+        }
+
+        switch (opcode) {
+        case binary_op_get:
+        case binary_op_getq:
+        case binary_op_getk:
+        case binary_op_getkq:
+            rh->stats->pm_get_key_size.record(request->key_length);
+            break;
+        case binary_op_delete:
+        case binary_op_deleteq:
+            rh->stats->pm_delete_key_size.record(request->key_length);
+            break;
+        case binary_op_set:
+        case binary_op_setq:
+        case binary_op_add:
+        case binary_op_addq:
+        case binary_op_replace:
+        case binary_op_replaceq:
+        case binary_op_append:
+        case binary_op_appendq:
+        case binary_op_prepend:
+        case binary_op_prependq:
+            rh->stats->pm_storage_key_size.record(request->key_length);
+            rh->stats->pm_storage_value_size.record(request->value->size());
+            break;
+        default:
+            break;
+        }
+
+        switch (opcode) {
+        case binary_op_noop:
+            pipeliner_acq->done_argparsing();
+            pipeliner_acq->begin_write();
+            write_binary_response(rh, request.get(), binary_status_ok, NULL, 0, NULL, 0);
+            pipeliner_acq->end_write();
+            break;
+        case binary_op_version: {
+            pipeliner_acq->done_argparsing();
+            pipeliner_acq->begin_write();
+            std::string version = strprintf("rethinkdb-%s", RETHINKDB_VERSION);
+            write_binary_response(rh, request.get(), binary_status_ok, NULL, 0, version.data(), version.size());
+            pipeliner_acq->end_write();
+        } break;
+        case binary_op_stat: {
+            std::set<std::string> names_to_match;
+            if (request->key_length > 0) {
+                names_to_match.insert(std::string(request->key_data(), request->key_length));
+            }
+            std::vector<std::pair<std::string, std::string> > stats;
+            get_memcached_stats(names_to_match, &stats);
+
+            pipeliner_acq->done_argparsing();
+            pipeliner_acq->begin_write();
+            for (size_t i = 0; i < stats.size(); ++i) {
+                write_binary_response(rh, request.get(), binary_status_ok,
+                                      stats[i].first.data(), stats[i].first.size(),
+                                      stats[i].second.data(), stats[i].second.size());
+            }
+            /* A response with no key marks the end of the stats. */
+            write_binary_response(rh, request.get(), binary_status_ok, NULL, 0, NULL, 0);
+            pipeliner_acq->end_write();
+        } break;
+        case binary_op_get:
+        case binary_op_getq:
+        case binary_op_getk:
+        case binary_op_getkq:
+        case binary_op_set:
+        case binary_op_setq:
+        case binary_op_add:
+        case binary_op_addq:
+        case binary_op_replace:
+        case binary_op_replaceq:
+        case binary_op_append:
+        case binary_op_appendq:
+        case binary_op_prepend:
+        case binary_op_prependq:
+        case binary_op_delete:
+        case binary_op_deleteq:
+        case binary_op_increment:
+        case binary_op_incrementq:
+        case binary_op_decrement:
+        case binary_op_decrementq: {
+            order_token_t token = order_source->check_in(strprintf("handle_binary_memcache+%u", opcode));
+            pipeliner_acq->done_argparsing();
+            coro_t::spawn_now_dangerously(boost::bind(&run_binary_request, rh, pipeliner_acq.release(), request.release(), token));
+        } break;
+        default:
+            /* This includes "flush", which the text protocol doesn't support
+            either. */
+            pipeliner_acq->done_argparsing();
+            pipeliner_acq->begin_write();
+            write_binary_error(rh, request.get(), binary_status_unknown_command, "Unknown command");
+            pipeliner_acq->end_write();
+            break;
+        }
+
+        action_timer.end();
+    }
+}
+
+/* Handles text protocol commands until the client quits or goes away */
+void handle_text_memcache(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, order_source_t *order_source) {
     /* Declared outside the while-loop so it doesn't repeatedly reallocate its buffer */
     std::vector<char> line;
     std::vector<char*> args;
 
-    pipeliner_t pipeliner(&rh);
-
-    while (pipeliner.lock_argparsing(), !interruptor->is_pulsed()) {
+    while (pipeliner->lock_argparsing(), !rh->interruptor->is_pulsed()) {
         /* Read a line off the socket */
-        block_pm_duration read_timer(&rh.stats->pm_conns_reading);
+        block_pm_duration read_timer(&rh->stats->pm_conns_reading);
         try {
-            rh.read_line(&line);
+            rh->read_line(&line);
         } catch (const memcached_interface_t::no_more_data_exc_t &) {
             break;
         }
         read_timer.end();
 
-        block_pm_duration action_timer(&rh.stats->pm_conns_acting);
+        block_pm_duration action_timer(&rh->stats->pm_conns_acting);
 
         /* Tokenize the line */
         line.push_back('\0');   // Null terminator
@@ -1145,55 +1890,55 @@ void handle_memcache(memcached_interface_t *interface,
         }
 
         if (args.empty()) {
-            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq_t pipeliner_acq(pipeliner);
             pipeliner_acq.done_argparsing();
             pipeliner_acq.begin_write();
-            rh.error();
+            rh->error();
             pipeliner_acq.end_write();
             continue;
         }
 
         /* Dispatch to the appropriate subclass */
-        order_token_t token = order_source.check_in(std::string("handle_memcache+") + args[0]);
+        order_token_t token = order_source->check_in(std::string("handle_memcache+") + args[0]);
         if (!strcmp(args[0], "get")) {    // check for retrieval commands
-            coro_t::spawn_now_dangerously(boost::bind(do_get, &rh, &pipeliner, false, args.size(), args.data(), token.with_read_mode()));
+            coro_t::spawn_now_dangerously(boost::bind(do_get, rh, pipeliner, false, args.size(), args.data(), token.with_read_mode()));
         } else if (!strcmp(args[0], "gets")) {
-            coro_t::spawn_now_dangerously(boost::bind(do_get, &rh, &pipeliner, true, args.size(), args.data(), token));
+            coro_t::spawn_now_dangerously(boost::bind(do_get, rh, pipeliner, true, args.size(), args.data(), token));
         } else if (!strcmp(args[0], "rget")) {
-            coro_t::spawn_now_dangerously(boost::bind(do_rget, &rh, &pipeliner, &order_source, args.size(), args.data()));
+            coro_t::spawn_now_dangerously(boost::bind(do_rget, rh, pipeliner, order_source, args.size(), args.data()));
         } else if (!strcmp(args[0], "set")) {     // check for storage commands
-            do_storage(&rh, &pipeliner, set_command, args.size(), args.data(), token);
+            do_storage(rh, pipeliner, set_command, args.size(), args.data(), token);
         } else if (!strcmp(args[0], "add")) {
-            do_storage(&rh, &pipeliner, add_command, args.size(), args.data(), token);
+            do_storage(rh, pipeliner, add_command, args.size(), args.data(), token);
         } else if (!strcmp(args[0], "replace")) {
-            do_storage(&rh, &pipeliner, replace_command, args.size(), args.data(), token);
+            do_storage(rh, pipeliner, replace_command, args.size(), args.data(), token);
         } else if (!strcmp(args[0], "append")) {
-            do_storage(&rh, &pipeliner, append_command, args.size(), args.data(), token);
+            do_storage(rh, pipeliner, append_command, args.size(), args.data(), token);
         } else if (!strcmp(args[0], "prepend")) {
-            do_storage(&rh, &pipeliner, prepend_command, args.size(), args.data(), token);
+            do_storage(rh, pipeliner, prepend_command, args.size(), args.data(), token);
         } else if (!strcmp(args[0], "cas")) {
-            do_storage(&rh, &pipeliner, cas_command, args.size(), args.data(), token);
+            do_storage(rh, pipeliner, cas_command, args.size(), args.data(), token);
         } else if (!strcmp(args[0], "delete")) {
-            coro_t::spawn_now_dangerously(boost::bind(do_delete, &rh, &pipeliner, args.size(), args.data(), token));
+            coro_t::spawn_now_dangerously(boost::bind(do_delete, rh, pipeliner, args.size(), args.data(), token));
         } else if (!strcmp(args[0], "incr")) {
-            coro_t::spawn_now_dangerously(boost::bind(do_incr_decr, &rh, &pipeliner, true, args.size(), args.data(), token));
+            coro_t::spawn_now_dangerously(boost::bind(do_incr_decr, rh, pipeliner, true, args.size(), args.data(), token));
         } else if (!strcmp(args[0], "decr")) {
-            coro_t::spawn_now_dangerously(boost::bind(do_incr_decr, &rh, &pipeliner, false, args.size(), args.data(), token));
+            coro_t::spawn_now_dangerously(boost::bind(do_incr_decr, rh, pipeliner, false, args.size(), args.data(), token));
         } else if (!strcmp(args[0], "quit")) {
             // Make sure there's no more tokens (the kind in args, not
             // order tokens)
             if (args.size() > 1) {
-                pipeliner_acq_t pipeliner_acq(&pipeliner);
+                pipeliner_acq_t pipeliner_acq(pipeliner);
                 // We block everybody, but who cares?
                 pipeliner_acq.done_argparsing();
                 pipeliner_acq.begin_write();
-                rh.error();
+                rh->error();
                 pipeliner_acq.end_write();
             } else {
                 break;
             }
         } else if (!strcmp(args[0], "stats") || !strcmp(args[0], "stat")) {
-            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq_t pipeliner_acq(pipeliner);
 
             std::vector<std::string> stat_response_lines;
             memcached_stats(args.size(), args.data(), &stat_response_lines);
@@ -1202,30 +1947,65 @@ void handle_memcache(memcached_interface_t *interface,
             pipeliner_acq.done_argparsing();
             pipeliner_acq.begin_write();
             for (std::vector<std::string>::const_iterator i = stat_response_lines.begin(); i != stat_response_lines.end(); ++i) {
-                rh.write(*i);
+                rh->write(*i);
             }
             pipeliner_acq.end_write();
         } else if (!strcmp(args[0], "version")) {
-            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq_t pipeliner_acq(pipeliner);
 
             pipeliner_acq.done_argparsing();
             pipeliner_acq.begin_write();
             if (args.size() == 1) {
-                rh.writef("VERSION rethinkdb-%s\r\n", RETHINKDB_VERSION);
+                rh->writef("VERSION rethinkdb-%s\r\n", RETHINKDB_VERSION);
             } else {
-                rh.error();
+                rh->error();
             }
             pipeliner_acq.end_write();
         } else {
-            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq_t pipeliner_acq(pipeliner);
             pipeliner_acq.done_argparsing();
             pipeliner_acq.begin_write();
-            rh.error();
+            rh->error();
             pipeliner_acq.end_write();
         }
 
         action_timer.end();
     }
+}
+
+/* Handle memcached, takes a txt_memcached_handler_t and handles the memcached commands that come in on it */
+void handle_memcache(memcached_interface_t *interface,
+        namespace_interface_t<memcached_protocol_t> *nsi,
+        int max_concurrent_queries_per_connection,
+        memcached_stats_t *stats,
+        signal_t *interruptor) {
+    logDBG("Opened memcached stream: %p", coro_t::self());
+
+    /* This object just exists to group everything together so we don't have to pass a lot of
+    context around. */
+    txt_memcached_handler_t rh(interface, nsi, max_concurrent_queries_per_connection, stats, interruptor);
+
+    /* The commands from each individual memcached handler must be performed in the order
+    that the handler parses them. This `order_source_t` is used to guarantee that. */
+    order_source_t order_source;
+
+    pipeliner_t pipeliner(&rh);
+
+    /* No text command starts with the binary protocol's magic byte, so the first
+    byte the client sends tells us which protocol it speaks. */
+    bool binary;
+    try {
+        binary = static_cast<uint8_t>(rh.peek()) == binary_request_magic;
+    } catch (const memcached_interface_t::no_more_data_exc_t &) {
+        logDBG("Closed memcached stream: %p", coro_t::self());
+        return;
+    }
+
+    if (binary) {
+        handle_binary_memcache(&rh, &pipeliner, &order_source);
+    } else {
+        handle_text_memcache(&rh, &pipeliner, &order_source);
+    }
 
     // Make sure anything that would be running has finished.
     pipeliner_acq_t pipeliner_acq(&pipeliner);
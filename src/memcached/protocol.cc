@@ -19,6 +19,7 @@
 #include "memcached/memcached_btree/delete.hpp"
 #include "memcached/memcached_btree/distribution.hpp"
 #include "memcached/memcached_btree/erase_range.hpp"
+#include "memcached/memcached_btree/expire.hpp"
 #include "memcached/memcached_btree/get.hpp"
 #include "memcached/memcached_btree/get_cas.hpp"
 #include "memcached/memcached_btree/incr_decr.hpp"
@@ -49,7 +50,7 @@ write_message_t &operator<<(write_message_t &msg, const counted_t<data_buffer_t>
         msg << exists;
         int64_t size = buf->size();
         msg << size;
-        msg.append(buf->buf(), buf->size());
+        msg.append_data_buffer(buf);
     } else {
         bool exists = false;
         msg << exists;
@@ -77,18 +78,23 @@ archive_result_t deserialize(read_stream_t *s, counted_t<data_buffer_t> *buf) {
 }
 
 RDB_IMPL_SERIALIZABLE_1(get_query_t, key);
+RDB_IMPL_SERIALIZABLE_3(multi_get_query_t, keys, positions, region);
 RDB_IMPL_SERIALIZABLE_2(rget_query_t, region, maximum);
 RDB_IMPL_SERIALIZABLE_3(distribution_get_query_t, max_depth, result_limit, region);
+RDB_IMPL_SERIALIZABLE_2(expired_keys_query_t, region, maximum);
 RDB_IMPL_SERIALIZABLE_3(get_result_t, value, flags, cas);
+RDB_IMPL_SERIALIZABLE_2(multi_get_result_t, positions, results);
 RDB_IMPL_SERIALIZABLE_3(key_with_data_buffer_t, key, mcflags, value_provider);
 RDB_IMPL_SERIALIZABLE_2(rget_result_t, pairs, truncated);
 RDB_IMPL_SERIALIZABLE_2(distribution_result_t, region, key_counts);
+RDB_IMPL_SERIALIZABLE_2(expired_keys_result_t, keys, sizes);
 RDB_IMPL_SERIALIZABLE_1(get_cas_mutation_t, key);
 RDB_IMPL_SERIALIZABLE_7(sarc_mutation_t, key, data, flags, exptime, add_policy, replace_policy, old_cas);
 RDB_IMPL_SERIALIZABLE_2(delete_mutation_t, key, dont_put_in_delete_queue);
-RDB_IMPL_SERIALIZABLE_3(incr_decr_mutation_t, kind, key, amount);
+RDB_IMPL_SERIALIZABLE_6(incr_decr_mutation_t, kind, key, amount, create_if_missing, initial, exptime);
 RDB_IMPL_SERIALIZABLE_2(incr_decr_result_t, res, new_value);
 RDB_IMPL_SERIALIZABLE_3(append_prepend_mutation_t, kind, key, data);
+RDB_IMPL_SERIALIZABLE_1(expire_mutation_t, key);
 RDB_IMPL_SERIALIZABLE_6(backfill_atom_t, key, value, flags, exptime, recency, cas_or_zero);
 
 RDB_IMPL_SERIALIZABLE_1(memcached_protocol_t::read_response_t, result);
@@ -107,6 +113,23 @@ region_t monokey_region(const store_key_t &k) {
     return region_t(h, h + 1, key_range_t(key_range_t::closed, k, key_range_t::closed, k));
 }
 
+multi_get_query_t::multi_get_query_t(const std::vector<store_key_t> &_keys)
+    : keys(_keys) {
+    guarantee(!keys.empty());
+    store_key_t leftmost = keys[0], rightmost = keys[0];
+    positions.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        positions.push_back(i);
+        if (keys[i] < leftmost) {
+            leftmost = keys[i];
+        }
+        if (rightmost < keys[i]) {
+            rightmost = keys[i];
+        }
+    }
+    region = region_t(key_range_t(key_range_t::closed, leftmost, key_range_t::closed, rightmost));
+}
+
 /* `read_t::get_region()` */
 
 /* Wrap all our local types in anonymous namespaces so the linker doesn't
@@ -117,12 +140,18 @@ struct read_get_region_visitor_t : public boost::static_visitor<region_t> {
     region_t operator()(get_query_t get) {
         return monokey_region(get.key);
     }
+    region_t operator()(const multi_get_query_t &multi_get) {
+        return multi_get.region;
+    }
     region_t operator()(rget_query_t rget) {
         return rget.region;
     }
     region_t operator()(distribution_get_query_t dst_get) {
         return dst_get.region;
     }
+    region_t operator()(const expired_keys_query_t &expired_keys) {
+        return expired_keys.region;
+    }
 };
 
 }   /* anonymous namespace */
@@ -149,6 +178,22 @@ struct read_shard_visitor_t : public boost::static_visitor<bool> {
         return ret;
     }
 
+    bool operator()(const multi_get_query_t &multi_get) const {
+        multi_get_query_t tmp;
+        for (size_t i = 0; i < multi_get.keys.size(); ++i) {
+            if (region_contains_key(*region, multi_get.keys[i])) {
+                tmp.keys.push_back(multi_get.keys[i]);
+                tmp.positions.push_back(multi_get.positions[i]);
+            }
+        }
+        if (tmp.keys.empty()) {
+            return false;
+        }
+        tmp.region = region_intersection(*region, multi_get.region);
+        *read_out = read_t(tmp, effective_time);
+        return true;
+    }
+
     template <class T>
     bool rangey_query(const T &arg) const {
         const hash_region_t<key_range_t> intersection
@@ -171,6 +216,10 @@ struct read_shard_visitor_t : public boost::static_visitor<bool> {
         return rangey_query(distribution_get);
     }
 
+    bool operator()(const expired_keys_query_t &expired_keys) const {
+        return rangey_query(expired_keys);
+    }
+
 private:
     const exptime_t effective_time;
     const region_t *region;
@@ -237,6 +286,23 @@ struct read_unshard_visitor_t : public boost::static_visitor<read_response_t> {
         guarantee(count == 1);
         return read_response_t(boost::get<get_result_t>(bits[0].result));
     }
+    read_response_t operator()(const multi_get_query_t &multi_get) {
+        /* Each shard answered for some of our keys. `multi_get.positions` is
+        sorted, so we can find where each answer goes by binary search. */
+        multi_get_result_t result;
+        result.positions = multi_get.positions;
+        result.results.resize(multi_get.positions.size());
+        for (size_t i = 0; i < count; ++i) {
+            const multi_get_result_t *bit = boost::get<multi_get_result_t>(&bits[i].result);
+            guarantee(bit, "Bad boost::get\n");
+            for (size_t j = 0; j < bit->positions.size(); ++j) {
+                std::vector<uint64_t>::const_iterator it = std::lower_bound(multi_get.positions.begin(), multi_get.positions.end(), bit->positions[j]);
+                guarantee(it != multi_get.positions.end() && *it == bit->positions[j]);
+                result.results[it - multi_get.positions.begin()] = bit->results[j];
+            }
+        }
+        return read_response_t(result);
+    }
     read_response_t operator()(rget_query_t rget) {
         // TODO: do this without dynamic memory?
         std::vector<key_with_data_buffer_t> pairs;
@@ -326,6 +392,19 @@ struct read_unshard_visitor_t : public boost::static_visitor<read_response_t> {
 
         return read_response_t(res);
     }
+
+    read_response_t operator()(const expired_keys_query_t &expired_keys) {
+        expired_keys_result_t result;
+        for (size_t i = 0; i < count; ++i) {
+            const expired_keys_result_t *bit = boost::get<expired_keys_result_t>(&bits[i].result);
+            guarantee(bit, "Bad boost::get\n");
+            for (size_t j = 0; j < bit->keys.size() && result.keys.size() < static_cast<size_t>(expired_keys.maximum); ++j) {
+                result.keys.push_back(bit->keys[j]);
+                result.sizes.push_back(bit->sizes[j]);
+            }
+        }
+        return read_response_t(result);
+    }
 };
 
 }   /* anonymous namespace */
@@ -425,12 +504,34 @@ store_t::~store_t() {
 
 namespace {
 
+void do_multi_get_lookup(const multi_get_query_t *multi_get, int i, btree_slice_t *btree, exptime_t effective_time,
+                         transaction_t *txn, superblock_t *superblock, multi_get_result_t *result) {
+    result->results[i] = memcached_get(multi_get->keys[i], btree, effective_time, txn, superblock);
+}
+
 struct read_visitor_t : public boost::static_visitor<read_response_t> {
     read_response_t operator()(const get_query_t& get) {
         return read_response_t(
             memcached_get(get.key, btree, effective_time, txn, superblock));
     }
 
+    read_response_t operator()(const multi_get_query_t& multi_get) {
+        multi_get_result_t result;
+        result.positions = multi_get.positions;
+        result.results.resize(multi_get.keys.size());
+        if (multi_get.keys.empty()) {
+            superblock->release();
+            return read_response_t(result);
+        }
+
+        /* Every lookup releases the superblock once it has the root; the real
+        superblock is released after the last one does. */
+        refcount_superblock_t refcount_wrapper(superblock, multi_get.keys.size());
+        pmap(multi_get.keys.size(), boost::bind(&do_multi_get_lookup, &multi_get, _1,
+                                                btree, effective_time, txn, &refcount_wrapper, &result));
+        return read_response_t(result);
+    }
+
     read_response_t operator()(const rget_query_t& rget) {
         return read_response_t(
             memcached_rget_slice(btree, rget.region.inner, rget.maximum, effective_time, txn, superblock));
@@ -456,6 +557,11 @@ struct read_visitor_t : public boost::static_visitor<read_response_t> {
         return read_response_t(dstr);
     }
 
+    read_response_t operator()(const expired_keys_query_t& expired_keys) {
+        return read_response_t(
+            memcached_expired_keys(btree, expired_keys.region.inner, expired_keys.maximum, effective_time, txn, superblock));
+    }
+
     read_visitor_t(btree_slice_t *_btree,
                    transaction_t *_txn,
                    superblock_t *_superblock,
@@ -502,7 +608,7 @@ struct write_visitor_t : public boost::static_visitor<write_response_t> {
     }
     write_response_t operator()(const incr_decr_mutation_t &m) {
         return write_response_t(
-            memcached_incr_decr(m.key, btree, (m.kind == incr_decr_INCR), m.amount, proposed_cas, effective_time, timestamp, txn, superblock));
+            memcached_incr_decr(m.key, btree, (m.kind == incr_decr_INCR), m.amount, m.create_if_missing, m.initial, m.exptime, proposed_cas, effective_time, timestamp, txn, superblock));
     }
     write_response_t operator()(const append_prepend_mutation_t &m) {
         return write_response_t(
@@ -513,6 +619,11 @@ struct write_visitor_t : public boost::static_visitor<write_response_t> {
         return write_response_t(
             memcached_delete(m.key, m.dont_put_in_delete_queue, btree, effective_time, timestamp, txn, superblock));
     }
+    write_response_t operator()(const expire_mutation_t &m) {
+        guarantee(proposed_cas == INVALID_CAS);
+        return write_response_t(
+            memcached_expire(m.key, btree, effective_time, timestamp, txn, superblock));
+    }
 
     write_visitor_t(btree_slice_t *_btree,
                     transaction_t *_txn,
@@ -769,7 +880,8 @@ void debug_print(append_only_printf_buffer_t *buf, const delete_mutation_t& mut)
 void debug_print(append_only_printf_buffer_t *buf, const incr_decr_mutation_t& mut) {
     buf->appendf("incr_decr{%s, %" PRIu64 ", ", mut.kind == incr_decr_INCR ? "INCR" : mut.kind == incr_decr_DECR ? "DECR" : "???", mut.amount);
     debug_print(buf, mut.key);
-    buf->appendf("}");
+    buf->appendf(", create_if_missing=%s, initial=%" PRIu64 ", exptime=%" PRIu32 "}",
+                 mut.create_if_missing ? "true" : "false", mut.initial, mut.exptime);
 }
 
 void debug_print(append_only_printf_buffer_t *buf, const append_prepend_mutation_t& mut) {
@@ -779,6 +891,12 @@ void debug_print(append_only_printf_buffer_t *buf, const append_prepend_mutation
     buf->appendf(", ...}");
 }
 
+void debug_print(append_only_printf_buffer_t *buf, const expire_mutation_t& mut) {
+    buf->appendf("expire{");
+    debug_print(buf, mut.key);
+    buf->appendf("}");
+}
+
 void debug_print(append_only_printf_buffer_t *buf, const backfill_chunk_t& chunk) {
     generic_debug_print_visitor_t v(buf);
     boost::apply_visitor(v, chunk.val);
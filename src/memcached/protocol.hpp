@@ -32,18 +32,23 @@ write_message_t &operator<<(write_message_t &msg, const rget_result_t &iter);
 archive_result_t deserialize(read_stream_t *s, rget_result_t *iter);
 
 RDB_DECLARE_SERIALIZABLE(get_query_t);
+RDB_DECLARE_SERIALIZABLE(multi_get_query_t);
 RDB_DECLARE_SERIALIZABLE(rget_query_t);
 RDB_DECLARE_SERIALIZABLE(distribution_get_query_t);
+RDB_DECLARE_SERIALIZABLE(expired_keys_query_t);
 RDB_DECLARE_SERIALIZABLE(get_result_t);
+RDB_DECLARE_SERIALIZABLE(multi_get_result_t);
 RDB_DECLARE_SERIALIZABLE(key_with_data_buffer_t);
 RDB_DECLARE_SERIALIZABLE(rget_result_t);
 RDB_DECLARE_SERIALIZABLE(distribution_result_t);
+RDB_DECLARE_SERIALIZABLE(expired_keys_result_t);
 RDB_DECLARE_SERIALIZABLE(get_cas_mutation_t);
 RDB_DECLARE_SERIALIZABLE(sarc_mutation_t);
 RDB_DECLARE_SERIALIZABLE(delete_mutation_t);
 RDB_DECLARE_SERIALIZABLE(incr_decr_mutation_t);
 RDB_DECLARE_SERIALIZABLE(incr_decr_result_t);
 RDB_DECLARE_SERIALIZABLE(append_prepend_mutation_t);
+RDB_DECLARE_SERIALIZABLE(expire_mutation_t);
 RDB_DECLARE_SERIALIZABLE(backfill_atom_t);
 
 /* `memcached_protocol_t` is a container struct. It's never actually
@@ -58,7 +63,7 @@ public:
     struct context_t { };
 
     struct read_response_t {
-        typedef boost::variant<get_result_t, rget_result_t, distribution_result_t> result_t;
+        typedef boost::variant<get_result_t, multi_get_result_t, rget_result_t, distribution_result_t, expired_keys_result_t> result_t;
 
         read_response_t() { }
         read_response_t(const read_response_t& r) : result(r.result) { }
@@ -68,7 +73,7 @@ public:
     };
 
     struct read_t {
-        typedef boost::variant<get_query_t, rget_query_t, distribution_get_query_t> query_t;
+        typedef boost::variant<get_query_t, multi_get_query_t, rget_query_t, distribution_get_query_t, expired_keys_query_t> query_t;
 
         region_t get_region() const THROWS_NOTHING;
         // Returns true if the read had any applicability to the region, and a non-empty
@@ -98,7 +103,7 @@ public:
     };
 
     struct write_t {
-        typedef boost::variant<get_cas_mutation_t, sarc_mutation_t, delete_mutation_t, incr_decr_mutation_t, append_prepend_mutation_t> query_t;
+        typedef boost::variant<get_cas_mutation_t, sarc_mutation_t, delete_mutation_t, incr_decr_mutation_t, append_prepend_mutation_t, expire_mutation_t> query_t;
         region_t get_region() const THROWS_NOTHING;
 
         // Returns true if the write had any applicability to the region, and a non-empty
@@ -144,6 +149,9 @@ public:
         API. */
         repli_timestamp_t get_btree_repli_timestamp() const THROWS_NOTHING;
 
+        /* Every chunk carries at most one key. */
+        size_t get_key_count() const THROWS_NOTHING { return 1; }
+
         boost::variant<delete_range_t, delete_key_t, key_value_pair_t> val;
 
         static backfill_chunk_t delete_range(const region_t &range) {
@@ -52,6 +52,30 @@ struct get_result_t {
     cas_t cas;
 };
 
+/* `get` with several keys */
+
+/* `multi_get_query_t` looks up several keys with one read. When it's sharded,
+each shard gets just the keys it holds, and looks them all up under one
+superblock acquisition. `positions[i]` is the place of `keys[i]` in the original
+query, so the results can be put back in the order the keys were asked for. */
+struct multi_get_query_t {
+    std::vector<store_key_t> keys;
+    std::vector<uint64_t> positions;
+    /* A region that contains every key; `shard()` narrows it down along with the
+    keys. */
+    hash_region_t<key_range_t> region;
+
+    multi_get_query_t() { }
+    explicit multi_get_query_t(const std::vector<store_key_t> &_keys);
+};
+
+/* `results[i]` goes with `positions[i]` from the query. Once the shards' results
+are combined, `positions` is just 0, 1, 2, ... */
+struct multi_get_result_t {
+    std::vector<uint64_t> positions;
+    std::vector<get_result_t> results;
+};
+
 /* `rget` */
 
 struct rget_query_t {
@@ -105,6 +129,24 @@ struct distribution_result_t  {
     std::map<store_key_t, int64_t> key_counts;
 };
 
+/* `expired_keys` isn't a memcached command. The expiration sweeper uses it to
+find keys in `region` whose values have expired, so that it can remove them with
+`expire_mutation_t`s. At most `maximum` keys are returned. */
+struct expired_keys_query_t {
+    hash_region_t<key_range_t> region;
+    int maximum;
+
+    expired_keys_query_t() { }
+    expired_keys_query_t(const hash_region_t<key_range_t> &_region, int _maximum)
+        : region(_region), maximum(_maximum) { }
+};
+
+/* `sizes[i]` is how many bytes `keys[i]` and its value take up. */
+struct expired_keys_result_t {
+    std::vector<store_key_t> keys;
+    std::vector<int64_t> sizes;
+};
+
 /* `gets` */
 
 struct get_cas_mutation_t {
@@ -230,9 +272,19 @@ struct incr_decr_mutation_t {
     store_key_t key;
     uint64_t amount;
 
+    /* If `create_if_missing` is set and the key doesn't exist, it is stored with
+    the value `initial` and expiration time `exptime` instead of failing. (The
+    binary protocol asks for this.) */
+    bool create_if_missing;
+    uint64_t initial;
+    exptime_t exptime;
+
     incr_decr_mutation_t() { }
     incr_decr_mutation_t(incr_decr_kind_t idk, const store_key_t &k, uint64_t a) :
-        kind(idk), key(k), amount(a) { }
+        kind(idk), key(k), amount(a), create_if_missing(false), initial(0), exptime(0) { }
+    incr_decr_mutation_t(incr_decr_kind_t idk, const store_key_t &k, uint64_t a,
+                         uint64_t _initial, exptime_t _exptime) :
+        kind(idk), key(k), amount(a), create_if_missing(true), initial(_initial), exptime(_exptime) { }
 };
 
 void debug_print(append_only_printf_buffer_t *buf, const incr_decr_mutation_t& mut);
@@ -278,4 +330,17 @@ enum append_prepend_result_t {
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(append_prepend_result_t, int8_t, apr_success, apr_not_found);
 
+/* `expire` isn't a memcached command either. It removes `key` if its value has
+expired as of the write's effective time, and does nothing otherwise, so unlike a
+`delete` it can't clobber a value that was set again after the sweeper found the
+expired one. It returns `dr_deleted` if it removed anything. */
+struct expire_mutation_t {
+    store_key_t key;
+
+    expire_mutation_t() { }
+    explicit expire_mutation_t(const store_key_t &k) : key(k) { }
+};
+
+void debug_print(append_only_printf_buffer_t *buf, const expire_mutation_t& mut);
+
 #endif /* MEMCACHED_QUERIES_HPP_ */
@@ -84,6 +84,8 @@ public:
         std::string key, value;
         state_timestamp_t timestamp;
 
+        size_t get_key_count() const THROWS_NOTHING { return 1; }
+
         RDB_MAKE_ME_SERIALIZABLE_3(key, value, timestamp);
     };
 
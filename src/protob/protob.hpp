@@ -15,6 +15,8 @@
 #include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/mutex.hpp"
+#include "concurrency/semaphore.hpp"
 #include "containers/archive/archive.hpp"
 #include "http/http.hpp"
 
@@ -100,6 +102,14 @@ private:
 // request_t::protob_type *underlying_protob_value(request_t *request);
 //
 // "request_t::protob_type" does not actually have to be defined.
+//
+// A client opens a connection by sending context_t::magic_number, in which case
+// its queries are handled in the server's callback mode, or
+// context_t::unordered_magic_number, in which case they're handled as in
+// CORO_UNORDERED mode: each query gets its own coroutine, at most
+// PROTOB_MAX_CONCURRENT_QUERIES_PER_CONN at a time, and each response is sent as
+// soon as it's ready.  It's up to f to keep queries that depend on each other
+// from running at the same time.
 
 
 template <class request_t, class response_t, class context_t>
@@ -117,6 +127,13 @@ public:
 private:
 
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn, auto_drainer_t::lock_t);
+    // Returns true if the request couldn't be parsed, in which case the client
+    // should get *forced_response instead.
+    bool read_request(tcp_conn_t *conn, request_t *request, response_t *forced_response, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t);
+    void handle_unordered_conn(tcp_conn_t *conn, context_t *ctx, signal_t *closer);
+    void handle_unordered_query(request_t request, tcp_conn_t *conn, context_t *ctx,
+                                semaphore_t *query_semaphore, mutex_t *send_mutex,
+                                signal_t *closer, auto_drainer_t::lock_t);
     void send(const response_t &, tcp_conn_t *conn, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
     // For HTTP server
@@ -61,14 +61,16 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
     int chosen_thread = (next_thread++) % get_num_db_threads();
     cross_thread_signal_t ct_keepalive(keepalive.get_drain_signal(), chosen_thread);
     on_thread_t rethreader(chosen_thread);
-    context_t ctx;
     scoped_ptr_t<tcp_conn_t> conn;
     nconn->make_overcomplicated(&conn);
 
+    protob_server_callback_mode_t conn_mode = cb_mode;
     try {
         int32_t client_magic_number;
         conn->read(&client_magic_number, sizeof(int32_t), &ct_keepalive);
-        if (client_magic_number != context_t::magic_number) {
+        if (client_magic_number == context_t::unordered_magic_number) {
+            conn_mode = CORO_UNORDERED;
+        } else if (client_magic_number != context_t::magic_number) {
             const char *msg =
                 "ERROR: This is the rdb protocol port! (bad magic number)\n";
             conn->write(msg, strlen(msg), &ct_keepalive);
@@ -81,32 +83,32 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
         return;
     }
 
-    //TODO figure out how to do this with less copying
+    /* Queries may leave work behind them that outlives the query itself (for
+    instance the stream cache prefetching the next chunk of a stream), so they
+    all share an interruptor that lasts as long as the connection. `ctx` is
+    declared after it so that it's destroyed first. */
+#ifdef __linux
+    linux_event_watcher_t *ew = conn->get_event_watcher();
+    linux_event_watcher_t::watch_t conn_interrupted(ew, poll_event_rdhup);
+    wait_any_t interruptor(&conn_interrupted, shutdown_signal());
+#else
+    wait_any_t interruptor(shutdown_signal());
+#endif  // __linux
+    context_t ctx;
+    ctx.interruptor = &interruptor;
+
+    if (conn_mode == CORO_UNORDERED) {
+        handle_unordered_conn(conn.get(), &ctx, &ct_keepalive);
+        return;
+    }
+
     for (;;) {
         request_t request;
         make_empty_protob_bearer(&request);
-        bool force_response = false;
         response_t forced_response;
-        std::string err;
+        bool force_response;
         try {
-            int32_t size;
-            conn->read(&size, sizeof(int32_t), &ct_keepalive);
-            if (size < 0) {
-                err = strprintf("Negative protobuf size (%d).", size);
-                forced_response = on_unparsable_query(request_t(), err);
-                force_response = true;
-            } else {
-                scoped_array_t<char> data(size);
-                conn->read(data.data(), size, &ct_keepalive);
-
-                const bool res
-                    = underlying_protob_value(&request)->ParseFromArray(data.data(), size);
-                if (!res) {
-                    err = "Client is buggy (failed to deserialize protobuf).";
-                    forced_response = on_unparsable_query(request, err);
-                    force_response = true;
-                }
-            }
+            force_response = read_request(conn.get(), &request, &forced_response, &ct_keepalive);
         } catch (const tcp_conn_read_closed_exc_t &) {
             //TODO need to figure out what blocks us up here in non inline cb
             //mode
@@ -119,15 +121,6 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
                 if (force_response) {
                     send(forced_response, conn.get(), &ct_keepalive);
                 } else {
-#ifdef __linux
-                    linux_event_watcher_t *ew = conn->get_event_watcher();
-                    linux_event_watcher_t::watch_t conn_interrupted(
-                        ew, poll_event_rdhup);
-                    wait_any_t interruptor(&conn_interrupted, shutdown_signal());
-                    ctx.interruptor = &interruptor;
-#else
-                    ctx.interruptor = shutdown_signal();
-#endif  // __linux
                     response_t response;
                     bool response_needed = f(request, &response, &ctx);
                     if (response_needed) {
@@ -139,7 +132,7 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
                 crash("unimplemented");
                 break;
             case CORO_UNORDERED:
-                crash("unimplemented");
+                unreachable();
                 break;
             default:
                 crash("unreachable");
@@ -153,6 +146,96 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(
     }
 }
 
+template <class request_t, class response_t, class context_t>
+bool protob_server_t<request_t, response_t, context_t>::read_request(
+    tcp_conn_t *conn,
+    request_t *request,
+    response_t *forced_response,
+    signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
+    //TODO figure out how to do this with less copying
+    int32_t size;
+    conn->read(&size, sizeof(int32_t), closer);
+    if (size < 0) {
+        std::string err = strprintf("Negative protobuf size (%d).", size);
+        *forced_response = on_unparsable_query(request_t(), err);
+        return true;
+    }
+
+    scoped_array_t<char> data(size);
+    conn->read(data.data(), size, closer);
+
+    const bool res
+        = underlying_protob_value(request)->ParseFromArray(data.data(), size);
+    if (!res) {
+        std::string err = "Client is buggy (failed to deserialize protobuf).";
+        *forced_response = on_unparsable_query(*request, err);
+        return true;
+    }
+    return false;
+}
+
+template <class request_t, class response_t, class context_t>
+void protob_server_t<request_t, response_t, context_t>::handle_unordered_conn(
+    tcp_conn_t *conn,
+    context_t *ctx,
+    signal_t *closer) {
+    /* The semaphore is what keeps a client from starting an unbounded number
+    of queries at once: once it runs out, we stop reading from the connection
+    until a query finishes. */
+    semaphore_t query_semaphore(PROTOB_MAX_CONCURRENT_QUERIES_PER_CONN);
+    mutex_t send_mutex;
+
+    /* This has to be destroyed first, so that the queries still running when
+    the client goes away can finish with everything above. */
+    auto_drainer_t drainer;
+
+    for (;;) {
+        request_t request;
+        make_empty_protob_bearer(&request);
+        response_t forced_response;
+        try {
+            if (read_request(conn, &request, &forced_response, closer)) {
+                mutex_t::acq_t send_acq(&send_mutex);
+                send(forced_response, conn, closer);
+                continue;
+            }
+        } catch (const tcp_conn_read_closed_exc_t &) {
+            return;
+        } catch (const tcp_conn_write_closed_exc_t &) {
+            return;
+        }
+
+        query_semaphore.co_lock();
+        coro_t::spawn_sometime(boost::bind(
+            &protob_server_t<request_t, response_t, context_t>::handle_unordered_query,
+            this, request, conn, ctx, &query_semaphore, &send_mutex, closer,
+            auto_drainer_t::lock_t(&drainer)));
+    }
+}
+
+template <class request_t, class response_t, class context_t>
+void protob_server_t<request_t, response_t, context_t>::handle_unordered_query(
+    request_t request,
+    tcp_conn_t *conn,
+    context_t *ctx,
+    semaphore_t *query_semaphore,
+    mutex_t *send_mutex,
+    signal_t *closer,
+    auto_drainer_t::lock_t) {
+    response_t response;
+    bool response_needed = f(request, &response, ctx);
+    if (response_needed) {
+        mutex_t::acq_t send_acq(send_mutex);
+        try {
+            send(response, conn, closer);
+        } catch (const tcp_conn_write_closed_exc_t &) {
+            /* `handle_unordered_conn()` will notice that the connection is
+            gone when it next tries to read from it. */
+        }
+    }
+    query_semaphore->unlock();
+}
+
 template <class request_t, class response_t, class context_t>
 void protob_server_t<request_t, response_t, context_t>::send(
     const response_t &res,
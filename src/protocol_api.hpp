@@ -48,6 +48,13 @@ class namespace_interface_t {
 public:
     virtual void read(const typename protocol_t::read_t &, typename protocol_t::read_response_t *response, order_token_t tok, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) = 0;
     virtual void read_outdated(const typename protocol_t::read_t &, typename protocol_t::read_response_t *response, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) = 0;
+
+    /* Like `read_outdated()`, but only reads from replicas whose data is at most
+    `max_staleness_ms` milliseconds out of date. Implementations whose outdated
+    reads are never stale can leave this alone. */
+    virtual void read_bounded_staleness(const typename protocol_t::read_t &r, typename protocol_t::read_response_t *response, UNUSED int64_t max_staleness_ms, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        read_outdated(r, response, interruptor);
+    }
     virtual void write(const typename protocol_t::write_t &, typename protocol_t::write_response_t *response, order_token_t tok, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) = 0;
 
     /* These calls are for the sole purpose of optimizing queries; don't rely
@@ -1,4 +1,7 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <algorithm>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -12,6 +15,7 @@
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
 #include "btree/parallel_traversal.hpp"
+#include "btree/superblock.hpp"
 #include "buffer_cache/blob.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/vector_stream.hpp"
@@ -359,10 +363,12 @@ void rdb_batched_replace(const std::vector<std::pair<int64_t, point_replace_t> >
 void rdb_set(const store_key_t &key, boost::shared_ptr<scoped_cJSON_t> data, bool overwrite,
              btree_slice_t *slice, repli_timestamp_t timestamp,
              transaction_t *txn, superblock_t *superblock, point_write_response_t *response_out,
-             rdb_modification_info_t *mod_info) {
+             rdb_modification_info_t *mod_info,
+             promise_t<superblock_t *> *pass_back_superblock) {
     keyvalue_location_t<rdb_value_t> kv_location;
     find_keyvalue_location_for_write(txn, superblock, key.btree_key(), &kv_location,
-                                     &slice->root_eviction_priority, &slice->stats);
+                                     &slice->root_eviction_priority, &slice->stats,
+                                     pass_back_superblock);
     const bool had_value = kv_location.value.has();
 
     /* update the modification report */
@@ -393,14 +399,17 @@ public:
     }
 
     void on_pair(transaction_t *txn, repli_timestamp_t recency, const btree_key_t *key, const void *val, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-        rassert(kr_.contains_key(key->contents, key->size));
-        const rdb_value_t *value = static_cast<const rdb_value_t *>(val);
+        std::vector<rdb_protocol_details::backfill_atom_t> atoms(1);
+        make_atom(txn, recency, key, val, &atoms[0]);
+        cb_->on_keyvalues(atoms, interruptor);
+    }
 
-        rdb_protocol_details::backfill_atom_t atom;
-        atom.key.assign(key->size, key->contents);
-        atom.value = get_data(value, txn);
-        atom.recency = recency;
-        cb_->on_keyvalue(atom, interruptor);
+    void on_pairs(transaction_t *txn, const std::vector<backfill_pair_t> &pairs, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        std::vector<rdb_protocol_details::backfill_atom_t> atoms(pairs.size());
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            make_atom(txn, pairs[i].recency, pairs[i].key, pairs[i].value, &atoms[i]);
+        }
+        cb_->on_keyvalues(atoms, interruptor);
     }
 
     void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
@@ -409,6 +418,17 @@ public:
 
     rdb_backfill_callback_t *cb_;
     key_range_t kr_;
+
+private:
+    void make_atom(transaction_t *txn, repli_timestamp_t recency, const btree_key_t *key, const void *val,
+                   rdb_protocol_details::backfill_atom_t *atom_out) {
+        rassert(kr_.contains_key(key->contents, key->size));
+        const rdb_value_t *value = static_cast<const rdb_value_t *>(val);
+
+        atom_out->key.assign(key->size, key->contents);
+        atom_out->value = get_data(value, txn);
+        atom_out->recency = recency;
+    }
 };
 
 void rdb_backfill(btree_slice_t *slice, const key_range_t& key_range,
@@ -481,7 +501,31 @@ void sindex_erase_range(const key_range_t &key_range,
     }
 }
 
-/* Spawns a coro to carry out the erase range for each sindex. */
+/* The primary keys a sindex has already indexed. Writes to these keys must
+ * update the sindex directly. */
+key_range_t sindex_constructed_range(const secondary_index_t &sindex) {
+    if (sindex.post_construction_complete) {
+        return key_range_t::universe();
+    } else {
+        return key_range_t(key_range_t::none, store_key_t(),
+                           key_range_t::open, sindex.post_construction_progress);
+    }
+}
+
+/* The primary keys a sindex has yet to index. These are left to post
+ * construction. */
+key_range_t sindex_unconstructed_range(const secondary_index_t &sindex) {
+    if (sindex.post_construction_complete) {
+        return key_range_t::empty();
+    } else {
+        return key_range_t(key_range_t::closed, sindex.post_construction_progress,
+                           key_range_t::none, store_key_t());
+    }
+}
+
+/* Spawns a coro to carry out the erase range for each sindex. Each sindex only
+ * erases the part of the range it has already constructed or, if
+ * `post_construction` is true, the part it hasn't. */
 void spawn_sindex_erase_ranges(
         const sindex_access_vector_t *sindex_access,
         const key_range_t &key_range,
@@ -489,10 +533,20 @@ void spawn_sindex_erase_ranges(
         auto_drainer_t *drainer,
         auto_drainer_t::lock_t,
         bool release_superblock,
+        bool post_construction,
         signal_t *interruptor) {
     for (auto it = sindex_access->begin(); it != sindex_access->end(); ++it) {
+        key_range_t sindex_range = key_range.intersection(post_construction
+                ? sindex_unconstructed_range(it->sindex)
+                : sindex_constructed_range(it->sindex));
+        if (sindex_range.is_empty()) {
+            if (release_superblock) {
+                it->super_block->release();
+            }
+            continue;
+        }
         coro_t::spawn_sometime(boost::bind(
-                    &sindex_erase_range, key_range, txn, &*it,
+                    &sindex_erase_range, sindex_range, txn, &*it,
                     auto_drainer_t::lock_t(drainer), interruptor,
                     release_superblock));
     }
@@ -531,7 +585,8 @@ void rdb_erase_range(btree_slice_t *slice, key_tester_t *tester,
     auto_drainer_t drainer;
     spawn_sindex_erase_ranges(&sindex_superblocks, key_range, txn,
             &drainer, auto_drainer_t::lock_t(&drainer),
-            true, /* release the superblock */ interruptor);
+            true, /* release the superblock */
+            false, /* not post construction */ interruptor);
 
     /* This is guaranteed because the way the keys are calculated below would
      * lead to a single key being deleted even if the range was empty. */
@@ -559,12 +614,6 @@ void rdb_erase_range(btree_slice_t *slice, key_tester_t *tester,
     //auto_drainer_t is destructed here so this waits for other coros to finish.
 }
 
-// This is actually a kind of misleading name. This function estimates the size of a cJSON object
-// not a whole rget though it is used for that purpose (by summing up these responses).
-size_t estimate_rget_response_size(const boost::shared_ptr<scoped_cJSON_t> &json) {
-    return cJSON_estimate_size(json->get());
-}
-
 class rdb_rget_depth_first_traversal_callback_t : public depth_first_traversal_callback_t {
 public:
     /* This constructor does a traversal on the primary btree, it's not to be
@@ -574,14 +623,18 @@ public:
                                               const rdb_protocol_details::transform_t &_transform,
                                               boost::optional<rdb_protocol_details::terminal_t> _terminal,
                                               const key_range_t &range,
+                                              size_t _max_chunk_bytes,
                                               rget_read_response_t *_response) :
         bad_init(false),
         transaction(txn),
         response(_response),
         cumulative_size(0),
+        max_chunk_bytes(_max_chunk_bytes),
         ql_env(_ql_env),
         transform(_transform),
-        terminal(_terminal)
+        terminal(_terminal),
+        primary_slice(NULL),
+        multi_sindex_mapping(NULL)
     {
         init(range);
     }
@@ -600,16 +653,30 @@ public:
                                               boost::optional<rdb_protocol_details::terminal_t> _terminal,
                                               const key_range_t &range,
                                               const key_range_t &_primary_key_range,
+                                              btree_slice_t *_primary_slice,
+                                              superblock_t *_primary_superblock,
+                                              ql::map_wire_func_t *_multi_sindex_mapping,
+                                              counted_t<const ql::datum_t> _sindex_start_value,
+                                              counted_t<const ql::datum_t> _sindex_end_value,
+                                              size_t _max_chunk_bytes,
                                               rget_read_response_t *_response) :
         bad_init(false),
         transaction(txn),
         response(_response),
         cumulative_size(0),
+        max_chunk_bytes(_max_chunk_bytes),
         ql_env(_ql_env),
         transform(_transform),
         terminal(_terminal),
-        primary_key_range(_primary_key_range)
+        primary_key_range(_primary_key_range),
+        primary_slice(_primary_slice),
+        multi_sindex_mapping(_multi_sindex_mapping),
+        sindex_start_value(_sindex_start_value),
+        sindex_end_value(_sindex_end_value)
     {
+        if (_primary_superblock != NULL) {
+            primary_superblock.init(new shared_superblock_t(_primary_superblock));
+        }
         init(range);
     }
     void init(const key_range_t &range) {
@@ -640,10 +707,11 @@ public:
         if (bad_init) {
             return false;
         }
+        store_key_t primary_key;
         if (primary_key_range) {
-            std::string pk = ql::datum_t::unprint_secondary(
-                    key_to_unescaped_str(store_key_t(key)));
-            if (!primary_key_range->contains_key(store_key_t(pk))) {
+            primary_key = store_key_t(ql::datum_t::unprint_secondary(
+                    key_to_unescaped_str(store_key_t(key))));
+            if (!primary_key_range->contains_key(primary_key)) {
                 return true;
             }
         }
@@ -653,11 +721,34 @@ public:
                 response->last_considered_key = store_key;
             }
 
+            /* A slim sindex doesn't store enough of the row for this read, so
+            we go and get the whole row from the primary btree. */
+            keyvalue_location_t<rdb_value_t> primary_location;
             const rdb_value_t *rdb_value = reinterpret_cast<const rdb_value_t *>(value);
+            if (primary_superblock.has()) {
+                find_keyvalue_location_for_read(transaction, primary_superblock.get(),
+                                                primary_key.btree_key(), &primary_location,
+                                                primary_slice->root_eviction_priority,
+                                                &primary_slice->stats);
+                if (!primary_location.value.has()) {
+                    return true;
+                }
+                rdb_value = primary_location.value.get();
+            }
+
+            /* We count the rows we read by their serialized size, which we get
+            for free, rather than walking the JSON we send back. This also
+            bounds the work done for rows that a filter then drops. */
+            cumulative_size += rdb_value->value_size();
 
             json_list_t data;
             data.push_back(get_data(rdb_value, transaction));
 
+            if (multi_sindex_mapping != NULL
+                && !is_first_entry_in_range(store_key, primary_key, data.front())) {
+                return true;
+            }
+
             // Apply transforms to the data
             {
                 rdb_protocol_details::transform_t::iterator it;
@@ -691,10 +782,9 @@ public:
                                            it != data.end();
                                            ++it) {
                     stream->push_back(std::make_pair(store_key_t(key), *it));
-                    cumulative_size += estimate_rget_response_size(*it);
                 }
 
-                return cumulative_size < rget_max_chunk_size;
+                return cumulative_size < max_chunk_bytes;
             } else {
                 try {
                     for (auto jt = data.begin(); jt != data.end(); ++jt) {
@@ -720,16 +810,65 @@ public:
         }
 
     }
+    /* A multi index stores a row once for each element of the array its
+     * mapping returns, so the range can hold several entries for one row. We
+     * only keep the entry for the row's first element in the range. */
+    bool is_first_entry_in_range(const store_key_t &sindex_key,
+                                 const store_key_t &primary_key,
+                                 const boost::shared_ptr<scoped_cJSON_t> &row) {
+        counted_t<const ql::datum_t> index;
+        try {
+            index = multi_sindex_mapping->compile(ql_env)->call(
+                make_counted<ql::datum_t>(row->get(), ql_env))->as_datum();
+        } catch (const ql::base_exc_t &) {
+            // The row isn't in the index any more.
+            return false;
+        }
+
+        std::vector<counted_t<const ql::datum_t> > elements;
+        if (index->get_type() == ql::datum_t::R_ARRAY) {
+            for (size_t i = 0; i < index->size(); ++i) {
+                elements.push_back(index->get(i));
+            }
+        } else {
+            elements.push_back(index);
+        }
+
+        boost::optional<store_key_t> first_key;
+        for (auto it = elements.begin(); it != elements.end(); ++it) {
+            if ((sindex_start_value.has() && **it < *sindex_start_value)
+                || (sindex_end_value.has() && *sindex_end_value < **it)) {
+                continue;
+            }
+            store_key_t key((*it)->print_secondary(primary_key));
+            if (!first_key || key < *first_key) {
+                first_key = key;
+            }
+        }
+        return first_key && *first_key == sindex_key;
+    }
+
     bool bad_init;
     transaction_t *transaction;
     rget_read_response_t *response;
     size_t cumulative_size;
+    size_t max_chunk_bytes;
     ql::env_t *ql_env;
     rdb_protocol_details::transform_t transform;
     boost::optional<rdb_protocol_details::terminal_t> terminal;
 
     /* Only present if we're doing a sindex read.*/
     boost::optional<key_range_t> primary_key_range;
+
+    /* Only present if we're doing a sindex read that needs whole rows the
+     * sindex doesn't store. */
+    btree_slice_t *primary_slice;
+    scoped_ptr_t<shared_superblock_t> primary_superblock;
+
+    /* Only present if we're doing a read on a multi index. */
+    ql::map_wire_func_t *multi_sindex_mapping;
+    counted_t<const ql::datum_t> sindex_start_value;
+    counted_t<const ql::datum_t> sindex_end_value;
 };
 
 class result_finalizer_visitor_t : public boost::static_visitor<void> {
@@ -760,11 +899,12 @@ void rdb_rget_slice(btree_slice_t *slice, const key_range_t &range,
                     ql::env_t *ql_env,
                     const rdb_protocol_details::transform_t &transform,
                     const boost::optional<rdb_protocol_details::terminal_t> &terminal,
+                    size_t max_chunk_bytes,
                     rget_read_response_t *response) {
-    rdb_rget_depth_first_traversal_callback_t callback(txn, ql_env, transform, terminal, range, response);
+    rdb_rget_depth_first_traversal_callback_t callback(txn, ql_env, transform, terminal, range, max_chunk_bytes, response);
     btree_depth_first_traversal(slice, txn, superblock, range, &callback);
 
-    if (callback.cumulative_size >= rget_max_chunk_size) {
+    if (!terminal && callback.cumulative_size >= max_chunk_bytes) {
         response->truncated = true;
     } else {
         response->truncated = false;
@@ -779,11 +919,21 @@ void rdb_rget_secondary_slice(btree_slice_t *slice, const key_range_t &range,
                     const rdb_protocol_details::transform_t &transform,
                     const boost::optional<rdb_protocol_details::terminal_t> &terminal,
                     const key_range_t &pk_range,
+                    btree_slice_t *primary_slice,
+                    superblock_t *primary_superblock,
+                    ql::map_wire_func_t *multi_sindex_mapping,
+                    counted_t<const ql::datum_t> sindex_start_value,
+                    counted_t<const ql::datum_t> sindex_end_value,
+                    size_t max_chunk_bytes,
                     rget_read_response_t *response) {
-    rdb_rget_depth_first_traversal_callback_t callback(txn, ql_env, transform, terminal, range, pk_range, response);
+    rdb_rget_depth_first_traversal_callback_t callback(txn, ql_env, transform, terminal, range, pk_range,
+                                                       primary_slice, primary_superblock,
+                                                       multi_sindex_mapping,
+                                                       sindex_start_value, sindex_end_value,
+                                                       max_chunk_bytes, response);
     btree_depth_first_traversal(slice, txn, superblock, range, &callback);
 
-    if (callback.cumulative_size >= rget_max_chunk_size) {
+    if (!terminal && callback.cumulative_size >= max_chunk_bytes) {
         response->truncated = true;
     } else {
         response->truncated = false;
@@ -923,6 +1073,153 @@ void rdb_modification_report_cb_t::on_mod_report(
 
 typedef btree_store_t<rdb_protocol_t>::sindex_access_vector_t sindex_access_vector_t;
 
+void serialize_sindex_info(write_message_t *wm,
+                           const ql::map_wire_func_t &mapping,
+                           sindex_multi_bool_t multi,
+                           const boost::optional<std::vector<std::string> > &projection) {
+    *wm << mapping;
+    *wm << multi;
+    *wm << projection;
+}
+
+void deserialize_sindex_info(const std::vector<char> &data,
+                             ql::map_wire_func_t *mapping,
+                             sindex_multi_bool_t *multi,
+                             boost::optional<std::vector<std::string> > *projection) {
+    vector_read_stream_t read_stream(&data);
+    int success = deserialize(&read_stream, mapping);
+    guarantee(success == ARCHIVE_SUCCESS, "Corrupted sindex description.");
+
+    /* Sindexes created before multi indexes only stored the mapping. Once the
+     * stream runs out, every field after it also reads as EOF. */
+    success = deserialize(&read_stream, multi);
+    if (success == ARCHIVE_SOCK_EOF) {
+        *multi = SINGLE;
+    } else {
+        guarantee(success == ARCHIVE_SUCCESS, "Corrupted sindex description.");
+    }
+
+    /* Sindexes created before slim sindexes have no projection; they store
+     * whole rows. */
+    success = deserialize(&read_stream, projection);
+    if (success == ARCHIVE_SOCK_EOF) {
+        *projection = boost::none;
+    } else {
+        guarantee(success == ARCHIVE_SUCCESS, "Corrupted sindex description.");
+    }
+}
+
+bool is_var(const Term &term, int64_t var) {
+    return term.type() == Term::VAR && term.args_size() == 1
+        && term.args(0).type() == Term::DATUM
+        && term.args(0).datum().r_num() == var;
+}
+
+/* Checks that `term` only ever uses the variable `var` to get one of `fields`
+ * from it. */
+bool term_uses_only_fields(const Term &term, int64_t var,
+                           const std::set<std::string> &fields) {
+    if (term.type() == Term::IMPLICIT_VAR || is_var(term, var)) {
+        return false;
+    }
+    if (term.type() == Term::GETATTR && term.args_size() == 2
+        && is_var(term.args(0), var)) {
+        const Term &attr = term.args(1);
+        return attr.type() == Term::DATUM
+            && attr.datum().type() == Datum::R_STR
+            && fields.count(attr.datum().r_str()) == 1;
+    }
+
+    for (int i = 0; i < term.args_size(); ++i) {
+        if (!term_uses_only_fields(term.args(i), var, fields)) {
+            return false;
+        }
+    }
+    for (int i = 0; i < term.optargs_size(); ++i) {
+        if (!term_uses_only_fields(term.optargs(i).val(), var, fields)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool func_uses_only_fields(const Term &func, const std::set<std::string> &fields) {
+    if (func.type() != Term::FUNC || func.args_size() != 2
+        || func.args(0).type() != Term::DATUM
+        || func.args(0).datum().r_array_size() != 1) {
+        return false;
+    }
+    int64_t var = func.args(0).datum().r_array(0).r_num();
+    return term_uses_only_fields(func.args(1), var, fields);
+}
+
+bool sindex_projection_covers(const std::vector<std::string> &projection,
+                              const ql::map_wire_func_t &mapping,
+                              const rdb_protocol_details::transform_t &transform,
+                              const boost::optional<rdb_protocol_details::terminal_t> &terminal) {
+    std::set<std::string> fields(projection.begin(), projection.end());
+
+    /* The rows are checked against the sindex range using the mapping. */
+    if (!func_uses_only_fields(mapping.get_term(), fields)) {
+        return false;
+    }
+
+    /* Filters see the rows and pass them on, a map or concat map sees them
+     * and replaces them with something else. */
+    for (auto it = transform.begin(); it != transform.end(); ++it) {
+        if (const ql::filter_wire_func_t *f = boost::get<ql::filter_wire_func_t>(&it->variant)) {
+            if (!func_uses_only_fields(f->get_term(), fields)) {
+                return false;
+            }
+        } else if (const ql::map_wire_func_t *m = boost::get<ql::map_wire_func_t>(&it->variant)) {
+            return func_uses_only_fields(m->get_term(), fields);
+        } else {
+            const ql::concatmap_wire_func_t *c =
+                boost::get<ql::concatmap_wire_func_t>(&it->variant);
+            guarantee(c);
+            return func_uses_only_fields(c->get_term(), fields);
+        }
+    }
+
+    /* Otherwise the rows themselves come out the other end, unless all we do
+     * is count them. */
+    return terminal && boost::get<ql::count_wire_func_t>(&terminal->variant) != NULL;
+}
+
+/* Picks out the fields of a row a slim sindex stores. */
+boost::shared_ptr<scoped_cJSON_t> project_row(const boost::shared_ptr<scoped_cJSON_t> &row,
+                                              const std::vector<std::string> &projection) {
+    boost::shared_ptr<scoped_cJSON_t> projected(new scoped_cJSON_t(cJSON_CreateObject()));
+    for (auto it = projection.begin(); it != projection.end(); ++it) {
+        cJSON *field = row->GetObjectItem(it->c_str());
+        if (field != NULL) {
+            projected->AddItemToObject(it->c_str(), cJSON_DeepCopy(field));
+        }
+    }
+    return projected;
+}
+
+/* Computes the keys under which a row appears in a sindex: one key normally,
+ * or one per element if it's a multi index and the row maps to an array.
+ * Throws if the row doesn't belong in the index at all. */
+void compute_sindex_keys(ql::map_wire_func_t *mapping, sindex_multi_bool_t multi,
+                         ql::env_t *env, counted_t<const ql::datum_t> row,
+                         const store_key_t &primary_key,
+                         std::vector<store_key_t> *keys_out)
+    THROWS_ONLY(ql::base_exc_t) {
+    counted_t<const ql::datum_t> index =
+        mapping->compile(env)->call(row)->as_datum();
+
+    if (multi == MULTI && index->get_type() == ql::datum_t::R_ARRAY) {
+        for (size_t i = 0; i < index->size(); ++i) {
+            keys_out->push_back(
+                store_key_t(index->get(i)->print_secondary(primary_key)));
+        }
+    } else {
+        keys_out->push_back(store_key_t(index->print_secondary(primary_key)));
+    }
+}
+
 /* Used below by rdb_update_sindexes. */
 void rdb_update_single_sindex(
         const btree_store_t<rdb_protocol_t>::sindex_access_t *sindex,
@@ -936,9 +1233,9 @@ void rdb_update_single_sindex(
     guarantee(modification->primary_key.size() != 0);
 
     ql::map_wire_func_t mapping;
-    vector_read_stream_t read_stream(&sindex->sindex.opaque_definition);
-    int success = deserialize(&read_stream, &mapping);
-    guarantee(success == ARCHIVE_SUCCESS, "Corrupted sindex description.");
+    sindex_multi_bool_t multi;
+    boost::optional<std::vector<std::string> > projection;
+    deserialize_sindex_info(sindex->sindex.opaque_definition, &mapping, &multi, &projection);
 
     //TODO we just use a NULL environment here. People should not be able
     //to do anything that requires an environment like gets from other
@@ -952,31 +1249,34 @@ void rdb_update_single_sindex(
 
     if (modification->info.deleted) {
         try {
-            promise_t<superblock_t *> return_superblock_local;
-            {
-                counted_t<const ql::datum_t> deleted =
-                    make_counted<ql::datum_t>(modification->info.deleted, &env);
-
-                counted_t<const ql::datum_t> index =
-                    mapping.compile(&env)->call(deleted)->as_datum();
-
-                store_key_t sindex_key(
-                    index->print_secondary(modification->primary_key));
-
-                keyvalue_location_t<rdb_value_t> kv_location;
-
-                find_keyvalue_location_for_write(txn, super_block,
-                                                 sindex_key.btree_key(),
-                                                 &kv_location,
-                                                 &sindex->btree->root_eviction_priority,
-                                                 &sindex->btree->stats,
-                                                 &return_superblock_local);
-
-                kv_location_delete(&kv_location, sindex_key,
-                                   sindex->btree, repli_timestamp_t::distant_past, txn);
-                //The keyvalue location gets destroyed here.
+            std::vector<store_key_t> deleted_keys;
+            compute_sindex_keys(&mapping, multi, &env,
+                                make_counted<ql::datum_t>(modification->info.deleted, &env),
+                                modification->primary_key, &deleted_keys);
+
+            for (auto it = deleted_keys.begin(); it != deleted_keys.end(); ++it) {
+                promise_t<superblock_t *> return_superblock_local;
+                {
+                    keyvalue_location_t<rdb_value_t> kv_location;
+
+                    find_keyvalue_location_for_write(txn, super_block,
+                                                     it->btree_key(),
+                                                     &kv_location,
+                                                     &sindex->btree->root_eviction_priority,
+                                                     &sindex->btree->stats,
+                                                     &return_superblock_local);
+
+                    // Post construction may replay a change whose result it has
+                    // already seen, and a multi index may have listed the same
+                    // key twice, in which case the entry is already gone.
+                    if (kv_location.value.has()) {
+                        kv_location_delete(&kv_location, *it,
+                                           sindex->btree, repli_timestamp_t::distant_past, txn);
+                    }
+                    //The keyvalue location gets destroyed here.
+                }
+                super_block = return_superblock_local.wait();
             }
-            super_block = return_superblock_local.wait();
         } catch (const ql::base_exc_t &) {
             // Do nothing (it wasn't actually in the index).
         }
@@ -984,56 +1284,79 @@ void rdb_update_single_sindex(
 
     if (modification->info.added) {
         try {
-            counted_t<const ql::datum_t> added =
-                make_counted<ql::datum_t>(modification->info.added, &env);
-
-            counted_t<const ql::datum_t> index
-                = mapping.compile(&env)->call(added)->as_datum();
-
-            store_key_t sindex_key(index->print_secondary(modification->primary_key));
-
-            keyvalue_location_t<rdb_value_t> kv_location;
-
-            promise_t<superblock_t *> dummy;
-            find_keyvalue_location_for_write(txn,
-                                             super_block,
-                                             sindex_key.btree_key(),
-                                             &kv_location,
-                                             &sindex->btree->root_eviction_priority,
-                                             &sindex->btree->stats,
-                                             &dummy);
-
-            kv_location_set(&kv_location, sindex_key,
-                            modification->info.added, sindex->btree,
-                            repli_timestamp_t::distant_past, txn);
+            std::vector<store_key_t> added_keys;
+            compute_sindex_keys(&mapping, multi, &env,
+                                make_counted<ql::datum_t>(modification->info.added, &env),
+                                modification->primary_key, &added_keys);
+
+            boost::shared_ptr<scoped_cJSON_t> stored = projection
+                ? project_row(modification->info.added, *projection)
+                : modification->info.added;
+
+            for (auto it = added_keys.begin(); it != added_keys.end(); ++it) {
+                promise_t<superblock_t *> return_superblock_local;
+                {
+                    keyvalue_location_t<rdb_value_t> kv_location;
+
+                    find_keyvalue_location_for_write(txn,
+                                                     super_block,
+                                                     it->btree_key(),
+                                                     &kv_location,
+                                                     &sindex->btree->root_eviction_priority,
+                                                     &sindex->btree->stats,
+                                                     &return_superblock_local);
+
+                    kv_location_set(&kv_location, *it,
+                                    stored, sindex->btree,
+                                    repli_timestamp_t::distant_past, txn);
+                }
+                super_block = return_superblock_local.wait();
+            }
         } catch (const ql::base_exc_t &) {
             // Do nothing (we just drop the row from the index).
         }
     }
 }
 
-void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
+void rdb_update_sindexes_internal(const sindex_access_vector_t &sindexes,
         const rdb_modification_report_t *modification,
-        transaction_t *txn) {
+        transaction_t *txn,
+        bool post_construction) {
     auto_drainer_t drainer;
 
     for (sindex_access_vector_t::const_iterator it  = sindexes.begin();
                                                 it != sindexes.end();
                                                 ++it) {
+        if (it->sindex.is_ready_for_key(modification->primary_key) == post_construction) {
+            continue;
+        }
         coro_t::spawn_sometime(boost::bind(
                     &rdb_update_single_sindex, &*it,
                     modification, txn, auto_drainer_t::lock_t(&drainer)));
     }
 }
 
+void rdb_update_sindexes(const sindex_access_vector_t &sindexes,
+        const rdb_modification_report_t *modification,
+        transaction_t *txn) {
+    rdb_update_sindexes_internal(sindexes, modification, txn, false);
+}
+
+void rdb_post_construct_sindexes(const sindex_access_vector_t &sindexes,
+        const rdb_modification_report_t *modification,
+        transaction_t *txn) {
+    rdb_update_sindexes_internal(sindexes, modification, txn, true);
+}
+
 void rdb_erase_range_sindexes(const sindex_access_vector_t &sindexes,
         const rdb_erase_range_report_t *erase_range,
         transaction_t *txn, signal_t *interruptor) {
     auto_drainer_t drainer;
 
     spawn_sindex_erase_ranges(&sindexes, erase_range->range_to_erase,
-            txn, &drainer, auto_drainer_t::lock_t(&drainer), 
-            false, /* don't release the superblock */ interruptor);
+            txn, &drainer, auto_drainer_t::lock_t(&drainer),
+            false, /* don't release the superblock */
+            true, /* post construction */ interruptor);
 }
 
 class post_construct_traversal_helper_t : public btree_traversal_helper_t {
@@ -1041,11 +1364,13 @@ public:
     post_construct_traversal_helper_t(
             btree_store_t<rdb_protocol_t> *store,
             const std::set<uuid_u> &sindexes_to_post_construct,
+            const key_range_t &chunk,
             cond_t *interrupt_myself,
             signal_t *interruptor
             )
         : store_(store),
           sindexes_to_post_construct_(sindexes_to_post_construct),
+          chunk_(chunk),
           interrupt_myself_(interrupt_myself), interruptor_(interruptor)
     { }
 
@@ -1061,8 +1386,8 @@ public:
             scoped_ptr_t<real_superblock_t> superblock;
 
             // We want soft durability because having a partially constructed secondary index is
-            // okay -- we wipe it and rebuild it, if it has not been marked completely
-            // constructed.
+            // okay -- we wipe whatever lies past its checkpoint and rebuild that part, if it has
+            // not been marked completely constructed.
             store_->acquire_superblock_for_write(
                 rwi_write,
                 repli_timestamp_t::distant_past,
@@ -1106,11 +1431,14 @@ public:
             node_iter.step(leaf_node);
 
             store_key_t pk(key);
+            if (!chunk_.contains_key(pk)) {
+                continue;
+            }
             rdb_modification_report_t mod_report(pk);
             const rdb_value_t *rdb_value = static_cast<const rdb_value_t *>(value);
             mod_report.info.added = get_data(rdb_value, txn);
 
-            rdb_update_sindexes(sindexes, &mod_report, wtxn.get());
+            rdb_post_construct_sindexes(sindexes, &mod_report, wtxn.get());
         }
     }
 
@@ -1118,7 +1446,12 @@ public:
 
     void filter_interesting_children(UNUSED transaction_t *txn, ranged_block_ids_t *ids_source, interesting_children_callback_t *cb) {
         for (int i = 0, e = ids_source->num_block_ids(); i < e; ++i) {
-            cb->receive_interesting_child(i);
+            block_id_t block_id;
+            const btree_key_t *left_excl, *right_incl;
+            ids_source->get_block_id_and_bounding_interval(i, &block_id, &left_excl, &right_incl);
+            if (overlaps_chunk(left_excl, right_incl)) {
+                cb->receive_interesting_child(i);
+            }
         }
         cb->no_more_interesting_children();
     }
@@ -1126,8 +1459,16 @@ public:
     access_t btree_superblock_mode() { return rwi_read; }
     access_t btree_node_mode() { return rwi_read; }
 
+private:
+    // Checks if (left_excl, right_incl] intersects `chunk_`.
+    bool overlaps_chunk(const btree_key_t *left_excl, const btree_key_t *right_incl) const {
+        return (right_incl == NULL || sized_strcmp(right_incl->contents, right_incl->size, chunk_.left.contents(), chunk_.left.size()) >= 0)
+            && (left_excl == NULL || chunk_.right.unbounded || sized_strcmp(left_excl->contents, left_excl->size, chunk_.right.key.contents(), chunk_.right.key.size()) < 0);
+    }
+
     btree_store_t<rdb_protocol_t> *store_;
     const std::set<uuid_u> &sindexes_to_post_construct_;
+    const key_range_t chunk_;
     cond_t *interrupt_myself_;
     signal_t *interruptor_;
 };
@@ -1135,6 +1476,7 @@ public:
 void post_construct_secondary_indexes(
         btree_store_t<rdb_protocol_t> *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
+        const key_range_t &chunk,
         signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t) {
     cond_t local_interruptor;
@@ -1142,7 +1484,7 @@ void post_construct_secondary_indexes(
     wait_any_t wait_any(&local_interruptor, interruptor);
 
     post_construct_traversal_helper_t helper(store,
-            sindexes_to_post_construct, &local_interruptor, interruptor);
+            sindexes_to_post_construct, chunk, &local_interruptor, interruptor);
 
     object_buffer_t<fifo_enforcer_sink_t::exit_read_t> read_token;
     store->new_read_token(&read_token);
@@ -1161,3 +1503,85 @@ void post_construct_secondary_indexes(
     btree_parallel_traversal(txn.get(), superblock.get(),
             store->btree.get(), &helper, &wait_any);
 }
+
+/* Reads the btree's key distribution, sorted, along with the number of keys in
+ * it. */
+void get_sorted_key_distribution(btree_slice_t *slice, transaction_t *txn,
+                                 superblock_t *superblock, int64_t *key_count_out,
+                                 std::vector<store_key_t> *key_splits_out) {
+    get_btree_key_distribution(slice, txn, superblock,
+                               RDB_SINDEX_POST_CONSTRUCTION_DEPTH,
+                               key_count_out, key_splits_out);
+    std::sort(key_splits_out->begin(), key_splits_out->end());
+}
+
+void get_post_construction_chunks(
+        btree_store_t<rdb_protocol_t> *store,
+        const store_key_t &start,
+        int64_t chunk_keys,
+        std::vector<key_range_t> *chunks_out,
+        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    object_buffer_t<fifo_enforcer_sink_t::exit_read_t> read_token;
+    store->new_read_token(&read_token);
+
+    scoped_ptr_t<transaction_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_read(
+        rwi_read,
+        &read_token,
+        &txn,
+        &superblock,
+        interruptor,
+        true /* USE_SNAPSHOT */);
+
+    int64_t key_count;
+    std::vector<store_key_t> key_splits;
+    get_sorted_key_distribution(store->btree.get(), txn.get(), superblock.get(),
+                                &key_count, &key_splits);
+
+    /* Each split starts a bucket of about `keys_per_bucket` keys, so we cut a
+     * chunk every `stride` splits. */
+    int64_t keys_per_bucket = std::max<int64_t>(key_count / (key_splits.size() + 1), 1);
+    size_t stride = std::max<int64_t>(chunk_keys / keys_per_bucket, 1);
+
+    store_key_t left = start;
+    size_t since_last_cut = 0;
+    for (auto it = key_splits.begin(); it != key_splits.end(); ++it) {
+        if (*it <= left || ++since_last_cut < stride) {
+            continue;
+        }
+        chunks_out->push_back(key_range_t(key_range_t::closed, left,
+                                          key_range_t::open, *it));
+        left = *it;
+        since_last_cut = 0;
+    }
+    chunks_out->push_back(key_range_t(key_range_t::closed, left,
+                                      key_range_t::none, store_key_t()));
+}
+
+void get_post_construction_progress(
+        btree_slice_t *slice,
+        transaction_t *txn,
+        superblock_t *superblock,
+        const std::map<std::string, secondary_index_t> &sindexes,
+        std::map<std::string, std::pair<int64_t, int64_t> > *progress_out) {
+    int64_t key_count;
+    std::vector<store_key_t> key_splits;
+    get_sorted_key_distribution(slice, txn, superblock, &key_count, &key_splits);
+
+    int64_t keys_per_bucket = std::max<int64_t>(key_count / (key_splits.size() + 1), 1);
+    for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+        if (it->second.post_construction_complete) {
+            continue;
+        }
+        const store_key_t &progress = it->second.post_construction_progress;
+        int64_t buckets_done = 0;
+        if (progress != store_key_t::min()) {
+            buckets_done = (std::upper_bound(key_splits.begin(), key_splits.end(), progress)
+                            - key_splits.begin());
+        }
+        (*progress_out)[it->first] =
+            std::make_pair(std::min(buckets_done * keys_per_bucket, key_count), key_count);
+    }
+}
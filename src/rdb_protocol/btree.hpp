@@ -2,6 +2,7 @@
 #ifndef RDB_PROTOCOL_BTREE_HPP_
 #define RDB_PROTOCOL_BTREE_HPP_
 
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,8 +44,6 @@ typedef rdb_protocol_t::point_delete_response_t point_delete_response_t;
 
 class parallel_traversal_progress_t;
 
-static const size_t rget_max_chunk_size = MEGABYTE;
-
 bool btree_value_fits(block_size_t bs, int data_length, const rdb_value_t *value);
 
 template <>
@@ -99,16 +98,21 @@ void rdb_batched_replace(const std::vector<std::pair<int64_t, point_replace_t> >
                          batched_replaces_response_t *response_out,
                          rdb_modification_report_cb_t *sindex_cb);
 
+/* If `pass_back_superblock` isn't NULL, the superblock is handed back through it instead
+of being released, so that the caller can go on to write other keys in the same
+transaction. */
 void rdb_set(const store_key_t &key, boost::shared_ptr<scoped_cJSON_t> data, bool overwrite,
              btree_slice_t *slice, repli_timestamp_t timestamp,
              transaction_t *txn, superblock_t *superblock, point_write_response_t *response,
-             rdb_modification_info_t *mod_info);
+             rdb_modification_info_t *mod_info,
+             promise_t<superblock_t *> *pass_back_superblock = NULL);
 
 class rdb_backfill_callback_t {
 public:
     virtual void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_deletion(const btree_key_t *key, repli_timestamp_t recency, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
-    virtual void on_keyvalue(const rdb_protocol_details::backfill_atom_t& atom, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    // Gets all the pairs from one leaf at once, sorted by key.
+    virtual void on_keyvalues(const std::vector<rdb_protocol_details::backfill_atom_t> &atoms, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
 protected:
     virtual ~rdb_backfill_callback_t() { }
@@ -140,7 +144,6 @@ void rdb_erase_range(btree_slice_t *slice, key_tester_t *tester,
                      signal_t *interruptor);
 
 /* RGETS */
-size_t estimate_rget_response_size(const boost::shared_ptr<scoped_cJSON_t> &json);
 
 struct rget_response_t {
     std::vector<std::pair<store_key_t, boost::shared_ptr<scoped_cJSON_t> > > pairs;
@@ -152,14 +155,28 @@ void rdb_rget_slice(btree_slice_t *slice, const key_range_t &range,
                     ql::env_t *ql_env,
                     const rdb_protocol_details::transform_t &transform,
                     const boost::optional<rdb_protocol_details::terminal_t> &terminal,
+                    size_t max_chunk_bytes,
                     rget_read_response_t *response);
 
+/* If `primary_superblock` isn't NULL, each row is looked up in the primary
+ * btree `primary_slice` instead of being taken from the sindex. The caller
+ * keeps ownership of `primary_superblock`.
+ *
+ * If `multi_sindex_mapping` isn't NULL, the sindex is a multi index with that
+ * mapping. A row is then returned once, for its first element between
+ * `sindex_start_value` and `sindex_end_value`, rather than once for each. */
 void rdb_rget_secondary_slice(btree_slice_t *slice, const key_range_t &range,
                     transaction_t *txn, superblock_t *superblock,
                     ql::env_t *ql_env,
                     const rdb_protocol_details::transform_t &transform,
                     const boost::optional<rdb_protocol_details::terminal_t> &terminal,
                     const key_range_t &pk_range,
+                    btree_slice_t *primary_slice,
+                    superblock_t *primary_superblock,
+                    ql::map_wire_func_t *multi_sindex_mapping,
+                    counted_t<const ql::datum_t> sindex_start_value,
+                    counted_t<const ql::datum_t> sindex_end_value,
+                    size_t max_chunk_bytes,
                     rget_read_response_t *response);
 
 void rdb_distribution_get(btree_slice_t *slice, int max_depth, const store_key_t &left_key,
@@ -233,21 +250,71 @@ private:
     btree_store_t<rdb_protocol_t>::sindex_access_vector_t sindexes_;
 };
 
+/* A sindex's opaque definition is its mapping followed by whether it's a multi
+ * index and, for a slim index, the fields of each row it stores. */
+void serialize_sindex_info(write_message_t *wm,
+                           const ql::map_wire_func_t &mapping,
+                           sindex_multi_bool_t multi,
+                           const boost::optional<std::vector<std::string> > &projection);
+void deserialize_sindex_info(const std::vector<char> &data,
+                             ql::map_wire_func_t *mapping,
+                             sindex_multi_bool_t *multi,
+                             boost::optional<std::vector<std::string> > *projection);
+
+/* Whether a read through a slim sindex can make do with the fields the sindex
+ * stores, or has to look each row up in the primary btree. */
+bool sindex_projection_covers(const std::vector<std::string> &projection,
+                              const ql::map_wire_func_t &mapping,
+                              const rdb_protocol_details::transform_t &transform,
+                              const boost::optional<rdb_protocol_details::terminal_t> &terminal);
+
+/* Applies a modification to the sindexes which have already post constructed
+ * its primary key. */
 void rdb_update_sindexes(
         const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
         const rdb_modification_report_t *modification,
         transaction_t *txn);
 
+/* Applies a modification to the sindexes which have yet to post construct its
+ * primary key. */
+void rdb_post_construct_sindexes(
+        const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
+        const rdb_modification_report_t *modification,
+        transaction_t *txn);
+
+/* Erases the part of the range which the sindexes have yet to post construct. */
 void rdb_erase_range_sindexes(
         const btree_store_t<rdb_protocol_t>::sindex_access_vector_t &sindexes,
         const rdb_erase_range_report_t *erase_range,
         transaction_t *txn,
         signal_t *interruptor);
 
+/* Indexes the rows of the primary btree which fall in `chunk`. */
 void post_construct_secondary_indexes(
         btree_store_t<rdb_protocol_t> *store,
         const std::set<uuid_u> &sindexes_to_post_construct,
+        const key_range_t &chunk,
         signal_t *interruptor)
     THROWS_ONLY(interrupted_exc_t);
 
+/* Splits the primary btree from `start` onwards into the chunks of about
+ * `chunk_keys` keys that post construction should work through. The last chunk
+ * is unbounded. */
+void get_post_construction_chunks(
+        btree_store_t<rdb_protocol_t> *store,
+        const store_key_t &start,
+        int64_t chunk_keys,
+        std::vector<key_range_t> *chunks_out,
+        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t);
+
+/* Estimates, for each sindex still being post constructed, how many of the
+ * primary btree's keys it has indexed and how many there are in total. */
+void get_post_construction_progress(
+        btree_slice_t *slice,
+        transaction_t *txn,
+        superblock_t *superblock,
+        const std::map<std::string, secondary_index_t> &sindexes,
+        std::map<std::string, std::pair<int64_t, int64_t> > *progress_out);
+
 #endif /* RDB_PROTOCOL_BTREE_HPP_ */
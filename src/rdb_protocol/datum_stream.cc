@@ -112,7 +112,7 @@ lazy_datum_stream_t::lazy_datum_stream_t(
     : datum_stream_t(env, bt_src),
       json_stream(new query_language::batched_rget_stream_t(
                       *ns_access, env->interruptor, counted_t<datum_t>(), counted_t<datum_t>(),
-                      env->get_all_optargs(), use_outdated))
+                      env->get_all_optargs(), use_outdated, false))
 { }
 
 lazy_datum_stream_t::lazy_datum_stream_t(
@@ -122,7 +122,7 @@ lazy_datum_stream_t::lazy_datum_stream_t(
     : datum_stream_t(env, bt_src),
       json_stream(new query_language::batched_rget_stream_t(
                       *ns_access, env->interruptor, left_bound, right_bound,
-                      env->get_all_optargs(), use_outdated))
+                      env->get_all_optargs(), use_outdated, true))
 { }
 
 lazy_datum_stream_t::lazy_datum_stream_t(
@@ -346,4 +346,20 @@ counted_t<const datum_t> union_datum_stream_t::next_impl() {
     return counted_t<const datum_t>();
 }
 
+counted_t<const datum_t> intersect_datum_stream_t::next_impl() {
+    if (!read_keys) {
+        while (counted_t<const datum_t> row = keys->next()) {
+            primary_keys.insert(row->get(pkey)->print_primary());
+        }
+        keys.reset();
+        read_keys = true;
+    }
+    while (counted_t<const datum_t> row = source->next()) {
+        if (primary_keys.count(row->get(pkey)->print_primary()) == 1) {
+            return row;
+        }
+    }
+    return counted_t<const datum_t>();
+}
+
 } // namespace ql
@@ -2,6 +2,8 @@
 #define RDB_PROTOCOL_DATUM_STREAM_HPP_
 
 #include <algorithm>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "rdb_protocol/stream.hpp"
@@ -284,6 +286,26 @@ private:
     size_t streams_index;
 };
 
+// The rows of `source` whose primary keys are also those of rows in `keys`.
+// `between` and `get_all` use this to intersect a selection with the rows of
+// their own (usually secondary index) scan. `keys` is read in full first.
+class intersect_datum_stream_t : public eager_datum_stream_t {
+public:
+    intersect_datum_stream_t(env_t *env, counted_t<datum_stream_t> _source,
+                             counted_t<datum_stream_t> _keys, const std::string &_pkey,
+                             const protob_t<const Backtrace> &bt_src)
+        : eager_datum_stream_t(env, bt_src), source(_source), keys(_keys),
+          pkey(_pkey), read_keys(false) { }
+private:
+    counted_t<const datum_t> next_impl();
+
+    counted_t<datum_stream_t> source;
+    counted_t<datum_stream_t> keys;
+    std::string pkey;
+    bool read_keys;
+    std::set<std::string> primary_keys;
+};
+
 } // namespace ql
 
 #endif // RDB_PROTOCOL_DATUM_STREAM_HPP_
@@ -4,10 +4,18 @@
 #include <stdexcept>
 
 #include "utils.hpp"
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
 
+#include "arch/runtime/thread_pool.hpp"
+
 namespace rdb_protocol {
 
+// Parsing a big document is pure CPU work, so it can run on whichever thread has time.
+void parse_json_body(const std::string *body, cJSON **out) {
+    *out = cJSON_Parse(body->c_str());
+}
+
 query_http_app_t::query_http_app_t(const boost::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> > &_semilattice_metadata,
                                    namespace_repo_t<rdb_protocol_t> * _ns_repo)
     : semilattice_metadata(_semilattice_metadata), ns_repo(_ns_repo)
@@ -102,7 +110,9 @@ http_res_t query_http_app_t::handle(const http_req_t &req) {
 
                 store_key_t key(*it);
 
-                boost::shared_ptr<scoped_cJSON_t> doc(new scoped_cJSON_t(cJSON_Parse(req.body.c_str())));
+                cJSON *parsed;
+                thread_pool_t::run_thread_agnostic(boost::bind(&parse_json_body, &req.body, &parsed));
+                boost::shared_ptr<scoped_cJSON_t> doc(new scoped_cJSON_t(parsed));
 
                 if (!doc->get()) {
                     return http_res_t(HTTP_BAD_REQUEST, "text/plain", "Json failed to parse");
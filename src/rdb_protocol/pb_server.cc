@@ -44,6 +44,13 @@ bool query2_server_t::handle(ql::protob_t<Query> q,
     guarantee(interruptor);
     response_out->set_token(q->token());
 
+    boost::shared_ptr<mutex_t> &token_mutex_slot = query2_context->token_mutexes[q->token()];
+    if (!token_mutex_slot) {
+        token_mutex_slot = boost::make_shared<mutex_t>();
+    }
+    boost::shared_ptr<mutex_t> token_mutex = token_mutex_slot;
+    mutex_t::acq_t token_acq(token_mutex.get());
+
     bool response_needed = true;
     try {
         boost::shared_ptr<js::runner_t> js_runner = boost::make_shared<js::runner_t>();
@@ -67,6 +74,12 @@ bool query2_server_t::handle(ql::protob_t<Query> q,
                        strprintf("Unexpected exception: %s\n", e.what()));
     }
 
+    token_acq.reset();
+    if (token_mutex.use_count() == 2) {
+        // Nobody else is waiting on this token.
+        query2_context->token_mutexes.erase(q->token());
+    }
+
     return response_needed;
 }
 
@@ -9,6 +9,7 @@
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/namespace_interface_repository.hpp"
 #include "clustering/administration/namespace_metadata.hpp"
+#include "concurrency/mutex.hpp"
 #include "protob/protob.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -32,8 +33,13 @@ public:
     struct context_t {
         context_t() : interruptor(0) { }
         static const int32_t magic_number = VersionDummy::V0_1;
+        static const int32_t unordered_magic_number = VersionDummy::V0_1_UNORDERED;
         ql::stream_cache2_t stream_cache2;
         signal_t *interruptor;
+        /* On an unordered connection, queries with different tokens run at the
+        same time, but a stream's START, CONTINUEs and STOP have to take turns.
+        Each token that has a query running has a mutex in here. */
+        std::map<int64_t, boost::shared_ptr<mutex_t> > token_mutexes;
     };
 private:
     MUST_USE bool handle(ql::protob_t<Query> q,
@@ -101,6 +101,7 @@ void post_construct_and_drain_queue(
         const std::set<uuid_u> &sindexes_to_bring_up_to_date,
         btree_store_t<rdb_protocol_t> *store,
         boost::shared_ptr<internal_disk_backed_queue_t> mod_queue,
+        int64_t chunk_keys,
         auto_drainer_t::lock_t lock)
     THROWS_NOTHING;
 /* Creates a queue of operations for the sindex, runs a post construction for
@@ -109,7 +110,8 @@ void bring_sindexes_up_to_date(
         const std::set<std::string> &sindexes_to_bring_up_to_date,
         btree_store_t<rdb_protocol_t> *store,
         buf_lock_t *sindex_block,
-        transaction_t *txn)
+        transaction_t *txn,
+        int64_t chunk_keys)
     THROWS_NOTHING
 {
     /* We register our modification queue here. An important point about
@@ -147,88 +149,160 @@ void bring_sindexes_up_to_date(
                 sindexes_to_bring_up_to_date_uuid,
                 store,
                 mod_queue,
+                chunk_keys,
                 auto_drainer_t::lock_t(&store->drainer)));
 }
 
+/* Applies the changes from the mod queue which post construction of the chunks
+ * up to and including `chunk` is responsible for. Changes to keys past it will
+ * be seen by the traversal of the chunk they fall in, since that only starts
+ * once this chunk has been checkpointed. */
 class apply_sindex_change_visitor_t : public boost::static_visitor<> {
 public:
     apply_sindex_change_visitor_t(const sindex_access_vector_t *sindexes,
+            const key_range_t &chunk,
             transaction_t *txn,
             signal_t *interruptor)
-        : sindexes_(sindexes), txn_(txn), interruptor_(interruptor) { }
+        : sindexes_(sindexes), txn_(txn), interruptor_(interruptor) {
+        constructed_range_.left = store_key_t::min();
+        constructed_range_.right = chunk.right;
+    }
     void operator()(const rdb_modification_report_t &mod_report) const {
-        rdb_update_sindexes(*sindexes_, &mod_report, txn_);
+        if (constructed_range_.contains_key(mod_report.primary_key)) {
+            rdb_post_construct_sindexes(*sindexes_, &mod_report, txn_);
+        }
     }
 
     void operator()(const rdb_erase_range_report_t &erase_range_report) const {
-        rdb_erase_range_sindexes(*sindexes_, &erase_range_report, txn_, interruptor_);
+        rdb_erase_range_report_t clipped(
+            erase_range_report.range_to_erase.intersection(constructed_range_));
+        if (!clipped.range_to_erase.is_empty()) {
+            rdb_erase_range_sindexes(*sindexes_, &clipped, txn_, interruptor_);
+        }
     }
 
 private:
     const sindex_access_vector_t *sindexes_;
+    key_range_t constructed_range_;
     transaction_t *txn_;
     signal_t *interruptor_;
 };
 
+/* Takes the sindexes which are being post constructed from a fresh write
+ * transaction. Returns false if they've all been dropped. */
+bool acquire_post_construction_sindexes(
+        const std::set<uuid_u> &sindexes_to_bring_up_to_date,
+        btree_store_t<rdb_protocol_t> *store,
+        write_token_pair_t *token_pair,
+        scoped_ptr_t<transaction_t> *txn_out,
+        scoped_ptr_t<buf_lock_t> *sindex_block_out,
+        sindex_access_vector_t *sindexes_out,
+        signal_t *interruptor)
+    THROWS_ONLY(interrupted_exc_t) {
+    store->new_write_token_pair(token_pair);
+
+    scoped_ptr_t<real_superblock_t> superblock;
+
+    // We don't need hard durability here, because a secondary index just
+    // gets rebuilt from its last checkpoint if the server dies while it's
+    // partially constructed.
+    store->acquire_superblock_for_write(
+        rwi_write,
+        repli_timestamp_t::distant_past,
+        2,
+        WRITE_DURABILITY_SOFT,
+        token_pair,
+        txn_out,
+        &superblock,
+        interruptor);
+
+    store->acquire_sindex_block_for_write(
+        token_pair,
+        txn_out->get(),
+        sindex_block_out,
+        superblock->get_sindex_block_id(),
+        interruptor);
+
+    store->acquire_sindex_superblocks_for_write(
+            sindexes_to_bring_up_to_date,
+            sindex_block_out->get(),
+            txn_out->get(),
+            sindexes_out);
+
+    return !sindexes_out->empty();
+}
+
 /* This function is really part of the logic of bring_sindexes_up_to_date
  * however it needs to be in a seperate function so that it can be spawned in a
- * coro. */
+ * coro.
+ *
+ * Post construction works through the primary btree one chunk at a time. After
+ * each chunk it drains the mod queue and checkpoints the sindexes' progress, so
+ * from then on writes to the chunk go straight to the sindexes and a restart
+ * picks up where we left off. Every write still goes through the queue, so it
+ * holds whatever was written anywhere in the table while the last chunk was
+ * being traversed; nothing bounds how much that is. */
 void post_construct_and_drain_queue(
         const std::set<uuid_u> &sindexes_to_bring_up_to_date,
         btree_store_t<rdb_protocol_t> *store,
         boost::shared_ptr<internal_disk_backed_queue_t> mod_queue,
+        int64_t chunk_keys,
         auto_drainer_t::lock_t lock)
     THROWS_NOTHING
 {
     try {
-        post_construct_secondary_indexes(store, sindexes_to_bring_up_to_date, lock.get_drain_signal());
+        store_key_t start = store_key_t::max();
+        bool sindexes_exist;
+        {
+            /* Anything past a sindex's checkpoint was put there by a post
+             * construction that didn't finish, and may be stale. Wipe it and
+             * start from the earliest checkpoint. */
+            write_token_pair_t token_pair;
+            scoped_ptr_t<transaction_t> txn;
+            scoped_ptr_t<buf_lock_t> sindex_block;
+            sindex_access_vector_t sindexes;
+            sindexes_exist = acquire_post_construction_sindexes(
+                    sindexes_to_bring_up_to_date, store, &token_pair, &txn,
+                    &sindex_block, &sindexes, lock.get_drain_signal());
 
-        /* Drain the queue. */
+            for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+                if (it->sindex.post_construction_progress < start) {
+                    start = it->sindex.post_construction_progress;
+                }
+            }
 
-        int previous_size = mod_queue->size();
-        while (!lock.get_drain_signal()->is_pulsed()) {
-            write_token_pair_t token_pair;
-            store->new_write_token_pair(&token_pair);
+            rdb_erase_range_report_t wipe(key_range_t::universe());
+            rdb_erase_range_sindexes(sindexes, &wipe, txn.get(), lock.get_drain_signal());
+        }
 
-            scoped_ptr_t<transaction_t> queue_txn;
-            scoped_ptr_t<real_superblock_t> queue_superblock;
-
-            // We don't need hard durability here, because a secondary index just gets rebuilt
-            // if the server dies while it's partially constructed.
-            store->acquire_superblock_for_write(
-                rwi_write,
-                repli_timestamp_t::distant_past,
-                2,
-                WRITE_DURABILITY_SOFT,
-                &token_pair,
-                &queue_txn,
-                &queue_superblock,
-                lock.get_drain_signal());
+        std::vector<key_range_t> chunks;
+        if (sindexes_exist) {
+            get_post_construction_chunks(store, start, chunk_keys, &chunks,
+                                         lock.get_drain_signal());
+        }
 
-            scoped_ptr_t<buf_lock_t> queue_sindex_block;
-            store->acquire_sindex_block_for_write(
-                &token_pair,
-                queue_txn.get(),
-                &queue_sindex_block,
-                queue_superblock->get_sindex_block_id(),
-                lock.get_drain_signal());
+        for (auto chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+            post_construct_secondary_indexes(store, sindexes_to_bring_up_to_date,
+                                             *chunk, lock.get_drain_signal());
 
+            /* Checkpoint. Holding the sindex block keeps writes out while we
+             * drain the queue and move the checkpoint past the chunk. */
+            write_token_pair_t token_pair;
+            scoped_ptr_t<transaction_t> queue_txn;
+            scoped_ptr_t<buf_lock_t> queue_sindex_block;
             sindex_access_vector_t sindexes;
-            store->acquire_sindex_superblocks_for_write(
-                    sindexes_to_bring_up_to_date,
-                    queue_sindex_block.get(),
-                    queue_txn.get(),
-                    &sindexes);
-
-            if (sindexes.empty()) {
+            if (!acquire_post_construction_sindexes(
+                    sindexes_to_bring_up_to_date, store, &token_pair, &queue_txn,
+                    &queue_sindex_block, &sindexes, lock.get_drain_signal())) {
                 break;
             }
 
             mutex_t::acq_t acq;
             store->lock_sindex_queue(queue_sindex_block.get(), &acq);
 
-            while (mod_queue->size() >= previous_size &&
-                   mod_queue->size() > 0) {
+            apply_sindex_change_visitor_t visitor(&sindexes, *chunk, queue_txn.get(),
+                                                  lock.get_drain_signal());
+            while (mod_queue->size() > 0) {
                 std::vector<char> data_vec;
                 mod_queue->pop(&data_vec);
                 vector_read_stream_t read_stream(&data_vec);
@@ -237,13 +311,10 @@ void post_construct_and_drain_queue(
                 int ser_res = deserialize(&read_stream, &sindex_change);
                 guarantee_err(ser_res == 0, "corruption in disk-backed queue");
 
-                boost::apply_visitor(apply_sindex_change_visitor_t(&sindexes, queue_txn.get(), lock.get_drain_signal()),
-                                     sindex_change);
+                boost::apply_visitor(visitor, sindex_change);
             }
 
-            previous_size = mod_queue->size();
-
-            if (mod_queue->size() == 0) {
+            if (chunk->right.unbounded) {
                 for (auto it = sindexes_to_bring_up_to_date.begin();
                      it != sindexes_to_bring_up_to_date.end(); ++it) {
                     store->mark_index_up_to_date(*it, queue_txn.get(), queue_sindex_block.get());
@@ -251,10 +322,19 @@ void post_construct_and_drain_queue(
                 store->deregister_sindex_queue(mod_queue.get(), &acq);
                 return;
             }
+
+            for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+                if (it->sindex.post_construction_progress < chunk->right.key) {
+                    store->mark_index_post_construction_progress(
+                        it->sindex.id, chunk->right.key,
+                        queue_txn.get(), queue_sindex_block.get());
+                }
+            }
         }
     } catch (const interrupted_exc_t &) {
         // We were interrupted so we just exit. Sindex post construct is in an
-        // indeterminate state and will be cleaned up at a later point.
+        // indeterminate state past its last checkpoint and will be cleaned up
+        // at a later point.
     }
 
     if (lock.get_drain_signal()->is_pulsed()) {
@@ -295,7 +375,6 @@ void post_construct_and_drain_queue(
     }
 }
 
-
 bool range_key_tester_t::key_should_be_erased(const btree_key_t *key) {
     uint64_t h = hash_region_hasher(key->contents, key->size);
     return delete_range->beg <= h && h < delete_range->end
@@ -375,12 +454,6 @@ key_range_t rdb_protocol_t::sindex_key_range(const store_key_t &start,
     return key_range_t(key_range_t::closed, start, key_range_t::open, end_key);
 }
 
-// Returns the key identifying the monokey region used for sindex_list_t
-// operations.
-store_key_t sindex_list_region_key() {
-    return store_key_t();
-}
-
 /* read_t::get_region implementation */
 struct rdb_r_get_region_visitor : public boost::static_visitor<region_t> {
     region_t operator()(const point_read_t &pr) const {
@@ -395,8 +468,8 @@ struct rdb_r_get_region_visitor : public boost::static_visitor<region_t> {
         return dg.region;
     }
 
-    region_t operator()(UNUSED const sindex_list_t &sl) const {
-        return rdb_protocol_t::monokey_region(sindex_list_region_key());
+    region_t operator()(const sindex_list_t &sl) const {
+        return sl.region;
     }
 };
 
@@ -447,7 +520,7 @@ struct rdb_r_shard_visitor_t : public boost::static_visitor<bool> {
     }
 
     bool operator()(const sindex_list_t &sl) const {
-        return keyed_read(sl, sindex_list_region_key());
+        return rangey_read(sl);
     }
 
     const hash_region_t<key_range_t> *region;
@@ -740,9 +813,24 @@ public:
     }
 
     void operator()(UNUSED const sindex_list_t &sl) {
-        guarantee(count == 1);
-        guarantee(boost::get<sindex_list_response_t>(&responses[0].response));
-        *response_out = responses[0];
+        // Every shard has the same sindexes, but each knows only how far post
+        // construction has got through its own keys.
+        sindex_list_response_t res;
+        for (size_t i = 0; i < count; ++i) {
+            const sindex_list_response_t *result =
+                boost::get<sindex_list_response_t>(&responses[i].response);
+            guarantee(result);
+            if (i == 0) {
+                res.sindexes = result->sindexes;
+            }
+            for (auto it = result->post_construction_progress.begin();
+                 it != result->post_construction_progress.end(); ++it) {
+                std::pair<int64_t, int64_t> *progress = &res.post_construction_progress[it->first];
+                progress->first += it->second.first;
+                progress->second += it->second.second;
+            }
+        }
+        response_out->response = res;
     }
 
 private:
@@ -1023,6 +1111,33 @@ store_t::~store_t() {
     assert_thread();
 }
 
+/* Sets `arg` to check that the variable `var` lies between the rget's
+ * sindex_start_value and sindex_end_value. */
+void add_sindex_range_check(Term *arg, int var, const rget_read_t &rget) {
+    N2(ALL,
+       if (rget.sindex_start_value) {
+           N2(GE, NVAR(var),
+              *ql::pb::set_datum(arg) = rget.sindex_start_value->get_datum());
+       } else {
+           NDATUM_BOOL(true);
+       },
+       if (rget.sindex_end_value) {
+           N2(LE, NVAR(var),
+              *ql::pb::set_datum(arg) = rget.sindex_end_value->get_datum());
+       } else {
+           NDATUM_BOOL(true);
+       });
+}
+
+counted_t<const ql::datum_t> compile_sindex_bound(
+        const boost::optional<ql::wire_datum_t> &bound, ql::env_t *env) {
+    if (!bound) {
+        return counted_t<const ql::datum_t>();
+    }
+    ql::wire_datum_t compiled(*bound);
+    return compiled.compile(env);
+}
+
 // TODO: get rid of this extra response_t copy on the stack
 struct rdb_read_visitor_t : public boost::static_visitor<void> {
     void operator()(const point_read_t &get) {
@@ -1042,7 +1157,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
 
         if (!rget.sindex) {
             //Normal rget
-            rdb_rget_slice(btree, rget.region.inner, txn, superblock, &ql_env, rget.transform, rget.terminal, res);
+            rdb_rget_slice(btree, rget.region.inner, txn, superblock, &ql_env, rget.transform, rget.terminal, rget.max_chunk_bytes, res);
         } else {
             scoped_ptr_t<real_superblock_t> sindex_sb;
             std::vector<char> sindex_mapping_data;
@@ -1073,48 +1188,54 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             //  that don't fall in the specified range.  Because the secondary index
             //  keys may have been truncated, we can't go by keys alone.  Therefore,
             //  we construct a filter function that ensures all returned items lie
-            //  between sindex_start_value and sindex_end_value.
+            //  between sindex_start_value and sindex_end_value.  A multi index
+            //  stores a row once per element, so there the traversal checks each
+            //  entry itself, and only keeps the one for the row's first element
+            //  in range.
             ql::map_wire_func_t sindex_mapping;
-            vector_read_stream_t read_stream(&sindex_mapping_data);
-            int success = deserialize(&read_stream, &sindex_mapping);
-            guarantee(success == ARCHIVE_SUCCESS, "Corrupted sindex description.");
-
-            Term filter_term;
-            int arg1 = ql_env.gensym();
-            int sindex_val = ql_env.gensym();
-            Term *arg = ql::pb::set_func(&filter_term, arg1);
-            N2(FUNCALL, arg = ql::pb::set_func(arg, sindex_val);
-               N2(ALL,
-                  if (rget.sindex_start_value) {
-                      N2(GE, NVAR(sindex_val),
-                         *ql::pb::set_datum(arg) =rget.sindex_start_value->get_datum());
-                  } else {
-                      NDATUM_BOOL(true);
-                  },
-                  if (rget.sindex_end_value) {
-                      N2(LE, NVAR(sindex_val),
-                         *ql::pb::set_datum(arg) = rget.sindex_end_value->get_datum());
-                  } else {
-                      NDATUM_BOOL(true);
-                  }),
-               N2(FUNCALL,
-                  *arg = sindex_mapping.get_term(),
-                  NVAR(arg1)));
-
-            Backtrace dummy_backtrace;
-            ql::propagate_backtrace(&filter_term, &dummy_backtrace);
-            ql::filter_wire_func_t sindex_filter(filter_term, std::map<int64_t, Datum>());
-
-            // We then add this new filter to the beginning of the transform stack
+            sindex_multi_bool_t sindex_multi;
+            boost::optional<std::vector<std::string> > sindex_projection;
+            deserialize_sindex_info(sindex_mapping_data, &sindex_mapping, &sindex_multi,
+                                    &sindex_projection);
+
+            // A slim sindex only stores part of each row, so unless that part
+            //  is all the query looks at we have to read the rows from the
+            //  primary btree.
+            bool read_primary = sindex_projection
+                && !sindex_projection_covers(*sindex_projection, sindex_mapping,
+                                             rget.transform, rget.terminal);
+
             rdb_protocol_details::transform_t sindex_transform(rget.transform);
-            sindex_transform.push_front(rdb_protocol_details::transform_atom_t(
-                                            sindex_filter, scopes_t(), backtrace_t()));
+            if (sindex_multi != MULTI) {
+                Term filter_term;
+                int arg1 = ql_env.gensym();
+                int sindex_val = ql_env.gensym();
+                Term *arg = ql::pb::set_func(&filter_term, arg1);
+                N2(FUNCALL, arg = ql::pb::set_func(arg, sindex_val);
+                   add_sindex_range_check(arg, sindex_val, rget),
+                   N2(FUNCALL,
+                      *arg = sindex_mapping.get_term(),
+                      NVAR(arg1)));
+
+                Backtrace dummy_backtrace;
+                ql::propagate_backtrace(&filter_term, &dummy_backtrace);
+                ql::filter_wire_func_t sindex_filter(filter_term, std::map<int64_t, Datum>());
+
+                // We then add this new filter to the beginning of the transform stack
+                sindex_transform.push_front(rdb_protocol_details::transform_atom_t(
+                                                sindex_filter, scopes_t(), backtrace_t()));
+            }
 
             rdb_rget_secondary_slice(
                     store->get_sindex_slice(*rget.sindex),
                     rget.sindex_region->inner,
                     txn, sindex_sb.get(), &ql_env, sindex_transform,
-                    rget.terminal, rget.region.inner, res);
+                    rget.terminal, rget.region.inner,
+                    btree, read_primary ? superblock : NULL,
+                    sindex_multi == MULTI ? &sindex_mapping : NULL,
+                    compile_sindex_bound(rget.sindex_start_value, &ql_env),
+                    compile_sindex_bound(rget.sindex_end_value, &ql_env),
+                    rget.max_chunk_bytes, res);
         }
     }
 
@@ -1148,8 +1269,15 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         store->get_sindexes(token_pair, txn, superblock, &sindexes, &interruptor);
 
         res->sindexes.reserve(sindexes.size());
+        bool post_constructing = false;
         for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
             res->sindexes.push_back(it->first);
+            post_constructing |= !it->second.post_construction_complete;
+        }
+
+        if (post_constructing) {
+            get_post_construction_progress(btree, txn, superblock, sindexes,
+                                           &res->post_construction_progress);
         }
     }
 
@@ -1255,7 +1383,7 @@ struct rdb_write_visitor_t : public boost::static_visitor<void> {
         sindex_create_response_t res;
 
         write_message_t wm;
-        wm << c.mapping;
+        serialize_sindex_info(&wm, c.mapping, c.multi, c.projection);
 
         vector_stream_t stream;
         int write_res = send_write_message(&stream, &wm);
@@ -1381,8 +1509,16 @@ struct rdb_backfill_chunk_get_btree_repli_timestamp_visitor_t : public boost::st
         return repli_timestamp_t::invalid;
     }
 
-    repli_timestamp_t operator()(const backfill_chunk_t::key_value_pair_t &kv) {
-        return kv.backfill_atom.recency;
+    repli_timestamp_t operator()(const backfill_chunk_t::key_value_pairs_t &kvs) {
+        repli_timestamp_t most_recent = repli_timestamp_t::invalid;
+        for (std::vector<rdb_backfill_atom_t>::const_iterator it = kvs.backfill_atoms.begin();
+             it != kvs.backfill_atoms.end();
+             ++it) {
+            if (most_recent == repli_timestamp_t::invalid || most_recent < it->recency) {
+                most_recent = it->recency;
+            }
+        }
+        return most_recent;
     }
 
     repli_timestamp_t operator()(const backfill_chunk_t::sindexes_t &) {
@@ -1395,6 +1531,14 @@ repli_timestamp_t backfill_chunk_t::get_btree_repli_timestamp() const THROWS_NOT
     return boost::apply_visitor(v, val);
 }
 
+size_t backfill_chunk_t::get_key_count() const THROWS_NOTHING {
+    if (const key_value_pairs_t *kvs = boost::get<key_value_pairs_t>(&val)) {
+        return kvs->backfill_atoms.size();
+    } else {
+        return 1;
+    }
+}
+
 struct rdb_backfill_callback_impl_t : public rdb_backfill_callback_t {
 public:
     typedef backfill_chunk_t chunk_t;
@@ -1411,8 +1555,8 @@ public:
         chunk_fun_cb->send_chunk(chunk_t::delete_key(to_store_key(key), recency), interruptor);
     }
 
-    void on_keyvalue(const rdb_backfill_atom_t &atom, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-        chunk_fun_cb->send_chunk(chunk_t::set_key(atom), interruptor);
+    void on_keyvalues(const std::vector<rdb_backfill_atom_t> &atoms, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        chunk_fun_cb->send_chunk(chunk_t::set_keys(atoms), interruptor);
     }
 
     void on_sindexes(const std::map<std::string, secondary_index_t> &sindexes, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
@@ -1480,11 +1624,11 @@ struct rdb_receive_backfill_visitor_t : public boost::static_visitor<void> {
 
     void operator()(const backfill_chunk_t::delete_key_t& delete_key) const {
         point_delete_response_t response;
-        rdb_modification_report_t mod_report(delete_key.key);
+        std::vector<rdb_modification_report_t> mod_reports(1, rdb_modification_report_t(delete_key.key));
         rdb_delete(delete_key.key, btree, delete_key.recency,
-                   txn, superblock, &response, &mod_report.info);
+                   txn, superblock, &response, &mod_reports[0].info);
 
-        update_sindexes(&mod_report);
+        update_sindexes(mod_reports);
     }
 
     void operator()(const backfill_chunk_t::delete_range_t& delete_range) const {
@@ -1493,16 +1637,30 @@ struct rdb_receive_backfill_visitor_t : public boost::static_visitor<void> {
                 store, token_pair, interruptor);
     }
 
-    void operator()(const backfill_chunk_t::key_value_pair_t& kv) const {
-        const rdb_backfill_atom_t& bf_atom = kv.backfill_atom;
-        point_write_response_t response;
-        rdb_modification_report_t mod_report(bf_atom.key);
-        rdb_set(bf_atom.key, bf_atom.value, true,
-                btree, bf_atom.recency,
-                txn, superblock, &response,
-                &mod_report.info);
+    void operator()(const backfill_chunk_t::key_value_pairs_t& kvs) const {
+        /* The whole run of pairs goes in with one transaction. We hang on to the
+        superblock from one key to the next instead of letting it go, and we only touch
+        the secondary indexes once, after all of them are in. */
+        std::vector<rdb_modification_report_t> mod_reports;
+        mod_reports.reserve(kvs.backfill_atoms.size());
+
+        superblock_t *current_superblock = superblock;
+        for (std::vector<rdb_backfill_atom_t>::const_iterator it = kvs.backfill_atoms.begin();
+             it != kvs.backfill_atoms.end();
+             ++it) {
+            point_write_response_t response;
+            mod_reports.push_back(rdb_modification_report_t(it->key));
+            promise_t<superblock_t *> superblock_promise;
+            rdb_set(it->key, it->value, true,
+                    btree, it->recency,
+                    txn, current_superblock, &response,
+                    &mod_reports.back().info,
+                    &superblock_promise);
+            current_superblock = superblock_promise.wait();
+        }
+        current_superblock->release();
 
-        update_sindexes(&mod_report);
+        update_sindexes(mod_reports);
     }
 
     void operator()(const backfill_chunk_t::sindexes_t &s) const {
@@ -1526,7 +1684,7 @@ struct rdb_receive_backfill_visitor_t : public boost::static_visitor<void> {
     }
 
 private:
-    void update_sindexes(rdb_modification_report_t *mod_report) const {
+    void update_sindexes(const std::vector<rdb_modification_report_t> &mod_reports) const {
         scoped_ptr_t<buf_lock_t> sindex_block;
         store->acquire_sindex_block_for_write(
             token_pair, txn, &sindex_block,
@@ -1535,14 +1693,18 @@ private:
         mutex_t::acq_t acq;
         store->lock_sindex_queue(sindex_block.get(), &acq);
 
-        write_message_t wm;
-        wm << rdb_sindex_change_t(*mod_report);
-        store->sindex_queue_push(wm, &acq);
+        for (size_t i = 0; i < mod_reports.size(); ++i) {
+            write_message_t wm;
+            wm << rdb_sindex_change_t(mod_reports[i]);
+            store->sindex_queue_push(wm, &acq);
+        }
 
         sindex_access_vector_t sindexes;
         store->aquire_post_constructed_sindex_superblocks_for_write(
                 sindex_block.get(), txn, &sindexes);
-        rdb_update_sindexes(sindexes, mod_report, txn);
+        for (size_t i = 0; i < mod_reports.size(); ++i) {
+            rdb_update_sindexes(sindexes, &mod_reports[i], txn);
+        }
     }
 
     btree_store_t<rdb_protocol_t> *store;
@@ -1597,16 +1759,16 @@ RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_read_response_t, data);
 RDB_IMPL_ME_SERIALIZABLE_5(rdb_protocol_t::rget_read_response_t,
                            result, errors, key_range, truncated, last_considered_key);
 RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::distribution_read_response_t, region, key_counts);
-RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::sindex_list_response_t, sindexes);
+RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::sindex_list_response_t, sindexes, post_construction_progress);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::read_response_t, response);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_read_t, key);
-RDB_IMPL_ME_SERIALIZABLE_8(rdb_protocol_t::rget_read_t, region, sindex,
+RDB_IMPL_ME_SERIALIZABLE_9(rdb_protocol_t::rget_read_t, region, sindex,
                            sindex_region, sindex_start_value, sindex_end_value,
-                           transform, terminal, optargs);
+                           transform, terminal, optargs, max_chunk_bytes);
 
 RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::distribution_read_t, max_depth, result_limit, region);
-RDB_IMPL_ME_SERIALIZABLE_0(rdb_protocol_t::sindex_list_t);
+RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::sindex_list_t, region);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::read_t, read);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_write_response_t, result);
 
@@ -1624,7 +1786,7 @@ RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::batched_replaces_t, point_replaces);
 RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::point_write_t, key, data, overwrite);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_delete_t, key);
 
-RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::sindex_create_t, id, mapping, region);
+RDB_IMPL_ME_SERIALIZABLE_5(rdb_protocol_t::sindex_create_t, id, mapping, multi, projection, region);
 RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::sindex_drop_t, id, region);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::write_t, write);
@@ -1632,7 +1794,7 @@ RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::delete_key_t, key);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::delete_range_t, range);
 
-RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::key_value_pair_t, backfill_atom);
+RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::key_value_pairs_t, backfill_atoms);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::sindexes_t, sindexes);
 
@@ -61,6 +61,14 @@ enum point_delete_result_t {
 };
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(point_delete_result_t, int8_t, DELETED, MISSING);
 
+// Whether a sindex whose function returns an array indexes the array as a whole
+// (a compound index) or each of its elements (a multi index).
+enum sindex_multi_bool_t {
+    SINGLE,
+    MULTI
+};
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(sindex_multi_bool_t, int8_t, SINGLE, MULTI);
+
 RDB_DECLARE_SERIALIZABLE(Term);
 RDB_DECLARE_SERIALIZABLE(Datum);
 
@@ -116,11 +124,14 @@ struct terminal_t {
 
 RDB_DECLARE_SERIALIZABLE(terminal_t);
 
+/* `chunk_keys` is about how many keys post construction indexes between
+ * checkpoints. */
 void bring_sindexes_up_to_date(
         const std::set<std::string> &sindexes_to_bring_up_to_date,
         btree_store_t<rdb_protocol_t> *store,
         buf_lock_t *sindex_block,
-        transaction_t *txn)
+        transaction_t *txn,
+        int64_t chunk_keys = RDB_SINDEX_POST_CONSTRUCTION_CHUNK_KEYS)
     THROWS_NOTHING;
 
 } // namespace rdb_protocol_details
@@ -243,6 +254,9 @@ struct rdb_protocol_t {
     struct sindex_list_response_t {
         sindex_list_response_t() { }
         std::vector<std::string> sindexes;
+        // For each sindex still being post constructed, roughly how many of the
+        // table's keys it has indexed and how many there are in total.
+        std::map<std::string, std::pair<int64_t, int64_t> > post_construction_progress;
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
@@ -271,11 +285,12 @@ struct rdb_protocol_t {
 
     class rget_read_t {
     public:
-        rget_read_t() { }
+        rget_read_t() : max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) { }
 
         explicit rget_read_t(const region_t &_region,
                              const std::map<std::string, ql::wire_func_t> &_optargs)
-            : region(_region), optargs(_optargs) {
+            : region(_region), optargs(_optargs),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
         }
 
         void init_sindexes(counted_t<const ql::datum_t> start,
@@ -300,7 +315,8 @@ struct rdb_protocol_t {
                                   : store_key_t::min(),
                                 _sindex_end_value != NULL
                                   ? _sindex_end_value->truncated_secondary()
-                                  : store_key_t::max())) {
+                                  : store_key_t::max())),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
             init_sindexes(_sindex_start_value, _sindex_end_value);
         }
 
@@ -309,7 +325,8 @@ struct rdb_protocol_t {
                     counted_t<const ql::datum_t> _sindex_start_value,
                     counted_t<const ql::datum_t> _sindex_end_value)
             : region(region_t::universe()), sindex(_sindex),
-              sindex_region(_sindex_region) {
+              sindex_region(_sindex_region),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
             init_sindexes(_sindex_start_value, _sindex_end_value);
         }
 
@@ -321,21 +338,24 @@ struct rdb_protocol_t {
                     const std::map<std::string, ql::wire_func_t> &_optargs)
             : region(region_t::universe()), sindex(_sindex),
               sindex_region(_sindex_region),
-              transform(_transform), optargs(_optargs) {
+              transform(_transform), optargs(_optargs),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
             init_sindexes(_sindex_start_value, _sindex_end_value);
         }
 
         rget_read_t(const region_t &_region,
                     const rdb_protocol_details::transform_t &_transform,
                     const std::map<std::string, ql::wire_func_t> &_optargs)
-            : region(_region), transform(_transform), optargs(_optargs) {
+            : region(_region), transform(_transform), optargs(_optargs),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
             rassert(optargs.size() != 0);
         }
 
         rget_read_t(const region_t &_region,
                     const boost::optional<rdb_protocol_details::terminal_t> &_terminal,
                     const std::map<std::string, ql::wire_func_t> &_optargs)
-            : region(_region), terminal(_terminal), optargs(_optargs) {
+            : region(_region), terminal(_terminal), optargs(_optargs),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
             rassert(optargs.size() != 0);
         }
 
@@ -344,7 +364,8 @@ struct rdb_protocol_t {
                     const boost::optional<rdb_protocol_details::terminal_t> &_terminal,
                     const std::map<std::string, ql::wire_func_t> &_optargs)
             : region(_region), transform(_transform),
-              terminal(_terminal), optargs(_optargs) {
+              terminal(_terminal), optargs(_optargs),
+              max_chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES) {
             rassert(optargs.size() != 0);
         }
 
@@ -373,6 +394,10 @@ struct rdb_protocol_t {
         boost::optional<rdb_protocol_details::terminal_t> terminal;
         std::map<std::string, ql::wire_func_t> optargs;
 
+        /* Each shard stops reading once it has read this many bytes of rows (by
+        their serialized size) and marks its response as truncated. */
+        size_t max_chunk_bytes;
+
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
@@ -394,7 +419,10 @@ struct rdb_protocol_t {
 
     class sindex_list_t {
     public:
-        sindex_list_t() { }
+        sindex_list_t() : region(region_t::universe()) { }
+
+        region_t region;
+
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
@@ -543,13 +571,21 @@ struct rdb_protocol_t {
 
     class sindex_create_t {
     public:
-        sindex_create_t() { }
-        sindex_create_t(const std::string &_id, const ql::map_wire_func_t &_mapping)
-            : id(_id), mapping(_mapping), region(region_t::universe())
+        sindex_create_t() : multi(SINGLE) { }
+        sindex_create_t(const std::string &_id, const ql::map_wire_func_t &_mapping,
+                        sindex_multi_bool_t _multi = SINGLE,
+                        const boost::optional<std::vector<std::string> > &_projection
+                            = boost::optional<std::vector<std::string> >())
+            : id(_id), mapping(_mapping), multi(_multi), projection(_projection),
+              region(region_t::universe())
         { }
 
         std::string id;
         ql::map_wire_func_t mapping;
+        sindex_multi_bool_t multi;
+        // If set, the sindex stores only these fields of each row rather than
+        // the whole row.
+        boost::optional<std::vector<std::string> > projection;
         region_t region;
 
         RDB_DECLARE_ME_SERIALIZABLE;
@@ -613,11 +649,12 @@ struct rdb_protocol_t {
 
             RDB_DECLARE_ME_SERIALIZABLE;
         };
-        struct key_value_pair_t {
-            rdb_protocol_details::backfill_atom_t backfill_atom;
+        /* The live pairs from one leaf of the backfiller's btree, sorted by key. */
+        struct key_value_pairs_t {
+            std::vector<rdb_protocol_details::backfill_atom_t> backfill_atoms;
 
-            key_value_pair_t() { }
-            explicit key_value_pair_t(const rdb_protocol_details::backfill_atom_t& _backfill_atom) : backfill_atom(_backfill_atom) { }
+            key_value_pairs_t() { }
+            explicit key_value_pairs_t(const std::vector<rdb_protocol_details::backfill_atom_t> &_backfill_atoms) : backfill_atoms(_backfill_atoms) { }
 
             RDB_DECLARE_ME_SERIALIZABLE;
         };
@@ -631,7 +668,7 @@ struct rdb_protocol_t {
             RDB_DECLARE_ME_SERIALIZABLE;
         };
 
-        typedef boost::variant<delete_range_t, delete_key_t, key_value_pair_t, sindexes_t> value_t;
+        typedef boost::variant<delete_range_t, delete_key_t, key_value_pairs_t, sindexes_t> value_t;
 
         backfill_chunk_t() { }
         explicit backfill_chunk_t(const value_t &_val) : val(_val) { }
@@ -643,8 +680,8 @@ struct rdb_protocol_t {
         static backfill_chunk_t delete_key(const store_key_t& key, const repli_timestamp_t& recency) {
             return backfill_chunk_t(delete_key_t(key, recency));
         }
-        static backfill_chunk_t set_key(const rdb_protocol_details::backfill_atom_t& key) {
-            return backfill_chunk_t(key_value_pair_t(key));
+        static backfill_chunk_t set_keys(const std::vector<rdb_protocol_details::backfill_atom_t> &keys) {
+            return backfill_chunk_t(key_value_pairs_t(keys));
         }
 
         static backfill_chunk_t sindexes(const std::map<std::string, secondary_index_t> &sindexes) {
@@ -654,6 +691,10 @@ struct rdb_protocol_t {
         /* This is for `btree_store_t`; it's not part of the ICL protocol API. */
         repli_timestamp_t get_btree_repli_timestamp() const THROWS_NOTHING;
 
+        /* How many keys this chunk carries. The backfiller and backfillee use
+        it to charge the chunk against the backfill's credit window. */
+        size_t get_key_count() const THROWS_NOTHING;
+
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
@@ -1,6 +1,12 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "rdb_protocol/stream.hpp"
 
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/wait_any.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rdb_protocol/ql2.hpp"
 #include "rdb_protocol/transform_visitors.hpp"
 
@@ -97,15 +103,32 @@ boost::shared_ptr<json_stream_t> transform_stream_t::add_transformation(const rd
     return shared_from_this();
 }
 
+static perfmon_sampler_t pm_rget_time_to_first_row(secs_to_ticks(1), false);
+static perfmon_membership_t pm_rget_time_to_first_row_membership(
+    &get_global_perfmon_collection(), &pm_rget_time_to_first_row,
+    "rdb_rget_time_to_first_row");
+
+batched_rget_stream_t::shard_stream_t::shard_stream_t(
+    const rdb_protocol_t::region_t &_region, const key_range_t &_range)
+    : region(_region), range(_range), finished(false),
+      chunk_bytes(RDB_RGET_INITIAL_CHUNK_BYTES),
+      read_truncated(false), read_ticks(0) { }
+
+bool batched_rget_stream_t::shard_stream_t::exhausted() const {
+    return data.empty() && !read_done.has() && finished;
+}
+
 batched_rget_stream_t::batched_rget_stream_t(
     const namespace_repo_t<rdb_protocol_t>::access_t &_ns_access,
     signal_t *_interruptor,
     counted_t<const ql::datum_t> left_bound,
     counted_t<const ql::datum_t> right_bound,
     const std::map<std::string, ql::wire_func_t> &_optargs,
-    bool _use_outdated)
+    bool _use_outdated,
+    bool _ordered)
     : ns_access(_ns_access), interruptor(_interruptor),
-      finished(false), started(false), optargs(_optargs), use_outdated(_use_outdated),
+      started(false), optargs(_optargs), use_outdated(_use_outdated),
+      ordered(_ordered),
       range(key_range_t::closed,
             left_bound.has()
               ? store_key_t(left_bound->print_primary())
@@ -114,7 +137,10 @@ batched_rget_stream_t::batched_rget_stream_t(
             right_bound.has()
               ? store_key_t(right_bound->print_primary())
               : store_key_t::max()),
-      table_scan_backtrace()
+      table_scan_backtrace(),
+      next_shard(0),
+      start_ticks(0),
+      returned_first_row(false)
 { }
 
 batched_rget_stream_t::batched_rget_stream_t(
@@ -127,10 +153,10 @@ batched_rget_stream_t::batched_rget_stream_t(
     : ns_access(_ns_access),
       interruptor(_interruptor),
       sindex_id(_sindex_id),
-      finished(false),
       started(false),
       optargs(_optargs),
       use_outdated(_use_outdated),
+      ordered(true),
       sindex_start_value(_sindex_start_value),
       sindex_end_value(_sindex_end_value),
       range(rdb_protocol_t::sindex_key_range(
@@ -140,25 +166,111 @@ batched_rget_stream_t::batched_rget_stream_t(
                 _sindex_end_value != NULL
                   ? _sindex_end_value->truncated_secondary()
                   : store_key_t::max())),
-      table_scan_backtrace()
+      table_scan_backtrace(),
+      next_shard(0),
+      start_ticks(0),
+      returned_first_row(false)
 { }
 
 boost::shared_ptr<scoped_cJSON_t> batched_rget_stream_t::next() {
-    started = true;
-    if (data.empty()) {
-        if (finished) {
-            return boost::shared_ptr<scoped_cJSON_t>();
+    if (read_error) {
+        std::rethrow_exception(read_error);
+    }
+    if (!started) {
+        started = true;
+        start_ticks = get_ticks();
+        init_shards();
+    }
+
+    rget_stream_t::value_type row;
+    if (!(ordered ? next_ordered(&row) : next_unordered(&row))) {
+        return boost::shared_ptr<scoped_cJSON_t>();
+    }
+
+    if (!returned_first_row) {
+        returned_first_row = true;
+        pm_rget_time_to_first_row.record(ticks_to_secs(get_ticks() - start_ticks));
+    }
+    guarantee(row.second);
+    return row.second;
+}
+
+bool batched_rget_stream_t::next_ordered(rget_stream_t::value_type *row_out) {
+    for (;;) {
+        /* Once a shard's read is done, its `range` starts after the rows that
+        read got, so those rows have to be in `data` before we look at `range`
+        below. */
+        for (size_t i = 0; i < shards.size(); ++i) {
+            shard_stream_t *shard = &shards[i];
+            if (shard->data.empty() && shard->read_done.has()
+                && shard->read_done->is_pulsed()) {
+                finish_read(shard, false);
+            }
         }
-        read_more();
-        if (data.empty()) {
-            finished = true;
-            return boost::shared_ptr<scoped_cJSON_t>();
+
+        shard_stream_t *best = NULL;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            shard_stream_t *shard = &shards[i];
+            if (!shard->data.empty()
+                && (best == NULL || shard->data.front().first < best->data.front().first)) {
+                best = shard;
+            }
+        }
+
+        /* A shard that has no rows yet could still have one that comes before
+        `best`'s, unless everything it has left to read comes after it. (For a
+        primary key rget on a table sharded by key, that's how we avoid waiting
+        on the later shards.) */
+        shard_stream_t *blocking = NULL;
+        for (size_t i = 0; i < shards.size(); ++i) {
+            shard_stream_t *shard = &shards[i];
+            if (shard->data.empty() && !shard->exhausted()
+                && (best == NULL || shard->range.left <= best->data.front().first)) {
+                blocking = shard;
+                break;
+            }
+        }
+
+        if (blocking != NULL) {
+            fill(blocking);
+        } else if (best != NULL) {
+            *row_out = best->data.front();
+            best->data.pop_front();
+            return true;
+        } else {
+            return false;
         }
     }
+}
 
-    boost::shared_ptr<scoped_cJSON_t> datum = data.front();
-    data.pop_front();
-    return datum;
+bool batched_rget_stream_t::next_unordered(rget_stream_t::value_type *row_out) {
+    bool waited = false;
+    for (;;) {
+        bool all_exhausted = true;
+        for (size_t n = 0; n < shards.size(); ++n) {
+            shard_stream_t *shard = &shards[(next_shard + n) % shards.size()];
+            if (shard->data.empty() && shard->read_done.has()
+                && shard->read_done->is_pulsed()) {
+                finish_read(shard, waited);
+            }
+            if (!shard->data.empty()) {
+                next_shard = (next_shard + n + 1) % shards.size();
+                *row_out = shard->data.front();
+                shard->data.pop_front();
+                return true;
+            }
+            all_exhausted = all_exhausted && shard->exhausted();
+        }
+        if (all_exhausted) {
+            return false;
+        }
+
+        // Every shard that isn't exhausted has a read out; wait for one.
+        read_arrived.init(new cond_t);
+        read_arrived->wait_lazily_unordered();
+        read_arrived.reset();
+        waited = true;
+    }
 }
 
 boost::shared_ptr<json_stream_t> batched_rget_stream_t::add_transformation(const rdb_protocol_details::transform_variant_t &t, UNUSED ql::env_t *ql_env2, const scopes_t &scopes, const backtrace_t &per_op_backtrace) {
@@ -172,7 +284,8 @@ result_t batched_rget_stream_t::apply_terminal(
     UNUSED ql::env_t *ql_env,
     const scopes_t &scopes,
     const backtrace_t &per_op_backtrace) {
-    rdb_protocol_t::rget_read_t rget_read = get_rget();
+    rdb_protocol_t::rget_read_t rget_read
+        = get_rget(rdb_protocol_t::region_t::universe(), range, RDB_RGET_INITIAL_CHUNK_BYTES);
     rget_read.terminal = rdb_protocol_details::terminal_t(t, scopes, per_op_backtrace);
     rdb_protocol_t::read_t read(rget_read);
     try {
@@ -196,77 +309,198 @@ result_t batched_rget_stream_t::apply_terminal(
 
         return p_res->result;
     } catch (const cannot_perform_query_exc_t &e) {
-        if (table_scan_backtrace) {
-            throw runtime_exc_t("cannot perform read: " + std::string(e.what()), *table_scan_backtrace);
-        } else {
-            // No backtrace for these.
-            throw ql::exc_t("cannot perform read: " + std::string(e.what()),
-                            ql::backtrace_t());
+        throw_cannot_perform(e);
+    }
+}
+
+void batched_rget_stream_t::reset_interruptor(signal_t *new_interruptor) {
+    // The reads in flight are still using the old interruptor.
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (shards[i].read_done.has()) {
+            shards[i].read_done->wait_lazily_unordered();
         }
     }
+    interruptor = new_interruptor;
 }
 
-rdb_protocol_t::rget_read_t batched_rget_stream_t::get_rget() {
+rdb_protocol_t::rget_read_t batched_rget_stream_t::get_rget(
+    const rdb_protocol_t::region_t &region,
+    const key_range_t &read_range,
+    size_t chunk_bytes) {
+    rdb_protocol_t::rget_read_t rget_read;
     if (!sindex_id) {
-        return rdb_protocol_t::rget_read_t(rdb_protocol_t::region_t(range),
-                                           transform,
-                                           optargs);
+        rdb_protocol_t::region_t read_region = region;
+        read_region.inner = read_range;
+        rget_read = rdb_protocol_t::rget_read_t(read_region,
+                                                transform,
+                                                optargs);
     } else {
-        return rdb_protocol_t::rget_read_t(rdb_protocol_t::region_t(range),
-                                           *sindex_id,
-                                           sindex_start_value,
-                                           sindex_end_value,
-                                           transform,
-                                           optargs);
+        rget_read = rdb_protocol_t::rget_read_t(rdb_protocol_t::region_t(read_range),
+                                                *sindex_id,
+                                                sindex_start_value,
+                                                sindex_end_value,
+                                                transform,
+                                                optargs);
+        rget_read.region = region;
     }
+    rget_read.max_chunk_bytes = chunk_bytes;
+    return rget_read;
 }
 
-void batched_rget_stream_t::read_more() {
-    rdb_protocol_t::read_t read(get_rget());
+void batched_rget_stream_t::init_shards() {
+    guarantee(shards.empty());
+    guarantee(ns_access.get_namespace_if());
+    std::set<rdb_protocol_t::region_t> scheme;
     try {
-        guarantee(ns_access.get_namespace_if());
-        rdb_protocol_t::read_response_t res;
-        if (use_outdated) {
-            ns_access.get_namespace_if()->read_outdated(read, &res, interruptor);
+        scheme = ns_access.get_namespace_if()->get_sharding_scheme();
+    } catch (const cannot_perform_query_exc_t &) {
+        /* The sharding scheme is only a hint; without it we read the whole
+        range as one stream and let the namespace interface split the reads. */
+        scheme.clear();
+        scheme.insert(rdb_protocol_t::region_t::universe());
+    }
+
+    for (std::set<rdb_protocol_t::region_t>::const_iterator it = scheme.begin();
+         it != scheme.end(); ++it) {
+        if (!sindex_id) {
+            rdb_protocol_t::region_t region
+                = region_intersection(rdb_protocol_t::region_t(range), *it);
+            if (!region_is_empty(region)) {
+                shards.push_back(new shard_stream_t(region, region.inner));
+            }
         } else {
-            ns_access.get_namespace_if()->read(read, &res, order_token_t::ignore, interruptor);
+            // Every shard has sindex rows anywhere in the sindex's keyspace.
+            shards.push_back(new shard_stream_t(*it, range));
         }
-        rdb_protocol_t::rget_read_response_t *p_res = boost::get<rdb_protocol_t::rget_read_response_t>(&res.response);
-        guarantee(p_res);
+    }
 
-        /* Re throw an exception if we got one. */
-        if (auto e = boost::get<runtime_exc_t>(&p_res->result)) {
-            throw *e;
-        } else if (auto e2 = boost::get<ql::exc_t>(&p_res->result)) {
-            throw *e2;
-        } else if (auto e3 = boost::get<ql::datum_exc_t>(&p_res->result)) {
-            throw *e3;
-        }
+    for (size_t i = 0; i < shards.size(); ++i) {
+        start_read(&shards[i]);
+    }
+}
 
-        // todo: just do a straight copy?
-        typedef rdb_protocol_t::rget_read_response_t::stream_t stream_t;
-        stream_t *stream = boost::get<stream_t>(&p_res->result);
-        guarantee(stream);
+void batched_rget_stream_t::throw_cannot_perform(const cannot_perform_query_exc_t &e) {
+    if (table_scan_backtrace) {
+        throw runtime_exc_t("cannot perform read: " + std::string(e.what()), *table_scan_backtrace);
+    } else {
+        // No backtrace.
+        throw ql::exc_t("cannot perform read: " + std::string(e.what()),
+                        ql::backtrace_t());
+    }
+}
 
-        for (stream_t::iterator i = stream->begin(); i != stream->end(); ++i) {
-            guarantee(i->second);
-            data.push_back(i->second);
-        }
+void batched_rget_stream_t::start_read(shard_stream_t *shard) {
+    guarantee(!shard->read_done.has());
+    guarantee(!shard->finished);
+    shard->read_done.init(new cond_t);
+    coro_t::spawn_sometime(boost::bind(&batched_rget_stream_t::do_read, this, shard,
+                                       get_rget(shard->region, shard->range,
+                                                shard->chunk_bytes),
+                                       auto_drainer_t::lock_t(&drainer)));
+}
+
+void batched_rget_stream_t::finish_read(shard_stream_t *shard, bool waited) {
+    guarantee(shard->read_done.has());
+    shard->read_done->wait_lazily_unordered();
+    shard->read_done.reset();
+
+    if (shard->read_error) {
+        // The shard's rows from here on are lost, so the stream can't go on.
+        read_error = shard->read_error;
+        shard->read_error = std::exception_ptr();
+        std::rethrow_exception(read_error);
+    }
 
-        range.left = p_res->last_considered_key;
+    adapt_chunk_size(shard, waited);
+    shard->data.insert(shard->data.end(),
+                       shard->read_data.begin(), shard->read_data.end());
+    shard->read_data.clear();
 
-        if (!range.left.increment()) {
-            finished = true;
+    if (!shard->finished) {
+        start_read(shard);
+    }
+}
+
+void batched_rget_stream_t::fill(shard_stream_t *shard) {
+    // A chunk may come back empty without being the last one, if a filter
+    // dropped every row in it.
+    while (shard->data.empty() && !shard->exhausted()) {
+        if (!shard->read_done.has()) {
+            start_read(shard);
         }
-    } catch (const cannot_perform_query_exc_t &e) {
-        if (table_scan_backtrace) {
-            throw runtime_exc_t("cannot perform read: " + std::string(e.what()), *table_scan_backtrace);
-        } else {
-            // No backtrace.
-            throw ql::exc_t("cannot perform read: " + std::string(e.what()),
-                            ql::backtrace_t());
+        finish_read(shard, !shard->read_done->is_pulsed());
+    }
+}
+
+void batched_rget_stream_t::do_read(shard_stream_t *shard,
+                                    rdb_protocol_t::rget_read_t rget_read,
+                                    auto_drainer_t::lock_t keepalive) {
+    ticks_t read_start_ticks = get_ticks();
+    try {
+        // If the stream goes away, nobody wants this chunk any more.
+        wait_any_t read_interruptor(interruptor, keepalive.get_drain_signal());
+        rdb_protocol_t::read_t read(rget_read);
+        try {
+            rdb_protocol_t::read_response_t res;
+            if (use_outdated) {
+                ns_access.get_namespace_if()->read_outdated(read, &res, &read_interruptor);
+            } else {
+                ns_access.get_namespace_if()->read(read, &res, order_token_t::ignore, &read_interruptor);
+            }
+            rdb_protocol_t::rget_read_response_t *p_res = boost::get<rdb_protocol_t::rget_read_response_t>(&res.response);
+            guarantee(p_res);
+
+            /* Re throw an exception if we got one. */
+            if (auto e = boost::get<runtime_exc_t>(&p_res->result)) {
+                throw *e;
+            } else if (auto e2 = boost::get<ql::exc_t>(&p_res->result)) {
+                throw *e2;
+            } else if (auto e3 = boost::get<ql::datum_exc_t>(&p_res->result)) {
+                throw *e3;
+            }
+
+            rget_stream_t *stream = boost::get<rget_stream_t>(&p_res->result);
+            guarantee(stream);
+            shard->read_data.swap(*stream);
+            shard->read_truncated = p_res->truncated;
+
+            shard->range.left = p_res->last_considered_key;
+
+            if (!shard->range.left.increment()
+                || (!shard->range.right.unbounded
+                    && shard->range.right.key <= shard->range.left)) {
+                shard->finished = true;
+            }
+        } catch (const cannot_perform_query_exc_t &e) {
+            throw_cannot_perform(e);
         }
+    } catch (const std::exception &) {
+        shard->read_error = std::current_exception();
+    }
+    shard->read_ticks = get_ticks() - read_start_ticks;
+    shard->read_done->pulse();
+    if (read_arrived.has() && !read_arrived->is_pulsed()) {
+        read_arrived->pulse();
+    }
+}
+
+void batched_rget_stream_t::adapt_chunk_size(shard_stream_t *shard, bool waited) {
+    shard->chunk_bytes = adapt_rget_chunk_bytes(shard->chunk_bytes, shard->read_truncated,
+                                                shard->read_ticks, waited);
+}
+
+size_t adapt_rget_chunk_bytes(size_t chunk_bytes, bool truncated, ticks_t read_ticks,
+                              bool waited) {
+    // Only a truncated chunk tells us how long a full chunk takes to read.
+    if (!truncated) {
+        return chunk_bytes;
+    }
+    if (ticks_to_secs(read_ticks) * 1000 > RDB_RGET_TARGET_CHUNK_LATENCY_MS) {
+        return std::max<size_t>(chunk_bytes / 2, RDB_RGET_MIN_CHUNK_BYTES);
+    } else if (waited) {
+        return std::min<size_t>(chunk_bytes * 2, RDB_RGET_MAX_CHUNK_BYTES);
     }
+    return chunk_bytes;
 }
 
 } //namespace query_language
@@ -3,6 +3,8 @@
 #define RDB_PROTOCOL_STREAM_HPP_
 
 #include <algorithm>
+#include <deque>
+#include <exception>
 #include <list>
 #include <set>
 #include <string>
@@ -11,11 +13,14 @@
 #include "errors.hpp"
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/function.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/variant/get.hpp>
 
 #include "clustering/administration/namespace_interface_repository.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "rdb_protocol/exceptions.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/proto_utils.hpp"
@@ -85,6 +90,21 @@ private:
     json_list_t data;
 };
 
+/* Returns the size of a shard's next chunk, given the size of the chunk it just
+read, whether that chunk was truncated, how long it took to read and whether the
+caller had to wait for it. */
+size_t adapt_rget_chunk_bytes(size_t chunk_bytes, bool truncated, ticks_t read_ticks,
+                              bool waited);
+
+/* `batched_rget_stream_t` reads a range from the table one chunk at a time. Each
+shard of the table is read as its own stream, and every shard has the read for its
+next chunk out while the caller consumes the current one. The size of the chunks
+adapts to how fast the shards answer and how fast the caller consumes them; see
+`RDB_RGET_INITIAL_CHUNK_BYTES`.
+
+An unordered stream returns rows from whichever shard has some. An ordered stream
+returns rows in key order by merging the shards' streams; it only waits on the
+shards whose next row could come first. */
 class batched_rget_stream_t : public json_stream_t {
 public:
     /* Primary key rget. */
@@ -93,9 +113,10 @@ public:
                           counted_t<const ql::datum_t> left_bound,
                           counted_t<const ql::datum_t> right_bound,
                           const std::map<std::string, ql::wire_func_t> &_optargs,
-                          bool _use_outdated);
+                          bool _use_outdated,
+                          bool _ordered);
 
-    /* Sindex rget. */
+    /* Sindex rget. These are always ordered. */
     batched_rget_stream_t(const namespace_repo_t<rdb_protocol_t>::access_t &_ns_access,
                           signal_t *_interruptor, const std::string &_sindex_id,
                           const std::map<std::string, ql::wire_func_t> &_optargs,
@@ -111,23 +132,71 @@ public:
                             const scopes_t &scopes,
                             const backtrace_t &backtrace);
 
-    virtual void reset_interruptor(signal_t *new_interruptor) {
-        interruptor = new_interruptor;
-    };
+    virtual void reset_interruptor(signal_t *new_interruptor);
 
 private:
-    rdb_protocol_t::rget_read_t get_rget();
-    void read_more();
+    typedef rdb_protocol_t::rget_read_response_t::stream_t rget_stream_t;
+
+    /* The part of the read that falls on one shard. */
+    struct shard_stream_t {
+        shard_stream_t(const rdb_protocol_t::region_t &_region, const key_range_t &_range);
+
+        // Which shard; for a primary key rget only the part of it in the range.
+        rdb_protocol_t::region_t region;
+        // What's left to read. For a sindex rget this is in the sindex's keyspace.
+        key_range_t range;
+        bool finished;
+        size_t chunk_bytes;
+
+        // Rows we have got but not returned yet.
+        std::deque<rget_stream_t::value_type> data;
+
+        /* State of the read in flight, if there is one. `read_done` is pulsed
+        when it's done; then either `read_error` is set or the rest describe
+        what it got. */
+        scoped_ptr_t<cond_t> read_done;
+        std::exception_ptr read_error;
+        rget_stream_t read_data;
+        bool read_truncated;
+        ticks_t read_ticks;
+
+        // There's no row left in this shard's part of the range.
+        bool exhausted() const;
+
+    private:
+        DISABLE_COPYING(shard_stream_t);
+    };
+
+    rdb_protocol_t::rget_read_t get_rget(const rdb_protocol_t::region_t &region,
+                                         const key_range_t &read_range,
+                                         size_t chunk_bytes);
+    void init_shards();
+    NORETURN void throw_cannot_perform(const cannot_perform_query_exc_t &e);
+
+    // Returns the next row of an ordered or unordered stream.
+    bool next_ordered(rget_stream_t::value_type *row_out);
+    bool next_unordered(rget_stream_t::value_type *row_out);
+
+    // Sends the read for the shard's next chunk.
+    void start_read(shard_stream_t *shard);
+    // Moves the rows of the shard's finished read to its `data`, and sends
+    // the read for the chunk after it.
+    void finish_read(shard_stream_t *shard, bool waited);
+    // Waits for reads until the shard has a row or is exhausted.
+    void fill(shard_stream_t *shard);
+    void do_read(shard_stream_t *shard, rdb_protocol_t::rget_read_t rget_read,
+                 auto_drainer_t::lock_t keepalive);
+    void adapt_chunk_size(shard_stream_t *shard, bool waited);
 
     rdb_protocol_details::transform_t transform;
     namespace_repo_t<rdb_protocol_t>::access_t ns_access;
     signal_t *interruptor;
     boost::optional<std::string> sindex_id;
 
-    json_list_t data;
-    bool finished, started;
+    bool started;
     const std::map<std::string, ql::wire_func_t> optargs;
     bool use_outdated;
+    bool ordered;
 
     counted_t<const ql::datum_t> sindex_start_value;
     counted_t<const ql::datum_t> sindex_end_value;
@@ -135,6 +204,20 @@ private:
     key_range_t range;
 
     boost::optional<backtrace_t> table_scan_backtrace;
+
+    boost::ptr_vector<shard_stream_t> shards;
+    // Where `next_unordered()` starts looking, so that it takes turns.
+    size_t next_shard;
+    // Pulsed when any shard's read is done, while `next_unordered()` waits.
+    scoped_ptr_t<cond_t> read_arrived;
+
+    ticks_t start_ticks;
+    bool returned_first_row;
+
+    // Set once a read fails; `next()` throws it from then on.
+    std::exception_ptr read_error;
+
+    auto_drainer_t drainer;
 };
 
 
@@ -1,5 +1,10 @@
 #include "rdb_protocol/stream_cache.hpp"
 
+#include "errors.hpp"
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include "arch/runtime/coroutines.hpp"
 #include "rdb_protocol/env.hpp"
 
 namespace ql {
@@ -18,51 +23,114 @@ void stream_cache2_t::insert(int64_t key,
 }
 
 void stream_cache2_t::erase(int64_t key) {
-    size_t num_erased = streams.erase(key);
-    guarantee(num_erased == 1);
+    guarantee(contains(key));
+    entry_t *entry = wait_for_prefetch(key);
+    // Someone else may have erased it while we were waiting.
+    if (entry == NULL) return;
+    prefetched_bytes -= entry->buffered_bytes;
+    streams.erase(key);
 }
 
 bool stream_cache2_t::serve(int64_t key, Response *res, signal_t *interruptor) {
-    boost::ptr_map<int64_t, entry_t>::iterator it = streams.find(key);
-    if (it == streams.end()) return false;
-    entry_t *entry = it->second;
+    entry_t *entry = wait_for_prefetch(key);
+    if (entry == NULL) return false;
     entry->last_activity = time(0);
     try {
+        if (entry->prefetch_error) {
+            std::exception_ptr error = entry->prefetch_error;
+            entry->prefetch_error = std::exception_ptr();
+            std::rethrow_exception(error);
+        }
+
         // This is a hack.  Some streams have an interruptor that is invalid by
         // the time we reach here, so we just reset it to a good one.
         entry->env->interruptor = interruptor;
 
         int chunk_size = 0;
-        if (entry->next_datum.has()) {
-            *res->add_response() = *entry->next_datum.get();
-            ++chunk_size;
-            entry->next_datum.reset();
-        }
-        while (counted_t<const datum_t> d = entry->stream->next()) {
-            d->write_to_protobuf(res->add_response());
-            if (entry->max_chunk_size && ++chunk_size >= entry->max_chunk_size) {
-                if (counted_t<const datum_t> next_d = entry->stream->next()) {
-                    r_sanity_check(!entry->next_datum.has());
-                    entry->next_datum.init(new Datum());
-                    next_d->write_to_protobuf(entry->next_datum.get());
-                    res->set_type(Response::SUCCESS_PARTIAL);
-                }
+        int64_t chunk_bytes = 0;
+        for (;;) {
+            if (entry->buffered.empty() && !buffer_one(entry)) {
                 break;
             }
+            if (chunk_is_full(entry, chunk_size, chunk_bytes)) {
+                res->set_type(Response::SUCCESS_PARTIAL);
+                break;
+            }
+            int64_t datum_bytes = entry->buffered.front().ByteSize();
+            entry->buffered_bytes -= datum_bytes;
+            prefetched_bytes -= datum_bytes;
+            chunk_bytes += datum_bytes;
+            ++chunk_size;
+            res->add_response()->Swap(&entry->buffered.front());
+            entry->buffered.pop_front();
         }
     } catch (const std::exception &e) {
         erase(key);
         throw;
     }
-    if (!entry->next_datum.has()) {
+    if (entry->buffered.empty()) {
+        r_sanity_check(entry->stream_exhausted);
         erase(key);
         res->set_type(Response::SUCCESS_SEQUENCE);
     } else {
         r_sanity_check(res->type() == Response::SUCCESS_PARTIAL);
+        entry->prefetch_done = boost::make_shared<cond_t>();
+        coro_t::spawn_sometime(boost::bind(&stream_cache2_t::prefetch, this, entry,
+                                           auto_drainer_t::lock_t(&drainer)));
     }
     return true;
 }
 
+bool stream_cache2_t::buffer_one(entry_t *entry) {
+    if (entry->stream_exhausted) return false;
+    counted_t<const datum_t> d = entry->stream->next();
+    if (!d.has()) {
+        entry->stream_exhausted = true;
+        return false;
+    }
+    Datum *pb = new Datum();
+    entry->buffered.push_back(pb);
+    d->write_to_protobuf(pb);
+    int64_t datum_bytes = pb->ByteSize();
+    entry->buffered_bytes += datum_bytes;
+    prefetched_bytes += datum_bytes;
+    return true;
+}
+
+bool stream_cache2_t::chunk_is_full(const entry_t *entry, int chunk_size, int64_t chunk_bytes) const {
+    // Every chunk gets at least one datum, however big it is.
+    return chunk_size > 0
+        && ((entry->max_chunk_size && chunk_size >= entry->max_chunk_size)
+            || chunk_bytes >= entry->max_chunk_bytes);
+}
+
+stream_cache2_t::entry_t *stream_cache2_t::wait_for_prefetch(int64_t key) {
+    for (;;) {
+        boost::ptr_map<int64_t, entry_t>::iterator it = streams.find(key);
+        if (it == streams.end()) return NULL;
+        entry_t *entry = it->second;
+        boost::shared_ptr<cond_t> done = entry->prefetch_done;
+        if (!done || done->is_pulsed()) return entry;
+        // The entry may be erased, or start another prefetch, while we wait.
+        done->wait_lazily_unordered();
+    }
+}
+
+void stream_cache2_t::prefetch(entry_t *entry, auto_drainer_t::lock_t keepalive) {
+    try {
+        // We read one datum past a full chunk, so that the next `serve()` can
+        // tell whether that chunk is the last one without waiting.
+        while (!keepalive.get_drain_signal()->is_pulsed()
+               && prefetched_bytes < RDB_STREAM_CACHE_PREFETCH_BUDGET_BYTES
+               && !chunk_is_full(entry, static_cast<int>(entry->buffered.size()) - 1,
+                              entry->buffered_bytes)
+               && buffer_one(entry)) { }
+    } catch (const std::exception &) {
+        entry->prefetch_error = std::current_exception();
+    }
+    entry->prefetch_done->pulse();
+}
+
 void stream_cache2_t::maybe_evict() {
     // We never evict right now.
 }
@@ -70,7 +138,8 @@ void stream_cache2_t::maybe_evict() {
 stream_cache2_t::entry_t::entry_t(time_t _last_activity, scoped_ptr_t<env_t> *env_ptr,
                                   counted_t<datum_stream_t> _stream)
     : last_activity(_last_activity), env(env_ptr->release()), stream(_stream),
-      max_chunk_size(DEFAULT_MAX_CHUNK_SIZE), max_age(DEFAULT_MAX_AGE) { }
+      max_chunk_size(DEFAULT_MAX_CHUNK_SIZE), max_chunk_bytes(DEFAULT_MAX_CHUNK_BYTES),
+      max_age(DEFAULT_MAX_AGE), buffered_bytes(0), stream_exhausted(false) { }
 
 stream_cache2_t::entry_t::~entry_t() { }
 
@@ -4,12 +4,18 @@
 
 #include <time.h>
 
+#include <exception>
 #include <map>
 
 #include "utils.hpp"
+#include <boost/ptr_container/ptr_deque.hpp>
+#include <boost/ptr_container/ptr_map.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/signal.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/ql2.pb.h"
@@ -21,9 +27,15 @@ class env_t;
 
 namespace ql {
 
+/* `stream_cache2_t` holds the streams of a connection's queries that returned
+`SUCCESS_PARTIAL`, so that `CONTINUE` queries can pick up where they left off.
+Once it has served a chunk of a stream, it starts reading the next chunk in the
+background, so that the reads to the shards overlap with the client's round
+trip. All the prefetched datums of a connection together are held to
+`RDB_STREAM_CACHE_PREFETCH_BUDGET_BYTES`. */
 class stream_cache2_t {
 public:
-    stream_cache2_t() { }
+    stream_cache2_t() : prefetched_bytes(0) { }
     MUST_USE bool contains(int64_t key);
     void insert(int64_t key,
                 scoped_ptr_t<env_t> *val_env, counted_t<datum_stream_t> val_stream);
@@ -39,6 +51,8 @@ private:
 #else
         static const int DEFAULT_MAX_CHUNK_SIZE = 1000;
 #endif // NDEBUG
+        // A chunk also ends once it has this many bytes of datums in it.
+        static const int64_t DEFAULT_MAX_CHUNK_BYTES = MEGABYTE;
         static const time_t DEFAULT_MAX_AGE = 0; // 0 = never evict
         entry_t(time_t _last_activity, scoped_ptr_t<env_t> *env_ptr,
                 counted_t<datum_stream_t> _stream);
@@ -46,14 +60,38 @@ private:
         scoped_ptr_t<env_t> env; // steals ownership from env_ptr !!!
         counted_t<datum_stream_t> stream;
         int max_chunk_size; // Size of 0 = unlimited
+        int64_t max_chunk_bytes;
         time_t max_age;
 
-        scoped_ptr_t<Datum> next_datum;
+        // Datums that have been read from `stream` but not sent yet.
+        boost::ptr_deque<Datum> buffered;
+        int64_t buffered_bytes;
+        bool stream_exhausted;
+
+        // Set when a prefetch starts; pulsed when it's done. Waiters hold
+        // their own reference, since the next prefetch replaces it.
+        boost::shared_ptr<cond_t> prefetch_done;
+        // If the prefetch failed, this is what it threw, to be rethrown to
+        // the next `CONTINUE`.
+        std::exception_ptr prefetch_error;
     private:
         DISABLE_COPYING(entry_t);
     };
 
+    // Reads one more datum from the stream into the buffer. Returns `false` if
+    // the stream is exhausted.
+    bool buffer_one(entry_t *entry);
+    bool chunk_is_full(const entry_t *entry, int chunk_size, int64_t chunk_bytes) const;
+    // Waits until the stream `key` has no prefetch running. Returns its entry,
+    // or `NULL` if the stream isn't (or is no longer) in the cache.
+    entry_t *wait_for_prefetch(int64_t key);
+    void prefetch(entry_t *entry, auto_drainer_t::lock_t keepalive);
+
     boost::ptr_map<int64_t, entry_t> streams;
+    int64_t prefetched_bytes;
+
+    auto_drainer_t drainer;
+
     DISABLE_COPYING(stream_cache2_t);
 };
 
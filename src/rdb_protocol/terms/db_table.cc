@@ -440,24 +440,39 @@ public:
         : op_term_t(env, term, argspec_t(2), optargspec_t(get_all_optargs)) { }
 private:
     virtual counted_t<val_t> eval_impl() {
-        counted_t<table_t> table = arg(0)->as_table();
+        // On a selection, such as a `between` or another `get_all`, this
+        // intersects the selection with the rows that have the key.
+        counted_t<val_t> source = arg(0);
+        counted_t<table_t> table;
+        counted_t<datum_stream_t> selection;
+        if (source->get_type().is_convertible(val_t::type_t::TABLE)) {
+            table = source->as_table();
+        } else {
+            std::pair<counted_t<table_t>, counted_t<datum_stream_t> > sel
+                = source->as_selection();
+            table = sel.first;
+            selection = sel.second;
+        }
+
         counted_t<const datum_t> pkey = arg(1)->as_datum();
-        if (counted_t<val_t> v = optarg("index", counted_t<val_t>())) {
-            if (v->as_str() != table->get_pkey()) {
-                counted_t<datum_stream_t> seq =
-                    table->get_sindex_rows(pkey, pkey, v->as_str(), backtrace());
-                return new_val(seq, table);
+        counted_t<datum_stream_t> stream;
+        counted_t<val_t> v = optarg("index", counted_t<val_t>());
+        if (v.has() && v->as_str() != table->get_pkey()) {
+            stream = table->get_sindex_rows(pkey, pkey, v->as_str(), backtrace());
+        } else {
+            counted_t<const datum_t> row = table->get_row(pkey);
+            scoped_ptr_t<datum_t> arr(new datum_t(datum_t::R_ARRAY));
+            if (row->get_type() != datum_t::R_NULL) {
+                arr->add(row);
             }
-        }
-        counted_t<const datum_t> row = table->get_row(pkey);
-        scoped_ptr_t<datum_t> arr(new datum_t(datum_t::R_ARRAY));
-        if (row->get_type() != datum_t::R_NULL) {
-            arr->add(row);
+            stream = make_counted<array_datum_stream_t>(env, counted_t<datum_t>(arr.release()),
+                                                        backtrace());
         }
 
-        counted_t<datum_stream_t> stream
-            = make_counted<array_datum_stream_t>(env, counted_t<datum_t>(arr.release()),
-                                                 backtrace());
+        if (selection.has()) {
+            stream = make_counted<intersect_datum_stream_t>(env, selection, stream,
+                                                            table->get_pkey(), backtrace());
+        }
         return new_val(stream, table);
     }
     virtual const char *name() const { return "get_all"; }
@@ -86,7 +86,20 @@ public:
         : op_term_t(env, term, argspec_t(3), optargspec_t(between_optargs)) { }
 private:
     virtual counted_t<val_t> eval_impl() {
-        counted_t<table_t> tbl = arg(0)->as_table();
+        // On a selection, such as another `between` or a `get_all`, this
+        // intersects the selection with the rows in range.
+        counted_t<val_t> source = arg(0);
+        counted_t<table_t> tbl;
+        counted_t<datum_stream_t> selection;
+        if (source->get_type().is_convertible(val_t::type_t::TABLE)) {
+            tbl = source->as_table();
+        } else {
+            std::pair<counted_t<table_t>, counted_t<datum_stream_t> > sel
+                = source->as_selection();
+            tbl = sel.first;
+            selection = sel.second;
+        }
+
         counted_t<const datum_t> lb = arg(1)->as_datum();
         if (lb->get_type() == datum_t::R_NULL) {
             lb.reset();
@@ -96,7 +109,9 @@ private:
             rb.reset();
         }
         if (!lb.has() && !rb.has()) {
-            return new_val(tbl->as_datum_stream(), tbl);
+            return selection.has()
+                ? new_val(selection, tbl)
+                : new_val(tbl->as_datum_stream(), tbl);
         } else if (lb.has() && rb.has() && *lb > *rb) {
             counted_t<const datum_t> arr = make_counted<datum_t>(datum_t::R_ARRAY);
             counted_t<datum_stream_t> ds(
@@ -104,15 +119,19 @@ private:
             return new_val(ds, tbl);
         }
 
+        counted_t<datum_stream_t> rows;
         counted_t<val_t> sindex = optarg("index", counted_t<val_t>());
-        if (sindex.has()) {
-            std::string sid = sindex->as_str();
-            if (sid != tbl->get_pkey()) {
-                return new_val(tbl->get_sindex_rows(lb, rb, sid, backtrace()), tbl);
-            }
+        if (sindex.has() && sindex->as_str() != tbl->get_pkey()) {
+            rows = tbl->get_sindex_rows(lb, rb, sindex->as_str(), backtrace());
+        } else {
+            rows = tbl->get_rows(lb, rb, backtrace());
         }
 
-        return new_val(tbl->get_rows(lb, rb, backtrace()), tbl);
+        if (selection.has()) {
+            rows = make_counted<intersect_datum_stream_t>(env, selection, rows,
+                                                          tbl->get_pkey(), backtrace());
+        }
+        return new_val(rows, tbl);
     }
     virtual const char *name() const { return "between"; }
 
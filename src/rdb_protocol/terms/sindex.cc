@@ -1,6 +1,7 @@
 #include "rdb_protocol/terms/terms.hpp"
 
 #include <string>
+#include <vector>
 
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/op.hpp"
@@ -10,6 +11,8 @@
 
 namespace ql {
 
+static const char *const sindex_create_optargs[] = {"multi", "projection"};
+
 // We need to use inheritance rather than composition for
 // `env_t::special_var_shadower_t` because it needs to be initialized before
 // `op_term_t`.
@@ -17,7 +20,7 @@ class sindex_create_term_t : private env_t::special_var_shadower_t, public op_te
 public:
     sindex_create_term_t(env_t *env, protob_t<const Term> term)
         : env_t::special_var_shadower_t(env, env_t::SINDEX_ERROR_VAR),
-          op_term_t(env, term, argspec_t(2, 3)) { }
+          op_term_t(env, term, argspec_t(2, 3), optargspec_t(sindex_create_optargs)) { }
 
     virtual counted_t<val_t> eval_impl() {
         counted_t<table_t> table = arg(0)->as_table();
@@ -42,7 +45,25 @@ public:
         }
         r_sanity_check(index_func.has());
 
-        bool success = table->sindex_create(name, index_func);
+        // With `multi`, an index function that returns an array indexes the row
+        // under each element rather than under the array as a whole.
+        sindex_multi_bool_t multi = SINGLE;
+        if (counted_t<val_t> v = optarg("multi", counted_t<val_t>())) {
+            multi = v->as_bool() ? MULTI : SINGLE;
+        }
+
+        // With `projection`, the index stores only the listed fields of each
+        // row, and reads that need more go back to the primary btree.
+        boost::optional<std::vector<std::string> > projection;
+        if (counted_t<val_t> v = optarg("projection", counted_t<val_t>())) {
+            counted_t<const datum_t> fields = v->as_datum();
+            projection = std::vector<std::string>();
+            for (size_t i = 0; i < fields->size(); ++i) {
+                projection->push_back(fields->get(i)->as_str());
+            }
+        }
+
+        bool success = table->sindex_create(name, index_func, multi, projection);
         if (success) {
             scoped_ptr_t<datum_t> res(new datum_t(datum_t::R_OBJECT));
             UNUSED bool b = res->add("created", make_counted<datum_t>(1.0));
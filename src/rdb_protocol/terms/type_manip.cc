@@ -262,7 +262,9 @@ private:
             counted_t<table_t> table = v->as_table();
             b |= info->add("name", make_counted<datum_t>(table->name));
             b |= info->add("primary_key", make_counted<datum_t>(table->get_pkey()));
-            b |= info->add("indexes", table->sindex_list());
+            counted_t<const datum_t> index_progress;
+            b |= info->add("indexes", table->sindex_list(&index_progress));
+            b |= info->add("index_progress", index_progress);
             b |= info->add("db", val_info(new_val(table->db)));
         } break;
         case SELECTION_TYPE: {
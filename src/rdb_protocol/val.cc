@@ -249,11 +249,13 @@ std::vector<counted_t<const datum_t> > table_t::batch_replace(
 }
 
 MUST_USE bool table_t::sindex_create(const std::string &id,
-                                     counted_t<func_t> index_func) {
+                                     counted_t<func_t> index_func,
+                                     sindex_multi_bool_t multi,
+                                     const boost::optional<std::vector<std::string> > &projection) {
     index_func->assert_deterministic("Index functions must be deterministic.");
     map_wire_func_t wire_func(env, index_func);
     rdb_protocol_t::write_t write(
-            rdb_protocol_t::sindex_create_t(id, wire_func));
+            rdb_protocol_t::sindex_create_t(id, wire_func, multi, projection));
 
     rdb_protocol_t::write_response_t res;
     access->get_namespace_if()->write(
@@ -279,8 +281,7 @@ MUST_USE bool table_t::sindex_drop(const std::string &id) {
     return response->success;
 }
 
-counted_t<const datum_t> table_t::sindex_list() {
-    scoped_ptr_t<datum_t> array(new datum_t(datum_t::R_ARRAY));
+void table_t::do_sindex_list(rdb_protocol_t::sindex_list_response_t *response_out) {
     rdb_protocol_t::sindex_list_t sindex_list;
     rdb_protocol_t::read_t read(sindex_list);
     try {
@@ -288,14 +289,33 @@ counted_t<const datum_t> table_t::sindex_list() {
         access->get_namespace_if()->read(read, &res, order_token_t::ignore, env->interruptor);
         rdb_protocol_t::sindex_list_response_t *s_res = boost::get<rdb_protocol_t::sindex_list_response_t>(&res.response);
         r_sanity_check(s_res);
-
-        for (std::vector<std::string>::const_iterator it = s_res->sindexes.begin();
-             it != s_res->sindexes.end(); ++it) {
-            array->add(make_counted<datum_t>(*it));
-        }
+        *response_out = *s_res;
     } catch (const cannot_perform_query_exc_t &ex) {
         rfail("cannot perform read: %s", ex.what());
     }
+}
+
+counted_t<const datum_t> table_t::sindex_list(counted_t<const datum_t> *progress_out) {
+    rdb_protocol_t::sindex_list_response_t s_res;
+    do_sindex_list(&s_res);
+
+    scoped_ptr_t<datum_t> array(new datum_t(datum_t::R_ARRAY));
+    for (std::vector<std::string>::const_iterator it = s_res.sindexes.begin();
+         it != s_res.sindexes.end(); ++it) {
+        array->add(make_counted<datum_t>(*it));
+    }
+
+    if (progress_out != NULL) {
+        scoped_ptr_t<datum_t> object(new datum_t(datum_t::R_OBJECT));
+        for (auto it = s_res.post_construction_progress.begin();
+             it != s_res.post_construction_progress.end(); ++it) {
+            int64_t built = it->second.first, total = it->second.second;
+            double percent = total == 0 ? 0.0 : 100.0 * built / total;
+            bool b = object->add(it->first, make_counted<datum_t>(percent));
+            r_sanity_check(!b);
+        }
+        *progress_out = counted_t<const datum_t>(object.release());
+    }
 
     return counted_t<const datum_t>(array.release());
 }
@@ -59,9 +59,13 @@ public:
         const std::vector<counted_t<const datum_t> > &replacement_values,
         bool upsert);
 
-    MUST_USE bool sindex_create(const std::string &name, counted_t<func_t> index_func);
+    MUST_USE bool sindex_create(const std::string &name, counted_t<func_t> index_func,
+                                sindex_multi_bool_t multi,
+                                const boost::optional<std::vector<std::string> > &projection);
     MUST_USE bool sindex_drop(const std::string &name);
-    counted_t<const datum_t> sindex_list();
+    // If `progress_out` isn't NULL, it gets an object mapping each index that
+    // is still being built to the percentage of the table it has indexed so far.
+    counted_t<const datum_t> sindex_list(counted_t<const datum_t> *progress_out = NULL);
 
     counted_t<const db_t> db;
     const std::string name;
@@ -84,6 +88,8 @@ private:
     std::vector<counted_t<const datum_t> > batch_replace(
         const std::vector<datum_func_pair_t> &replacements);
 
+    void do_sindex_list(rdb_protocol_t::sindex_list_response_t *response_out);
+
     counted_t<const datum_t> do_replace(counted_t<const datum_t> orig,
                                         const map_wire_func_t &mwf);
     counted_t<const datum_t> do_replace(counted_t<const datum_t> orig,
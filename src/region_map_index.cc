@@ -0,0 +1,64 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "region_map_index.hpp"
+
+#include <algorithm>
+
+void region_index_t<hash_region_t<key_range_t> >::reset(const std::vector<hash_region_t<key_range_t> > &_regions) {
+    regions = _regions;
+
+    boundaries.clear();
+    for (size_t i = 0; i < regions.size(); ++i) {
+        boundaries.push_back(regions[i].inner.left);
+        if (!regions[i].inner.right.unbounded) {
+            boundaries.push_back(regions[i].inner.right.key);
+        }
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    covering.assign(boundaries.size(), std::vector<size_t>());
+    for (size_t i = 0; i < regions.size(); ++i) {
+        if (region_is_empty(regions[i])) {
+            continue;
+        }
+        const key_range_t &inner = regions[i].inner;
+        size_t first = std::lower_bound(boundaries.begin(), boundaries.end(), inner.left) - boundaries.begin();
+        size_t last = inner.right.unbounded
+            ? boundaries.size()
+            : std::lower_bound(boundaries.begin(), boundaries.end(), inner.right.key) - boundaries.begin();
+        for (size_t slice = first; slice < last; ++slice) {
+            covering[slice].push_back(i);
+        }
+    }
+}
+
+void region_index_t<hash_region_t<key_range_t> >::find_overlapping(const hash_region_t<key_range_t> &region, std::vector<size_t> *positions_out) const {
+    if (region_is_empty(region) || boundaries.empty()) {
+        return;
+    }
+
+    /* Start at the slice that contains `region.inner.left`; if it's to the left
+    of every boundary, no region covers it, so start at the first slice. */
+    std::vector<store_key_t>::const_iterator start =
+        std::upper_bound(boundaries.begin(), boundaries.end(), region.inner.left);
+    size_t first = start == boundaries.begin() ? 0 : (start - boundaries.begin()) - 1;
+    size_t last = region.inner.right.unbounded
+        ? boundaries.size()
+        : std::lower_bound(boundaries.begin(), boundaries.end(), region.inner.right.key) - boundaries.begin();
+
+    size_t found_before = positions_out->size();
+    for (size_t slice = first; slice < last; ++slice) {
+        for (std::vector<size_t>::const_iterator it = covering[slice].begin(); it != covering[slice].end(); ++it) {
+            const hash_region_t<key_range_t> &candidate = regions[*it];
+            if (candidate.beg < region.end && region.beg < candidate.end) {
+                positions_out->push_back(*it);
+            }
+        }
+    }
+
+    /* A region that spans several slices shows up once for each of them. */
+    if (last - first > 1) {
+        std::sort(positions_out->begin() + found_before, positions_out->end());
+        positions_out->erase(std::unique(positions_out->begin() + found_before, positions_out->end()), positions_out->end());
+    }
+}
@@ -0,0 +1,90 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef REGION_MAP_INDEX_HPP_
+#define REGION_MAP_INDEX_HPP_
+
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "hash_region.hpp"
+#include "memcached/region.hpp"
+#include "protocol_api.hpp"
+
+/* `region_index_t` answers "which of these regions overlap this one?" For most
+region types it just checks every region, but for `hash_region_t<key_range_t>`,
+which is what real tables are sharded by, it keeps the regions' key boundaries
+sorted so that a lookup costs O(log n) plus the number of regions found. */
+
+template <class region_t>
+class region_index_t {
+public:
+    void reset(const std::vector<region_t> &_regions) {
+        regions = _regions;
+    }
+
+    /* Appends the positions (in the vector passed to `reset()`) of the regions
+    that overlap `region` to `positions_out`, in increasing order. */
+    void find_overlapping(const region_t &region, std::vector<size_t> *positions_out) const {
+        for (size_t i = 0; i < regions.size(); ++i) {
+            if (region_overlaps(regions[i], region)) {
+                positions_out->push_back(i);
+            }
+        }
+    }
+
+private:
+    std::vector<region_t> regions;
+};
+
+template <>
+class region_index_t<hash_region_t<key_range_t> > {
+public:
+    void reset(const std::vector<hash_region_t<key_range_t> > &_regions);
+
+    void find_overlapping(const hash_region_t<key_range_t> &region, std::vector<size_t> *positions_out) const;
+
+private:
+    std::vector<hash_region_t<key_range_t> > regions;
+
+    /* Every left and (bounded) right key of `regions`, sorted and without
+    duplicates. They cut the key space into slices; slice `i` runs from
+    `boundaries[i]` up to `boundaries[i + 1]`, and the last one is unbounded. */
+    std::vector<store_key_t> boundaries;
+
+    /* `covering[i]` holds the positions of the regions whose keys include slice
+    `i`, in increasing order. */
+    std::vector<std::vector<size_t> > covering;
+};
+
+/* `region_map_index_t` is a `region_index_t` over the regions of a
+`region_map_t`. The map doesn't know about the index, so whoever changes the map
+must call `rebuild()` afterwards. */
+template <class protocol_t, class value_t>
+class region_map_index_t {
+public:
+    explicit region_map_index_t(const region_map_t<protocol_t, value_t> *_map) : map(_map) {
+        rebuild();
+    }
+
+    void rebuild() {
+        std::vector<typename protocol_t::region_t> regions;
+        regions.reserve(map->size());
+        for (typename region_map_t<protocol_t, value_t>::const_iterator it = map->begin(); it != map->end(); ++it) {
+            regions.push_back(it->first);
+        }
+        index.reset(regions);
+    }
+
+    /* Appends the positions (for `region_map_t::get_nth()`) of the map entries
+    that overlap `region`, in increasing order. */
+    void find_overlapping(const typename protocol_t::region_t &region, std::vector<size_t> *positions_out) const {
+        index.find_overlapping(region, positions_out);
+    }
+
+private:
+    const region_map_t<protocol_t, value_t> *map;
+    region_index_t<typename protocol_t::region_t> index;
+
+    DISABLE_COPYING(region_map_index_t);
+};
+
+#endif  // REGION_MAP_INDEX_HPP_
@@ -50,10 +50,12 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
                                      int port,
                                      message_handler_t *mh,
                                      int client_port,
-                                     heartbeat_manager_t *_heartbeat_manager) THROWS_ONLY(address_in_use_exc_t) :
+                                     heartbeat_manager_t *_heartbeat_manager,
+                                     bool _compression_enabled) THROWS_ONLY(address_in_use_exc_t) :
     parent(p),
     message_handler(mh),
     heartbeat_manager(_heartbeat_manager),
+    compression_enabled(_compression_enabled),
 
     /* Create the socket to use when listening for connections from peers */
     cluster_listener_socket(new tcp_bound_socket_t(local_addresses, port)),
@@ -83,7 +85,7 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
     `connection_map` on each thread and notifying any listeners that we're now
     connected to ourself. The destructor will remove us from the
     `connection_map` and again notify any listeners. */
-    connection_to_ourself(this, parent->me, NULL, routing_table[parent->me]),
+    connection_to_ourself(this, parent->me, std::vector<tcp_conn_stream_t *>(), std::vector<bool>(), routing_table[parent->me]),
 
     listener(new tcp_listener_t(cluster_listener_socket.get(),
                                 boost::bind(&connectivity_cluster_t::run_t::on_new_connection,
@@ -109,14 +111,32 @@ void connectivity_cluster_t::run_t::join(peer_address_t address) THROWS_NOTHING
         auto_drainer_t::lock_t(&drainer)));
 }
 
-connectivity_cluster_t::run_t::connection_entry_t::connection_entry_t(run_t *p, peer_id_t id, tcp_conn_stream_t *c, peer_address_t a) THROWS_NOTHING :
-    conn(c), address(a), session_id(generate_uuid()),
+connectivity_cluster_t::run_t::connection_entry_t::connection_entry_t(run_t *p, peer_id_t id, const std::vector<tcp_conn_stream_t *> &l, const std::vector<bool> &compressed_lanes, peer_address_t a) THROWS_NOTHING :
+    conn(l.empty() ? NULL : l[0]), lanes(l), address(a), send_mutexes(l.size()),
+    deflaters(l.size()),
+    session_id(generate_uuid()),
     pm_collection(),
     pm_bytes_sent(secs_to_ticks(1), true),
     pm_collection_membership(&p->parent->connectivity_collection, &pm_collection, uuid_to_str(id.get_uuid())),
     pm_bytes_sent_membership(&pm_collection, &pm_bytes_sent, "bytes_sent"),
-    parent(p), peer(id),
-    entries(new one_per_thread_t<entry_installation_t>(this)) {
+    pm_compression_ratio(secs_to_ticks(1), false),
+    pm_compression_secs(secs_to_ticks(1), false),
+    pm_decompression_secs(secs_to_ticks(1), false),
+    pm_compression_membership(&pm_collection,
+        &pm_compression_ratio, "compression_ratio",
+        &pm_compression_secs, "compression_secs",
+        &pm_decompression_secs, "decompression_secs",
+        NULL),
+    parent(p), peer(id) {
+    guarantee(compressed_lanes.size() == l.size());
+    for (size_t i = 0; i < compressed_lanes.size(); ++i) {
+        if (compressed_lanes[i]) {
+            deflaters[i].init(new message_deflater_t);
+        }
+    }
+    /* This is what makes us visible, and listeners may send messages right
+    away, so everything has to be ready first. */
+    entries.init(new one_per_thread_t<entry_installation_t>(this));
     if (peer != parent->parent->me && parent->heartbeat_manager != NULL) {
         parent->heartbeat_manager->begin_peer_heartbeat(peer);
     }
@@ -131,8 +151,10 @@ connectivity_cluster_t::run_t::connection_entry_t::~connection_entry_t() THROWS_
     entries.reset();
 
     /* `~entry_installation_t` destroys the `auto_drainer_t`'s in entries,
-    so nothing can be holding the `send_mutex`. */
-    guarantee(!send_mutex.is_locked());
+    so nothing can be holding any of the `send_mutexes`. */
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        guarantee(!send_mutexes[i].is_locked());
+    }
 }
 
 static void ping_connection_watcher(peer_id_t peer, peers_list_callback_t *connect_disconnect_cb) THROWS_NOTHING {
@@ -375,37 +397,19 @@ bool is_similar_peer_address(const peer_address_t &left, const peer_address_t &r
     return left_loopback_only || right_loopback_only;
 }
 
-// We log error conditions as follows:
-// - silent: network error; conflict between parallel connections
-// - warning: invalid header
-// - error: id or address don't match expected id or address; deserialization range error; unknown error
-// In all cases we close the connection and quit.
-void connectivity_cluster_t::run_t::handle(
-        /* `conn` should remain valid until `handle()` returns.
-         * `handle()` does not take ownership of `conn`. */
-        keepalive_tcp_conn_stream_t *conn,
-        boost::optional<peer_id_t> expected_id,
-        boost::optional<peer_address_t> expected_address,
-        auto_drainer_t::lock_t drainer_lock,
-        bool *successful_join) THROWS_NOTHING
-{
-    parent->assert_thread();
-
-    // Get the name of our peer, for error reporting.
-    ip_address_t peer_addr;
-    std::string peerstr = "(unknown)";
-    if (!conn->get_underlying_conn()->getpeername(&peer_addr))
-        peerstr = peer_addr.as_dotted_decimal();
-    const char *peername = peerstr.c_str();
-
-    // Make sure that if we're ordered to shut down, any pending read
-    // or write gets interrupted.
-    cluster_conn_closing_subscription_t conn_closer_1(conn);
-    conn_closer_1.reset(drainer_lock.get_drain_signal());
-
-    // Each side sends a header followed by its own ID and address, then receives and checks the
-    // other side's.
+bool connectivity_cluster_t::run_t::exchange_handshake(
+        tcp_conn_stream_t *conn,
+        int32_t lane_index,
+        uuid_u lane_key,
+        const char *peername,
+        peer_id_t *other_id_out,
+        peer_address_t *other_address_out,
+        int32_t *other_lane_index_out,
+        uuid_u *other_lane_key_out,
+        bool *compressed_out) THROWS_NOTHING {
     {
+        const int32_t capabilities =
+            compression_enabled ? cluster_capability_compression : 0;
         write_message_t msg;
         msg.append(cluster_proto_header.c_str(), cluster_proto_header.length());
         msg << cluster_version;
@@ -413,8 +417,11 @@ void connectivity_cluster_t::run_t::handle(
         msg << cluster_build_mode;
         msg << parent->me;
         msg << routing_table[parent->me];
+        msg << lane_index;
+        msg << lane_key;
+        msg << capabilities;
         if (send_write_message(conn, &msg))
-            return; // network error.
+            return false; // network error.
     }
 
     // Receive & check header.
@@ -425,12 +432,12 @@ void connectivity_cluster_t::run_t::handle(
         for (uint64_t i = 0; i < cluster_proto_header.length(); i += r) {
             r = conn->read(buffer, std::min(buffer_size, int64_t(cluster_proto_header.length() - i)));
             if (-1 == r)
-                return; // network error.
+                return false; // network error.
             rassert(r >= 0);
             // If EOF or remote_header does not match header, terminate connection.
             if (0 == r || memcmp(cluster_proto_header.c_str() + i, buffer, r) != 0) {
                 logWRN("Received invalid clustering header from %s, closing connection -- something might be connecting to the wrong port.", peername);
-                return;
+                return false;
             }
         }
     }
@@ -443,36 +450,86 @@ void connectivity_cluster_t::run_t::handle(
         if (deserialize_and_check(conn, &remote_version, peername) ||
             deserialize_and_check(conn, &remote_arch_bitsize, peername),
             deserialize_and_check(conn, &remote_build_mode, peername))
-            return;
+            return false;
 
         if (remote_version != cluster_version) {
             logWRN("Connection attempt with a RethinkDB node of the wrong version,"
                    " local version: %s, remote version: %s, connection dropped\n",
                    cluster_version.c_str(), remote_version.c_str());
-            return;
+            return false;
         }
 
         if (remote_arch_bitsize != cluster_arch_bitsize) {
             logWRN("Connection attempt with a RethinkDB node of the wrong architecture,"
                    " local: %s, remote: %s, connection dropped\n",
                    cluster_arch_bitsize.c_str(), remote_arch_bitsize.c_str());
-            return;
+            return false;
         }
 
         if (remote_build_mode != cluster_build_mode) {
             logWRN("Connection attempt with a RethinkDB node of the wrong build mode,"
                    " local: %s, remote: %s, connection dropped\n",
                    cluster_build_mode.c_str(), remote_build_mode.c_str());
-            return;
+            return false;
         }
     }
 
-    // Receive id, address.
+    // Receive id, address, which lane this is, and what the peer supports.
+    int32_t other_capabilities;
+    if (deserialize_and_check(conn, other_id_out, peername) ||
+        deserialize_and_check(conn, other_address_out, peername) ||
+        deserialize_and_check(conn, other_lane_index_out, peername) ||
+        deserialize_and_check(conn, other_lane_key_out, peername) ||
+        deserialize_and_check(conn, &other_capabilities, peername))
+        return false;
+
+    *compressed_out = compression_enabled &&
+        (other_capabilities & cluster_capability_compression) != 0;
+
+    return true;
+}
+
+// We log error conditions as follows:
+// - silent: network error; conflict between parallel connections
+// - warning: invalid header
+// - error: id or address don't match expected id or address; deserialization range error; unknown error
+// In all cases we close the connection and quit.
+void connectivity_cluster_t::run_t::handle(
+        /* `conn` should remain valid until `handle()` returns.
+         * `handle()` does not take ownership of `conn`. */
+        keepalive_tcp_conn_stream_t *conn,
+        boost::optional<peer_id_t> expected_id,
+        boost::optional<peer_address_t> expected_address,
+        auto_drainer_t::lock_t drainer_lock,
+        bool *successful_join) THROWS_NOTHING
+{
+    parent->assert_thread();
+
+    // Get the name of our peer, for error reporting.
+    ip_address_t peer_addr;
+    std::string peerstr = "(unknown)";
+    const bool know_peer_addr = !conn->get_underlying_conn()->getpeername(&peer_addr);
+    if (know_peer_addr)
+        peerstr = peer_addr.as_dotted_decimal();
+    const char *peername = peerstr.c_str();
+
+    // Make sure that if we're ordered to shut down, any pending read
+    // or write gets interrupted.
+    cluster_conn_closing_subscription_t conn_closer_1(conn);
+    conn_closer_1.reset(drainer_lock.get_drain_signal());
+
+    // Each side sends a header followed by its own ID and address, then receives and checks the
+    // other side's.
     peer_id_t other_id;
     peer_address_t other_address;
-    if (deserialize_and_check(conn, &other_id, peername) ||
-        deserialize_and_check(conn, &other_address, peername))
+    int32_t other_lane_index;
+    uuid_u other_lane_key;
+    bool compressed;
+    if (!exchange_handshake(conn, 0, nil_uuid(), peername,
+                            &other_id, &other_address, &other_lane_index, &other_lane_key,
+                            &compressed)) {
         return;
+    }
 
     /* Sanity checks */
     if (other_id == parent->me) {
@@ -501,6 +558,14 @@ void connectivity_cluster_t::run_t::handle(
         return;
     }
 
+    if (other_lane_index != 0) {
+        /* This isn't a new session; the peer is adding a lane to one that's
+        already being set up. */
+        conn_closer_1.reset();
+        handle_incoming_lane(conn, other_id, other_lane_key, compressed, drainer_lock, peername);
+        return;
+    }
+
     // Just saying that we're still on the rpc listener thread.
     parent->assert_thread();
 
@@ -646,16 +711,67 @@ void connectivity_cluster_t::run_t::handle(
         }
     }
 
+    // We could pick a better way to pick a better thread, our choice
+    // now is hopefully a performance non-problem.
+    int chosen_thread = rng.randint(get_num_threads());
+
+    /* Set up the extra connections. We register to accept the peer's lanes
+    before we tell it our key, and it does the same, so neither side's lanes
+    can show up before the other side is ready for them. */
+    const int home_thread = get_thread_id();
+    incoming_lanes_t incoming(other_id);
+    object_buffer_t<map_insertion_sentry_t<uuid_u, incoming_lanes_t *> > incoming_lanes_sentry;
+    const uuid_u incoming_key = generate_uuid();
+    incoming_lanes_sentry.create(&incoming_lanes, incoming_key, &incoming);
+
+    uuid_u outgoing_key;
+    {
+        write_message_t msg;
+        msg << incoming_key;
+        if (send_write_message(conn, &msg))
+            return;         // network error
+    }
+    if (deserialize_and_check(conn, &outgoing_key, peername))
+        return;
+
+    /* When we connect from a fixed client port, every connection to the peer
+    has the same source and destination address, so we can only have one. */
+    const int num_lanes = cluster_client_port == 0 && know_peer_addr
+        ? CONNECTIVITY_CONNECTIONS_PER_PEER : 1;
+    outgoing_lanes_t outgoing(other_id, outgoing_key, num_lanes);
+    if (num_lanes > 1) {
+        for (int lane = 1; lane < num_lanes; ++lane) {
+            coro_t::spawn_sometime(boost::bind(
+                &connectivity_cluster_t::run_t::connect_lane, this,
+                peer_addr, other_address.port, lane,
+                (chosen_thread + lane) % get_num_threads(),
+                &outgoing, auto_drainer_t::lock_t(&outgoing.drainer), drainer_lock));
+        }
+        wait_any_t settled_or_draining(&outgoing.all_settled, drainer_lock.get_drain_signal());
+        settled_or_draining.wait_lazily_unordered();
+        if (drainer_lock.get_drain_signal()->is_pulsed()) {
+            return;
+        }
+    }
+
+    std::vector<tcp_conn_stream_t *> lanes(1, conn);
+    std::vector<bool> compressed_lanes(1, compressed);
+    for (int lane = 1; lane < num_lanes; ++lane) {
+        if (outgoing.conns[lane] != NULL) {
+            lanes.push_back(outgoing.conns[lane]);
+            compressed_lanes.push_back(outgoing.compressed[lane]);
+        }
+    }
+
     /* Now that we're about to switch threads, it's not safe to try to close
     the connection from this thread anymore. This is safe because we won't do
     anything that permanently blocks before setting up `conn_closer_2`. */
     conn_closer_1.reset();
 
-    // We could pick a better way to pick a better thread, our choice
-    // now is hopefully a performance non-problem.
-    int chosen_thread = rng.randint(get_num_threads());
-
-    cross_thread_signal_t connection_thread_drain_signal(drainer_lock.get_drain_signal(), chosen_thread);
+    /* If one of our lanes breaks, we have to assume that messages were lost on
+    it, so we end the whole session the same way as if `conn` had broken. */
+    wait_any_t stop_connection(drainer_lock.get_drain_signal(), &outgoing.lane_broken);
+    cross_thread_signal_t connection_thread_drain_signal(&stop_connection, chosen_thread);
 
     rethread_tcp_conn_stream_t unregister_conn(conn, INVALID_THREAD);
     on_thread_t conn_threader(chosen_thread);
@@ -670,43 +786,239 @@ void connectivity_cluster_t::run_t::handle(
         /* `connection_entry_t` is the public interface of this coroutine. Its
         constructor registers it in the `connectivity_cluster_t`'s connection
         map and notifies any connect listeners. */
-        connection_entry_t conn_structure(this, other_id, conn, other_address);
+        connection_entry_t conn_structure(this, other_id, lanes, compressed_lanes, other_address);
         object_buffer_t<heartbeat_keepalive_t> keepalive;
 
         if (heartbeat_manager != NULL) {
             keepalive.create(conn, heartbeat_manager, other_id);
         }
 
+        {
+            on_thread_t threader(home_thread);
+            incoming.entry = &conn_structure;
+            incoming.entry_ready.pulse();
+        }
+
         /* Main message-handling loop: read messages off the connection until
         it's closed, which may be due to network events, or the other end
         shutting down, or us shutting down. */
-        try {
-            while (true) {
-                /* For now, we use `std::string` for messages on the wire: it's
-                just a length and a byte vector. This is obviously slow and we
-                should change it when we care about performance. */
-                std::string message;
-                if (deserialize_and_check(conn, &message, peername))
-                    break;
-
-                std::vector<char> vec(message.begin(), message.end());
-                vector_read_stream_t stream(&vec);
-                message_handler->on_message(other_id, &stream); // might raise fake_archive_exc_t
-            }
-        } catch (const fake_archive_exc_t &) {
-            /* The exception broke us out of the loop, and that's what we
-            wanted. This could either be because we lost contact with the peer
-            or because the cluster is shutting down and `close_conn()` got
-            called. */
-        }
+        receive_messages(conn, other_id, compressed, &conn_structure, peername);
 
         guarantee(!conn->is_read_open(), "the connection is still open for "
             "read, which means we had a problem other than the TCP "
             "connection closing or dying");
 
+        /* Stop the peer's lanes before we tell anyone that the peer is gone,
+        so that no message from it shows up after the disconnect
+        notification. */
+        {
+            on_thread_t threader(home_thread);
+            incoming_lanes_sentry.reset();
+            incoming.drainer.reset();
+        }
+
         /* The `conn_structure` destructor removes us from the connection map
         and notifies any disconnect listeners. */
     }
+
+    /* `outgoing` is destroyed after we return to the home thread, which
+    closes our lanes to the peer. */
+}
+
+void connectivity_cluster_t::run_t::receive_messages(tcp_conn_stream_t *conn, peer_id_t other_id,
+        bool compressed, connection_entry_t *entry, const char *peername) THROWS_NOTHING {
+    scoped_ptr_t<message_inflater_t> inflater;
+    if (compressed) {
+        inflater.init(new message_inflater_t);
+    }
+    try {
+        while (true) {
+            /* Messages on the wire are serialized like a `std::string`: a
+            length and the bytes. We read the bytes straight into the vector
+            that we deserialize the message from. On a compressed connection,
+            the length is followed by a flag that says whether the message is
+            compressed, and a compressed message by its uncompressed length. */
+            int64_t size;
+            if (deserialize_and_check(conn, &size, peername))
+                break;
+            bool message_compressed = false;
+            int64_t uncompressed_size = size;
+            if (inflater.has()) {
+                if (deserialize_and_check(conn, &message_compressed, peername))
+                    break;
+                if (message_compressed &&
+                    deserialize_and_check(conn, &uncompressed_size, peername))
+                    break;
+            }
+            if (size < 0 || uncompressed_size < 0) {
+                logERR("could not deserialize data received from %s, closing connection", peername);
+                break;
+            }
+
+            std::vector<char> vec(size);
+            if (force_read(conn, vec.data(), size) != size)
+                break;
+            if (message_compressed) {
+                std::vector<char> uncompressed(uncompressed_size);
+                const ticks_t start_time = get_ticks();
+                if (!inflater->inflate_message(vec.data(), size,
+                                               uncompressed.data(), uncompressed_size)) {
+                    logERR("could not decompress data received from %s, closing connection", peername);
+                    break;
+                }
+                entry->pm_decompression_secs.record(ticks_to_secs(get_ticks() - start_time));
+                vec.swap(uncompressed);
+            }
+            vector_read_stream_t stream(&vec);
+            message_handler->on_message(other_id, &stream); // might raise fake_archive_exc_t
+        }
+    } catch (const fake_archive_exc_t &) {
+        /* The exception broke us out of the loop, and that's what we
+        wanted. This could either be because we lost contact with the peer
+        or because the cluster is shutting down and `close_conn()` got
+        called. */
+    }
+}
+
+void connectivity_cluster_t::run_t::handle_incoming_lane(
+        keepalive_tcp_conn_stream_t *conn,
+        peer_id_t other_id,
+        uuid_u lane_key,
+        bool compressed,
+        auto_drainer_t::lock_t drainer_lock,
+        const char *peername) THROWS_NOTHING {
+    parent->assert_thread();
+
+    std::map<uuid_u, incoming_lanes_t *>::iterator it = incoming_lanes.find(lane_key);
+    if (it == incoming_lanes.end() || it->second->peer != other_id) {
+        /* The session is gone already, or never existed. Either way the peer
+        will find out when we close the connection. */
+        return;
+    }
+    incoming_lanes_t *incoming = it->second;
+    auto_drainer_t::lock_t lanes_lock(incoming->drainer.get());
+
+    wait_any_t stop_lane(lanes_lock.get_drain_signal(), drainer_lock.get_drain_signal());
+    {
+        cluster_conn_closing_subscription_t conn_closer_1(conn);
+        conn_closer_1.reset(&stop_lane);
+
+        /* Tell the peer that we've got the lane, so it can start sending once
+        its session is up. */
+        {
+            write_message_t msg;
+            msg << true;
+            if (send_write_message(conn, &msg))
+                return;         // network error
+        }
+
+        wait_any_t ready_or_stopped(&incoming->entry_ready, &stop_lane);
+        ready_or_stopped.wait_lazily_unordered();
+        if (stop_lane.is_pulsed()) {
+            return;
+        }
+    }
+    connection_entry_t *entry = incoming->entry;
+
+    int lane_thread = rng.randint(get_num_threads());
+    cross_thread_signal_t lane_thread_stop_signal(&stop_lane, lane_thread);
+
+    rethread_tcp_conn_stream_t unregister_conn(conn, INVALID_THREAD);
+    on_thread_t conn_threader(lane_thread);
+    rethread_tcp_conn_stream_t reregister_conn(conn, get_thread_id());
+
+    cluster_conn_closing_subscription_t conn_closer_2(conn);
+    conn_closer_2.reset(&lane_thread_stop_signal);
+
+    receive_messages(conn, other_id, compressed, entry, peername);
+}
+
+void connectivity_cluster_t::run_t::connect_lane(
+        ip_address_t ip, int port,
+        int32_t lane_index,
+        int lane_thread,
+        outgoing_lanes_t *outgoing,
+        auto_drainer_t::lock_t outgoing_lock,
+        auto_drainer_t::lock_t drainer_lock) THROWS_NOTHING {
+    parent->assert_thread();
+    const int home_thread = get_thread_id();
+    std::string peerstr = ip.as_dotted_decimal();
+    const char *peername = peerstr.c_str();
+
+    wait_any_t stop_lane(outgoing_lock.get_drain_signal(), drainer_lock.get_drain_signal());
+    signal_timer_t setup_timeout(CONNECTIVITY_LANE_SETUP_TIMEOUT_MS);
+    wait_any_t setup_interruptor(&stop_lane, &setup_timeout);
+
+    /* Connect, handshake, and wait for the peer to acknowledge the lane. If any
+    of that fails, the session just goes on without this lane. */
+    scoped_ptr_t<keepalive_tcp_conn_stream_t> conn;
+    bool lane_ok = false;
+    bool lane_compressed = false;
+    try {
+        conn.init(new keepalive_tcp_conn_stream_t(ip, port, &setup_interruptor, 0));
+    } catch (const tcp_conn_t::connect_failed_exc_t &) {
+        /* Ignore */
+    } catch (const interrupted_exc_t &) {
+        /* Ignore */
+    }
+    if (conn.has()) {
+        cluster_conn_closing_subscription_t conn_closer_1(conn.get());
+        conn_closer_1.reset(&setup_interruptor);
+
+        peer_id_t remote_id;
+        peer_address_t remote_address;
+        int32_t remote_lane_index;
+        uuid_u remote_lane_key;
+        bool ack;
+        lane_ok = exchange_handshake(conn.get(), lane_index, outgoing->key, peername,
+                                     &remote_id, &remote_address,
+                                     &remote_lane_index, &remote_lane_key,
+                                     &lane_compressed) &&
+            remote_id == outgoing->peer &&
+            !deserialize_and_check(conn.get(), &ack, peername) &&
+            !setup_interruptor.is_pulsed();
+    }
+
+    if (!lane_ok) {
+        if (++outgoing->num_settled == static_cast<int>(outgoing->conns.size()) - 1) {
+            outgoing->all_settled.pulse();
+        }
+        return;
+    }
+
+    cross_thread_signal_t lane_thread_stop_signal(&stop_lane, lane_thread);
+    {
+        rethread_tcp_conn_stream_t unregister_conn(conn.get(), INVALID_THREAD);
+        on_thread_t conn_threader(lane_thread);
+        rethread_tcp_conn_stream_t reregister_conn(conn.get(), get_thread_id());
+
+        cluster_conn_closing_subscription_t conn_closer_2(conn.get());
+        conn_closer_2.reset(&lane_thread_stop_signal);
+
+        {
+            on_thread_t threader(home_thread);
+            outgoing->conns[lane_index] = conn.get();
+            outgoing->compressed[lane_index] = lane_compressed;
+            if (++outgoing->num_settled == static_cast<int>(outgoing->conns.size()) - 1) {
+                outgoing->all_settled.pulse();
+            }
+        }
+
+        /* The peer never sends anything over our lanes, so this only returns
+        once the lane has been closed, by either side. */
+        char dummy;
+        UNUSED int64_t res = conn->read(&dummy, 1);
+    }
+
+    if (!stop_lane.is_pulsed() && !outgoing->lane_broken.is_pulsed()) {
+        outgoing->lane_broken.pulse();
+    }
+
+    /* The session's `connection_entry_t` still points at `conn`, and senders
+    may be using it even though the lane is closed. `outgoing` is only
+    destroyed after the `connection_entry_t`, so `conn` has to stay around
+    until then. */
+    outgoing_lock.get_drain_signal()->wait_lazily_unordered();
 }
 
 connectivity_cluster_t::connectivity_cluster_t() THROWS_NOTHING :
@@ -759,10 +1071,9 @@ void connectivity_cluster_t::send_message(peer_id_t dest, send_message_write_cal
 
     guarantee(!dest.is_nil());
 
-    /* We currently write the message to a vector_stream_t, then
-       serialize that as a string. It's horribly inefficient, of course. */
-    // TODO: If we don't do it this way, we (or the caller) will need
-    // to worry about having the writer run on the connection thread.
+    /* We write the message to a vector_stream_t first, so that we know its
+       length before we send it, and so that the writer doesn't have to run on
+       the connection thread. The vector then goes out over the wire as-is. */
     vector_stream_t buffer;
     {
         ASSERT_FINITE_CORO_WAITING;
@@ -818,24 +1129,60 @@ void connectivity_cluster_t::send_message(peer_id_t dest, send_message_write_cal
 
     } else {
         guarantee(dest != me);
-        on_thread_t threader(conn_structure->conn->home_thread());
 
-        /* Acquire the send-mutex so we don't collide with other things trying
-        to send on the same connection. */
-        mutex_t::acq_t acq(&conn_structure->send_mutex);
+        /* Messages with the same ordering key always go over the same lane, so
+        they stay in order. Keyless messages all go over the session's own
+        connection, in order with each other. */
+        const uint64_t ordering_key = callback->get_ordering_key();
+        const size_t num_lanes = conn_structure->lanes.size();
+        size_t lane = 0;
+        if (ordering_key != 0 && num_lanes > 1) {
+            lane = 1 + ((ordering_key * 0x9E3779B97F4A7C15ULL) >> 32) % (num_lanes - 1);
+        }
+        tcp_conn_stream_t *lane_conn = conn_structure->lanes[lane];
+
+        on_thread_t threader(lane_conn->home_thread());
+
+        /* Acquire the lane's send-mutex so we don't collide with other things
+        trying to send on the same connection. */
+        mutex_t::acq_t acq(&conn_structure->send_mutexes[lane]);
 
         {
+            /* This is the same as serializing the buffer as a `std::string`,
+            but without copying it. See `receive_messages()` for how compressed
+            connections differ. */
             write_message_t msg;
-            std::string buffer_str(buffer.vector().begin(), buffer.vector().end());
-            msg << buffer_str;
-            int res = send_write_message(conn_structure->conn, &msg);
-            conn_structure->pm_bytes_sent.record(buffer.vector().size());
+            int64_t size = buffer.vector().size();
+            message_deflater_t *deflater = conn_structure->deflaters[lane].get_or_null();
+            std::vector<char> compressed;
+            if (deflater == NULL) {
+                msg << size;
+                msg.append_reference(buffer.vector().data(), size);
+            } else if (size < CLUSTER_COMPRESSION_THRESHOLD_BYTES) {
+                msg << size;
+                msg << false;
+                msg.append_reference(buffer.vector().data(), size);
+            } else {
+                const ticks_t start_time = get_ticks();
+                deflater->deflate_message(buffer.vector().data(), size, &compressed);
+                conn_structure->pm_compression_secs.record(ticks_to_secs(get_ticks() - start_time));
+                conn_structure->pm_compression_ratio.record(
+                    static_cast<double>(compressed.size()) / size);
+                int64_t compressed_size = compressed.size();
+                msg << compressed_size;
+                msg << true;
+                msg << size;
+                msg.append_reference(compressed.data(), compressed_size);
+            }
+            int res = send_write_message(lane_conn, &msg);
+            conn_structure->pm_bytes_sent.record(msg.size());
             if (res) {
                 /* Close the other half of the connection to make sure that
                    `connectivity_cluster_t::run_t::handle()` notices that something is
-                   up */
-                if (conn_structure->conn->is_read_open()) {
-                    conn_structure->conn->shutdown_read();
+                   up. (If it's one of the extra lanes, `connect_lane()` notices
+                   and takes the whole session down.) */
+                if (lane_conn->is_read_open()) {
+                    lane_conn->shutdown_read();
                 }
             }
         }
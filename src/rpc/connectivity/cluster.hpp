@@ -10,6 +10,7 @@
 
 #include "arch/types.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/one_per_thread.hpp"
 #include "concurrency/semaphore.hpp"
 #include "containers/archive/tcp_conn_stream.hpp"
@@ -18,6 +19,7 @@
 #include "rpc/connectivity/connectivity.hpp"
 #include "rpc/connectivity/messages.hpp"
 #include "rpc/connectivity/heartbeat.hpp"
+#include "rpc/connectivity/compression.hpp"
 #include "containers/uuid.hpp"
 
 namespace boost {
@@ -100,6 +102,12 @@ public:
     static const std::string cluster_arch_bitsize;
     static const std::string cluster_build_mode;
 
+    /* Bits for the capabilities that each side of a connection advertises in its
+    handshake. A feature is only used on a connection if both sides advertise it,
+    so nodes that don't support it (or have it turned off) can still talk to the
+    ones that do. */
+    static const int32_t cluster_capability_compression = 1;
+
     class run_t {
     public:
         run_t(connectivity_cluster_t *parent,
@@ -107,7 +115,8 @@ public:
               int port,
               message_handler_t *message_handler,
               int client_port,
-              heartbeat_manager_t *_heartbeat_manager) THROWS_ONLY(address_in_use_exc_t);
+              heartbeat_manager_t *_heartbeat_manager,
+              bool _compression_enabled = true) THROWS_ONLY(address_in_use_exc_t);
 
         ~run_t();
 
@@ -124,19 +133,31 @@ public:
         public:
             /* The constructor registers us in every thread's `connection_map`;
             the destructor deregisters us. Both also notify all subscribers. */
-            connection_entry_t(run_t *, peer_id_t, tcp_conn_stream_t *, peer_address_t) THROWS_NOTHING;
+            connection_entry_t(run_t *, peer_id_t, const std::vector<tcp_conn_stream_t *> &,
+                               const std::vector<bool> &compressed_lanes, peer_address_t) THROWS_NOTHING;
             ~connection_entry_t() THROWS_NOTHING;
 
             /* NULL for our "connection" to ourself */
             tcp_conn_stream_t *conn;
 
+            /* All the connections we send messages to the peer over. `lanes[0]`
+            is `conn`; the others are the extra connections we opened to the
+            peer, each on its own thread. Empty for our connection to ourself. */
+            std::vector<tcp_conn_stream_t *> lanes;
+
             /* `connection_t` contains a `peer_address_t` so that we can call
             `get_peers_list()` on any thread. Otherwise, we would have to go
             cross-thread to access the routing table. */
             peer_address_t address;
 
-            /* Unused for our connection to ourself */
-            mutex_t send_mutex;
+            /* One per lane. Unused for our connection to ourself */
+            scoped_array_t<mutex_t> send_mutexes;
+
+            /* One per lane; empty for the lanes where we didn't agree on
+            compression with the peer. Only used while holding the lane's send
+            mutex, because messages have to be deflated in the order in which
+            they go out. */
+            scoped_array_t<scoped_ptr_t<message_deflater_t> > deflaters;
 
             uuid_u session_id;
 
@@ -144,6 +165,13 @@ public:
             perfmon_sampler_t pm_bytes_sent;
             perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
 
+            /* The ratio of compressed to uncompressed size, and how long it takes
+            to compress and decompress a message, for the messages that we
+            compress. */
+            perfmon_sampler_t pm_compression_ratio;
+            perfmon_sampler_t pm_compression_secs, pm_decompression_secs;
+            perfmon_multi_membership_t pm_compression_membership;
+
         private:
             /* We only hold this information so we can deregister ourself */
             run_t *parent;
@@ -185,6 +213,63 @@ public:
             DISABLE_COPYING(variable_setter_t);
         };
 
+        /* Besides the connection that `handle()` runs the session on, we open
+        `CONNECTIVITY_CONNECTIONS_PER_PEER - 1` extra connections ("lanes") to
+        each peer, so that messages to different mailboxes can be sent in
+        parallel from different threads. Each side only sends on the lanes it
+        opened itself. The accepting side registers an `incoming_lanes_t` under
+        a random key and tells the peer the key; the peer presents it when it
+        opens its lanes. */
+        class incoming_lanes_t {
+        public:
+            explicit incoming_lanes_t(peer_id_t p) : peer(p), entry(NULL), drainer(new auto_drainer_t) { }
+            peer_id_t peer;
+
+            /* Pulsed once the session's `connection_entry_t` exists. Lanes
+            don't deliver any messages before then. */
+            cond_t entry_ready;
+
+            /* The session's `connection_entry_t`, for its stats. Set before
+            `entry_ready` is pulsed. */
+            connection_entry_t *entry;
+
+            /* Incoming lanes hold a lock on this. The session resets it before
+            it destroys its `connection_entry_t`, so that no lane delivers a
+            message after the disconnect notification. */
+            scoped_ptr_t<auto_drainer_t> drainer;
+        };
+
+        class outgoing_lanes_t {
+        public:
+            outgoing_lanes_t(peer_id_t p, uuid_u k, int num_lanes) :
+                peer(p), key(k), conns(num_lanes, NULL), compressed(num_lanes, false),
+                num_settled(0) { }
+            peer_id_t peer;
+
+            /* The key the peer gave us to present when we open a lane. */
+            uuid_u key;
+
+            /* `conns[0]` is unused; it stands for the session's own connection.
+            The others are NULL if the lane couldn't be set up. */
+            std::vector<tcp_conn_stream_t *> conns;
+
+            /* Whether we and the peer agreed to compress messages on each lane. */
+            std::vector<bool> compressed;
+
+            /* Pulsed once every lane has either been set up or given up. */
+            int num_settled;
+            cond_t all_settled;
+
+            /* Pulsed if a lane is closed while the session is still running.
+            The session then shuts down, since messages might have been lost. */
+            cond_t lane_broken;
+
+            /* Outgoing lanes hold a lock on this, and keep their connections
+            open until it drains. It must be destroyed after the
+            `connection_entry_t`, so that nobody is sending on the lanes anymore. */
+            auto_drainer_t drainer;
+        };
+
         void on_new_connection(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn, auto_drainer_t::lock_t lock) THROWS_NOTHING;
 
         /* `connectivity_cluster_t::connect_to_peer` is spawned for each known
@@ -216,12 +301,56 @@ public:
             auto_drainer_t::lock_t,
             bool *successful_join) THROWS_NOTHING;
 
+        /* Sends our handshake over `conn` and receives and checks the peer's.
+        `lane_index` is 0 unless `conn` is an extra connection for a session
+        that's already running, in which case `lane_key` is the key the peer
+        gave us for that session. `*compressed_out` is set to whether both
+        sides support compressing messages on `conn`. Returns false if the
+        connection should be closed. */
+        bool exchange_handshake(tcp_conn_stream_t *conn,
+            int32_t lane_index,
+            uuid_u lane_key,
+            const char *peername,
+            peer_id_t *other_id_out,
+            peer_address_t *other_address_out,
+            int32_t *other_lane_index_out,
+            uuid_u *other_lane_key_out,
+            bool *compressed_out) THROWS_NOTHING;
+
+        /* Delivers the messages that arrive over `conn` to `message_handler`
+        until the connection is closed. If `compressed` is true, the peer may
+        send compressed messages over `conn`; `entry` is the session's
+        `connection_entry_t`, which keeps the stats. */
+        void receive_messages(tcp_conn_stream_t *conn, peer_id_t other_id,
+            bool compressed, connection_entry_t *entry,
+            const char *peername) THROWS_NOTHING;
+
+        /* `handle_incoming_lane()` is called by `handle()` when the peer opened
+        `conn` as an extra connection for the session registered under
+        `lane_key`. `connect_lane()` is spawned by `handle()` for each extra
+        connection we open to the peer. */
+        void handle_incoming_lane(keepalive_tcp_conn_stream_t *conn,
+            peer_id_t other_id,
+            uuid_u lane_key,
+            bool compressed,
+            auto_drainer_t::lock_t drainer_lock,
+            const char *peername) THROWS_NOTHING;
+        void connect_lane(ip_address_t ip, int port,
+            int32_t lane_index,
+            int lane_thread,
+            outgoing_lanes_t *outgoing,
+            auto_drainer_t::lock_t outgoing_lock,
+            auto_drainer_t::lock_t drainer_lock) THROWS_NOTHING;
+
         connectivity_cluster_t *parent;
 
         message_handler_t *message_handler;
 
         heartbeat_manager_t *heartbeat_manager;
 
+        /* Whether we offer to compress messages to peers. */
+        bool compression_enabled;
+
         /* `attempt_table` is a table of all the host:port pairs we're currently
         trying to connect to or have connected to. If we are told to connect to
         an address already in this table, we'll just ignore it. That's important
@@ -237,6 +366,10 @@ public:
         `parent->thread_info.get()->connection_map`. */
         std::map<peer_id_t, peer_address_t> routing_table;
 
+        /* The sessions that are currently accepting extra connections, by the
+        key that we gave the peer. */
+        std::map<uuid_u, incoming_lanes_t *> incoming_lanes;
+
         /* Writes to `routing_table` are protected by this mutex so we never get
         redundant connections to the same peer. */
         mutex_t new_connection_mutex;
@@ -0,0 +1,68 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "rpc/connectivity/compression.hpp"
+
+#include <limits.h>
+#include <string.h>
+
+#include "config/args.hpp"
+
+message_deflater_t::message_deflater_t() {
+    memset(&stream, 0, sizeof(stream));
+    int res = deflateInit(&stream, CLUSTER_COMPRESSION_LEVEL);
+    guarantee(res == Z_OK, "deflateInit() failed (%d)", res);
+}
+
+message_deflater_t::~message_deflater_t() {
+    deflateEnd(&stream);
+}
+
+void message_deflater_t::deflate_message(const char *data, size_t size, std::vector<char> *out) {
+    guarantee(size <= UINT_MAX);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = size;
+
+    /* `deflateBound()` is meant for a whole stream, so it's only a guess here; if
+    the flush doesn't fit, we just grow the buffer and go around again. */
+    out->resize(deflateBound(&stream, size) + 16);
+    size_t used = 0;
+    while (true) {
+        stream.next_out = reinterpret_cast<Bytef *>(out->data() + used);
+        stream.avail_out = out->size() - used;
+        int res = deflate(&stream, Z_SYNC_FLUSH);
+        guarantee(res == Z_OK || res == Z_BUF_ERROR, "deflate() failed (%d)", res);
+        used = out->size() - stream.avail_out;
+        if (stream.avail_out != 0) {
+            break;
+        }
+        out->resize(out->size() * 2);
+    }
+    rassert(stream.avail_in == 0);
+    out->resize(used);
+}
+
+message_inflater_t::message_inflater_t() {
+    memset(&stream, 0, sizeof(stream));
+    int res = inflateInit(&stream);
+    guarantee(res == Z_OK, "inflateInit() failed (%d)", res);
+}
+
+message_inflater_t::~message_inflater_t() {
+    inflateEnd(&stream);
+}
+
+bool message_inflater_t::inflate_message(const char *data, size_t size, char *out, size_t out_size) {
+    guarantee(size <= UINT_MAX && out_size <= UINT_MAX);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef *>(out);
+    stream.avail_out = out_size;
+    while (stream.avail_in != 0) {
+        /* If the message decompresses to more than `out_size` bytes, this fails
+        with `Z_BUF_ERROR` once `out` is full. */
+        int res = inflate(&stream, Z_SYNC_FLUSH);
+        if (res != Z_OK) {
+            return false;
+        }
+    }
+    return stream.avail_out == 0;
+}
@@ -0,0 +1,51 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_COMPRESSION_HPP_
+#define RPC_CONNECTIVITY_COMPRESSION_HPP_
+
+#include <zlib.h>
+
+#include <vector>
+
+#include "errors.hpp"
+
+/* When both ends of a cluster connection support it, big messages are deflated
+before they go out over the connection. Each direction of a connection has a single
+zlib stream that lasts as long as the connection does, so a message can refer back
+to the ones that came before it; that's what makes a stream of similar messages, such
+as backfill chunks of documents from the same table, compress well. Every message is
+flushed to a byte boundary, so the receiver can decode it as soon as it arrives.
+
+Messages must be inflated in the same order that they were deflated, and both
+classes must only be used by one coroutine at a time. */
+
+class message_deflater_t {
+public:
+    message_deflater_t();
+    ~message_deflater_t();
+
+    /* Replaces the contents of `out` with the compressed form of `data`. */
+    void deflate_message(const char *data, size_t size, std::vector<char> *out);
+
+private:
+    z_stream stream;
+
+    DISABLE_COPYING(message_deflater_t);
+};
+
+class message_inflater_t {
+public:
+    message_inflater_t();
+    ~message_inflater_t();
+
+    /* Decompresses a message that `message_deflater_t::deflate_message()` made on
+    the other end into `out`, which must be exactly as big as the original message.
+    Returns false if the data is corrupt or doesn't decompress to `out_size` bytes. */
+    bool inflate_message(const char *data, size_t size, char *out, size_t out_size);
+
+private:
+    z_stream stream;
+
+    DISABLE_COPYING(message_inflater_t);
+};
+
+#endif  // RPC_CONNECTIVITY_COMPRESSION_HPP_
@@ -2,6 +2,8 @@
 #ifndef RPC_CONNECTIVITY_MESSAGES_HPP_
 #define RPC_CONNECTIVITY_MESSAGES_HPP_
 
+#include <stdint.h>
+
 class connectivity_service_t;
 class peer_id_t;
 class read_stream_t;
@@ -49,6 +51,13 @@ class send_message_write_callback_t {
 public:
     virtual ~send_message_write_callback_t() { }
     virtual void write(write_stream_t *stream) = 0;
+
+    /* Messages to the same peer that have the same ordering key are delivered
+    in the order they were sent in; messages with different keys may overtake
+    each other. The default key of 0 is for traffic that has to stay in order
+    with all other keyless traffic (directory, semilattice metadata,
+    heartbeats, ...). */
+    virtual uint64_t get_ordering_key() { return 0; }
 };
 
 class message_service_t  {
@@ -80,6 +80,10 @@ public:
         subwriter->write(os);
     }
 
+    uint64_t get_ordering_key() {
+        return subwriter->get_ordering_key();
+    }
+
 private:
     message_multiplexer_t::tag_t tag;
     send_message_write_callback_t *subwriter;
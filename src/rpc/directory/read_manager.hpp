@@ -3,9 +3,11 @@
 #define RPC_DIRECTORY_READ_MANAGER_HPP_
 
 #include <map>
+#include <string>
 
 #include "errors.hpp"
 #include <boost/ptr_container/ptr_map.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/fifo_enforcer.hpp"
@@ -14,6 +16,7 @@
 #include "containers/scoped.hpp"
 #include "rpc/connectivity/connectivity.hpp"
 #include "rpc/connectivity/messages.hpp"
+#include "rpc/directory/update.hpp"
 
 template<class metadata_t>
 class directory_read_manager_t :
@@ -33,11 +36,15 @@ private:
     when they disconnect. A new `session_t` is created if they reconnect. */
     class session_t {
     public:
-        explicit session_t(uuid_u si) : session_id(si) { }
+        explicit session_t(uuid_u si) : session_id(si), serialized_value_version(0) { }
         /* We get this by calling `get_connection_session_id()` on the
         `connectivity_service_t` from `super_connectivity_service`. */
         const uuid_u session_id;
         cond_t got_initial_message;
+        /* The peer's metadata in the form it was sent to us in. Updates from the peer
+        are applied to this in FIFO order and then deserialized. */
+        std::string serialized_value;
+        uint64_t serialized_value_version;
         scoped_ptr_t<fifo_enforcer_sink_t> metadata_fifo_sink;
         auto_drainer_t drainer;
     };
@@ -54,8 +61,8 @@ private:
     void on_disconnect(peer_id_t peer) THROWS_NOTHING;
 
     /* These are meant to be spawned in new coroutines */
-    void propagate_initialization(peer_id_t peer, uuid_u session_id, metadata_t new_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING;
-    void propagate_update(peer_id_t peer, uuid_u session_id, metadata_t new_value, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING;
+    void propagate_initialization(peer_id_t peer, uuid_u session_id, boost::shared_ptr<directory_update_t> initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING;
+    void propagate_update(peer_id_t peer, uuid_u session_id, boost::shared_ptr<directory_update_t> update, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING;
     void interrupt_updates_and_free_session(session_t *session, auto_drainer_t::lock_t global_keepalive) THROWS_NOTHING;
 
     /* The connectivity service telling us which peers are connected */
@@ -43,10 +43,10 @@ void directory_read_manager_t<metadata_t>::on_message(peer_id_t source_peer, rea
     switch (code) {
         case 'I': {
             /* Initial message from another peer */
-            metadata_t initial_value = metadata_t();
+            boost::shared_ptr<directory_update_t> initial_value(new directory_update_t);
             fifo_enforcer_state_t metadata_fifo_state;
             {
-                int res = deserialize(s, &initial_value);
+                int res = deserialize(s, initial_value.get());
                 guarantee(!res);  // In the spirit of unreachable...
                 res = deserialize(s, &metadata_fifo_state);
                 guarantee(!res);
@@ -65,10 +65,10 @@ void directory_read_manager_t<metadata_t>::on_message(peer_id_t source_peer, rea
 
         case 'U': {
             /* Update from another peer */
-            metadata_t new_value = metadata_t();
+            boost::shared_ptr<directory_update_t> update(new directory_update_t);
             fifo_enforcer_write_token_t metadata_fifo_token;
             {
-                int res = deserialize(s, &new_value);
+                int res = deserialize(s, update.get());
                 guarantee(!res);  // In the spirit of unreachable...
                 res = deserialize(s, &metadata_fifo_token);
                 guarantee(!res);  // In the spirit of unreachable...
@@ -81,7 +81,7 @@ void directory_read_manager_t<metadata_t>::on_message(peer_id_t source_peer, rea
             coro_t::spawn_sometime(boost::bind(
                 &directory_read_manager_t::propagate_update, this,
                 source_peer, connectivity_service->get_connection_session_id(source_peer),
-                new_value, metadata_fifo_token,
+                update, metadata_fifo_token,
                 auto_drainer_t::lock_t(per_thread_drainers.get())));
 
             break;
@@ -123,7 +123,7 @@ void directory_read_manager_t<metadata_t>::on_disconnect(peer_id_t peer) THROWS_
 }
 
 template<class metadata_t>
-void directory_read_manager_t<metadata_t>::propagate_initialization(peer_id_t peer, uuid_u session_id, metadata_t initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING {
+void directory_read_manager_t<metadata_t>::propagate_initialization(peer_id_t peer, uuid_u session_id, boost::shared_ptr<directory_update_t> initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING {
     per_thread_keepalive.assert_is_holding(per_thread_drainers.get());
     on_thread_t thread_switcher(home_thread());
 
@@ -142,13 +142,18 @@ void directory_read_manager_t<metadata_t>::propagate_initialization(peer_id_t pe
         return;
     }
 
+    guarantee(initial_value->is_full());
+    initial_value->apply(&session->serialized_value_version, &session->serialized_value);
+    metadata_t value = metadata_t();
+    deserialize_directory_value(session->serialized_value, &value);
+
     /* Notify that the peer has connected */
     {
         DEBUG_VAR mutex_assertion_t::acq_t acq(&variable_lock);
         std::map<peer_id_t, metadata_t> map = variable.get_watchable()->get();
 
         std::pair<typename std::map<peer_id_t, metadata_t>::iterator, bool> res
-            = map.insert(std::make_pair(peer, initial_value));
+            = map.insert(std::make_pair(peer, value));
         guarantee(res.second);
 
         variable.set_value(map);
@@ -164,7 +169,7 @@ void directory_read_manager_t<metadata_t>::propagate_initialization(peer_id_t pe
 }
 
 template<class metadata_t>
-void directory_read_manager_t<metadata_t>::propagate_update(peer_id_t peer, uuid_u session_id, metadata_t new_value, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING {
+void directory_read_manager_t<metadata_t>::propagate_update(peer_id_t peer, uuid_u session_id, boost::shared_ptr<directory_update_t> update, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t per_thread_keepalive) THROWS_NOTHING {
     per_thread_keepalive.assert_is_holding(per_thread_drainers.get());
     on_thread_t thread_switcher(home_thread());
 
@@ -199,6 +204,10 @@ void directory_read_manager_t<metadata_t>::propagate_update(peer_id_t peer, uuid
                                                      metadata_fifo_token);
         wait_interruptible(&fifo_exit, session_keepalive.get_drain_signal());
 
+        update->apply(&session->serialized_value_version, &session->serialized_value);
+        metadata_t new_value = metadata_t();
+        deserialize_directory_value(session->serialized_value, &new_value);
+
         {
             DEBUG_VAR mutex_assertion_t::acq_t acq(&variable_lock);
             std::map<peer_id_t, metadata_t> map = variable.get_watchable()->get();
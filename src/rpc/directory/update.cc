@@ -0,0 +1,77 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "rpc/directory/update.hpp"
+
+#include <algorithm>
+
+#include "perfmon/perfmon.hpp"
+
+static perfmon_sampler_t pm_directory_update_bytes(secs_to_ticks(1), true);
+static perfmon_sampler_t pm_directory_value_bytes(secs_to_ticks(1), false);
+static perfmon_counter_t pm_directory_full_updates;
+static perfmon_multi_membership_t pm_directory_update_membership(&get_global_perfmon_collection(),
+    &pm_directory_update_bytes, "directory_update_bytes",
+    &pm_directory_value_bytes, "directory_value_bytes",
+    &pm_directory_full_updates, "directory_full_updates",
+    NULLPTR);
+
+directory_update_t directory_update_t::make(uint64_t new_version,
+                                            const std::string &old_value,
+                                            const std::string &new_value,
+                                            bool force_full) {
+    directory_update_t update;
+    if (!force_full) {
+        const size_t max_common = std::min(old_value.size(), new_value.size());
+        size_t prefix = 0;
+        while (prefix < max_common && old_value[prefix] == new_value[prefix]) {
+            ++prefix;
+        }
+        // The suffix must not overlap the prefix in either value.
+        size_t suffix = 0;
+        while (suffix < max_common - prefix
+               && old_value[old_value.size() - 1 - suffix] == new_value[new_value.size() - 1 - suffix]) {
+            ++suffix;
+        }
+
+        // A delta that replaces most of the value isn't worth the dependency on the
+        // previous version.
+        const size_t replacement_size = new_value.size() - prefix - suffix;
+        if (replacement_size < new_value.size() / 2) {
+            update.version = new_version;
+            update.prefix_length = prefix;
+            update.suffix_length = suffix;
+            update.replacement.assign(new_value, prefix, replacement_size);
+        } else {
+            force_full = true;
+        }
+    }
+
+    if (force_full) {
+        update = make_full(new_version, new_value);
+    }
+
+    pm_directory_update_bytes.record(update.get_size());
+    pm_directory_value_bytes.record(new_value.size());
+    return update;
+}
+
+directory_update_t directory_update_t::make_full(uint64_t version, const std::string &value) {
+    ++pm_directory_full_updates;
+    directory_update_t update;
+    update.full = true;
+    update.version = version;
+    update.replacement = value;
+    return update;
+}
+
+void directory_update_t::apply(uint64_t *value_version, std::string *value) const {
+    if (full) {
+        *value = replacement;
+    } else {
+        guarantee(*value_version + 1 == version,
+                  "Directory delta for version %" PRIu64 " applied to version %" PRIu64,
+                  version, *value_version);
+        guarantee(prefix_length + suffix_length <= value->size());
+        value->replace(prefix_length, value->size() - prefix_length - suffix_length, replacement);
+    }
+    *value_version = version;
+}
@@ -0,0 +1,76 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#ifndef RPC_DIRECTORY_UPDATE_HPP_
+#define RPC_DIRECTORY_UPDATE_HPP_
+
+#include <string>
+
+#include "containers/archive/archive.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/archive/string_stream.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "rpc/serialize_macros.hpp"
+
+/* The directory doesn't send a peer's whole metadata every time it changes. Instead,
+the metadata is kept in serialized form on both ends, and a `directory_update_t`
+carries only the bytes that changed since the previous version: everything between
+the longest common prefix and the longest common suffix of the old and new serialized
+values. A change to one reactor's business card thus costs about as many bytes as the
+business card itself, no matter how many namespaces there are.
+
+Every so often, and whenever a delta wouldn't save much, a full update is sent
+instead. A full update doesn't depend on any earlier version. */
+
+class directory_update_t {
+public:
+    directory_update_t() : full(false), version(0), prefix_length(0), suffix_length(0) { }
+
+    /* Makes an update that turns `old_value` (at version `new_version - 1`) into
+    `new_value`. If `force_full` is true, or if a delta wouldn't be much smaller than
+    `new_value`, the result is a full update. */
+    static directory_update_t make(uint64_t new_version,
+                                   const std::string &old_value,
+                                   const std::string &new_value,
+                                   bool force_full);
+
+    /* Makes a full update. */
+    static directory_update_t make_full(uint64_t version, const std::string &value);
+
+    /* Applies the update to `*value`, which must be at the version that the update
+    was made against unless it is a full update. */
+    void apply(uint64_t *value_version, std::string *value) const;
+
+    bool is_full() const { return full; }
+    uint64_t get_version() const { return version; }
+
+    // Roughly how many bytes the update takes up on the wire.
+    size_t get_size() const { return replacement.size() + 3 * sizeof(uint64_t) + 1; }
+
+    RDB_MAKE_ME_SERIALIZABLE_5(full, version, prefix_length, suffix_length, replacement);
+
+private:
+    bool full;
+    uint64_t version;
+    // The number of bytes at the beginning and at the end of the old value that are
+    // kept; whatever is between them is replaced by `replacement`.
+    uint64_t prefix_length, suffix_length;
+    std::string replacement;
+};
+
+template <class metadata_t>
+std::string serialize_directory_value(const metadata_t &value) {
+    write_message_t msg;
+    msg << value;
+    vector_stream_t stream;
+    int res = send_write_message(&stream, &msg);
+    guarantee(res == 0);
+    return std::string(stream.vector().begin(), stream.vector().end());
+}
+
+template <class metadata_t>
+void deserialize_directory_value(const std::string &serialized, metadata_t *value_out) {
+    read_string_stream_t stream(serialized);
+    int res = deserialize(&stream, value_out);
+    guarantee(res == 0);  // In the spirit of unreachable...
+}
+
+#endif  // RPC_DIRECTORY_UPDATE_HPP_
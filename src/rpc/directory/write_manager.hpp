@@ -2,13 +2,22 @@
 #ifndef RPC_DIRECTORY_WRITE_MANAGER_HPP_
 #define RPC_DIRECTORY_WRITE_MANAGER_HPP_
 
+#include <string>
+
+#include "errors.hpp"
+#include <boost/shared_ptr.hpp>
+
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/watchable.hpp"
 #include "rpc/connectivity/connectivity.hpp"
+#include "rpc/directory/update.hpp"
 
 class message_service_t;
 
+/* `directory_write_manager_t` sends our directory metadata to every peer: all of it
+when the peer connects, and then a `directory_update_t` every time it changes. */
+
 template<class metadata_t>
 class directory_write_manager_t : private peers_list_callback_t {
 public:
@@ -22,8 +31,8 @@ private:
     void on_disconnect(UNUSED peer_id_t p) { }
     void on_change() THROWS_NOTHING;
 
-    void send_initialization(peer_id_t peer, const metadata_t &initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
-    void send_update(peer_id_t peer, const metadata_t &new_value, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
+    void send_initialization(peer_id_t peer, const boost::shared_ptr<directory_update_t> &initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
+    void send_update(peer_id_t peer, const boost::shared_ptr<directory_update_t> &update, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t keepalive) THROWS_NOTHING;
 
     class initialization_writer_t;
     class update_writer_t;
@@ -31,6 +40,14 @@ private:
     message_service_t *const message_service;
     clone_ptr_t<watchable_t<metadata_t> > value_watchable;
     fifo_enforcer_source_t metadata_fifo_source;
+
+    /* The serialized form of the value we sent to the peers last, and its version.
+    Every peer either has it or will have it once it has processed the updates we
+    have sent so far, so this is what the next update is made against. */
+    std::string serialized_value;
+    uint64_t serialized_value_version;
+    int updates_since_full_update;
+
     auto_drainer_t drainer;
     typename watchable_t<metadata_t>::subscription_t value_subscription;
     connectivity_service_t::peers_list_subscription_t connectivity_subscription;
@@ -5,7 +5,9 @@
 #include "rpc/directory/write_manager.hpp"
 
 #include <set>
+#include <string>
 
+#include "config/args.hpp"
 #include "rpc/connectivity/messages.hpp"
 
 template<class metadata_t>
@@ -14,11 +16,14 @@ directory_write_manager_t<metadata_t>::directory_write_manager_t(
         const clone_ptr_t<watchable_t<metadata_t> > &value) THROWS_NOTHING :
     message_service(sub),
     value_watchable(value),
+    serialized_value_version(0),
+    updates_since_full_update(0),
     value_subscription(boost::bind(&directory_write_manager_t::on_change, this)),
     connectivity_subscription(this) {
     typename watchable_t<metadata_t>::freeze_t value_freeze(value_watchable);
     connectivity_service_t::peers_list_freeze_t connectivity_freeze(message_service->get_connectivity_service());
     guarantee(message_service->get_connectivity_service()->get_peers_list().empty());
+    serialized_value = serialize_directory_value(value_watchable->get());
     value_subscription.reset(value_watchable, &value_freeze);
     connectivity_subscription.reset(message_service->get_connectivity_service(), &connectivity_freeze);
 }
@@ -29,10 +34,12 @@ directory_write_manager_t<metadata_t>::~directory_write_manager_t() { }
 template<class metadata_t>
 void directory_write_manager_t<metadata_t>::on_connect(peer_id_t peer) THROWS_NOTHING {
     typename watchable_t<metadata_t>::freeze_t freeze(value_watchable);
+    boost::shared_ptr<directory_update_t> initial_value(new directory_update_t(
+        directory_update_t::make_full(serialized_value_version, serialized_value)));
     coro_t::spawn_sometime(boost::bind(
         &directory_write_manager_t::send_initialization, this,
         peer,
-        value_watchable->get(), metadata_fifo_source.get_state(),
+        initial_value, metadata_fifo_source.get_state(),
         auto_drainer_t::lock_t(&drainer)));
 }
 
@@ -44,12 +51,27 @@ void directory_write_manager_t<metadata_t>::on_change() THROWS_NOTHING {
     update.) */
     connectivity_service_t::peers_list_freeze_t freeze(message_service->get_connectivity_service());
     fifo_enforcer_write_token_t metadata_fifo_token = metadata_fifo_source.enter_write();
+
+    /* The update is made once and shared by all peers. The peers apply updates in
+    `metadata_fifo_source` order, so they all make it against the same version. */
+    std::string new_serialized_value = serialize_directory_value(value_watchable->get());
+    ++updates_since_full_update;
+    const bool force_full = updates_since_full_update >= DIRECTORY_FULL_UPDATE_INTERVAL;
+    boost::shared_ptr<directory_update_t> update(new directory_update_t(
+        directory_update_t::make(serialized_value_version + 1, serialized_value,
+                                 new_serialized_value, force_full)));
+    if (update->is_full()) {
+        updates_since_full_update = 0;
+    }
+    serialized_value.swap(new_serialized_value);
+    ++serialized_value_version;
+
     std::set<peer_id_t> peers = message_service->get_connectivity_service()->get_peers_list();
     for (std::set<peer_id_t>::iterator it = peers.begin(); it != peers.end(); it++) {
         coro_t::spawn_sometime(boost::bind(
             &directory_write_manager_t::send_update, this,
             *it,
-            value_watchable->get(), metadata_fifo_token,
+            update, metadata_fifo_token,
             auto_drainer_t::lock_t(&drainer)));
     }
 }
@@ -57,7 +79,7 @@ void directory_write_manager_t<metadata_t>::on_change() THROWS_NOTHING {
 template <class metadata_t>
 class directory_write_manager_t<metadata_t>::initialization_writer_t : public send_message_write_callback_t {
 public:
-    initialization_writer_t(const metadata_t &_initial_value, fifo_enforcer_state_t _metadata_fifo_state) :
+    initialization_writer_t(const directory_update_t &_initial_value, fifo_enforcer_state_t _metadata_fifo_state) :
         initial_value(_initial_value), metadata_fifo_state(_metadata_fifo_state) { }
     ~initialization_writer_t() { }
 
@@ -73,22 +95,22 @@ public:
         }
     }
 private:
-    const metadata_t &initial_value;
+    const directory_update_t &initial_value;
     fifo_enforcer_state_t metadata_fifo_state;
 };
 
 template <class metadata_t>
 class directory_write_manager_t<metadata_t>::update_writer_t : public send_message_write_callback_t {
 public:
-    update_writer_t(const metadata_t &_new_value, fifo_enforcer_write_token_t _metadata_fifo_token) :
-        new_value(_new_value), metadata_fifo_token(_metadata_fifo_token) { }
+    update_writer_t(const directory_update_t &_update, fifo_enforcer_write_token_t _metadata_fifo_token) :
+        update(_update), metadata_fifo_token(_metadata_fifo_token) { }
     ~update_writer_t() { }
 
     void write(write_stream_t *stream) {
         write_message_t msg;
         uint8_t code = 'U';
         msg << code;
-        msg << new_value;
+        msg << update;
         msg << metadata_fifo_token;
         int res = send_write_message(stream, &msg);
         if (res) {
@@ -96,19 +118,19 @@ public:
         }
     }
 private:
-    const metadata_t &new_value;
+    const directory_update_t &update;
     fifo_enforcer_write_token_t metadata_fifo_token;
 };
 
 template<class metadata_t>
-void directory_write_manager_t<metadata_t>::send_initialization(peer_id_t peer, const metadata_t &initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t) THROWS_NOTHING {
-    initialization_writer_t writer(initial_value, metadata_fifo_state);
+void directory_write_manager_t<metadata_t>::send_initialization(peer_id_t peer, const boost::shared_ptr<directory_update_t> &initial_value, fifo_enforcer_state_t metadata_fifo_state, auto_drainer_t::lock_t) THROWS_NOTHING {
+    initialization_writer_t writer(*initial_value, metadata_fifo_state);
     message_service->send_message(peer, &writer);
 }
 
 template<class metadata_t>
-void directory_write_manager_t<metadata_t>::send_update(peer_id_t peer, const metadata_t &new_value, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t) THROWS_NOTHING {
-    update_writer_t writer(new_value, metadata_fifo_token);
+void directory_write_manager_t<metadata_t>::send_update(peer_id_t peer, const boost::shared_ptr<directory_update_t> &update, fifo_enforcer_write_token_t metadata_fifo_token, auto_drainer_t::lock_t) THROWS_NOTHING {
+    update_writer_t writer(*update, metadata_fifo_token);
     message_service->send_message(peer, &writer);
 }
 
@@ -77,6 +77,12 @@ public:
 
         subwriter->write(stream);
     }
+
+    // Messages to the same mailbox must arrive in order; messages to different
+    // mailboxes needn't.
+    uint64_t get_ordering_key() {
+        return dest_mailbox_id;
+    }
 private:
     int32_t dest_thread;
     raw_mailbox_t::id_t dest_mailbox_id;
@@ -0,0 +1,51 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "concurrency/queue/accounting.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* A deadline source whose deadline is either long gone or not set at all. */
+class fixed_deadline_source_t : public accounting_queue_deadline_source_t {
+public:
+    fixed_deadline_source_t() : overdue(false) { }
+    ticks_t next_pop_deadline() { return overdue ? 1 : 0; }
+    bool overdue;
+};
+
+void run_overdue_account_test() {
+    const int batch_factor = 4;
+    accounting_queue_t<int> queue(batch_factor);
+
+    unlimited_fifo_queue_t<int> background_source, urgent_source;
+    fixed_deadline_source_t deadline;
+    for (int i = 0; i < 100; ++i) {
+        background_source.push(0);
+        urgent_source.push(1);
+    }
+
+    // The background account has by far the larger share, so without deadlines the
+    // urgent account has to wait for a whole batch.
+    accounting_queue_t<int>::account_t background(&queue, &background_source, 99);
+    accounting_queue_t<int>::account_t urgent(&queue, &urgent_source, 1, &deadline);
+    for (int i = 0; i < batch_factor; ++i) {
+        EXPECT_EQ(0, queue.pop());
+    }
+
+    // Once its deadline has passed, it goes first, but never more than `batch_factor`
+    // times in a row.
+    deadline.overdue = true;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < batch_factor; ++i) {
+            EXPECT_EQ(1, queue.pop());
+        }
+        EXPECT_EQ(0, queue.pop());
+    }
+}
+
+TEST(AccountingQueueTest, OverdueAccountGoesFirst) {
+    unittest::run_in_thread_pool(&run_overdue_account_test);
+}
+
+}  // namespace unittest
@@ -5,6 +5,7 @@
 
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/archive/vector_stream.hpp"
 
 namespace unittest {
 
@@ -13,7 +14,7 @@ void dump_to_string(write_message_t *msg, std::string *out) {
 
     out->clear();
     for (write_buffer_t *p = buffers->head(); p; p = buffers->next(p)) {
-        out->append(p->data, p->data + p->size);
+        out->append(p->get_data(), p->get_data() + p->size);
     }
 }
 
@@ -36,6 +37,63 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(22u, u.size());
 }
 
+TEST(WriteMessageTest, BytesCopied) {
+    const int64_t big_size = 16 * write_message_t::MIN_REFERENCE_SIZE;
+    counted_t<data_buffer_t> big = data_buffer_t::create(big_size);
+    for (int64_t i = 0; i < big_size; ++i) {
+        big->buf()[i] = static_cast<char>(i);
+    }
+    counted_t<data_buffer_t> small = data_buffer_t::create(100);
+    memset(small->buf(), 'x', small->size());
+
+    write_message_t msg;
+    msg << int64_t(42);
+    msg.append_data_buffer(big);
+    msg.append_data_buffer(small);
+
+    // The big buffer is referenced, the rest is copied.
+    ASSERT_EQ(8 + big_size + 100, msg.size());
+    ASSERT_EQ(8 + 100, msg.bytes_copied());
+
+    std::string s;
+    dump_to_string(&msg, &s);
+    ASSERT_EQ(static_cast<size_t>(msg.size()), s.size());
+    ASSERT_EQ(0, memcmp(s.data() + 8, big->buf(), big_size));
+    ASSERT_EQ(std::string(100, 'x'), s.substr(8 + big_size));
+}
+
+/* Counts how `send_write_message()` hands a message to the stream. */
+class counting_write_stream_t : public write_stream_t {
+public:
+    counting_write_stream_t() : num_writes(0), num_writevs(0) { }
+    int64_t write(const void *p, int64_t n) {
+        ++num_writes;
+        return stream.write(p, n);
+    }
+    int64_t writev(const iovec *iov, int64_t iovcnt) {
+        ++num_writevs;
+        return stream.writev(iov, iovcnt);
+    }
+    int num_writes, num_writevs;
+    vector_stream_t stream;
+};
+
+TEST(WriteMessageTest, SendGathersBuffers) {
+    // Enough to take more buffers than `send_write_message()` keeps on the stack.
+    const std::string payload(40 * write_buffer_t::DATA_SIZE + 17, 'y');
+    write_message_t msg;
+    msg << payload;
+
+    counting_write_stream_t stream;
+    ASSERT_EQ(0, send_write_message(&stream, &msg));
+    ASSERT_EQ(0, stream.num_writes);
+    ASSERT_EQ(1, stream.num_writevs);
+
+    std::string s;
+    dump_to_string(&msg, &s);
+    ASSERT_EQ(s, std::string(stream.stream.vector().begin(), stream.stream.vector().end()));
+}
+
 
 
 }  // namespace unittest
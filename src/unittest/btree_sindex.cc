@@ -5,6 +5,7 @@
 #include "btree/btree_store.hpp"
 #include "btree/operations.hpp"
 #include "buffer_cache/blob.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -61,6 +62,10 @@ void run_sindex_low_level_operations_test() {
         std::string opaque_blob = rand_string(1000);
         s.opaque_definition.assign(opaque_blob.begin(), opaque_blob.end());
 
+        if (i % 2 == 0) {
+            s.post_construction_progress = store_key_t(rand_string(10));
+        }
+
         mirror[id] = s;
 
         order_token_t otok = order_source.check_in("sindex unittest");
@@ -83,6 +88,38 @@ void run_sindex_low_level_operations_test() {
         get_secondary_indexes(txn.get(), &sindex_block, &sindexes);
 
         ASSERT_TRUE(sindexes == mirror);
+        for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+            EXPECT_TRUE(it->second.post_construction_progress == mirror[it->first].post_construction_progress);
+        }
+    }
+
+    {
+        /* Sindex blocks written before post construction recorded its progress
+         * have nothing after the map of sindexes. */
+        order_token_t otok = order_source.check_in("sindex unittest");
+        scoped_ptr_t<transaction_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        get_btree_superblock_and_txn(&btree, rwi_write, 1, repli_timestamp_t::invalid, otok, WRITE_DURABILITY_SOFT, &superblock, &txn);
+        buf_lock_t sindex_block(txn.get(), superblock->get_sindex_block_id(), rwi_write);
+
+        btree_sindex_block_t *data = static_cast<btree_sindex_block_t *>(sindex_block.get_data_write());
+        blob_t sindex_blob(data->sindex_blob, btree_sindex_block_t::SINDEX_BLOB_MAXREFLEN);
+        sindex_blob.clear(txn.get());
+
+        write_message_t wm;
+        wm << mirror;
+        vector_stream_t stream;
+        ASSERT_EQ(0, send_write_message(&stream, &wm));
+        sindex_blob.append_region(txn.get(), stream.vector().size());
+        sindex_blob.write_from_string(std::string(stream.vector().begin(), stream.vector().end()), txn.get(), 0);
+
+        std::map<std::string, secondary_index_t> sindexes;
+        get_secondary_indexes(txn.get(), &sindex_block, &sindexes);
+
+        ASSERT_TRUE(sindexes == mirror);
+        for (auto it = sindexes.begin(); it != sindexes.end(); ++it) {
+            EXPECT_TRUE(it->second.post_construction_progress == store_key_t::min());
+        }
     }
 }
 
@@ -1,12 +1,17 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "unittest/gtest.hpp"
 
+#include "errors.hpp"
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "clustering/generic/registrant.hpp"
 #include "clustering/immediate_consistency/branch/broadcaster.hpp"
 #include "clustering/immediate_consistency/branch/listener.hpp"
 #include "clustering/immediate_consistency/branch/replier.hpp"
 
 // TODO: We include master.hpp, which kind of breaks abstraction boundaries, for ack_checker_t.
 #include "clustering/immediate_consistency/query/master.hpp"
+#include "concurrency/pmap.hpp"
 #include "containers/uuid.hpp"
 #include "unittest/branch_history_manager.hpp"
 #include "unittest/clustering_utils.hpp"
@@ -318,4 +323,227 @@ TEST(ClusteringBranch, PartialBackfill) {
     run_in_thread_pool_with_broadcaster(&run_partial_backfill_test);
 }
 
+/* `WriteThroughput` measures how many writes per second the broadcaster gets
+out to one, two, or three mirrors. The mirrors are fakes that answer every write
+as soon as it arrives, so that the replication traffic is what gets measured
+rather than the store. */
+
+static boost::optional<boost::optional<registrar_business_card_t<listener_business_card_t<dummy_protocol_t> > > > get_registrar(
+        const boost::optional<broadcaster_business_card_t<dummy_protocol_t> > &bcard) {
+    return boost::optional<boost::optional<registrar_business_card_t<listener_business_card_t<dummy_protocol_t> > > >(
+        boost::optional<registrar_business_card_t<listener_business_card_t<dummy_protocol_t> > >(bcard->registrar));
+}
+
+class instant_mirror_t {
+public:
+    instant_mirror_t(mailbox_manager_t *mm,
+                     clone_ptr_t<watchable_t<boost::optional<broadcaster_business_card_t<dummy_protocol_t> > > > broadcaster_view) :
+        mailbox_manager(mm), num_writes(0), num_writereads(0),
+        intro_mailbox(mm, boost::bind(&instant_mirror_t::on_intro, this, _1), mailbox_callback_mode_inline),
+        write_mailbox(mm, boost::bind(&instant_mirror_t::on_write, this, _1, _2), mailbox_callback_mode_inline),
+        writeread_mailbox(mm, boost::bind(&instant_mirror_t::on_writeread, this, _1, _3), mailbox_callback_mode_inline),
+        read_mailbox(mm, boost::bind(&instant_mirror_t::on_read, this, _5), mailbox_callback_mode_inline),
+        registrant(mm, broadcaster_view->subview(&get_registrar),
+                   listener_business_card_t<dummy_protocol_t>(intro_mailbox.get_address(), write_mailbox.get_address())) { }
+
+    int64_t get_num_writes() const { return num_writes; }
+
+    /* How many of the writes came in as write-reads, because we were readable. */
+    int64_t get_num_writereads() const { return num_writereads; }
+
+    void upgrade() {
+        send(mailbox_manager, intro.upgrade_mailbox, writeread_mailbox.get_address(), read_mailbox.get_address());
+    }
+
+    /* Returns once the broadcaster has acknowledged the downgrade. */
+    void downgrade() {
+        cond_t acked;
+        mailbox_t<void()> ack_mailbox(mailbox_manager, boost::bind(&cond_t::pulse, &acked),
+                                      mailbox_callback_mode_inline);
+        send(mailbox_manager, intro.downgrade_mailbox, ack_mailbox.get_address());
+        acked.wait_lazily_unordered();
+    }
+
+private:
+    void on_intro(const listener_intro_t<dummy_protocol_t> &_intro) {
+        intro = _intro;
+        // Become readable right away, so that we get write-reads.
+        upgrade();
+    }
+    void on_write(const std::vector<listener_write_t<dummy_protocol_t> > &writes, mailbox_addr_t<void()> ack_addr) {
+        num_writes += writes.size();
+        send(mailbox_manager, ack_addr);
+    }
+    void on_writeread(const std::vector<listener_write_t<dummy_protocol_t> > &writes,
+                      mailbox_addr_t<void(std::vector<dummy_protocol_t::write_response_t>)> ack_addr) {
+        num_writes += writes.size();
+        num_writereads += writes.size();
+        send(mailbox_manager, ack_addr, std::vector<dummy_protocol_t::write_response_t>(writes.size()));
+    }
+    void on_read(mailbox_addr_t<void(dummy_protocol_t::read_response_t)> ack_addr) {
+        send(mailbox_manager, ack_addr, dummy_protocol_t::read_response_t());
+    }
+
+    mailbox_manager_t *mailbox_manager;
+    int64_t num_writes, num_writereads;
+    listener_intro_t<dummy_protocol_t> intro;
+
+    listener_business_card_t<dummy_protocol_t>::intro_mailbox_t intro_mailbox;
+    listener_business_card_t<dummy_protocol_t>::write_mailbox_t write_mailbox;
+    listener_business_card_t<dummy_protocol_t>::writeread_mailbox_t writeread_mailbox;
+    listener_business_card_t<dummy_protocol_t>::read_mailbox_t read_mailbox;
+    registrant_t<listener_business_card_t<dummy_protocol_t> > registrant;
+
+    DISABLE_COPYING(instant_mirror_t);
+};
+
+static void write_to_key_repeatedly(broadcaster_t<dummy_protocol_t> *broadcaster,
+                                    unittest::fake_fifo_enforcement_t *enforce,
+                                    order_source_t *order_source,
+                                    int writer,
+                                    int num_writes) {
+    const std::string key(1, 'a' + writer);
+    for (int i = 0; i < num_writes; ++i) {
+        fifo_enforcer_sink_t::exit_write_t exiter(&enforce->sink, enforce->source.enter_write());
+        order_token_t otok = order_source->check_in("unittest::write_to_key_repeatedly");
+        dummy_protocol_t::write_t w;
+        w.values[key] = strprintf("%d", i);
+        class : public broadcaster_t<dummy_protocol_t>::write_callback_t, public cond_t {
+        public:
+            void on_response(peer_id_t, const dummy_protocol_t::write_response_t &) {
+                /* Ignore. */
+            }
+            void on_done() {
+                pulse();
+            }
+        } write_callback;
+        spawn_write_fake_ack_checker_t ack_checker;
+        cond_t non_interruptor;
+        broadcaster->spawn_write(w, &exiter, otok, &write_callback, &non_interruptor, &ack_checker);
+        write_callback.wait_lazily_unordered();
+    }
+}
+
+void run_write_throughput_test(int num_mirrors) {
+    order_source_t order_source;
+    simple_mailbox_cluster_t cluster;
+    in_memory_branch_history_manager_t<dummy_protocol_t> branch_history_manager;
+    io_backender_t io_backender;
+    test_store_t<dummy_protocol_t> initial_store(&io_backender, &order_source, static_cast<dummy_protocol_t::context_t *>(NULL));
+    cond_t interruptor;
+
+    broadcaster_t<dummy_protocol_t> broadcaster(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &initial_store.store,
+        &get_global_perfmon_collection(),
+        &order_source,
+        &interruptor);
+
+    watchable_variable_t<boost::optional<broadcaster_business_card_t<dummy_protocol_t> > > broadcaster_directory_controller(
+        boost::optional<broadcaster_business_card_t<dummy_protocol_t> >(broadcaster.get_business_card()));
+
+    boost::ptr_vector<instant_mirror_t> mirrors;
+    for (int i = 0; i < num_mirrors; ++i) {
+        mirrors.push_back(new instant_mirror_t(cluster.get_mailbox_manager(),
+                                               broadcaster_directory_controller.get_watchable()));
+    }
+
+    /* Give time for the mirrors to register and become readable. */
+    let_stuff_happen();
+
+    /* Each writer has a key of its own. */
+    const int num_writers = 26;
+    const int writes_per_writer = 10000;
+    unittest::fake_fifo_enforcement_t enforce;
+    const ticks_t start = get_ticks();
+    pmap(num_writers, boost::bind(&write_to_key_repeatedly, &broadcaster, &enforce, &order_source, _1, writes_per_writer));
+    const double secs = ticks_to_secs(get_ticks() - start);
+
+    printf("broadcaster, %d mirror(s): %10.0f writes/sec\n",
+           num_mirrors, num_writers * writes_per_writer / secs);
+
+    for (int i = 0; i < num_mirrors; ++i) {
+        EXPECT_EQ(num_writers * writes_per_writer, mirrors[i].get_num_writes());
+    }
+}
+TEST(ClusteringBranch, WriteThroughput) {
+    for (int num_mirrors = 1; num_mirrors <= 3; ++num_mirrors) {
+        unittest::run_in_thread_pool(boost::bind(&run_write_throughput_test, num_mirrors));
+    }
+}
+
+/* `UpgradeDowngradeBatches` checks that the writes a mirror gets come in over
+the mailbox that matches whether it's readable, while writes are still going on
+when it's upgraded or downgraded. */
+
+void run_upgrade_downgrade_batches_test() {
+    order_source_t order_source;
+    simple_mailbox_cluster_t cluster;
+    in_memory_branch_history_manager_t<dummy_protocol_t> branch_history_manager;
+    io_backender_t io_backender;
+    test_store_t<dummy_protocol_t> initial_store(&io_backender, &order_source, static_cast<dummy_protocol_t::context_t *>(NULL));
+    cond_t interruptor;
+
+    broadcaster_t<dummy_protocol_t> broadcaster(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &initial_store.store,
+        &get_global_perfmon_collection(),
+        &order_source,
+        &interruptor);
+
+    watchable_variable_t<boost::optional<broadcaster_business_card_t<dummy_protocol_t> > > broadcaster_directory_controller(
+        boost::optional<broadcaster_business_card_t<dummy_protocol_t> >(broadcaster.get_business_card()));
+
+    instant_mirror_t mirror(cluster.get_mailbox_manager(), broadcaster_directory_controller.get_watchable());
+    let_stuff_happen();
+
+    const int num_writers = 4;
+    const int writes_per_writer = 100;
+    unittest::fake_fifo_enforcement_t enforce;
+
+    /* Readable: everything comes in as write-reads. */
+    pmap(num_writers, boost::bind(&write_to_key_repeatedly, &broadcaster, &enforce, &order_source, _1, writes_per_writer));
+    let_stuff_happen();
+    EXPECT_EQ(num_writers * writes_per_writer, mirror.get_num_writes());
+    EXPECT_EQ(num_writers * writes_per_writer, mirror.get_num_writereads());
+
+    /* Downgrade while writes are going on. Every write gets through, and once
+    the downgrade is done, no more write-reads come in. */
+    cond_t downgraded;
+    int64_t writereads_at_downgrade = 0;
+    {
+        struct downgrader_t {
+            static void run(instant_mirror_t *m, cond_t *done) {
+                m->downgrade();
+                done->pulse();
+            }
+        };
+        coro_t::spawn_sometime(boost::bind(&downgrader_t::run, &mirror, &downgraded));
+        pmap(num_writers, boost::bind(&write_to_key_repeatedly, &broadcaster, &enforce, &order_source, _1, writes_per_writer));
+        downgraded.wait_lazily_unordered();
+        let_stuff_happen();
+        writereads_at_downgrade = mirror.get_num_writereads();
+    }
+    EXPECT_EQ(2 * num_writers * writes_per_writer, mirror.get_num_writes());
+
+    pmap(num_writers, boost::bind(&write_to_key_repeatedly, &broadcaster, &enforce, &order_source, _1, writes_per_writer));
+    let_stuff_happen();
+    EXPECT_EQ(3 * num_writers * writes_per_writer, mirror.get_num_writes());
+    EXPECT_EQ(writereads_at_downgrade, mirror.get_num_writereads());
+
+    /* And back. */
+    mirror.upgrade();
+    let_stuff_happen();
+    pmap(num_writers, boost::bind(&write_to_key_repeatedly, &broadcaster, &enforce, &order_source, _1, writes_per_writer));
+    let_stuff_happen();
+    EXPECT_EQ(4 * num_writers * writes_per_writer, mirror.get_num_writes());
+    EXPECT_EQ(writereads_at_downgrade + num_writers * writes_per_writer, mirror.get_num_writereads());
+}
+
+TEST(ClusteringBranch, UpgradeDowngradeBatches) {
+    unittest::run_in_thread_pool(&run_upgrade_downgrade_batches_test);
+}
+
 }   /* namespace unittest */
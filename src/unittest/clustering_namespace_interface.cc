@@ -83,5 +83,104 @@ TEST(ClusteringNamespaceInterface, ReadOutdated) {
     unittest::run_in_thread_pool(&run_read_outdated_test);
 }
 
+/* Returns true if a read with the given staleness bound (or, for -1, an outdated
+read with no bound) goes through. */
+static bool try_bounded_read(cluster_namespace_interface_t<dummy_protocol_t> *namespace_if,
+                             int64_t max_staleness_ms) {
+    dummy_protocol_t::read_t r;
+    dummy_protocol_t::read_response_t rr;
+    r.keys.keys.insert("a");
+    cond_t non_interruptor;
+    try {
+        if (max_staleness_ms == -1) {
+            namespace_if->read_outdated(r, &rr, &non_interruptor);
+        } else {
+            namespace_if->read_bounded_staleness(r, &rr, max_staleness_ms, &non_interruptor);
+        }
+        return true;
+    } catch (const cannot_perform_query_exc_t &) {
+        return false;
+    }
+}
+
+static void run_read_bounded_staleness_test() {
+    test_cluster_group_t<dummy_protocol_t> cluster_group(2);
+
+    cluster_group.construct_all_reactors(cluster_group.compile_blueprint("p,s"));
+
+    cluster_group.wait_until_blueprint_is_satisfied("p,s");
+
+    scoped_ptr_t<cluster_namespace_interface_t<dummy_protocol_t> > namespace_if;
+    cluster_group.make_namespace_interface(0, &namespace_if);
+
+    /* Replicas that follow the primary are never out of date. */
+    EXPECT_TRUE(try_bounded_read(namespace_if.get(), 0));
+
+    /* Once the primary goes away, the secondary still serves reads, but only
+    to readers who don't mind how long ago it lost the primary. */
+    cluster_group.set_all_blueprints(cluster_group.compile_blueprint("n,s"));
+    for (int i = 0; i < 500; ++i) {
+        if (!try_bounded_read(namespace_if.get(), 0) && try_bounded_read(namespace_if.get(), 60000)) {
+            break;
+        }
+        nap(10);
+    }
+    nap(10);
+    EXPECT_FALSE(try_bounded_read(namespace_if.get(), 0));
+    EXPECT_TRUE(try_bounded_read(namespace_if.get(), 60000));
+    EXPECT_TRUE(try_bounded_read(namespace_if.get(), -1));
+}
+
+TEST(ClusteringNamespaceInterface, ReadBoundedStaleness) {
+    unittest::run_in_thread_pool(&run_read_bounded_staleness_test);
+}
+
+static void run_read_unknown_staleness_test() {
+    test_cluster_group_t<dummy_protocol_t> cluster_group(2);
+
+    /* The secondary has never had a primary, so nobody knows how old its data
+    is. */
+    cluster_group.construct_all_reactors(cluster_group.compile_blueprint("n,s"));
+
+    scoped_ptr_t<cluster_namespace_interface_t<dummy_protocol_t> > namespace_if;
+    cluster_group.make_namespace_interface(0, &namespace_if);
+
+    for (int i = 0; i < 500 && !try_bounded_read(namespace_if.get(), -1); ++i) {
+        nap(10);
+    }
+    EXPECT_TRUE(try_bounded_read(namespace_if.get(), -1));
+    EXPECT_FALSE(try_bounded_read(namespace_if.get(), 60000));
+}
+
+TEST(ClusteringNamespaceInterface, ReadUnknownStaleness) {
+    unittest::run_in_thread_pool(&run_read_unknown_staleness_test);
+}
+
+static void run_sharding_scheme_with_replicas_test() {
+    test_cluster_group_t<dummy_protocol_t> cluster_group(2);
+
+    cluster_group.construct_all_reactors(cluster_group.compile_blueprint("pp,ss"));
+
+    cluster_group.wait_until_blueprint_is_satisfied("pp,ss");
+
+    scoped_ptr_t<cluster_namespace_interface_t<dummy_protocol_t> > namespace_if;
+    cluster_group.make_namespace_interface(0, &namespace_if);
+
+    /* Give the namespace interface time to see the secondaries as well. Their
+    regions overlap the primaries', so only the primaries make up the scheme. */
+    nap(100);
+    std::set<dummy_protocol_t::region_t> scheme;
+    ASSERT_NO_THROW(scheme = namespace_if->get_sharding_scheme());
+    EXPECT_EQ(2u, scheme.size());
+
+    dummy_protocol_t::region_t whole;
+    ASSERT_EQ(REGION_JOIN_OK, region_join(std::vector<dummy_protocol_t::region_t>(scheme.begin(), scheme.end()), &whole));
+    EXPECT_TRUE(whole == dummy_protocol_t::region_t::universe());
+}
+
+TEST(ClusteringNamespaceInterface, ShardingSchemeWithReplicas) {
+    unittest::run_in_thread_pool(&run_sharding_scheme_with_replicas_test);
+}
+
 }   /* namespace unittest */
 
@@ -57,4 +57,78 @@ TEST(ClusteringSuggester, NewNamespace) {
     EXPECT_EQ(machines.size(), blueprint.machines_roles.size());
 }
 
+/* Makes a key distribution with `keys_per_letter` keys starting at each of the
+letters "a" through "z". */
+static std::map<store_key_t, int64_t> a_thru_z_key_counts(int64_t keys_per_letter) {
+    std::map<store_key_t, int64_t> key_counts;
+    for (char c = 'a'; c <= 'z'; ++c) {
+        key_counts[store_key_t(std::string(1, c))] = keys_per_letter;
+    }
+    return key_counts;
+}
+
+TEST(ClusteringSuggester, SplitPointsByLoad) {
+    std::vector<std::pair<key_range_t, double> > shard_loads;
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::none, store_key_t(), key_range_t::open, store_key_t("m")), 90.0));
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::closed, store_key_t("m"), key_range_t::none, store_key_t()), 10.0));
+
+    /* The first shard has twelve buckets with 7.5 load each; half the total
+    load comes after seven of them. */
+    std::vector<store_key_t> split_points;
+    ASSERT_TRUE(suggest_split_points_by_load(shard_loads, a_thru_z_key_counts(10), 2, &split_points));
+    ASSERT_EQ(1u, split_points.size());
+    EXPECT_EQ(store_key_t("h"), split_points[0]);
+
+    /* If every shard is equally busy, the load follows the keys. */
+    shard_loads[0].second = shard_loads[1].second = 50.0;
+    ASSERT_TRUE(suggest_split_points_by_load(shard_loads, a_thru_z_key_counts(10), 2, &split_points));
+    ASSERT_EQ(1u, split_points.size());
+    EXPECT_EQ(store_key_t("m"), split_points[0]);
+
+    ASSERT_TRUE(suggest_split_points_by_load(shard_loads, a_thru_z_key_counts(10), 4, &split_points));
+    ASSERT_EQ(3u, split_points.size());
+    EXPECT_LT(split_points[0], split_points[1]);
+    EXPECT_LT(split_points[1], split_points[2]);
+
+    EXPECT_TRUE(suggest_split_points_by_load(shard_loads, a_thru_z_key_counts(10), 1, &split_points));
+    EXPECT_TRUE(split_points.empty());
+}
+
+TEST(ClusteringSuggester, SplitPointsByLoadWithoutDistribution) {
+    std::vector<std::pair<key_range_t, double> > shard_loads;
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::none, store_key_t(), key_range_t::open, store_key_t("g")), 10.0));
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::closed, store_key_t("g"), key_range_t::open, store_key_t("p")), 10.0));
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::closed, store_key_t("p"), key_range_t::none, store_key_t()), 80.0));
+
+    /* Without a distribution, the only places we can split are the existing
+    shard boundaries, so the two cold shards end up together. */
+    std::vector<store_key_t> split_points;
+    ASSERT_TRUE(suggest_split_points_by_load(shard_loads, std::map<store_key_t, int64_t>(), 2, &split_points));
+    ASSERT_EQ(1u, split_points.size());
+    EXPECT_EQ(store_key_t("p"), split_points[0]);
+
+    /* ...and there aren't enough of those for more shards than we have. */
+    EXPECT_FALSE(suggest_split_points_by_load(shard_loads, std::map<store_key_t, int64_t>(), 4, &split_points));
+    EXPECT_LT(split_points.size(), 3u);
+}
+
+TEST(ClusteringSuggester, SplitPointsByLoadIdleTable) {
+    std::vector<std::pair<key_range_t, double> > shard_loads;
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::none, store_key_t(), key_range_t::open, store_key_t("m")), 0.0));
+    shard_loads.push_back(std::make_pair(
+        key_range_t(key_range_t::closed, store_key_t("m"), key_range_t::none, store_key_t()), 0.0));
+
+    /* An idle table gives us nothing to split by, so there's no suggestion to
+    apply, rather than a suggestion to merge everything into one shard. */
+    std::vector<store_key_t> split_points;
+    EXPECT_FALSE(suggest_split_points_by_load(shard_loads, a_thru_z_key_counts(10), 2, &split_points));
+    EXPECT_TRUE(split_points.empty());
+}
+
 }  // namespace unittest
@@ -21,6 +21,14 @@ TEST(ContextSwitchingTest, CreateArtificialStack) {
     EXPECT_FALSE(a.context.is_nil());
 }
 
+TEST(ContextSwitchingTest, ArtificialStackIsLazilyCommitted) {
+    artificial_stack_t a(&noop, 1024*1024);
+    EXPECT_EQ(1024u * 1024u, a.get_stack_size());
+    /* Only the page(s) at the top, where the initial context was set up, should
+    have been touched. */
+    EXPECT_LT(a.get_resident_size(), 64u * 1024u);
+}
+
 /* Thread-local variables for use in test functions, because we cannot pass a
 `void*` to the test functions... */
 
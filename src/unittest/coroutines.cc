@@ -0,0 +1,45 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "config/args.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+void record_stack_size(size_t *size_out, cond_t *done) {
+    *size_out = coro_t::self()->get_stack()->get_stack_size();
+    done->pulse();
+}
+
+void run_stack_class_test() {
+    size_t small_size = 0, default_size = 0;
+    cond_t small_done, default_done;
+    coro_t::spawn_sometime(boost::bind(&record_stack_size, &small_size, &small_done),
+                           CORO_STACK_SMALL);
+    coro_t::spawn_sometime(boost::bind(&record_stack_size, &default_size, &default_done));
+    small_done.wait();
+    default_done.wait();
+
+    EXPECT_EQ(std::min<size_t>(COROUTINE_SMALL_STACK_SIZE, COROUTINE_STACK_SIZE), small_size);
+    EXPECT_EQ(static_cast<size_t>(COROUTINE_STACK_SIZE), default_size);
+
+    /* The same callable type gets whichever stack its call site asks for. */
+    size_t again_size = 0;
+    cond_t again_done;
+    coro_t::spawn_now_dangerously(boost::bind(&record_stack_size, &again_size, &again_done),
+                                  CORO_STACK_SMALL);
+    again_done.wait();
+    EXPECT_EQ(small_size, again_size);
+}
+
+TEST(CoroutinesTest, StackClass) {
+    run_in_thread_pool(&run_stack_class_test);
+}
+
+}  // namespace unittest
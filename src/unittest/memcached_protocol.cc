@@ -144,5 +144,177 @@ TEST(MemcachedProtocol, GetSet) {
     run_in_thread_pool_with_namespace_interface(&run_get_set_test);
 }
 
+/* `MultiGet` tests that a `multi_get_query_t` whose keys live on different
+shards gets its results back in the order the keys were asked for */
+void run_multi_get_test(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source) {
+    const char *stored_keys[] = { "a", "m", "n", "z" };
+    for (size_t i = 0; i < sizeof(stored_keys) / sizeof(stored_keys[0]); ++i) {
+        sarc_mutation_t set;
+        set.key = store_key_t(stored_keys[i]);
+        set.data = data_buffer_t::create(1);
+        set.data->buf()[0] = stored_keys[i][0] - 'a' + 'A';
+        set.flags = i;
+        set.exptime = 0;
+        set.add_policy = add_policy_yes;
+        set.replace_policy = replace_policy_yes;
+        memcached_protocol_t::write_t write(set, time(NULL), 12345);
+
+        cond_t interruptor;
+        memcached_protocol_t::write_response_t result;
+        nsi->write(write, &result, order_source->check_in("unittest::run_multi_get_test(memcached_protocol.cc-A)"), &interruptor);
+        EXPECT_EQ(sr_stored, boost::get<set_result_t>(result.result));
+    }
+
+    /* Out of order, with a key that's missing and a key that's asked for twice */
+    std::vector<store_key_t> keys;
+    keys.push_back(store_key_t("z"));
+    keys.push_back(store_key_t("b"));
+    keys.push_back(store_key_t("a"));
+    keys.push_back(store_key_t("n"));
+    keys.push_back(store_key_t("z"));
+    keys.push_back(store_key_t("m"));
+    memcached_protocol_t::read_t read(multi_get_query_t(keys), time(NULL));
+
+    cond_t interruptor;
+    memcached_protocol_t::read_response_t result;
+    nsi->read(read, &result, order_source->check_in("unittest::run_multi_get_test(memcached_protocol.cc-B)").with_read_mode(), &interruptor);
+
+    multi_get_result_t *maybe_multi_get_result = boost::get<multi_get_result_t>(&result.result);
+    ASSERT_TRUE(maybe_multi_get_result != NULL);
+    ASSERT_EQ(keys.size(), maybe_multi_get_result->results.size());
+    const char expected[] = { 'Z', 0, 'A', 'N', 'Z', 'M' };
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const get_result_t &res = maybe_multi_get_result->results[i];
+        if (expected[i] == 0) {
+            EXPECT_FALSE(res.value.has());
+        } else {
+            ASSERT_TRUE(res.value.has());
+            ASSERT_EQ(1, res.value->size());
+            EXPECT_EQ(expected[i], res.value->buf()[0]);
+        }
+    }
+}
+TEST(MemcachedProtocol, MultiGet) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_get_test);
+}
+
+std::vector<store_key_t> find_expired_keys(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source, exptime_t effective_time) {
+    memcached_protocol_t::read_t read(expired_keys_query_t(hash_region_t<key_range_t>::universe(), 100), effective_time);
+
+    cond_t interruptor;
+    memcached_protocol_t::read_response_t result;
+    nsi->read(read, &result, order_source->check_in("unittest::find_expired_keys(memcached_protocol.cc)").with_read_mode(), &interruptor);
+
+    expired_keys_result_t *maybe_expired_keys_result = boost::get<expired_keys_result_t>(&result.result);
+    guarantee(maybe_expired_keys_result != NULL);
+    EXPECT_EQ(maybe_expired_keys_result->keys.size(), maybe_expired_keys_result->sizes.size());
+    for (size_t i = 0; i < maybe_expired_keys_result->sizes.size(); ++i) {
+        /* A one-byte key and a one-byte value */
+        EXPECT_EQ(2, maybe_expired_keys_result->sizes[i]);
+    }
+    std::vector<store_key_t> keys = maybe_expired_keys_result->keys;
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+/* `Expire` tests that `expired_keys_query_t` finds the expired keys on every
+shard, and that `expire_mutation_t` removes only keys that have expired */
+void run_expire_test(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source) {
+    const char *stored_keys[] = { "a", "m", "n", "z" };
+    const exptime_t exptimes[] = { 1000, 0, 1000, 3000 };
+    for (size_t i = 0; i < sizeof(stored_keys) / sizeof(stored_keys[0]); ++i) {
+        sarc_mutation_t set;
+        set.key = store_key_t(stored_keys[i]);
+        set.data = data_buffer_t::create(1);
+        set.data->buf()[0] = 'x';
+        set.flags = 0;
+        set.exptime = exptimes[i];
+        set.add_policy = add_policy_yes;
+        set.replace_policy = replace_policy_yes;
+        memcached_protocol_t::write_t write(set, time(NULL), 500);
+
+        cond_t interruptor;
+        memcached_protocol_t::write_response_t result;
+        nsi->write(write, &result, order_source->check_in("unittest::run_expire_test(memcached_protocol.cc-A)"), &interruptor);
+        EXPECT_EQ(sr_stored, boost::get<set_result_t>(result.result));
+    }
+
+    EXPECT_TRUE(find_expired_keys(nsi, order_source, 500).empty());
+
+    std::vector<store_key_t> expired = find_expired_keys(nsi, order_source, 2000);
+    ASSERT_EQ(2u, expired.size());
+    EXPECT_EQ(store_key_t("a"), expired[0]);
+    EXPECT_EQ(store_key_t("n"), expired[1]);
+
+    const char *keys_to_expire[] = { "a", "m", "z" };
+    const delete_result_t expected[] = { dr_deleted, dr_not_found, dr_not_found };
+    for (size_t i = 0; i < sizeof(keys_to_expire) / sizeof(keys_to_expire[0]); ++i) {
+        memcached_protocol_t::write_t write(expire_mutation_t(store_key_t(keys_to_expire[i])), INVALID_CAS, 2000);
+
+        cond_t interruptor;
+        memcached_protocol_t::write_response_t result;
+        nsi->write(write, &result, order_source->check_in("unittest::run_expire_test(memcached_protocol.cc-B)"), &interruptor);
+        EXPECT_EQ(expected[i], boost::get<delete_result_t>(result.result));
+    }
+
+    expired = find_expired_keys(nsi, order_source, 2000);
+    ASSERT_EQ(1u, expired.size());
+    EXPECT_EQ(store_key_t("n"), expired[0]);
+
+    /* "m" and "z" weren't expired, so they must still be there */
+    const char *live_keys[] = { "m", "z" };
+    for (size_t i = 0; i < sizeof(live_keys) / sizeof(live_keys[0]); ++i) {
+        memcached_protocol_t::read_t read(get_query_t(store_key_t(live_keys[i])), 2000);
+
+        cond_t interruptor;
+        memcached_protocol_t::read_response_t result;
+        nsi->read(read, &result, order_source->check_in("unittest::run_expire_test(memcached_protocol.cc-C)").with_read_mode(), &interruptor);
+        EXPECT_TRUE(boost::get<get_result_t>(result.result).value.has());
+    }
+}
+TEST(MemcachedProtocol, Expire) {
+    run_in_thread_pool_with_namespace_interface(&run_expire_test);
+}
+
+incr_decr_result_t run_incr(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source,
+                            const incr_decr_mutation_t &mutation) {
+    memcached_protocol_t::write_t write(mutation, time(NULL), 12345);
+
+    cond_t interruptor;
+    memcached_protocol_t::write_response_t result;
+    nsi->write(write, &result, order_source->check_in("unittest::run_incr(memcached_protocol.cc-A)"), &interruptor);
+    return boost::get<incr_decr_result_t>(result.result);
+}
+
+/* `IncrCreate` tests that an increment that may create its key does so in the
+same write, and leaves an existing key's value alone */
+void run_incr_create_test(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source) {
+    incr_decr_result_t res = run_incr(nsi, order_source, incr_decr_mutation_t(incr_decr_INCR, store_key_t("c"), 5));
+    EXPECT_EQ(incr_decr_result_t::idr_not_found, res.res);
+
+    res = run_incr(nsi, order_source, incr_decr_mutation_t(incr_decr_INCR, store_key_t("c"), 5, 10, 0));
+    EXPECT_EQ(incr_decr_result_t::idr_success, res.res);
+    EXPECT_EQ(10u, res.new_value);
+
+    res = run_incr(nsi, order_source, incr_decr_mutation_t(incr_decr_INCR, store_key_t("c"), 5, 10, 0));
+    EXPECT_EQ(incr_decr_result_t::idr_success, res.res);
+    EXPECT_EQ(15u, res.new_value);
+
+    res = run_incr(nsi, order_source, incr_decr_mutation_t(incr_decr_DECR, store_key_t("c"), 3));
+    EXPECT_EQ(incr_decr_result_t::idr_success, res.res);
+    EXPECT_EQ(12u, res.new_value);
+
+    memcached_protocol_t::read_t read(get_query_t(store_key_t("c")), time(NULL));
+    cond_t interruptor;
+    memcached_protocol_t::read_response_t result;
+    nsi->read(read, &result, order_source->check_in("unittest::run_incr_create_test(memcached_protocol.cc-A)").with_read_mode(), &interruptor);
+    get_result_t get_result = boost::get<get_result_t>(result.result);
+    ASSERT_TRUE(get_result.value.has());
+    EXPECT_EQ(std::string("12"), std::string(get_result.value->buf(), get_result.value->size()));
+}
+TEST(MemcachedProtocol, IncrCreate) {
+    run_in_thread_pool_with_namespace_interface(&run_incr_create_test);
+}
+
 }   /* namespace unittest */
 
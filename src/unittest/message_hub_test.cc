@@ -0,0 +1,50 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/pmap.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+/* Ping-pong microbenchmark for the message hub. Every thread runs a coroutine that hops
+back and forth between its own thread and the next one, so with N threads there are N
+rings busy in each direction at once. Each `on_thread_t` hop is one message. */
+
+static const int hub_round_trips_per_thread = 20000;
+
+void ping_pong(int num_threads, int thread) {
+    on_thread_t home(thread);
+    const int peer = (thread + 1) % num_threads;
+    for (int i = 0; i < hub_round_trips_per_thread; ++i) {
+        on_thread_t hop(peer);
+    }
+}
+
+void run_message_hub_ping_pong(int num_threads) {
+    const ticks_t start = get_ticks();
+    pmap(num_threads, boost::bind(&ping_pong, num_threads, _1));
+    const double secs = ticks_to_secs(get_ticks() - start);
+
+    const double messages = 2.0 * hub_round_trips_per_thread * num_threads;
+    // Every coroutine does its round trips back to back, so the latency of one round
+    // trip is simply the total time divided by the number of round trips per thread.
+    const double round_trip_usecs = secs * MILLION / hub_round_trips_per_thread;
+
+    printf("message hub ping-pong, %2d threads: %12.0f messages/sec, %8.2f usec/round trip\n",
+           num_threads, messages / secs, round_trip_usecs);
+}
+
+TEST(MessageHubTest, PingPong) {
+    for (int num_threads = 2; num_threads <= 64; num_threads *= 2) {
+        unittest::run_in_thread_pool(boost::bind(&run_message_hub_ping_pong, num_threads),
+                                     num_threads);
+    }
+}
+
+}  // namespace unittest
@@ -39,6 +39,11 @@ public:
         /* do nothing */
     }
 
+    ticks_t get_average_latency(UNUSED void *account) {
+        // Mock files complete everything immediately.
+        return 0;
+    }
+
     bool coop_lock_and_check();
 
 private:
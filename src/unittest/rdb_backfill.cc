@@ -1,12 +1,14 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 #include "unittest/gtest.hpp"
 
+#include "btree/btree_store.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/immediate_consistency/branch/broadcaster.hpp"
 #include "clustering/immediate_consistency/branch/listener.hpp"
 #include "clustering/immediate_consistency/branch/replier.hpp"
 #include "extproc/pool.hpp"
 #include "extproc/spawner.hpp"
+#include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/pb_utils.hpp"
 #include "rdb_protocol/proto_utils.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -326,5 +328,58 @@ TEST(RDBProtocolBackfill, SindexBackfill) {
      run_in_thread_pool_with_broadcaster(&run_sindex_backfill_test);
 }
 
+rdb_protocol_t::backfill_chunk_t make_leaf_chunk(size_t num_keys) {
+    std::vector<rdb_protocol_details::backfill_atom_t> atoms;
+    for (size_t i = 0; i < num_keys; ++i) {
+        atoms.push_back(rdb_protocol_details::backfill_atom_t(
+            store_key_t(strprintf("%zu", i)), generate_document(strprintf("%zu", i)),
+            repli_timestamp_t::invalid));
+    }
+    return rdb_protocol_t::backfill_chunk_t::set_keys(atoms);
+}
+
+/* A leaf's worth of pairs arrives as a single chunk and is written in a single
+transaction, so both the credit it uses up and the transaction it gets must be
+sized for every key in it. */
+void run_receive_leaf_chunk_test() {
+    order_source_t order_source;
+    io_backender_t io_backender;
+    test_store_t<rdb_protocol_t> store(&io_backender, &order_source, NULL);
+
+    const size_t leaf_keys = 500;
+    rdb_protocol_t::backfill_chunk_t leaf = make_leaf_chunk(leaf_keys);
+    EXPECT_EQ(leaf_keys, leaf.get_key_count());
+    EXPECT_EQ(std::min<int>(leaf_keys, BACKFILL_MAX_KEYS_IN_FLIGHT),
+              backfill_chunk_credit<rdb_protocol_t>(leaf));
+    EXPECT_EQ(1, backfill_chunk_credit<rdb_protocol_t>(
+                  rdb_protocol_t::backfill_chunk_t::delete_key(store_key_t("a"), repli_timestamp_t::invalid)));
+
+    cond_t non_interruptor;
+    {
+        write_token_pair_t token_pair;
+        store.store.new_write_token_pair(&token_pair);
+        store.store.receive_backfill(leaf, &token_pair, &non_interruptor);
+    }
+
+    read_token_pair_t token_pair;
+    store.store.new_read_token_pair(&token_pair);
+    scoped_ptr_t<transaction_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store.store.acquire_superblock_for_read(rwi_read, &token_pair.main_read_token,
+                                            &txn, &superblock, &non_interruptor, true);
+    for (size_t i = 0; i < leaf_keys; ++i) {
+        rdb_protocol_t::point_read_response_t response;
+        rdb_get(store_key_t(strprintf("%zu", i)), store.store.btree.get(),
+                txn.get(), superblock.get(), &response);
+        ASSERT_TRUE(response.data.get() != NULL);
+        EXPECT_EQ(0, query_language::json_cmp(generate_document(strprintf("%zu", i))->get(),
+                                               response.data->get()));
+    }
+}
+
+TEST(RDBProtocolBackfill, ReceiveLeafChunk) {
+    run_in_thread_pool(&run_receive_leaf_chunk_test);
+}
+
 }   /* namespace unittest */
 
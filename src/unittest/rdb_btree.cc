@@ -92,7 +92,7 @@ std::string create_sindex(btree_store_t<rdb_protocol_t> *store) {
     ql::map_wire_func_t m(mapping, std::map<int64_t, Datum>());
 
     write_message_t wm;
-    wm << m;
+    serialize_sindex_info(&wm, m, SINGLE, boost::optional<std::vector<std::string> >());
 
     vector_stream_t stream;
     int res = send_write_message(&stream, &wm);
@@ -216,7 +216,8 @@ void check_keys_are_present(btree_store_t<rdb_protocol_t> *store,
                rdb_protocol_t::sindex_key_range(store_key_t(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(i * i)).get(), backtrace_t())),
                                                 store_key_t(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(i * i)).get(), backtrace_t()))),
                txn.get(), sindex_sb.get(), NULL, rdb_protocol_details::transform_t(),
-               boost::optional<rdb_protocol_details::terminal_t>(), &res);
+               boost::optional<rdb_protocol_details::terminal_t>(),
+               RDB_RGET_MAX_CHUNK_BYTES, &res);
 
         rdb_protocol_t::rget_read_response_t::stream_t *stream = boost::get<rdb_protocol_t::rget_read_response_t::stream_t>(&res.result);
         ASSERT_TRUE(stream != NULL);
@@ -257,7 +258,8 @@ void check_keys_are_NOT_present(btree_store_t<rdb_protocol_t> *store,
                rdb_protocol_t::sindex_key_range(store_key_t(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(i * i)).get(), backtrace_t())),
                                                 store_key_t(cJSON_print_primary(scoped_cJSON_t(cJSON_CreateNumber(i * i)).get(), backtrace_t()))),
                txn.get(), sindex_sb.get(), NULL, rdb_protocol_details::transform_t(),
-               boost::optional<rdb_protocol_details::terminal_t>(), &res);
+               boost::optional<rdb_protocol_details::terminal_t>(),
+               RDB_RGET_MAX_CHUNK_BYTES, &res);
 
         rdb_protocol_t::rget_read_response_t::stream_t *stream = boost::get<rdb_protocol_t::rget_read_response_t::stream_t>(&res.result);
         ASSERT_TRUE(stream != NULL);
@@ -465,4 +467,283 @@ TEST(RDBBtree, SindexInterruptionViaStoreDelete) {
     run_in_thread_pool(&run_sindex_interruption_via_store_delete);
 }
 
+/* Reads the sindex's entry from the sindex block. Taking the sindex block for
+ * write keeps post construction from checkpointing while we look. */
+secondary_index_t get_sindex(btree_store_t<rdb_protocol_t> *store,
+                             const std::string &sindex_id) {
+    cond_t dummy_interruptor;
+    write_token_pair_t token_pair;
+    store->new_write_token_pair(&token_pair);
+
+    scoped_ptr_t<transaction_t> txn;
+    scoped_ptr_t<real_superblock_t> super_block;
+    store->acquire_superblock_for_write(rwi_write, repli_timestamp_t::invalid,
+                                        1, WRITE_DURABILITY_SOFT,
+                                        &token_pair, &txn, &super_block, &dummy_interruptor);
+
+    scoped_ptr_t<buf_lock_t> sindex_block;
+    store->acquire_sindex_block_for_write(
+            &token_pair, txn.get(), &sindex_block,
+            super_block->get_sindex_block_id(),
+            &dummy_interruptor);
+
+    secondary_index_t sindex;
+    bool found = get_secondary_index(txn.get(), sindex_block.get(), sindex_id, &sindex);
+    guarantee(found);
+    return sindex;
+}
+
+void run_sindex_chunked_post_construction_test() {
+    recreate_temporary_directory(base_path_t("."));
+    temp_file_t temp_file;
+
+    io_backender_t io_backender;
+
+    filepath_file_opener_t file_opener(temp_file.name(), &io_backender);
+    standard_serializer_t::create(
+        &file_opener,
+        standard_serializer_t::static_config_t());
+
+    standard_serializer_t serializer(
+        standard_serializer_t::dynamic_config_t(),
+        &file_opener,
+        &get_global_perfmon_collection());
+
+    scoped_ptr_t<rdb_protocol_t::store_t> store(
+            new rdb_protocol_t::store_t(
+            &serializer,
+            "unit_test_store",
+            GIGABYTE,
+            true,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t(".")));
+
+    insert_rows(0, TOTAL_KEYS_TO_INSERT, store.get());
+
+    std::string sindex_id = create_sindex(store.get());
+
+    /* With chunks of a single key, every bucket of the key distribution gets a
+     * chunk of its own. */
+    const int64_t chunk_keys = 1;
+    {
+        cond_t dummy_interruptor;
+        std::vector<key_range_t> chunks;
+        get_post_construction_chunks(store.get(), store_key_t::min(), chunk_keys,
+                                     &chunks, &dummy_interruptor);
+        ASSERT_GT(chunks.size(), 2u);
+    }
+
+    {
+        cond_t dummy_interruptor;
+        write_token_pair_t token_pair;
+        store->new_write_token_pair(&token_pair);
+
+        scoped_ptr_t<transaction_t> txn;
+        scoped_ptr_t<real_superblock_t> super_block;
+        store->acquire_superblock_for_write(rwi_write, repli_timestamp_t::invalid,
+                                            1, WRITE_DURABILITY_SOFT,
+                                            &token_pair, &txn, &super_block, &dummy_interruptor);
+
+        scoped_ptr_t<buf_lock_t> sindex_block;
+        store->acquire_sindex_block_for_write(
+                &token_pair, txn.get(), &sindex_block,
+                super_block->get_sindex_block_id(),
+                &dummy_interruptor);
+
+        std::set<std::string> created_sindexes;
+        created_sindexes.insert(sindex_id);
+
+        rdb_protocol_details::bring_sindexes_up_to_date(created_sindexes, store.get(),
+                sindex_block.get(), txn.get(), chunk_keys);
+    }
+
+    /* Wait for the first checkpoint, and interrupt post construction by
+     * deleting the store before it gets through the rest of the chunks. */
+    secondary_index_t sindex = get_sindex(store.get(), sindex_id);
+    while (sindex.post_construction_progress == store_key_t::min()
+           && !sindex.post_construction_complete) {
+        sindex = get_sindex(store.get(), sindex_id);
+    }
+    ASSERT_FALSE(sindex.post_construction_complete);
+    store.reset();
+
+    /* Reopening the store resumes post construction from the checkpoint. It
+     * has to wipe whatever the interrupted chunk left in the sindex, or the
+     * keys past the checkpoint would be indexed twice. */
+    store.init(new rdb_protocol_t::store_t(
+            &serializer,
+            "unit_test_store",
+            GIGABYTE,
+            false,
+            &get_global_perfmon_collection(),
+            NULL,
+            &io_backender,
+            base_path_t(".")));
+
+    sindex = get_sindex(store.get(), sindex_id);
+    EXPECT_FALSE(sindex.post_construction_progress == store_key_t::min());
+    for (int i = 0; i < 1000 && !sindex.post_construction_complete; ++i) {
+        nap(10);
+        sindex = get_sindex(store.get(), sindex_id);
+    }
+    ASSERT_TRUE(sindex.post_construction_complete);
+
+    check_keys_are_present(store.get(), sindex_id);
+}
+
+TEST(RDBBtree, SindexChunkedPostConstruct) {
+    run_in_thread_pool(&run_sindex_chunked_post_construction_test);
+}
+
+std::vector<char> sindex_info_blob(write_message_t *wm) {
+    vector_stream_t stream;
+    int res = send_write_message(&stream, wm);
+    guarantee(res == 0);
+    return stream.vector();
+}
+
+ql::map_wire_func_t sid_mapping() {
+    Term mapping;
+    Term *arg = ql::pb::set_func(&mapping, 1);
+    N2(GETATTR, NVAR(1), NDATUM("sid"));
+    return ql::map_wire_func_t(mapping, std::map<int64_t, Datum>());
+}
+
+void run_sindex_info_compatibility_test() {
+    ql::map_wire_func_t m = sid_mapping();
+    ql::map_wire_func_t mapping_out;
+    sindex_multi_bool_t multi_out = MULTI;
+    boost::optional<std::vector<std::string> > projection_out;
+
+    /* Older versions only stored the mapping. */
+    {
+        write_message_t wm;
+        wm << m;
+        deserialize_sindex_info(sindex_info_blob(&wm), &mapping_out, &multi_out, &projection_out);
+        EXPECT_EQ(SINGLE, multi_out);
+    }
+
+    {
+        write_message_t wm;
+        serialize_sindex_info(&wm, m, MULTI, boost::optional<std::vector<std::string> >());
+        deserialize_sindex_info(sindex_info_blob(&wm), &mapping_out, &multi_out, &projection_out);
+        EXPECT_EQ(MULTI, multi_out);
+    }
+}
+
+TEST(RDBBtree, SindexInfoCompatibility) {
+    run_in_thread_pool(&run_sindex_info_compatibility_test);
+}
+
+void run_slim_sindex_info_compatibility_test() {
+    ql::map_wire_func_t m = sid_mapping();
+    ql::map_wire_func_t mapping_out;
+    sindex_multi_bool_t multi_out;
+    boost::optional<std::vector<std::string> > projection_out;
+
+    /* Sindexes from before slim sindexes stop before the projection, whether
+    or not they have `multi`. */
+    {
+        projection_out = std::vector<std::string>(1, "sid");
+        write_message_t wm;
+        wm << m;
+        deserialize_sindex_info(sindex_info_blob(&wm), &mapping_out, &multi_out, &projection_out);
+        EXPECT_FALSE(projection_out);
+    }
+
+    {
+        projection_out = std::vector<std::string>(1, "sid");
+        write_message_t wm;
+        wm << m;
+        wm << MULTI;
+        deserialize_sindex_info(sindex_info_blob(&wm), &mapping_out, &multi_out, &projection_out);
+        EXPECT_EQ(MULTI, multi_out);
+        EXPECT_FALSE(projection_out);
+    }
+
+    {
+        write_message_t wm;
+        serialize_sindex_info(&wm, m, SINGLE, std::vector<std::string>(1, "sid"));
+        deserialize_sindex_info(sindex_info_blob(&wm), &mapping_out, &multi_out, &projection_out);
+        EXPECT_EQ(SINGLE, multi_out);
+        ASSERT_TRUE(projection_out);
+        EXPECT_EQ(std::vector<std::string>(1, "sid"), *projection_out);
+    }
+}
+
+TEST(RDBBtree, SlimSindexInfoCompatibility) {
+    run_in_thread_pool(&run_slim_sindex_info_compatibility_test);
+}
+
+/* A function of one row that gets `field` from it, like `r.row(field)` but
+ * through a proper variable. */
+Term get_field_func(const char *field) {
+    Term func;
+    Term *arg = ql::pb::set_func(&func, 1);
+    N2(GETATTR, NVAR(1), NDATUM(field));
+    return func;
+}
+
+void run_sindex_projection_covers_test() {
+    std::vector<std::string> projection(1, "sid");
+    ql::map_wire_func_t mapping(get_field_func("sid"), std::map<int64_t, Datum>());
+    boost::optional<rdb_protocol_details::terminal_t> no_terminal;
+    ql::count_wire_func_t count_func;
+    boost::optional<rdb_protocol_details::terminal_t> count(
+        rdb_protocol_details::terminal_t(count_func, scopes_t(), backtrace_t()));
+
+    /* The rows themselves need the primary btree, counting them doesn't. */
+    rdb_protocol_details::transform_t no_transform;
+    EXPECT_FALSE(sindex_projection_covers(projection, mapping, no_transform, no_terminal));
+    EXPECT_TRUE(sindex_projection_covers(projection, mapping, no_transform, count));
+
+    /* A map over a projected field is covered, over any other field it isn't. */
+    rdb_protocol_details::transform_t map_sid;
+    map_sid.push_back(rdb_protocol_details::transform_atom_t(
+        ql::map_wire_func_t(get_field_func("sid"), std::map<int64_t, Datum>()),
+        scopes_t(), backtrace_t()));
+    EXPECT_TRUE(sindex_projection_covers(projection, mapping, map_sid, no_terminal));
+
+    rdb_protocol_details::transform_t map_other;
+    map_other.push_back(rdb_protocol_details::transform_atom_t(
+        ql::map_wire_func_t(get_field_func("other"), std::map<int64_t, Datum>()),
+        scopes_t(), backtrace_t()));
+    EXPECT_FALSE(sindex_projection_covers(projection, mapping, map_other, no_terminal));
+
+    /* A filter on a projected field followed by a count is covered... */
+    rdb_protocol_details::transform_t filter_sid;
+    {
+        Term func;
+        Term *arg = ql::pb::set_func(&func, 1);
+        N2(EQ, N2(GETATTR, NVAR(1), NDATUM("sid")), NDATUM(1.0));
+        filter_sid.push_back(rdb_protocol_details::transform_atom_t(
+            ql::filter_wire_func_t(func, std::map<int64_t, Datum>()),
+            scopes_t(), backtrace_t()));
+    }
+    EXPECT_TRUE(sindex_projection_covers(projection, mapping, filter_sid, count));
+
+    /* ...but one that reads the row through `r.row` falls back to the
+     * primary btree, even if it only gets a projected field. */
+    rdb_protocol_details::transform_t filter_implicit;
+    {
+        Term func;
+        Term *arg = ql::pb::set_func(&func, 1);
+        N2(EQ, N2(GETATTR, N0(IMPLICIT_VAR), NDATUM("sid")), NDATUM(1.0));
+        filter_implicit.push_back(rdb_protocol_details::transform_atom_t(
+            ql::filter_wire_func_t(func, std::map<int64_t, Datum>()),
+            scopes_t(), backtrace_t()));
+    }
+    EXPECT_FALSE(sindex_projection_covers(projection, mapping, filter_implicit, count));
+
+    /* The index function has to be covered too. */
+    ql::map_wire_func_t other_mapping(get_field_func("other"), std::map<int64_t, Datum>());
+    EXPECT_FALSE(sindex_projection_covers(projection, other_mapping, no_transform, count));
+}
+
+TEST(RDBBtree, SindexProjectionCovers) {
+    run_in_thread_pool(&run_sindex_projection_covers_test);
+}
+
 } //namespace unittest
@@ -11,6 +11,7 @@
 #include "rdb_protocol/pb_utils.hpp"
 #include "rdb_protocol/proto_utils.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/stream.hpp"
 #include "rpc/directory/read_manager.hpp"
 #include "rpc/semilattice/semilattice_manager.hpp"
 #include "serializer/config.hpp"
@@ -164,7 +165,10 @@ TEST(RDBProtocol, OvershardedGetSet) {
 }
 
 std::string create_sindex(namespace_interface_t<rdb_protocol_t> *nsi,
-                          order_source_t *osource) {
+                          order_source_t *osource,
+                          sindex_multi_bool_t multi = SINGLE,
+                          const boost::optional<std::vector<std::string> > &projection
+                              = boost::optional<std::vector<std::string> >()) {
     std::string id = uuid_to_str(generate_uuid());
     Term mapping;
     Term *arg = ql::pb::set_func(&mapping, 1);
@@ -172,7 +176,7 @@ std::string create_sindex(namespace_interface_t<rdb_protocol_t> *nsi,
 
     ql::map_wire_func_t m(mapping, std::map<int64_t, Datum>());
 
-    rdb_protocol_t::write_t write(rdb_protocol_t::sindex_create_t(id, m));
+    rdb_protocol_t::write_t write(rdb_protocol_t::sindex_create_t(id, m, multi, projection));
     rdb_protocol_t::write_response_t response;
 
     cond_t interruptor;
@@ -298,6 +302,146 @@ TEST(RDBProtocol, OvershardedSindexCreateDrop) {
     run_in_thread_pool_with_namespace_interface(&run_create_drop_sindex_test, true);
 }
 
+size_t count_sindex_range_matches(namespace_interface_t<rdb_protocol_t> *nsi,
+                                  order_source_t *osource,
+                                  const std::string &id,
+                                  double left, double right) {
+    rdb_protocol_t::read_t read(rdb_protocol_t::rget_read_t(id,
+                                                            make_counted<ql::datum_t>(left),
+                                                            make_counted<ql::datum_t>(right)));
+    rdb_protocol_t::read_response_t response;
+
+    cond_t interruptor;
+    nsi->read(read, &response, osource->check_in("unittest::count_sindex_range_matches(rdb_protocol_t.cc-A"), &interruptor);
+
+    rdb_protocol_t::rget_read_response_t *rget_resp = boost::get<rdb_protocol_t::rget_read_response_t>(&response.response);
+    if (rget_resp == NULL) {
+        ADD_FAILURE() << "got wrong type of result back";
+        return 0;
+    }
+    rdb_protocol_t::rget_read_response_t::stream_t *stream = boost::get<rdb_protocol_t::rget_read_response_t::stream_t>(&rget_resp->result);
+    if (stream == NULL) {
+        ADD_FAILURE() << "got wrong type of result back";
+        return 0;
+    }
+    return stream->size();
+}
+
+size_t count_sindex_matches(namespace_interface_t<rdb_protocol_t> *nsi,
+                            order_source_t *osource,
+                            const std::string &id,
+                            double value) {
+    return count_sindex_range_matches(nsi, osource, id, value, value);
+}
+
+void run_multi_sindex_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    std::string multi_id = create_sindex(nsi, osource, MULTI);
+    std::string compound_id = create_sindex(nsi, osource, SINGLE);
+
+    query_language::backtrace_t b;
+    boost::shared_ptr<scoped_cJSON_t> data(new scoped_cJSON_t(cJSON_Parse("{\"id\" : 0, \"sid\" : [1, 2, 2]}")));
+    ASSERT_TRUE(data->get());
+    store_key_t pk = store_key_t(cJSON_print_primary(cJSON_GetObjectItem(data->get(), "id"), b));
+
+    {
+        rdb_protocol_t::write_t write(rdb_protocol_t::point_write_t(pk, data));
+        rdb_protocol_t::write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::run_multi_sindex_test(rdb_protocol_t.cc-A"), &interruptor);
+    }
+
+    /* The multi index has an entry for each distinct element... */
+    EXPECT_EQ(1u, count_sindex_matches(nsi, osource, multi_id, 1.0));
+    EXPECT_EQ(1u, count_sindex_matches(nsi, osource, multi_id, 2.0));
+    EXPECT_EQ(0u, count_sindex_matches(nsi, osource, multi_id, 3.0));
+
+    /* ...but a range that takes in several of them still gets the row once. */
+    EXPECT_EQ(1u, count_sindex_range_matches(nsi, osource, multi_id, 1.0, 2.0));
+    EXPECT_EQ(1u, count_sindex_range_matches(nsi, osource, multi_id, 0.0, 3.0));
+
+    /* ...while the other one indexes the array as a whole. */
+    EXPECT_EQ(0u, count_sindex_matches(nsi, osource, compound_id, 1.0));
+
+    {
+        rdb_protocol_t::point_delete_t d(pk);
+        rdb_protocol_t::write_t write(d);
+        rdb_protocol_t::write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::run_multi_sindex_test(rdb_protocol_t.cc-B"), &interruptor);
+    }
+
+    EXPECT_EQ(0u, count_sindex_matches(nsi, osource, multi_id, 1.0));
+    EXPECT_EQ(0u, count_sindex_matches(nsi, osource, multi_id, 2.0));
+}
+
+TEST(RDBProtocol, MultiSindex) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_sindex_test, false);
+}
+
+TEST(RDBProtocol, OvershardedMultiSindex) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_sindex_test, true);
+}
+
+void run_slim_sindex_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    std::string id = create_sindex(nsi, osource, SINGLE, std::vector<std::string>(1, "sid"));
+
+    query_language::backtrace_t b;
+    boost::shared_ptr<scoped_cJSON_t> data(new scoped_cJSON_t(cJSON_Parse("{\"id\" : 0, \"sid\" : 1, \"other\" : \"abc\"}")));
+    ASSERT_TRUE(data->get());
+    store_key_t pk = store_key_t(cJSON_print_primary(cJSON_GetObjectItem(data->get(), "id"), b));
+
+    {
+        rdb_protocol_t::write_t write(rdb_protocol_t::point_write_t(pk, data));
+        rdb_protocol_t::write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::run_slim_sindex_test(rdb_protocol_t.cc-A"), &interruptor);
+    }
+
+    {
+        /* The sindex only stores `sid`, but a plain read wants the whole row,
+         * so it has to come from the primary btree. */
+        counted_t<const ql::datum_t> sindex_key_literal = make_counted<ql::datum_t>(1.0);
+        rdb_protocol_t::read_t read(rdb_protocol_t::rget_read_t(id,
+                                                                sindex_key_literal,
+                                                                sindex_key_literal));
+        rdb_protocol_t::read_response_t response;
+
+        cond_t interruptor;
+        nsi->read(read, &response, osource->check_in("unittest::run_slim_sindex_test(rdb_protocol_t.cc-B"), &interruptor);
+
+        if (rdb_protocol_t::rget_read_response_t *rget_resp = boost::get<rdb_protocol_t::rget_read_response_t>(&response.response)) {
+            rdb_protocol_t::rget_read_response_t::stream_t *stream = boost::get<rdb_protocol_t::rget_read_response_t::stream_t>(&rget_resp->result);
+            ASSERT_TRUE(stream != NULL);
+            ASSERT_TRUE(stream->size() == 1);
+            ASSERT_TRUE(query_language::json_cmp(stream->at(0).second->get(), data->get()) == 0);
+        } else {
+            ADD_FAILURE() << "got wrong type of result back";
+        }
+    }
+
+    {
+        rdb_protocol_t::point_delete_t d(pk);
+        rdb_protocol_t::write_t write(d);
+        rdb_protocol_t::write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::run_slim_sindex_test(rdb_protocol_t.cc-C"), &interruptor);
+    }
+
+    EXPECT_EQ(0u, count_sindex_matches(nsi, osource, id, 1.0));
+}
+
+TEST(RDBProtocol, SlimSindex) {
+    run_in_thread_pool_with_namespace_interface(&run_slim_sindex_test, false);
+}
+
+TEST(RDBProtocol, OvershardedSlimSindex) {
+    run_in_thread_pool_with_namespace_interface(&run_slim_sindex_test, true);
+}
+
 std::set<std::string> list_sindexes(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
     rdb_protocol_t::sindex_list_t l;
     rdb_protocol_t::read_t read(l);
@@ -453,5 +597,316 @@ TEST(RDBProtocol, OvershardedMissingAttr) {
     run_in_thread_pool_with_namespace_interface(&run_sindex_missing_attr_test, true);
 }
 
+/* Stands in for the cluster's namespace interface in front of the one the tests
+run on, so that the rget stream tests can pick the sharding scheme it reports and
+make its reads fail. An empty `scheme` means it can't compute one. */
+class rget_stream_namespace_interface_t : public namespace_interface_t<rdb_protocol_t> {
+public:
+    rget_stream_namespace_interface_t(namespace_interface_t<rdb_protocol_t> *_inner,
+                                      const std::set<rdb_protocol_t::region_t> &_scheme)
+        : reads_fail(false), empty_chunks(0), inner(_inner), scheme(_scheme) { }
+
+    void read(const rdb_protocol_t::read_t &read,
+              rdb_protocol_t::read_response_t *response,
+              order_token_t tok,
+              signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        if (reads_fail) {
+            throw cannot_perform_query_exc_t("read failed on purpose");
+        }
+        if (!answer_with_empty_chunk(read, response)) {
+            inner->read(read, response, tok, interruptor);
+        }
+    }
+
+    void read_outdated(const rdb_protocol_t::read_t &read,
+                       rdb_protocol_t::read_response_t *response,
+                       signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        if (reads_fail) {
+            throw cannot_perform_query_exc_t("read failed on purpose");
+        }
+        if (!answer_with_empty_chunk(read, response)) {
+            inner->read_outdated(read, response, interruptor);
+        }
+    }
+
+    void write(const rdb_protocol_t::write_t &write,
+               rdb_protocol_t::write_response_t *response,
+               order_token_t tok,
+               signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        inner->write(write, response, tok, interruptor);
+    }
+
+    std::set<rdb_protocol_t::region_t> get_sharding_scheme() THROWS_ONLY(cannot_perform_query_exc_t) {
+        if (scheme.empty()) {
+            throw cannot_perform_query_exc_t("cannot compute sharding scheme");
+        }
+        return scheme;
+    }
+
+    bool reads_fail;
+    // The next this many primary key rgets get back a truncated chunk with no
+    // rows, as if a filter had dropped every row in it.
+    int empty_chunks;
+
+private:
+    bool answer_with_empty_chunk(const rdb_protocol_t::read_t &read,
+                                 rdb_protocol_t::read_response_t *response) {
+        const rdb_protocol_t::rget_read_t *rget = boost::get<rdb_protocol_t::rget_read_t>(&read.read);
+        if (empty_chunks == 0 || rget == NULL || rget->sindex) {
+            return false;
+        }
+        --empty_chunks;
+        // The chunk only got as far as the first key of the range, so no row is lost.
+        response->response = rdb_protocol_t::rget_read_response_t(
+            rget->region.inner, rdb_protocol_t::rget_read_response_t::stream_t(),
+            0, true, rget->region.inner.left);
+        return true;
+    }
+
+    namespace_interface_t<rdb_protocol_t> *inner;
+    std::set<rdb_protocol_t::region_t> scheme;
+};
+
+/* Hands out the one namespace interface it was given. */
+class single_namespace_repo_t : public base_namespace_repo_t<rdb_protocol_t> {
+public:
+    explicit single_namespace_repo_t(namespace_interface_t<rdb_protocol_t> *nsi) {
+        entry.namespace_if.pulse(nsi);
+        entry.ref_count = 0;
+        entry.pulse_when_ref_count_becomes_zero = NULL;
+        entry.pulse_when_ref_count_becomes_nonzero = NULL;
+    }
+
+private:
+    namespace_cache_entry_t *get_cache_entry(UNUSED const uuid_u &ns_id) {
+        return &entry;
+    }
+
+    namespace_cache_entry_t entry;
+};
+
+const int num_rget_stream_rows = 100;
+
+/* Row `i` has `sid` `(i * 37) % num_rget_stream_rows`, so the rows' order in a
+`sid` index interleaves the shards. */
+void insert_rget_stream_rows(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    for (int i = 0; i < num_rget_stream_rows; ++i) {
+        boost::shared_ptr<scoped_cJSON_t> data(new scoped_cJSON_t(cJSON_CreateObject()));
+        cJSON_AddItemToObject(data->get(), "id", cJSON_CreateNumber(i));
+        cJSON_AddItemToObject(data->get(), "sid", cJSON_CreateNumber((i * 37) % num_rget_stream_rows));
+        store_key_t pk(make_counted<const ql::datum_t>(static_cast<double>(i))->print_primary());
+
+        rdb_protocol_t::write_t write(rdb_protocol_t::point_write_t(pk, data));
+        rdb_protocol_t::write_response_t response;
+
+        cond_t interruptor;
+        nsi->write(write, &response, osource->check_in("unittest::insert_rget_stream_rows(rdb_protocol_t.cc-A"), &interruptor);
+    }
+}
+
+/* Two shards split in the middle of the rows' primary keys. */
+std::set<rdb_protocol_t::region_t> rget_stream_scheme() {
+    store_key_t split(make_counted<const ql::datum_t>(static_cast<double>(num_rget_stream_rows / 2))->print_primary());
+    std::set<rdb_protocol_t::region_t> scheme;
+    scheme.insert(rdb_protocol_t::region_t(key_range_t(key_range_t::none, store_key_t(), key_range_t::open, split)));
+    scheme.insert(rdb_protocol_t::region_t(key_range_t(key_range_t::closed, split, key_range_t::none, store_key_t())));
+    return scheme;
+}
+
+std::vector<double> read_rget_stream(query_language::batched_rget_stream_t *stream,
+                                     const char *field) {
+    std::vector<double> values;
+    while (boost::shared_ptr<scoped_cJSON_t> row = stream->next()) {
+        values.push_back(cJSON_GetObjectItem(row->get(), field)->valuedouble);
+    }
+    return values;
+}
+
+void run_rget_stream_order_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    std::string sindex_id = create_sindex(nsi, osource);
+    insert_rget_stream_rows(nsi, osource);
+
+    rget_stream_namespace_interface_t test_nsi(nsi, rget_stream_scheme());
+    single_namespace_repo_t repo(&test_nsi);
+    cond_t interruptor;
+    namespace_repo_t<rdb_protocol_t>::access_t access(&repo, generate_uuid(), &interruptor);
+    std::map<std::string, ql::wire_func_t> optargs;
+
+    {
+        /* Both shards have rows all over the sindex; the merge has to put them
+        in order. */
+        boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+            boost::make_shared<query_language::batched_rget_stream_t>(
+                access, &interruptor, sindex_id, optargs, false,
+                counted_t<const ql::datum_t>(), counted_t<const ql::datum_t>());
+        std::vector<double> sids = read_rget_stream(stream.get(), "sid");
+        ASSERT_EQ(static_cast<size_t>(num_rget_stream_rows), sids.size());
+        for (int i = 0; i < num_rget_stream_rows; ++i) {
+            EXPECT_EQ(static_cast<double>(i), sids[i]);
+        }
+    }
+
+    {
+        boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+            boost::make_shared<query_language::batched_rget_stream_t>(
+                access, &interruptor, counted_t<const ql::datum_t>(),
+                counted_t<const ql::datum_t>(), optargs, false, true);
+        std::vector<double> ids = read_rget_stream(stream.get(), "id");
+        ASSERT_EQ(static_cast<size_t>(num_rget_stream_rows), ids.size());
+        for (int i = 0; i < num_rget_stream_rows; ++i) {
+            EXPECT_EQ(static_cast<double>(i), ids[i]);
+        }
+    }
+}
+
+TEST(RDBProtocol, RgetStreamOrder) {
+    run_in_thread_pool_with_namespace_interface(&run_rget_stream_order_test, false);
+}
+
+void run_rget_stream_unordered_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    insert_rget_stream_rows(nsi, osource);
+
+    rget_stream_namespace_interface_t test_nsi(nsi, rget_stream_scheme());
+    single_namespace_repo_t repo(&test_nsi);
+    cond_t interruptor;
+    namespace_repo_t<rdb_protocol_t>::access_t access(&repo, generate_uuid(), &interruptor);
+
+    boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+        boost::make_shared<query_language::batched_rget_stream_t>(
+            access, &interruptor, counted_t<const ql::datum_t>(),
+            counted_t<const ql::datum_t>(), std::map<std::string, ql::wire_func_t>(),
+            false, false);
+    std::vector<double> ids = read_rget_stream(stream.get(), "id");
+    ASSERT_EQ(static_cast<size_t>(num_rget_stream_rows), ids.size());
+    std::sort(ids.begin(), ids.end());
+    for (int i = 0; i < num_rget_stream_rows; ++i) {
+        EXPECT_EQ(static_cast<double>(i), ids[i]);
+    }
+}
+
+TEST(RDBProtocol, RgetStreamUnordered) {
+    run_in_thread_pool_with_namespace_interface(&run_rget_stream_unordered_test, false);
+}
+
+/* A table with more than one replica, or one that is missing a master, has no
+sharding scheme; the stream reads it as a single shard. */
+void run_rget_stream_no_scheme_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    std::string sindex_id = create_sindex(nsi, osource);
+    insert_rget_stream_rows(nsi, osource);
+
+    rget_stream_namespace_interface_t test_nsi(nsi, std::set<rdb_protocol_t::region_t>());
+    single_namespace_repo_t repo(&test_nsi);
+    cond_t interruptor;
+    namespace_repo_t<rdb_protocol_t>::access_t access(&repo, generate_uuid(), &interruptor);
+    std::map<std::string, ql::wire_func_t> optargs;
+
+    for (int ordered = 0; ordered < 2; ++ordered) {
+        boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+            boost::make_shared<query_language::batched_rget_stream_t>(
+                access, &interruptor, counted_t<const ql::datum_t>(),
+                counted_t<const ql::datum_t>(), optargs, false, ordered == 1);
+        EXPECT_EQ(static_cast<size_t>(num_rget_stream_rows),
+                  read_rget_stream(stream.get(), "id").size());
+    }
+
+    boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+        boost::make_shared<query_language::batched_rget_stream_t>(
+            access, &interruptor, sindex_id, optargs, false,
+            counted_t<const ql::datum_t>(), counted_t<const ql::datum_t>());
+    EXPECT_EQ(static_cast<size_t>(num_rget_stream_rows),
+              read_rget_stream(stream.get(), "sid").size());
+}
+
+TEST(RDBProtocol, RgetStreamNoShardingScheme) {
+    run_in_thread_pool_with_namespace_interface(&run_rget_stream_no_scheme_test, false);
+}
+
+/* Once a read fails, every later `next()` throws instead of waiting for a read
+that was never sent. */
+void run_rget_stream_error_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    insert_rget_stream_rows(nsi, osource);
+
+    rget_stream_namespace_interface_t test_nsi(nsi, std::set<rdb_protocol_t::region_t>());
+    test_nsi.reads_fail = true;
+    single_namespace_repo_t repo(&test_nsi);
+    cond_t interruptor;
+    namespace_repo_t<rdb_protocol_t>::access_t access(&repo, generate_uuid(), &interruptor);
+
+    for (int ordered = 0; ordered < 2; ++ordered) {
+        boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+            boost::make_shared<query_language::batched_rget_stream_t>(
+                access, &interruptor, counted_t<const ql::datum_t>(),
+                counted_t<const ql::datum_t>(), std::map<std::string, ql::wire_func_t>(),
+                false, ordered == 1);
+        EXPECT_THROW(stream->next(), ql::exc_t);
+        EXPECT_THROW(stream->next(), ql::exc_t);
+    }
+}
+
+TEST(RDBProtocol, RgetStreamError) {
+    run_in_thread_pool_with_namespace_interface(&run_rget_stream_error_test, false);
+}
+
+/* A chunk can come back empty without being the last one, if a filter dropped
+every row in it; the stream has to go on reading until it gets a row. */
+void run_rget_stream_empty_chunks_test(namespace_interface_t<rdb_protocol_t> *nsi, order_source_t *osource) {
+    insert_rget_stream_rows(nsi, osource);
+
+    rget_stream_namespace_interface_t test_nsi(nsi, std::set<rdb_protocol_t::region_t>());
+    single_namespace_repo_t repo(&test_nsi);
+    cond_t interruptor;
+    namespace_repo_t<rdb_protocol_t>::access_t access(&repo, generate_uuid(), &interruptor);
+
+    for (int ordered = 0; ordered < 2; ++ordered) {
+        test_nsi.empty_chunks = 3;
+        boost::shared_ptr<query_language::batched_rget_stream_t> stream =
+            boost::make_shared<query_language::batched_rget_stream_t>(
+                access, &interruptor, counted_t<const ql::datum_t>(),
+                counted_t<const ql::datum_t>(), std::map<std::string, ql::wire_func_t>(),
+                false, ordered == 1);
+        std::vector<double> ids = read_rget_stream(stream.get(), "id");
+        EXPECT_EQ(0, test_nsi.empty_chunks);
+        ASSERT_EQ(static_cast<size_t>(num_rget_stream_rows), ids.size());
+        if (ordered == 0) {
+            std::sort(ids.begin(), ids.end());
+        }
+        for (int i = 0; i < num_rget_stream_rows; ++i) {
+            EXPECT_EQ(static_cast<double>(i), ids[i]);
+        }
+    }
+}
+
+TEST(RDBProtocol, RgetStreamEmptyChunks) {
+    run_in_thread_pool_with_namespace_interface(&run_rget_stream_empty_chunks_test, false);
+}
+
+TEST(RDBProtocol, RgetStreamChunkSize) {
+    const ticks_t fast = 0;
+    const ticks_t slow = secs_to_ticks(1);
+    const size_t initial = RDB_RGET_INITIAL_CHUNK_BYTES;
+
+    /* The chunk size doubles when the caller had to wait for a chunk that was
+    quick to read, and halves when a chunk was slow to read. */
+    EXPECT_EQ(2 * initial, query_language::adapt_rget_chunk_bytes(initial, true, fast, true));
+    EXPECT_EQ(initial, query_language::adapt_rget_chunk_bytes(initial, true, fast, false));
+    EXPECT_EQ(initial / 2, query_language::adapt_rget_chunk_bytes(initial, true, slow, true));
+    EXPECT_EQ(initial / 2, query_language::adapt_rget_chunk_bytes(initial, true, slow, false));
+
+    /* A chunk that wasn't truncated says nothing about how long a full one takes. */
+    EXPECT_EQ(initial, query_language::adapt_rget_chunk_bytes(initial, false, fast, true));
+    EXPECT_EQ(initial, query_language::adapt_rget_chunk_bytes(initial, false, slow, true));
+
+    /* It stays between the bounds however long it keeps growing or shrinking. */
+    size_t bytes = initial;
+    for (int i = 0; i < 20; ++i) {
+        bytes = query_language::adapt_rget_chunk_bytes(bytes, true, fast, true);
+    }
+    EXPECT_EQ(static_cast<size_t>(RDB_RGET_MAX_CHUNK_BYTES), bytes);
+    for (int i = 0; i < 20; ++i) {
+        bytes = query_language::adapt_rget_chunk_bytes(bytes, true, slow, true);
+    }
+    EXPECT_EQ(static_cast<size_t>(RDB_RGET_MIN_CHUNK_BYTES), bytes);
+}
+
 }   /* namespace unittest */
 
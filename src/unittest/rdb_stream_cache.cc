@@ -0,0 +1,172 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "rdb_protocol/counted_term.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/stream_cache.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* A stream of `num_datums` strings of `datum_bytes` bytes each, which counts how
+many it has handed out and fails when asked for datum number `fail_at`. */
+class counting_datum_stream_t : public ql::eager_datum_stream_t {
+public:
+    counting_datum_stream_t(ql::env_t *env, const ql::protob_t<const Backtrace> &bt,
+                            size_t _num_datums, size_t _datum_bytes)
+        : ql::eager_datum_stream_t(env, bt), num_read(0), fail_at(_num_datums + 1),
+          num_datums(_num_datums), datum_bytes(_datum_bytes) { }
+
+    size_t num_read;
+    size_t fail_at;
+
+private:
+    counted_t<const ql::datum_t> next_impl() {
+        if (num_read == fail_at) {
+            rfail("counting_datum_stream_t failed on purpose.");
+        }
+        if (num_read == num_datums) {
+            return counted_t<const ql::datum_t>();
+        }
+        ++num_read;
+        return make_counted<ql::datum_t>(std::string(datum_bytes, 'x'));
+    }
+
+    size_t num_datums;
+    size_t datum_bytes;
+};
+
+counted_t<counting_datum_stream_t> insert_stream(ql::stream_cache2_t *cache, int64_t key,
+                                                 signal_t *interruptor,
+                                                 size_t num_datums, size_t datum_bytes) {
+    ql::protob_t<Term> term = ql::make_counted_term();
+    ql::protob_t<const Backtrace> bt = term.make_child(&term->GetExtension(ql2::extension::backtrace));
+    scoped_ptr_t<ql::env_t> env(new ql::env_t(interruptor));
+    counted_t<counting_datum_stream_t> stream =
+        make_counted<counting_datum_stream_t>(env.get(), bt, num_datums, datum_bytes);
+    cache->insert(key, &env, counted_t<ql::datum_stream_t>(stream.get()));
+    return stream;
+}
+
+/* The datums are big enough that the byte limit, not the datum count, ends the
+chunks. */
+const size_t big_datum_bytes = 300 * KILOBYTE;
+
+void run_prefetch_test() {
+    cond_t interruptor;
+    ql::stream_cache2_t cache;
+    counted_t<counting_datum_stream_t> stream = insert_stream(&cache, 0, &interruptor, 100, big_datum_bytes);
+
+    Response first;
+    ASSERT_TRUE(cache.serve(0, &first, &interruptor));
+    EXPECT_EQ(Response::SUCCESS_PARTIAL, first.type());
+    size_t served = first.response_size();
+
+    /* Let the prefetch run. It reads the next chunk before the client asks for it. */
+    coro_t::yield();
+    size_t read_ahead = stream->num_read;
+    EXPECT_GT(read_ahead, served + 1);
+
+    /* So the next chunk comes straight out of the buffer. */
+    Response second;
+    ASSERT_TRUE(cache.serve(0, &second, &interruptor));
+    EXPECT_EQ(Response::SUCCESS_PARTIAL, second.type());
+    EXPECT_EQ(read_ahead, stream->num_read);
+    EXPECT_EQ(served, static_cast<size_t>(second.response_size()));
+
+    cache.erase(0);
+    EXPECT_FALSE(cache.contains(0));
+}
+
+TEST(RDBStreamCache, Prefetch) {
+    run_in_thread_pool(&run_prefetch_test);
+}
+
+void run_prefetch_budget_test() {
+    cond_t interruptor;
+    ql::stream_cache2_t cache;
+
+    /* Together these streams would read ahead much more than the budget. */
+    const int num_streams = 2 * RDB_STREAM_CACHE_PREFETCH_BUDGET_BYTES / MEGABYTE;
+    std::vector<counted_t<counting_datum_stream_t> > streams;
+    std::vector<size_t> served;
+    for (int i = 0; i < num_streams; ++i) {
+        streams.push_back(insert_stream(&cache, i, &interruptor, 100, big_datum_bytes));
+        Response res;
+        ASSERT_TRUE(cache.serve(i, &res, &interruptor));
+        served.push_back(res.response_size());
+        coro_t::yield();
+    }
+
+    /* The first streams got to read ahead; once the budget was used up, the others
+    only hold the one datum `serve()` reads past the end of a chunk. */
+    EXPECT_GT(streams.front()->num_read, served.front() + 1);
+    EXPECT_EQ(served.back() + 1, streams.back()->num_read);
+
+    int64_t buffered_bytes = 0;
+    for (int i = 0; i < num_streams; ++i) {
+        buffered_bytes += (streams[i]->num_read - served[i]) * big_datum_bytes;
+    }
+    EXPECT_LT(buffered_bytes, RDB_STREAM_CACHE_PREFETCH_BUDGET_BYTES
+                              + num_streams * static_cast<int64_t>(big_datum_bytes));
+}
+
+TEST(RDBStreamCache, PrefetchBudget) {
+    run_in_thread_pool(&run_prefetch_budget_test);
+}
+
+void run_prefetch_error_test() {
+    cond_t interruptor;
+    ql::stream_cache2_t cache;
+    counted_t<counting_datum_stream_t> stream = insert_stream(&cache, 0, &interruptor, 100, big_datum_bytes);
+
+    Response first;
+    ASSERT_TRUE(cache.serve(0, &first, &interruptor));
+
+    /* The prefetch's first read fails. The error goes to the next `CONTINUE`,
+    and the stream is dropped. */
+    stream->fail_at = stream->num_read;
+    coro_t::yield();
+    EXPECT_TRUE(cache.contains(0));
+
+    Response second;
+    UNUSED bool served;
+    EXPECT_THROW(served = cache.serve(0, &second, &interruptor), ql::exc_t);
+    EXPECT_FALSE(cache.contains(0));
+}
+
+TEST(RDBStreamCache, PrefetchError) {
+    run_in_thread_pool(&run_prefetch_error_test);
+}
+
+void run_concurrent_erase_test() {
+    cond_t interruptor;
+    ql::stream_cache2_t cache;
+    insert_stream(&cache, 0, &interruptor, 100, big_datum_bytes);
+
+    Response first;
+    ASSERT_TRUE(cache.serve(0, &first, &interruptor));
+
+    /* Both wait for the prefetch; whichever runs second finds the stream gone. */
+    coro_t::spawn_now_dangerously(boost::bind(&ql::stream_cache2_t::erase, &cache, 0));
+    coro_t::spawn_now_dangerously(boost::bind(&ql::stream_cache2_t::erase, &cache, 0));
+    EXPECT_TRUE(cache.contains(0));
+    for (int i = 0; i < 3; ++i) {
+        coro_t::yield();
+    }
+    EXPECT_FALSE(cache.contains(0));
+}
+
+TEST(RDBStreamCache, ConcurrentErase) {
+    run_in_thread_pool(&run_concurrent_erase_test);
+}
+
+}   /* namespace unittest */
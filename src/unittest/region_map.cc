@@ -3,6 +3,7 @@
 
 #include "mock/dummy_protocol.hpp"
 #include "protocol_api.hpp"
+#include "region_map_index.hpp"
 
 namespace unittest {
 using mock::dummy_protocol_t;
@@ -44,4 +45,126 @@ TEST(RegionMap, Mask) {
         }
     }
 }
+TEST(RegionMapIndex, Dummy) {
+    region_map_t<dummy_protocol_t, int> rmap(dummy_protocol_t::region_t('a', 'z'), 0);
+    rmap.set(dummy_protocol_t::region_t('a', 'm'), 1);
+    rmap.set(dummy_protocol_t::region_t('n', 'z'), 2);
+    region_map_index_t<dummy_protocol_t, int> index(&rmap);
+
+    std::vector<size_t> positions;
+    index.find_overlapping(dummy_protocol_t::region_t('k', 'p'), &positions);
+    EXPECT_EQ(2u, positions.size());
+
+    positions.clear();
+    index.find_overlapping(dummy_protocol_t::region_t('q', 'r'), &positions);
+    ASSERT_EQ(1u, positions.size());
+    EXPECT_EQ(2, rmap.get_nth(positions[0]).second);
+}
+
+/* Real tables are sharded by `hash_region_t<key_range_t>`, which is the case
+that `region_index_t` speeds up. This is all `region_map_t` needs from a
+protocol. */
+struct hash_region_protocol_t {
+    typedef hash_region_t<key_range_t> region_t;
+};
+
+static store_key_t shard_key(int i) {
+    return store_key_t(strprintf("key%05d", i));
+}
+
+/* Makes a region map with `num_shards` shards, each worth its own number. The
+shard at `split_shard` is also split in two by hash value. */
+static region_map_t<hash_region_protocol_t, int> make_sharded_map(int num_shards, int split_shard) {
+    std::vector<std::pair<hash_region_t<key_range_t>, int> > pairs;
+    for (int i = 0; i < num_shards; ++i) {
+        key_range_t range;
+        range.left = i == 0 ? store_key_t::min() : shard_key(i);
+        range.right = i + 1 < num_shards
+            ? key_range_t::right_bound_t(shard_key(i + 1))
+            : key_range_t::right_bound_t();
+        if (i == split_shard) {
+            pairs.push_back(std::make_pair(hash_region_t<key_range_t>(0, HASH_REGION_HASH_SIZE / 2, range), i));
+            pairs.push_back(std::make_pair(hash_region_t<key_range_t>(HASH_REGION_HASH_SIZE / 2, HASH_REGION_HASH_SIZE, range), -i));
+        } else {
+            pairs.push_back(std::make_pair(hash_region_t<key_range_t>(range), i));
+        }
+    }
+    return region_map_t<hash_region_protocol_t, int>(pairs.begin(), pairs.end());
+}
+
+static void find_overlapping_linearly(const region_map_t<hash_region_protocol_t, int> &rmap,
+                                      const hash_region_t<key_range_t> &region,
+                                      std::vector<size_t> *positions_out) {
+    for (size_t i = 0; i < rmap.size(); ++i) {
+        if (region_overlaps(rmap.get_nth(i).first, region)) {
+            positions_out->push_back(i);
+        }
+    }
+}
+
+TEST(RegionMapIndex, HashRegions) {
+    const int num_shards = 100;
+    region_map_t<hash_region_protocol_t, int> rmap = make_sharded_map(num_shards, 42);
+    region_map_index_t<hash_region_protocol_t, int> index(&rmap);
+
+    std::vector<hash_region_t<key_range_t> > queries;
+    for (int i = 0; i < num_shards; i += 7) {
+        /* A single key, a key between shard boundaries, a range across several
+        shards, and one that runs off the end of the table. */
+        queries.push_back(hash_region_t<key_range_t>(key_range_t(key_range_t::closed, shard_key(i), key_range_t::closed, shard_key(i))));
+        store_key_t middle(strprintf("key%05da", i));
+        queries.push_back(hash_region_t<key_range_t>(key_range_t(key_range_t::closed, middle, key_range_t::closed, middle)));
+        queries.push_back(hash_region_t<key_range_t>(key_range_t(key_range_t::open, middle, key_range_t::open, shard_key(i + 5))));
+        queries.push_back(hash_region_t<key_range_t>(key_range_t(key_range_t::closed, middle, key_range_t::none, store_key_t())));
+    }
+    queries.push_back(hash_region_t<key_range_t>::universe());
+    /* Only the first half of the split shard's hash range. */
+    queries.push_back(hash_region_t<key_range_t>(0, 1000, key_range_t(key_range_t::closed, shard_key(42), key_range_t::open, shard_key(44))));
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        std::vector<size_t> expected, actual;
+        find_overlapping_linearly(rmap, queries[i], &expected);
+        index.find_overlapping(queries[i], &actual);
+        EXPECT_TRUE(expected == actual) << "query " << i;
+    }
+}
+
+TEST(RegionMapIndex, Benchmark) {
+    const int num_shards = 500;
+    const int num_lookups = 20000;
+    region_map_t<hash_region_protocol_t, int> rmap = make_sharded_map(num_shards, -1);
+    region_map_index_t<hash_region_protocol_t, int> index(&rmap);
+
+    std::vector<hash_region_t<key_range_t> > queries;
+    for (int i = 0; i < num_lookups; ++i) {
+        store_key_t key(strprintf("key%05d", (i * 7919) % num_shards));
+        queries.push_back(hash_region_t<key_range_t>(key_range_t(key_range_t::closed, key, key_range_t::closed, key)));
+    }
+
+    size_t found_linearly = 0, found_by_index = 0;
+    std::vector<size_t> positions;
+
+    ticks_t start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        positions.clear();
+        find_overlapping_linearly(rmap, queries[i], &positions);
+        found_linearly += positions.size();
+    }
+    ticks_t linear_ticks = get_ticks() - start;
+
+    start = get_ticks();
+    for (int i = 0; i < num_lookups; ++i) {
+        positions.clear();
+        index.find_overlapping(queries[i], &positions);
+        found_by_index += positions.size();
+    }
+    ticks_t index_ticks = get_ticks() - start;
+
+    EXPECT_EQ(static_cast<size_t>(num_lookups), found_linearly);
+    EXPECT_EQ(found_linearly, found_by_index);
+    RecordProperty("linear_ns_per_lookup", static_cast<int>(linear_ticks / num_lookups));
+    RecordProperty("index_ns_per_lookup", static_cast<int>(index_ticks / num_lookups));
+    EXPECT_LT(index_ticks, linear_ticks);
+}
+
 } //namespace unittest
@@ -1,9 +1,12 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <stdio.h>
+
 #include "errors.hpp"
 #include <boost/bind.hpp>
 
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "rpc/connectivity/cluster.hpp"
@@ -196,6 +199,115 @@ TEST(RPCConnectivityTest, OrderingMultiThread) {
     unittest::run_in_thread_pool(&run_ordering_test, 3);
 }
 
+/* `keyed_test_application_t` sends `(key, sequence number)` pairs with the key
+as the ordering key, the way mailbox messages are sent. It checks that the
+messages for each key arrive in the order they were sent in. */
+
+class keyed_test_application_t : public home_thread_mixin_t, public message_handler_t {
+public:
+    explicit keyed_test_application_t(message_service_t *s) :
+        service(s), num_received(0), num_out_of_order(0) { }
+
+    void send(uint64_t key, int64_t seq, peer_id_t peer) {
+        class writer_t : public send_message_write_callback_t {
+        public:
+            writer_t(uint64_t _key, int64_t _seq) : key(_key), seq(_seq) { }
+            virtual ~writer_t() { }
+            void write(write_stream_t *stream) {
+                write_message_t msg;
+                msg << key;
+                msg << seq;
+                int res = send_write_message(stream, &msg);
+                if (res) { throw fake_archive_exc_t(); }
+            }
+            uint64_t get_ordering_key() { return key; }
+            uint64_t key;
+            int64_t seq;
+        } writer(key, seq);
+        service->send_message(peer, &writer);
+    }
+
+    int64_t get_num_received() {
+        assert_thread();
+        return num_received;
+    }
+    int64_t get_num_out_of_order() {
+        assert_thread();
+        return num_out_of_order;
+    }
+
+private:
+    void on_message(UNUSED peer_id_t peer, read_stream_t *stream) {
+        uint64_t key;
+        int64_t seq;
+        int res = deserialize(stream, &key);
+        if (res) { throw fake_archive_exc_t(); }
+        res = deserialize(stream, &seq);
+        if (res) { throw fake_archive_exc_t(); }
+        on_thread_t th(home_thread());
+        std::map<uint64_t, int64_t>::iterator it = last_seq.find(key);
+        if (it != last_seq.end() && it->second + 1 != seq) {
+            ++num_out_of_order;
+        }
+        last_seq[key] = seq;
+        ++num_received;
+    }
+
+    message_service_t *service;
+    std::map<uint64_t, int64_t> last_seq;
+    int64_t num_received;
+    int64_t num_out_of_order;
+};
+
+/* `KeyedThroughput` sends lots of messages with many different ordering keys
+from every thread at once, which spreads them over all the connections to the
+peer. It checks that messages with the same key stay in order, and prints how
+many messages per second got through. */
+
+static const int keyed_keys_per_thread = 16;
+static const int keyed_messages_per_key = 500;
+
+void send_keyed_messages(keyed_test_application_t *app, peer_id_t peer, int thread) {
+    on_thread_t th(thread);
+    for (int64_t seq = 0; seq < keyed_messages_per_key; ++seq) {
+        for (int k = 0; k < keyed_keys_per_thread; ++k) {
+            app->send(1 + thread * keyed_keys_per_thread + k, seq, peer);
+        }
+    }
+}
+
+void run_keyed_throughput_test() {
+    connectivity_cluster_t c1, c2;
+    keyed_test_application_t a1(&c1), a2(&c2);
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), ANY_PORT, &a1, 0, NULL);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), ANY_PORT, &a2, 0, NULL);
+
+    cr1.join(c2.get_peer_address(c2.get_me()));
+
+    let_stuff_happen();
+
+    const int64_t num_messages = static_cast<int64_t>(get_num_threads()) *
+        keyed_keys_per_thread * keyed_messages_per_key;
+    const ticks_t start = get_ticks();
+    pmap(get_num_threads(), boost::bind(&send_keyed_messages, &a1, c2.get_me(), _1));
+    for (int i = 0; i < 1000 && a2.get_num_received() < num_messages; ++i) {
+        nap(10);
+    }
+    const double secs = ticks_to_secs(get_ticks() - start);
+
+    EXPECT_EQ(num_messages, a2.get_num_received());
+    EXPECT_EQ(0, a2.get_num_out_of_order());
+
+    printf("cluster messages, %2d threads: %12.0f messages/sec\n",
+           get_num_threads(), num_messages / secs);
+}
+TEST(RPCConnectivityTest, KeyedThroughput) {
+    unittest::run_in_thread_pool(&run_keyed_throughput_test);
+}
+TEST(RPCConnectivityTest, KeyedThroughputMultiThread) {
+    unittest::run_in_thread_pool(&run_keyed_throughput_test, 4);
+}
+
 /* `GetPeersList` confirms that the behavior of `cluster_t::get_peers_list()` is
 correct. */
 
@@ -484,6 +596,121 @@ TEST(RPCConnectivityTest, Multiplexer) {
     unittest::run_in_thread_pool(&run_multiplexer_test);
 }
 
+/* `Compression` sends messages of all sizes between two nodes that compress big
+messages and one that has compression turned off, and makes sure that they all
+arrive intact and in order. */
+
+class string_test_application_t : public home_thread_mixin_t, public message_handler_t {
+public:
+    explicit string_test_application_t(message_service_t *s) : service(s) { }
+    void send(const std::string &message, peer_id_t peer) {
+        class writer_t : public send_message_write_callback_t {
+        public:
+            explicit writer_t(const std::string *_data) : data(_data) { }
+            virtual ~writer_t() { }
+            void write(write_stream_t *stream) {
+                write_message_t msg;
+                msg << *data;
+                int res = send_write_message(stream, &msg);
+                if (res) { throw fake_archive_exc_t(); }
+            }
+            const std::string *data;
+        } writer(&message);
+        service->send_message(peer, &writer);
+    }
+    std::map<peer_id_t, std::vector<std::string> > inbox;
+
+private:
+    void on_message(peer_id_t peer, read_stream_t *stream) {
+        std::string message;
+        int res = deserialize(stream, &message);
+        if (res) { throw fake_archive_exc_t(); }
+        on_thread_t th(home_thread());
+        inbox[peer].push_back(message);
+    }
+
+    message_service_t *service;
+};
+
+/* Every third message is random and won't compress; the others are repetitive. */
+std::string make_compression_test_message(int i) {
+    std::string message;
+    const size_t size = (i * 7919) % 40000;
+    while (message.size() < size) {
+        if (i % 3 == 0) {
+            message.push_back(static_cast<char>(randint(256)));
+        } else {
+            message += strprintf("{\"id\": %d, \"payload\": \"%zu\"}", i, message.size());
+        }
+    }
+    return message;
+}
+
+void run_compression_test() {
+    connectivity_cluster_t c1, c2, c3;
+    string_test_application_t a1(&c1), a2(&c2), a3(&c3);
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), ANY_PORT, &a1, 0, NULL);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), ANY_PORT, &a2, 0, NULL);
+    connectivity_cluster_t::run_t cr3(&c3, get_unittest_addresses(), ANY_PORT, &a3, 0, NULL, false);
+    cr2.join(c1.get_peer_address(c1.get_me()));
+    cr3.join(c1.get_peer_address(c1.get_me()));
+
+    let_stuff_happen();
+
+    std::vector<std::string> messages;
+    for (int i = 0; i < 60; ++i) {
+        messages.push_back(make_compression_test_message(i));
+    }
+    for (size_t i = 0; i < messages.size(); ++i) {
+        a1.send(messages[i], c2.get_me());
+        a1.send(messages[i], c3.get_me());
+        a2.send(messages[i], c1.get_me());
+        a3.send(messages[i], c1.get_me());
+    }
+
+    let_stuff_happen();
+
+    EXPECT_TRUE(messages == a2.inbox[c1.get_me()]);
+    EXPECT_TRUE(messages == a3.inbox[c1.get_me()]);
+    EXPECT_TRUE(messages == a1.inbox[c2.get_me()]);
+    EXPECT_TRUE(messages == a1.inbox[c3.get_me()]);
+}
+TEST(RPCConnectivityTest, Compression) {
+    unittest::run_in_thread_pool(&run_compression_test);
+}
+TEST(RPCConnectivityTest, CompressionMultiThread) {
+    unittest::run_in_thread_pool(&run_compression_test, 3);
+}
+
+/* `CompressionStream` checks that messages that are deflated one after another
+can be inflated one after another, and that corrupt data is caught. */
+
+TEST(RPCConnectivityTest, CompressionStream) {
+    message_deflater_t deflater;
+    message_inflater_t inflater;
+    for (int i = 1; i < 30; ++i) {
+        std::string message = make_compression_test_message(i);
+        std::vector<char> compressed;
+        deflater.deflate_message(message.data(), message.size(), &compressed);
+        if (i % 3 != 0) {
+            EXPECT_LT(compressed.size(), message.size() / 4);
+        }
+        std::vector<char> uncompressed(message.size());
+        ASSERT_TRUE(inflater.inflate_message(compressed.data(), compressed.size(),
+                                             uncompressed.data(), uncompressed.size()));
+        EXPECT_TRUE(std::string(uncompressed.begin(), uncompressed.end()) == message);
+    }
+
+    // An inflater that missed the earlier messages can't make sense of later ones.
+    std::string message = make_compression_test_message(31);
+    std::vector<char> compressed;
+    deflater.deflate_message(message.data(), message.size(), &compressed);
+    message_inflater_t late_inflater;
+    std::vector<char> uncompressed(message.size());
+    EXPECT_FALSE(late_inflater.inflate_message(compressed.data(), compressed.size(),
+                                               uncompressed.data(), uncompressed.size()));
+}
+
 /* `BinaryData` makes sure that any octet can be sent over the wire. */
 
 class binary_test_application_t : public message_handler_t {
@@ -4,6 +4,7 @@
 #include "arch/timing.hpp"
 #include "rpc/connectivity/cluster.hpp"
 #include "rpc/directory/read_manager.hpp"
+#include "rpc/directory/update.hpp"
 #include "rpc/directory/write_manager.hpp"
 #include "unittest/unittest_utils.hpp"
 
@@ -92,6 +93,52 @@ TEST(RPCDirectoryTest, Update) {
     unittest::run_in_thread_pool(&run_update_test, 1);
 }
 
+/* `ManyUpdates` sends enough updates that some of them go out as deltas and some as
+full updates, and checks that the peers end up with the right value. */
+
+void run_many_updates_test() {
+    connectivity_cluster_t c1, c2;
+    directory_read_manager_t<int> rm1(&c1), rm2(&c2);
+    watchable_variable_t<int> w1(0), w2(0);
+    directory_write_manager_t<int> wm1(&c1, w1.get_watchable()), wm2(&c2, w2.get_watchable());
+    connectivity_cluster_t::run_t cr1(&c1, get_unittest_addresses(), ANY_PORT, &rm1, 0, NULL);
+    connectivity_cluster_t::run_t cr2(&c2, get_unittest_addresses(), ANY_PORT, &rm2, 0, NULL);
+    cr2.join(c1.get_peer_address(c1.get_me()));
+    let_stuff_happen();
+    for (int i = 1; i <= 3 * DIRECTORY_FULL_UPDATE_INTERVAL; ++i) {
+        w1.set_value(i);
+    }
+    let_stuff_happen();
+    ASSERT_EQ(1u, rm2.get_root_view()->get().count(c1.get_me()));
+    EXPECT_EQ(3 * DIRECTORY_FULL_UPDATE_INTERVAL, rm2.get_root_view()->get().find(c1.get_me())->second);
+}
+TEST(RPCDirectoryTest, ManyUpdates) {
+    unittest::run_in_thread_pool(&run_many_updates_test, 1);
+}
+
+/* `DeltaUpdate` tests that a delta reproduces the new value and only carries the
+bytes that changed. */
+
+TEST(RPCDirectoryTest, DeltaUpdate) {
+    const std::string old_value = "prefix-old-suffix";
+    const std::string new_value = "prefix-brand-new-suffix";
+    std::string value = old_value;
+    uint64_t version = 7;
+
+    directory_update_t update = directory_update_t::make(8, old_value, new_value, false);
+    EXPECT_FALSE(update.is_full());
+    EXPECT_LT(update.get_size(), new_value.size() + 3 * sizeof(uint64_t));
+    update.apply(&version, &value);
+    EXPECT_EQ(new_value, value);
+    EXPECT_EQ(8u, version);
+
+    directory_update_t full = directory_update_t::make(9, value, old_value, true);
+    EXPECT_TRUE(full.is_full());
+    full.apply(&version, &value);
+    EXPECT_EQ(old_value, value);
+    EXPECT_EQ(9u, version);
+}
+
 /* `DestructorRace` tests a nasty race condition that we had at some point. */
 
 void run_destructor_race_test() {
@@ -0,0 +1,44 @@
+// Copyright 2010-2013 RethinkDB, all rights reserved.
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "concurrency/pmap.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+static const int num_jobs = 64;
+
+void sum_squares(int64_t n, int64_t *sum_out) {
+    int64_t sum = 0;
+    for (int64_t i = 0; i < n; ++i) {
+        sum += i * i;
+    }
+    *sum_out = sum;
+}
+
+void submit_job(int job, int64_t *results) {
+    const int home_thread = get_thread_id();
+    linux_thread_pool_t::run_thread_agnostic(boost::bind(&sum_squares, job * 1000, &results[job]));
+    // We always come back to the thread we submitted from.
+    EXPECT_EQ(home_thread, get_thread_id());
+}
+
+void run_thread_agnostic_jobs_test() {
+    int64_t results[num_jobs];
+    pmap(num_jobs, boost::bind(&submit_job, _1, results));
+
+    for (int job = 0; job < num_jobs; ++job) {
+        int64_t expected;
+        sum_squares(job * 1000, &expected);
+        EXPECT_EQ(expected, results[job]);
+    }
+}
+
+TEST(WorkStealerTest, ThreadAgnosticJobs) {
+    unittest::run_in_thread_pool(&run_thread_agnostic_jobs_test, 4);
+}
+
+}  // namespace unittest
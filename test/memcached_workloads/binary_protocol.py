@@ -0,0 +1,136 @@
+#!/usr/bin/python
+# Copyright 2010-2013 RethinkDB, all rights reserved.
+import sys, os, struct
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import memcached_workload_common
+from vcoptparse import *
+
+GET, SET, ADD, REPLACE, DELETE, INCR, DECR, QUIT = 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+GETQ, NOOP, VERSION, GETK, GETKQ, APPEND, PREPEND = 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+SETQ = 0x11
+
+OK, NOT_FOUND, EXISTS, NOT_STORED, NON_NUMERIC = 0x0000, 0x0001, 0x0002, 0x0005, 0x0006
+
+def request(opcode, key = '', value = '', extras = '', opaque = 0, cas = 0):
+    body = extras + key + value
+    return struct.pack("!BBHBBHIIQ", 0x80, opcode, len(key), len(extras), 0, 0, len(body), opaque, cas) + body
+
+def recv_exactly(s, n):
+    data = ''
+    while len(data) < n:
+        chunk = s.recv(n - len(data))
+        if not chunk:
+            raise ValueError("Connection closed")
+        data += chunk
+    return data
+
+def response(s):
+    magic, opcode, key_len, extras_len, _, status, body_len, opaque, cas = struct.unpack("!BBHBBHIIQ", recv_exactly(s, 24))
+    if magic != 0x81:
+        raise ValueError("Bad response magic: %x" % magic)
+    body = recv_exactly(s, body_len)
+    extras, key, value = body[:extras_len], body[extras_len:extras_len + key_len], body[extras_len + key_len:]
+    return opcode, status, opaque, extras, key, value
+
+def expect(s, opcode, status, value = None, opaque = None):
+    got = response(s)
+    if got[0] != opcode or got[1] != status or (value is not None and got[5] != value) or (opaque is not None and got[2] != opaque):
+        raise ValueError("Expected opcode %x, status %x, value %r; got %r" % (opcode, status, value, got))
+    return got
+
+def storage_extras(flags = 0, exptime = 0):
+    return struct.pack("!II", flags, exptime)
+
+def incr_extras(delta, initial = 0, exptime = 0):
+    return struct.pack("!QQI", delta, initial, exptime)
+
+op = memcached_workload_common.option_parser_for_socket()
+op["num_keys"] = IntFlag("--num-keys", 1000)
+opts = op.parse(sys.argv)
+
+with memcached_workload_common.make_socket_connection(opts) as s:
+    print "Basic commands"
+
+    s.send(request(SET, "foo", "bar", storage_extras(flags = 123)))
+    expect(s, SET, OK)
+    s.send(request(GET, "foo"))
+    _, _, _, extras, key, _ = expect(s, GET, OK, "bar")
+    if struct.unpack("!I", extras)[0] != 123 or key != "":
+        raise ValueError("Bad flags or key in get response: %r %r" % (extras, key))
+    s.send(request(GETK, "foo"))
+    if expect(s, GETK, OK, "bar")[4] != "foo":
+        raise ValueError("getk didn't return the key")
+
+    s.send(request(ADD, "foo", "baz", storage_extras()))
+    expect(s, ADD, EXISTS)
+    s.send(request(REPLACE, "nonexistent", "baz", storage_extras()))
+    expect(s, REPLACE, NOT_FOUND)
+    s.send(request(APPEND, "foo", "!"))
+    expect(s, APPEND, OK)
+    s.send(request(PREPEND, "foo", "<"))
+    expect(s, PREPEND, OK)
+    s.send(request(GET, "foo"))
+    expect(s, GET, OK, "<bar!")
+    s.send(request(APPEND, "nonexistent", "!"))
+    expect(s, APPEND, NOT_STORED)
+
+    s.send(request(INCR, "counter", extras = incr_extras(5, 10)))
+    expect(s, INCR, OK, struct.pack("!Q", 10))
+    s.send(request(INCR, "counter", extras = incr_extras(5, 10)))
+    expect(s, INCR, OK, struct.pack("!Q", 15))
+    s.send(request(DECR, "counter", extras = incr_extras(3)))
+    expect(s, DECR, OK, struct.pack("!Q", 12))
+    s.send(request(INCR, "nonexistent", extras = incr_extras(1, 0, 0xffffffff)))
+    expect(s, INCR, NOT_FOUND)
+    s.send(request(INCR, "foo", extras = incr_extras(1)))
+    expect(s, INCR, NON_NUMERIC)
+
+    s.send(request(DELETE, "foo"))
+    expect(s, DELETE, OK)
+    s.send(request(DELETE, "foo"))
+    expect(s, DELETE, NOT_FOUND)
+    s.send(request(GET, "foo"))
+    expect(s, GET, NOT_FOUND)
+
+    s.send(request(VERSION))
+    expect(s, VERSION, OK)
+
+    print "Pipelined quiet commands"
+
+    # Quiet sets don't answer if they succeed, so the only response should be
+    # the noop's.
+    batch = ''
+    for i in xrange(opts["num_keys"]):
+        batch += request(SETQ, str(i), str(i * 2), storage_extras(), opaque = i)
+    batch += request(NOOP, opaque = 0xdeadbeef)
+    s.send(batch)
+    expect(s, NOOP, OK, opaque = 0xdeadbeef)
+
+    # Quiet gets don't answer misses; every other key is missing.
+    batch = ''
+    for i in xrange(opts["num_keys"]):
+        batch += request(GETKQ, str(i), opaque = i)
+        batch += request(GETQ, "missing-" + str(i), opaque = opts["num_keys"] + i)
+    batch += request(NOOP, opaque = 0xdeadbeef)
+    s.send(batch)
+    for i in xrange(opts["num_keys"]):
+        _, _, _, _, key, _ = expect(s, GETKQ, OK, str(i * 2), opaque = i)
+        if key != str(i):
+            raise ValueError("Expected key %r, got %r" % (str(i), key))
+    expect(s, NOOP, OK, opaque = 0xdeadbeef)
+
+    # Increments that create their keys must still answer in request order,
+    # interleaved with the other pipelined commands.
+    batch = ''
+    for i in xrange(opts["num_keys"]):
+        batch += request(INCR, "new-counter-" + str(i), extras = incr_extras(1, i), opaque = 3 * i)
+        batch += request(INCR, "new-counter-" + str(i), extras = incr_extras(1, i), opaque = 3 * i + 1)
+        batch += request(GET, "new-counter-" + str(i), opaque = 3 * i + 2)
+    s.send(batch)
+    for i in xrange(opts["num_keys"]):
+        expect(s, INCR, OK, struct.pack("!Q", i), opaque = 3 * i)
+        expect(s, INCR, OK, struct.pack("!Q", i + 1), opaque = 3 * i + 1)
+        expect(s, GET, OK, str(i + 1), opaque = 3 * i + 2)
+
+    s.send(request(QUIT))
+    expect(s, QUIT, OK)
@@ -0,0 +1,83 @@
+#!/usr/bin/python
+# Copyright 2010-2013 RethinkDB, all rights reserved.
+
+# Measures how many bytes each insert costs as secondary indexes are added to
+# a table, for indexes that store a copy of the whole row and for slim ones
+# that only store the indexed field.
+#
+# The server doesn't count bytes written per insert, so this measures how
+# much the data directory grows while the rows are inserted. Run it against a
+# server started on an empty DATA_DIR; the serializer garbage collects in the
+# background, so the numbers are approximate.
+#
+# Environment variables:
+# HOST: location of server (default = "localhost")
+# PORT: port that server listens for RDB protocol traffic on (default = 28015)
+# DB_NAME: database to create the table in (default = "test")
+# DATA_DIR: data directory of the server (required)
+# ROWS: number of rows to insert (default = 10000)
+# DOC_BYTES: size of the padding in each row (default = 1000)
+
+import os, sys, time
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..', 'drivers', 'python')))
+
+import rethinkdb as r
+
+TABLE_NAME = 'sindex_bytes_written'
+INDEXED_FIELDS = ['a', 'b', 'c', 'd']
+
+def dir_size(path):
+    total = 0
+    for root, dirs, files in os.walk(path):
+        for name in files:
+            total += os.path.getsize(os.path.join(root, name))
+    return total
+
+def bytes_per_insert(db, conn, data_dir, rows, padding, num_indexes, slim):
+    if TABLE_NAME in db.table_list().run(conn):
+        db.table_drop(TABLE_NAME).run(conn)
+    db.table_create(TABLE_NAME).run(conn)
+    table = db.table(TABLE_NAME)
+
+    for field in INDEXED_FIELDS[:num_indexes]:
+        if slim:
+            table.index_create(field, projection=[field]).run(conn)
+        else:
+            table.index_create(field).run(conn)
+
+    # Let the table creation settle before we start measuring.
+    time.sleep(1)
+    before = dir_size(data_dir)
+
+    batch = []
+    for i in xrange(rows):
+        doc = {'id': i, 'padding': padding}
+        for field in INDEXED_FIELDS:
+            doc[field] = i % 100
+        batch.append(doc)
+        if len(batch) == 1000:
+            table.insert(batch).run(conn)
+            batch = []
+    if batch:
+        table.insert(batch).run(conn)
+
+    after = dir_size(data_dir)
+    db.table_drop(TABLE_NAME).run(conn)
+    return float(after - before) / rows
+
+def main():
+    conn = r.connect(os.environ.get('HOST', 'localhost'), int(os.environ.get('PORT', 28015)))
+    db = r.db(os.environ.get('DB_NAME', 'test'))
+    data_dir = os.environ['DATA_DIR']
+    rows = int(os.environ.get('ROWS', 10000))
+    padding = 'x' * int(os.environ.get('DOC_BYTES', 1000))
+
+    print "%-8s %16s %16s" % ("indexes", "full (bytes)", "slim (bytes)")
+    for num_indexes in xrange(len(INDEXED_FIELDS) + 1):
+        full = bytes_per_insert(db, conn, data_dir, rows, padding, num_indexes, False)
+        slim = bytes_per_insert(db, conn, data_dir, rows, padding, num_indexes, True)
+        print "%-8d %16.1f %16.1f" % (num_indexes, full, slim)
+
+if __name__ == '__main__':
+    main()
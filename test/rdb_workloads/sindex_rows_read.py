@@ -0,0 +1,96 @@
+#!/usr/bin/python
+# Copyright 2010-2013 RethinkDB, all rights reserved.
+
+# Compares plans for a query on two fields, depending on which secondary
+# indexes the query uses:
+#  - a single-field index on `a`, with `b` filtered afterwards,
+#  - the intersection of the single-field indexes on `a` and `b`,
+#  - a compound index on `[a, b]`,
+#  - a multi index on the `tags` array.
+#
+# The server doesn't report how many rows a query scanned, so the "index hits"
+# column is the number of rows the plan's index lookups return, counted with
+# separate queries. Anything the plan filters out afterwards was still read.
+#
+# Environment variables:
+# HOST: location of server (default = "localhost")
+# PORT: port that server listens for RDB protocol traffic on (default = 28015)
+# DB_NAME: database to create the table in (default = "test")
+# ROWS: number of rows to insert (default = 10000)
+
+import os, sys, time
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..', 'drivers', 'python')))
+
+import rethinkdb as r
+from rethinkdb.errors import RqlRuntimeError
+
+FIELD_VALUES = 20
+TABLE_NAME = 'sindex_rows_read'
+
+def wait_for_index(table, name, conn):
+    while True:
+        try:
+            table.get_all(0, index=name).count().run(conn)
+            return
+        except RqlRuntimeError:
+            time.sleep(0.1)
+
+def timed(query, conn):
+    start = time.time()
+    result = query.run(conn)
+    return result, time.time() - start
+
+def main():
+    conn = r.connect(os.environ.get('HOST', 'localhost'), int(os.environ.get('PORT', 28015)))
+    db = r.db(os.environ.get('DB_NAME', 'test'))
+    rows = int(os.environ.get('ROWS', 10000))
+
+    if TABLE_NAME in db.table_list().run(conn):
+        db.table_drop(TABLE_NAME).run(conn)
+    db.table_create(TABLE_NAME).run(conn)
+    table = db.table(TABLE_NAME)
+
+    batch = []
+    for i in xrange(rows):
+        a, b = i % FIELD_VALUES, (i / FIELD_VALUES) % FIELD_VALUES
+        batch.append({'id': i, 'a': a, 'b': b, 'tags': ['a%d' % a, 'b%d' % b]})
+        if len(batch) == 1000:
+            table.insert(batch).run(conn)
+            batch = []
+    if batch:
+        table.insert(batch).run(conn)
+
+    table.index_create('a').run(conn)
+    table.index_create('b').run(conn)
+    table.index_create('ab', lambda row: [row['a'], row['b']]).run(conn)
+    table.index_create('tags', multi=True).run(conn)
+    for name in ['a', 'b', 'ab', 'tags']:
+        wait_for_index(table, name, conn)
+
+    a, b = 3, 7
+    plans = [
+        ("index on a, filter on b",
+         [table.get_all(a, index='a').count()],
+         table.get_all(a, index='a').filter({'b': b}).count()),
+        ("intersection of indexes on a and b",
+         [table.get_all(a, index='a').count(), table.get_all(b, index='b').count()],
+         table.get_all(a, index='a').get_all(b, index='b').count()),
+        ("compound index on [a, b]",
+         [table.get_all([a, b], index='ab').count()],
+         table.get_all([a, b], index='ab').count()),
+        ("multi index on tags, filter on b",
+         [table.get_all('a%d' % a, index='tags').count()],
+         table.get_all('a%d' % a, index='tags').filter({'b': b}).count()),
+    ]
+
+    print "%-36s %10s %10s %10s" % ("plan", "index hits", "matches", "seconds")
+    for name, hit_queries, match_query in plans:
+        hits = sum(query.run(conn) for query in hit_queries)
+        matches, seconds = timed(match_query, conn)
+        print "%-36s %10d %10d %10.4f" % (name, hits, matches, seconds)
+
+    db.table_drop(TABLE_NAME).run(conn)
+
+if __name__ == '__main__':
+    main()
@@ -229,6 +229,46 @@ class TestBatching(TestWithConnection):
         self.assertGreaterEqual(len(cursor.chunks), 1)
         self.assertGreaterEqual(len(cursor.chunks[0]), 1)
 
+class TestUnordered(TestWithConnection):
+    # A connection opened with the V0_1_UNORDERED magic number gets each
+    # response as soon as its query is done, so a slow query doesn't hold up
+    # a fast one sent after it.
+    def runTest(self):
+        import socket
+        import struct
+        from rethinkdb import ql2_pb2 as p
+
+        sock = socket.create_connection(('localhost', self.port))
+        sock.sendall(struct.pack("<L", p.VersionDummy.V0_1_UNORDERED))
+
+        def send(token, term):
+            query = p.Query()
+            query.type = p.Query.START
+            query.token = token
+            term.build(query.query)
+            data = query.SerializeToString()
+            sock.sendall(struct.pack("<L", len(data)) + data)
+
+        def recv_exactly(n):
+            data = ''
+            while len(data) < n:
+                chunk = sock.recv(n - len(data))
+                self.assertTrue(chunk)
+                data += chunk
+            return data
+
+        def recv():
+            (size,) = struct.unpack("<L", recv_exactly(4))
+            response = p.Response()
+            response.ParseFromString(recv_exactly(size))
+            return response
+
+        send(1, r.js('var x = 0; for (var i = 0; i < 300000000; ++i) { x += i; } x', timeout=60))
+        send(2, r.expr(2))
+
+        self.assertEqual([2, 1], [recv().token, recv().token])
+        sock.close()
+
 # # TODO: test cursors, streaming large values
 
 if __name__ == '__main__':
@@ -240,6 +280,7 @@ if __name__ == '__main__':
     suite.addTest(loader.loadTestsFromTestCase(TestShutdown))
     suite.addTest(TestPrinting())
     suite.addTest(TestBatching())
+    suite.addTest(TestUnordered())
 
     res = unittest.TextTestRunner(verbosity=2).run(suite)
 